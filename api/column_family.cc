@@ -569,17 +569,20 @@ void set_column_family(http_context& ctx, routes& r) {
         return make_ready_future<json::json_return_type>(0);
     });
 
-    cf::get_speculative_retries.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        //auto id = get_uuid(req->param["name"], ctx.db.local());
-        return make_ready_future<json::json_return_type>(0);
+    cf::get_speculative_retries.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cf_stats(ctx, req->param["name"], &column_family::stats::speculative_retries);
     });
 
-    cf::get_all_speculative_retries.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        return make_ready_future<json::json_return_type>(0);
+    cf::get_all_speculative_retries.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cf_stats(ctx, &column_family::stats::speculative_retries);
+    });
+
+    cf::get_speculative_retries_won.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cf_stats(ctx, req->param["name"], &column_family::stats::speculative_retries_won);
+    });
+
+    cf::get_all_speculative_retries_won.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cf_stats(ctx, &column_family::stats::speculative_retries_won);
     });
 
     cf::get_key_cache_hit_rate.set(r, [] (std::unique_ptr<request> req) {
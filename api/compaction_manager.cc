@@ -21,6 +21,7 @@
 
 #include "compaction_manager.hh"
 #include "api/api-doc/compaction_manager.json.hh"
+#include "sstables/compaction.hh"
 
 namespace api {
 
@@ -37,19 +38,58 @@ static future<json::json_return_type> get_cm_stats(http_context& ctx,
     });
 }
 
+// Describes the running compactions of all shards.
+static future<std::vector<std::map<sstring, sstring>>> get_compactions(http_context& ctx) {
+    auto res = make_lw_shared<std::vector<std::map<sstring, sstring>>>();
+    return ctx.db.map_reduce([res] (std::vector<std::map<sstring, sstring>> compactions) {
+        res->insert(res->end(), compactions.begin(), compactions.end());
+    }, [] (database& db) {
+        std::vector<std::map<sstring, sstring>> compactions;
+        for (auto& c : db.get_compaction_manager().get_compactions()) {
+            compactions.push_back({
+                { "id", c->id.to_sstring() },
+                { "keyspace", c->ks },
+                { "columnfamily", c->cf },
+                { "completed", to_sstring(c->written_bytes) },
+                { "total", to_sstring(c->total_bytes) },
+                { "taskType", "COMPACTION" },
+                { "unit", "bytes" },
+                { "throughput", sprint("%.3f", c->throughput()) },
+            });
+        }
+        return make_ready_future<std::vector<std::map<sstring, sstring>>>(std::move(compactions));
+    }).then([res] {
+        return std::move(*res);
+    });
+}
+
 void set_compaction_manager(http_context& ctx, routes& r) {
-    cm::get_compactions.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        std::vector<cm::jsonmap> map;
-        return make_ready_future<json::json_return_type>(map);
+    cm::get_compactions.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_compactions(ctx).then([] (std::vector<std::map<sstring, sstring>> compactions) {
+            std::vector<cm::jsonmap> res;
+            for (auto& c : compactions) {
+                cm::jsonmap m;
+                for (auto& e : c) {
+                    cm::mapper val;
+                    val.key = e.first;
+                    val.value = e.second;
+                    m.value.push(val);
+                }
+                res.push_back(m);
+            }
+            return make_ready_future<json::json_return_type>(res);
+        });
     });
 
-    cm::get_compaction_summary.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        std::vector<sstring> res;
-        return make_ready_future<json::json_return_type>(res);
+    cm::get_compaction_summary.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_compactions(ctx).then([] (std::vector<std::map<sstring, sstring>> compactions) {
+            std::vector<sstring> res;
+            for (auto& c : compactions) {
+                res.push_back(sprint("%s(%s, %s, %s/%s %s, %s MB/s)", c["taskType"], c["keyspace"], c["columnfamily"],
+                    c["completed"], c["total"], c["unit"], c["throughput"]));
+            }
+            return make_ready_future<json::json_return_type>(res);
+        });
     });
 
     cm::force_user_defined_compaction.set(r, [] (std::unique_ptr<request> req) {
@@ -79,10 +119,8 @@ void set_compaction_manager(http_context& ctx, routes& r) {
         return make_ready_future<json::json_return_type>(0);
     });
 
-    cm::get_bytes_compacted.set(r, [] (std::unique_ptr<request> req) {
-        //TBD
-        unimplemented();
-        return make_ready_future<json::json_return_type>(0);
+    cm::get_bytes_compacted.set(r, [&ctx] (std::unique_ptr<request> req) {
+        return get_cm_stats(ctx, &compaction_manager::stats::bytes_compacted);
     });
 
     cm::get_compaction_history.set(r, [] (std::unique_ptr<request> req) {
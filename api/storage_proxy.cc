@@ -332,6 +332,30 @@ void set_storage_proxy(http_context& ctx, routes& r) {
         return sum_histogram_stats(ctx.sp, &proxy::stats::read);
     });
 
+    sp::get_write_metrics_queued.set(r, [&ctx](std::unique_ptr<request> req) {
+        return ctx.db.map_reduce0([](const database& db) {
+            return int64_t(db.get_write_admission_controller().queued_writes());
+        }, int64_t(0), std::plus<int64_t>()).then([](int64_t res) {
+            return make_ready_future<json::json_return_type>(res);
+        });
+    });
+
+    sp::get_write_metrics_rejected.set(r, [&ctx](std::unique_ptr<request> req) {
+        return ctx.db.map_reduce0([](const database& db) {
+            return int64_t(db.get_write_admission_controller().get_stats().rejected);
+        }, int64_t(0), std::plus<int64_t>()).then([](int64_t res) {
+            return make_ready_future<json::json_return_type>(res);
+        });
+    });
+
+    sp::get_write_metrics_admission_histogram.set(r, [&ctx](std::unique_ptr<request> req) {
+        return ctx.db.map_reduce0([](const database& db) {
+            return db.get_write_admission_controller().get_stats().wait_time;
+        }, httpd::utils_json::histogram(), add_histogram).then([](const httpd::utils_json::histogram& val) {
+            return make_ready_future<json::json_return_type>(val);
+        });
+    });
+
     sp::get_read_estimated_histogram.set(r, [&ctx](std::unique_ptr<request> req) {
         return sum_estimated_histogram(ctx, &proxy::stats::estimated_read);
     });
@@ -317,6 +317,25 @@ class bytes_ostream {
         return total;
     }
 
+    // Calls "func" with each fragment of the data written since given position.
+    // "pos" must be valid.
+    template <typename Func>
+    void for_each_fragment_since(position pos, Func&& func) const {
+        chunk* c = pos._chunk;
+        if (!c) {
+            c = _begin.get();
+        } else {
+            if (c->offset > pos._offset) {
+                func(bytes_view(c->data + pos._offset, c->offset - pos._offset));
+            }
+            c = c->next.get();
+        }
+        while (c) {
+            func(bytes_view(c->data, c->offset));
+            c = c->next.get();
+        }
+    }
+
     // Rollbacks all data written after "pos".
     // Invalidates all placeholders and positions created after "pos".
     void retract(position pos) {
@@ -25,12 +25,15 @@ class column_family;
 
 namespace sstables {
 
+class sstable;
+using shared_sstable = lw_shared_ptr<sstable>;
+
 enum class compaction_strategy_type {
     null,
     major,
     size_tiered,
     leveled,
-    // FIXME: Add support to DateTiered.
+    time_window,
 };
 
 class compaction_strategy_impl;
@@ -47,6 +50,10 @@ class compaction_strategy {
     compaction_strategy& operator=(compaction_strategy&&);
 
     future<> compact(column_family& cfs);
+
+    // Must be called whenever sstables are added to or removed from the
+    // column family, so that strategies may keep their own view of it.
+    void notify_sstables_changed(const std::vector<shared_sstable>& added, const std::vector<shared_sstable>& removed);
     static sstring name(compaction_strategy_type type) {
         switch (type) {
         case compaction_strategy_type::null:
@@ -57,6 +64,8 @@ class compaction_strategy {
             return "SizeTieredCompactionStrategy";
         case compaction_strategy_type::leveled:
             return "LeveledCompactionStrategy";
+        case compaction_strategy_type::time_window:
+            return "TimeWindowCompactionStrategy";
         default:
             throw std::runtime_error("Invalid Compaction Strategy");
         }
@@ -71,6 +80,8 @@ class compaction_strategy {
             return compaction_strategy_type::size_tiered;
         } else if (name == "LeveledCompactionStrategy") {
             return compaction_strategy_type::leveled;
+        } else if (name == "TimeWindowCompactionStrategy") {
+            return compaction_strategy_type::time_window;
         } else {
             throw exceptions::configuration_exception(sprint("Unable to find compaction strategy class 'org.apache.cassandra.db.compaction.%s", name));
         }
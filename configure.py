@@ -146,12 +146,16 @@ scylla_tests = [
     'tests/perf_row_cache_update',
     'tests/perf/perf_hash',
     'tests/perf/perf_cql_parser',
+    'tests/perf/perf_cql_compression',
+    'tests/perf/perf_shard_routing',
+    'tests/perf/perf_replica_placement',
     'tests/perf/perf_simple_query',
     'tests/memory_footprint',
     'tests/perf/perf_sstable',
     'tests/cql_query_test',
     'tests/storage_proxy_test',
     'tests/mutation_reader_test',
+    'tests/streamed_mutation_test',
     'tests/key_reader_test',
     'tests/mutation_query_test',
     'tests/row_cache_test',
@@ -172,6 +176,8 @@ scylla_tests = [
     'tests/gossiping_property_file_snitch_test',
     'tests/ec2_snitch_test',
     'tests/snitch_reset_test',
+    'tests/dynamic_snitch_test',
+    'tests/speculative_retry_test',
     'tests/network_topology_strategy_test',
     'tests/query_processor_test',
     'tests/batchlog_manager_test',
@@ -182,7 +188,10 @@ scylla_tests = [
     'tests/logalloc_test',
     'tests/managed_vector_test',
     'tests/crc_test',
+    'tests/cql_compression_test',
     'tests/flush_queue_test',
+    'tests/write_admission_controller_test',
+    'tests/token_bucket_test',
 ]
 
 apps = [
@@ -246,6 +255,7 @@ scylla_core = (['database.cc',
                  'mutation_partition_view.cc',
                  'mutation_partition_serializer.cc',
                  'mutation_reader.cc',
+                 'streamed_mutation.cc',
                  'mutation_query.cc',
                  'key_reader.cc',
                  'keys.cc',
@@ -260,6 +270,7 @@ scylla_core = (['database.cc',
                  'transport/event.cc',
                  'transport/event_notifier.cc',
                  'transport/server.cc',
+                 'transport/compression.cc',
                  'cql3/abstract_marker.cc',
                  'cql3/attributes.cc',
                  'cql3/cf_name.cc',
@@ -330,6 +341,7 @@ scylla_core = (['database.cc',
                  'db/index/secondary_index.cc',
                  'db/marshal/type_parser.cc',
                  'db/batchlog_manager.cc',
+                 'db/write_admission_controller.cc',
                  'io/io.cc',
                  'utils/utils.cc',
                  'utils/UUID_gen.cc',
@@ -337,6 +349,7 @@ scylla_core = (['database.cc',
                  'utils/bloom_filter.cc',
                  'utils/bloom_calculations.cc',
                  'utils/rate_limiter.cc',
+                 'utils/token_bucket.cc',
                  'utils/compaction_manager.cc',
                  'utils/file_lock.cc',
                  'gms/version_generator.cc',
@@ -368,6 +381,8 @@ scylla_core = (['database.cc',
                  'locator/gossiping_property_file_snitch.cc',
                  'locator/production_snitch_base.cc',
                  'locator/ec2_snitch.cc',
+                 'locator/dynamic_snitch.cc',
+                 'locator/replica_placement.cc',
                  'message/messaging_service.cc',
                  'service/migration_task.cc',
                  'service/storage_service.cc',
@@ -467,6 +482,9 @@ tests_not_using_seastar_test_framework = set([
     'tests/cartesian_product_test',
     'tests/perf/perf_hash',
     'tests/perf/perf_cql_parser',
+    'tests/perf/perf_cql_compression',
+    'tests/perf/perf_shard_routing',
+    'tests/perf/perf_replica_placement',
     'tests/message',
     'tests/perf/perf_simple_query',
     'tests/memory_footprint',
@@ -475,6 +493,7 @@ tests_not_using_seastar_test_framework = set([
     'tests/compound_test',
     'tests/range_test',
     'tests/crc_test',
+    'tests/cql_compression_test',
     'tests/perf/perf_sstable',
     'tests/managed_vector_test',
 ])
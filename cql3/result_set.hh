@@ -46,6 +46,8 @@
 #include "enum_set.hh"
 #include "service/pager/paging_state.hh"
 #include "schema.hh"
+#include "query-result-reader.hh"
+#include "core/distributed.hh"
 
 namespace cql3 {
 
@@ -294,7 +296,32 @@ class result_set {
 
 public:
     ::shared_ptr<metadata> _metadata;
-    std::deque<std::vector<bytes_opt>> _rows;
+    // Filled from _serialized when the rows are first accessed.
+    mutable std::deque<std::vector<bytes_opt>> _rows;
+private:
+    // Rows sent by the replicas in the CQL binary protocol format, see
+    // query::partition_slice::cql_columns. The CQL server writes them to the
+    // client as they are, without parsing them.
+    mutable foreign_ptr<lw_shared_ptr<query::result>> _serialized;
+    uint32_t _serialized_row_count = 0;
+    size_t _serialized_size = 0;
+private:
+    void deserialize_rows() const {
+        if (!_serialized) {
+            return;
+        }
+        auto serialized = std::move(_serialized);
+        auto column_count = _metadata->value_count();
+        query::cql_rows_reader reader(serialized->buf());
+        for (uint32_t i = 0; i < _serialized_row_count; ++i) {
+            std::vector<bytes_opt> row;
+            row.reserve(column_count);
+            for (uint32_t j = 0; j < column_count; ++j) {
+                row.emplace_back(reader.read_value());
+            }
+            _rows.emplace_back(std::move(row));
+        }
+    }
 public:
     result_set(std::vector<::shared_ptr<column_specification>> metadata_)
         : _metadata(::make_shared<metadata>(std::move(metadata_)))
@@ -304,20 +331,31 @@ class result_set {
         : _metadata(std::move(metadata))
     { }
 
+    // Result set of the rows of a query whose slice has cql_columns.
+    result_set(::shared_ptr<metadata> metadata, foreign_ptr<lw_shared_ptr<query::result>> serialized)
+        : _metadata(std::move(metadata))
+        , _serialized(std::move(serialized))
+    {
+        std::tie(_serialized_row_count, _serialized_size) =
+            query::count_cql_rows(_serialized->buf(), _metadata->value_count(), query::max_rows);
+    }
+
     size_t size() const {
-        return _rows.size();
+        return _serialized ? _serialized_row_count : _rows.size();
     }
 
     bool empty() const {
-        return _rows.empty();
+        return !size();
     }
 
     void add_row(std::vector<bytes_opt> row) {
         assert(row.size() == _metadata->value_count());
+        deserialize_rows();
         _rows.emplace_back(std::move(row));
     }
 
     void add_column_value(bytes_opt value) {
+        deserialize_rows();
         if (_rows.empty() || _rows.back().size() == _metadata->value_count()) {
             std::vector<bytes_opt> row;
             row.reserve(_metadata->value_count());
@@ -328,10 +366,18 @@ class result_set {
     }
 
     void reverse() {
+        deserialize_rows();
         std::reverse(_rows.begin(), _rows.end());
     }
 
     void trim(size_t limit) {
+        if (_serialized) {
+            if (_serialized_row_count > limit) {
+                std::tie(_serialized_row_count, _serialized_size) =
+                    query::count_cql_rows(_serialized->buf(), _metadata->value_count(), limit);
+            }
+            return;
+        }
         if (_rows.size() > limit) {
             _rows.resize(limit);
         }
@@ -339,6 +385,7 @@ class result_set {
 
     template<typename RowComparator>
     void sort(RowComparator&& cmp) {
+        deserialize_rows();
         std::sort(_rows.begin(), _rows.end(), std::forward<RowComparator>(cmp));
     }
 
@@ -348,8 +395,20 @@ class result_set {
 
     // Returns a range of rows. A row is a range of bytes_opt.
     auto const& rows() const {
+        deserialize_rows();
         return _rows;
     }
+
+    // Returns the rows in the CQL binary protocol format, or null if they are
+    // held deserialized. Only the first serialized_rows_size() bytes belong
+    // to the rows of this result set.
+    const bytes_ostream* serialized_rows() const {
+        return _serialized ? &_serialized->buf() : nullptr;
+    }
+
+    size_t serialized_rows_size() const {
+        return _serialized_size;
+    }
 #if 0
     public CqlResult toThriftResult()
     {
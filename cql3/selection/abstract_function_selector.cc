@@ -40,6 +40,7 @@
 #include "abstract_function_selector.hh"
 #include "aggregate_function_selector.hh"
 #include "scalar_function_selector.hh"
+#include "simple_selector.hh"
 #include "to_string.hh"
 
 namespace cql3 {
@@ -97,6 +98,46 @@ abstract_function_selector::new_factory(shared_ptr<functions::function> fun, sha
         virtual bool is_aggregate_selector_factory() override {
             return _fun->is_aggregate() || _factories->contains_only_aggregate_functions();
         }
+
+        virtual std::experimental::optional<query::aggregate> get_pushed_down_aggregate(const std::vector<const column_definition*>& columns) override {
+            if (!_fun->is_aggregate() || !_fun->is_native()) {
+                return {};
+            }
+            auto&& name = _fun->name().name;
+            auto nr_args = std::distance(_factories->begin(), _factories->end());
+            if (name == "countRows") {
+                if (nr_args != 0) {
+                    return {};
+                }
+                return query::aggregate{query::aggregate::kind::count_rows};
+            }
+            if (nr_args != 1) {
+                return {};
+            }
+            auto arg = dynamic_pointer_cast<simple_selector_factory>(*_factories->begin());
+            if (!arg) {
+                return {};
+            }
+            auto&& def = *columns[arg->index()];
+            if ((def.kind != column_kind::regular_column && def.kind != column_kind::static_column) || (def.type != int32_type && def.type != long_type)) {
+                return {};
+            }
+            query::aggregate a{query::aggregate::kind::count, def.kind, def.id};
+            if (name == "count") {
+                a.type = query::aggregate::kind::count;
+            } else if (name == "sum") {
+                a.type = query::aggregate::kind::sum;
+            } else if (name == "avg") {
+                a.type = query::aggregate::kind::avg;
+            } else if (name == "min") {
+                a.type = query::aggregate::kind::min;
+            } else if (name == "max") {
+                a.type = query::aggregate::kind::max;
+            } else {
+                return {};
+            }
+            return a;
+        }
     };
 
     return make_shared<fun_selector_factory>(std::move(fun), std::move(factories));
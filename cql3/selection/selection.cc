@@ -103,6 +103,20 @@ class simple_selection : public selection {
 
     virtual bool is_wildcard() const override { return _is_wildcard; }
     virtual bool is_aggregate() const override { return false; }
+
+    virtual std::vector<query::cql_column> get_cql_columns() override {
+        std::vector<query::cql_column> columns;
+        if (get_columns().size() != get_result_metadata()->value_count()) {
+            return columns;
+        }
+        for (auto&& def : get_columns()) {
+            if (def->type->is_multi_cell() || def->type->is_counter()) {
+                return {};
+            }
+            columns.push_back(query::cql_column{def->kind, def->id});
+        }
+        return columns;
+    }
 protected:
     class simple_selectors : public selectors {
     private:
@@ -159,6 +173,21 @@ class selection_with_processing : public selection {
     virtual bool is_aggregate() const override {
         return _factories->contains_only_aggregate_functions();
     }
+
+    virtual std::vector<query::aggregate> get_pushed_down_aggregates() override {
+        std::vector<query::aggregate> aggregates;
+        if (!is_aggregate() || _factories->contains_write_time_selector_factory() || _factories->contains_ttl_selector_factory()) {
+            return aggregates;
+        }
+        for (auto&& factory : *_factories) {
+            auto a = factory->get_pushed_down_aggregate(get_columns());
+            if (!a) {
+                return {};
+            }
+            aggregates.push_back(*a);
+        }
+        return aggregates;
+    }
 protected:
     class selectors_with_processing : public selectors {
     private:
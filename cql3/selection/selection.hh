@@ -201,6 +201,27 @@ class selection {
 
     virtual bool is_aggregate() const = 0;
 
+    /**
+     * Returns the aggregates which replicas can compute in place of this selection.
+     *
+     * @return one aggregate per selector, or an empty vector if the queried rows have to be processed
+     * on the coordinator
+     */
+    virtual std::vector<query::aggregate> get_pushed_down_aggregates() {
+        return {};
+    }
+
+    /**
+     * Returns the columns which replicas can send already serialized in the CQL binary protocol
+     * format in place of the rows of this selection.
+     *
+     * @return one column per selected column, or an empty vector if the rows have to be processed
+     * on the coordinator
+     */
+    virtual std::vector<query::cql_column> get_cql_columns() {
+        return {};
+    }
+
     /**
      * Checks that selectors are either all aggregates or that none of them is.
      *
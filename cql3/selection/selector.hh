@@ -45,6 +45,7 @@
 #include "cql3/assignment_testable.hh"
 #include "types.hh"
 #include "schema.hh"
+#include "query-request.hh"
 
 namespace cql3 {
 
@@ -172,6 +173,17 @@ class selector::factory {
         return false;
     }
 
+    /**
+     * Returns the aggregate which replicas can compute in place of the selector instances created by this
+     * factory, if there is one.
+     *
+     * @param columns the columns of the selection
+     * @return the aggregate, or nothing if the selectors have to process the queried rows
+     */
+    virtual std::experimental::optional<query::aggregate> get_pushed_down_aggregate(const std::vector<const column_definition*>& columns) {
+        return {};
+    }
+
     /**
      * Returns the name of the column corresponding to the output value of the selector instances created by
      * this factory.
@@ -45,9 +45,8 @@
 #include "validation.hh"
 #include "core/shared_ptr.hh"
 #include "query-result-reader.hh"
-#include <boost/range/adaptor/transformed.hpp>
-#include <boost/range/algorithm_ext/push_back.hpp>
-#include <boost/range/adaptor/filtered.hpp>
+#include <boost/range/algorithm/sort.hpp>
+#include <boost/range/algorithm/unique.hpp>
 
 namespace cql3 {
 
@@ -167,23 +166,28 @@ modification_statement::read_required_rows(
         return make_ready_future<update_parameters::prefetched_rows_type>(
                 update_parameters::prefetched_rows_type{});
     }
-    try {
-        validate_for_read(keyspace(), cl);
-    } catch (exceptions::invalid_request_exception& e) {
-        throw exceptions::invalid_request_exception(sprint("Write operation require a read but consistency %s is not supported on reads", cl));
+    if (!local) {
+        try {
+            validate_for_read(keyspace(), cl);
+        } catch (exceptions::invalid_request_exception& e) {
+            throw exceptions::invalid_request_exception(sprint("Write operation require a read but consistency %s is not supported on reads", cl));
+        }
     }
 
-    static auto is_collection = [] (const column_definition& def) {
-        return def.type->is_collection();
-    };
-
-    // FIXME: we read all collection columns, but could be enhanced just to read the list(s) being RMWed
+    // Only the collections which are read-modify-written need to be fetched
     std::vector<column_id> static_cols;
-    boost::range::push_back(static_cols, s->static_columns()
-        | boost::adaptors::filtered(is_collection) | boost::adaptors::transformed([] (auto&& col) { return col.id; }));
     std::vector<column_id> regular_cols;
-    boost::range::push_back(regular_cols, s->regular_columns()
-        | boost::adaptors::filtered(is_collection) | boost::adaptors::transformed([] (auto&& col) { return col.id; }));
+    for (auto&& op : _column_operations) {
+        if (!op->requires_read()) {
+            continue;
+        }
+        auto& cols = op->column.is_static() ? static_cols : regular_cols;
+        cols.push_back(op->column.id);
+    }
+    for (auto* cols : { &static_cols, &regular_cols }) {
+        boost::sort(*cols);
+        cols->erase(boost::unique(*cols).end(), cols->end());
+    }
     query::partition_slice ps(
             {query::clustering_range(clustering_key_prefix::from_clustering_prefix(*s, *prefix))},
             std::move(static_cols),
@@ -195,15 +199,12 @@ modification_statement::read_required_rows(
     for (auto&& pk : *keys) {
         pr.emplace_back(dht::global_partitioner().decorate_key(*s, pk));
     }
-    query::read_command cmd(s->id(), ps, std::numeric_limits<uint32_t>::max());
-    // FIXME: ignoring "local"
-    return proxy.local().query(s, make_lw_shared(std::move(cmd)), std::move(pr), cl).then([this, ps] (auto result) {
-        // FIXME: copying
-        // FIXME: Use scattered_reader to avoid copying
-        bytes_ostream buf(result->buf());
-        query::result_view v(buf.linearize());
+    auto cmd = make_lw_shared<query::read_command>(s->id(), ps, std::numeric_limits<uint32_t>::max());
+    auto f = local ? proxy.local().query_local(cmd, std::move(pr))
+                   : proxy.local().query(s, cmd, std::move(pr), cl);
+    return f.then([this, cmd] (auto result) {
         auto prefetched_rows = update_parameters::prefetched_rows_type({update_parameters::prefetch_data(s)});
-        v.consume(ps, prefetch_data_builder(prefetched_rows.value(), ps));
+        query::result_view::consume(*result, cmd->slice, prefetch_data_builder(prefetched_rows.value(), cmd->slice));
         return prefetched_rows;
     });
 }
@@ -45,7 +45,9 @@
 #include "cql3/selection/selection.hh"
 #include "core/shared_ptr.hh"
 #include "query-result-reader.hh"
+#include "query-result-aggregates.hh"
 #include "query_result_merger.hh"
+#include "service/storage_service.hh"
 
 namespace cql3 {
 
@@ -71,6 +73,14 @@ select_statement::select_statement(schema_ptr schema,
         , _ordering_comparator(std::move(ordering_comparator))
 {
     _opts = _selection->get_query_options();
+    // LIMIT is applied to the rows fed to the aggregates, which replicas
+    // can't do on their own for multi-partition queries.
+    if (!_limit && !_parameters->is_distinct()) {
+        _aggregates = _selection->get_pushed_down_aggregates();
+    }
+    if (_aggregates.empty() && !_parameters->is_distinct() && !needs_post_query_ordering()) {
+        _cql_columns = _selection->get_cql_columns();
+    }
 }
 
 bool select_statement::uses_function(const sstring& ks_name, const sstring& function_name) const {
@@ -144,8 +154,20 @@ select_statement::make_partition_slice(const query_options& options) {
         _opts.set(query::partition_slice::option::reversed);
         std::reverse(bounds.begin(), bounds.end());
     }
+    // Nodes which don't know about aggregates or cql_columns would ignore
+    // them and return rows in the regular format, so they are only used once
+    // every node supports them.
+    auto& ss = service::get_local_storage_service();
+    std::vector<query::aggregate> aggregates;
+    if (ss.cluster_supports_aggregate_pushdown()) {
+        aggregates = _aggregates;
+    }
+    std::vector<query::cql_column> cql_columns;
+    if (ss.cluster_supports_cql_columns()) {
+        cql_columns = _cql_columns;
+    }
     return query::partition_slice(std::move(bounds),
-        std::move(static_columns), std::move(regular_columns), _opts);
+        std::move(static_columns), std::move(regular_columns), _opts, std::move(aggregates), std::move(cql_columns));
 }
 
 int32_t select_statement::get_limit(const query_options& options) const {
@@ -375,19 +397,25 @@ class result_set_building_visitor {
 shared_ptr<transport::messages::result_message>
 select_statement::process_results(foreign_ptr<lw_shared_ptr<query::result>> results, lw_shared_ptr<query::read_command> cmd,
         const query_options& options, db_clock::time_point now) {
-    cql3::selection::result_set_builder builder(*_selection, now, options.get_serialization_format());
+    if (!cmd->slice.aggregates.empty()) {
+        query::partial_aggregates aggregates(cmd->slice.aggregates);
+        aggregates.merge(*results);
+        auto rs = std::make_unique<result_set>(::make_shared<metadata>(*_selection->get_result_metadata()));
+        rs->add_row(aggregates.finish(*_schema));
+        rs->trim(cmd->row_limit);
+        return ::make_shared<transport::messages::result_message::rows>(std::move(rs));
+    }
 
-    // FIXME: This special casing saves us the cost of copying an already
-    // linearized response. When we switch views to scattered_reader this will go away.
-    if (results->buf().is_linearized()) {
-        query::result_view view(results->buf().view());
-        view.consume(cmd->slice, result_set_building_visitor(builder, *this));
-    } else {
-        bytes_ostream w(results->buf());
-        query::result_view view(w.linearize());
-        view.consume(cmd->slice, result_set_building_visitor(builder, *this));
+    if (!cmd->slice.cql_columns.empty()) {
+        auto rs = std::make_unique<result_set>(::make_shared<metadata>(*_selection->get_result_metadata()), std::move(results));
+        rs->trim(cmd->row_limit);
+        return ::make_shared<transport::messages::result_message::rows>(std::move(rs));
     }
 
+    cql3::selection::result_set_builder builder(*_selection, now, options.get_serialization_format());
+
+    query::result_view::consume(*results, cmd->slice, result_set_building_visitor(builder, *this));
+
     auto rs = builder.build();
     if (needs_post_query_ordering()) {
         rs->sort(_ordering_comparator);
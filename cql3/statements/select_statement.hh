@@ -111,6 +111,17 @@ class select_statement : public cql_statement {
     ordering_comparator_type _ordering_comparator;
 
     query::partition_slice::option_set _opts;
+
+    /**
+     * The aggregates computed by replicas, when all the selectors can be pushed down to them.
+     */
+    std::vector<query::aggregate> _aggregates;
+
+    /**
+     * The columns of the rows replicas send in the CQL binary protocol format, when the rows
+     * need no processing on the coordinator.
+     */
+    std::vector<query::cql_column> _cql_columns;
 public:
     select_statement(schema_ptr schema,
             uint32_t bound_terms,
@@ -126,8 +126,8 @@ column_family::make_partition_presence_checker(lw_shared_ptr<sstable_list> old_s
 
 mutation_source
 column_family::sstables_as_mutation_source() {
-    return [this] (const query::partition_range& r) {
-        return make_sstable_reader(r);
+    return [this] (const query::partition_range& r, const query::partition_slice& slice) {
+        return make_sstable_reader(r, slice);
     };
 }
 
@@ -154,14 +154,15 @@ class range_sstable_reader final : public mutation_reader::impl {
     lw_shared_ptr<sstable_list> _sstables;
     mutation_reader _reader;
 public:
-    range_sstable_reader(schema_ptr s, lw_shared_ptr<sstable_list> sstables, const query::partition_range& pr)
+    range_sstable_reader(schema_ptr s, lw_shared_ptr<sstable_list> sstables, const query::partition_range& pr,
+            const query::partition_slice& slice)
         : _pr(pr)
         , _sstables(std::move(sstables))
     {
         std::vector<mutation_reader> readers;
         for (const lw_shared_ptr<sstables::sstable>& sst : *_sstables | boost::adaptors::map_values) {
             // FIXME: make sstable::read_range_rows() return ::mutation_reader so that we can drop this wrapper.
-            mutation_reader reader = make_mutation_reader<sstable_range_wrapping_reader>(sst, s, pr);
+            mutation_reader reader = make_mutation_reader<sstable_range_wrapping_reader>(sst, s, pr, slice);
             if (sst->is_shared()) {
                 reader = make_filtering_reader(std::move(reader), belongs_to_current_shard);
             }
@@ -180,13 +181,16 @@ class range_sstable_reader final : public mutation_reader::impl {
 class single_key_sstable_reader final : public mutation_reader::impl {
     schema_ptr _schema;
     sstables::key _key;
+    const query::partition_slice& _slice;
     mutation_opt _m;
     bool _done = false;
     lw_shared_ptr<sstable_list> _sstables;
 public:
-    single_key_sstable_reader(schema_ptr schema, lw_shared_ptr<sstable_list> sstables, const partition_key& key)
+    single_key_sstable_reader(schema_ptr schema, lw_shared_ptr<sstable_list> sstables, const partition_key& key,
+            const query::partition_slice& slice)
         : _schema(std::move(schema))
         , _key(sstables::key::from_partition_key(*_schema, key))
+        , _slice(slice)
         , _sstables(std::move(sstables))
     { }
 
@@ -195,7 +199,7 @@ class single_key_sstable_reader final : public mutation_reader::impl {
             return make_ready_future<mutation_opt>();
         }
         return parallel_for_each(*_sstables | boost::adaptors::map_values, [this](const lw_shared_ptr<sstables::sstable>& sstable) {
-            return sstable->read_row(_schema, _key).then([this](mutation_opt mo) {
+            return sstable->read_row(_schema, _key, _slice).then([this](mutation_opt mo) {
                 apply(_m, std::move(mo));
             });
         }).then([this] {
@@ -206,16 +210,16 @@ class single_key_sstable_reader final : public mutation_reader::impl {
 };
 
 mutation_reader
-column_family::make_sstable_reader(const query::partition_range& pr) const {
+column_family::make_sstable_reader(const query::partition_range& pr, const query::partition_slice& slice) const {
     if (pr.is_singular() && pr.start()->value().has_key()) {
         const dht::ring_position& pos = pr.start()->value();
         if (dht::shard_of(pos.token()) != engine().cpu_id()) {
             return make_empty_reader(); // range doesn't belong to this shard
         }
-        return make_mutation_reader<single_key_sstable_reader>(_schema, _sstables, *pos.key());
+        return make_mutation_reader<single_key_sstable_reader>(_schema, _sstables, *pos.key(), slice);
     } else {
         // range_sstable_reader is not movable so we need to wrap it
-        return make_mutation_reader<range_sstable_reader>(_schema, _sstables, pr);
+        return make_mutation_reader<range_sstable_reader>(_schema, _sstables, pr, slice);
     }
 }
 
@@ -274,7 +278,7 @@ column_family::find_row(const dht::decorated_key& partition_key, clustering_key
 }
 
 mutation_reader
-column_family::make_reader(const query::partition_range& range) const {
+column_family::make_reader(const query::partition_range& range, const query::partition_slice& slice) const {
     if (query::is_wrap_around(range, *_schema)) {
         // make_combined_reader() can't handle streams that wrap around yet.
         fail(unimplemented::cause::WRAP_AROUND);
@@ -304,18 +308,60 @@ column_family::make_reader(const query::partition_range& range) const {
     // https://github.com/scylladb/scylla/issues/185
 
     for (auto&& mt : *_memtables) {
-        readers.emplace_back(mt->make_reader(range));
+        readers.emplace_back(mt->make_reader(range, slice));
     }
 
     if (_config.enable_cache) {
-        readers.emplace_back(_cache.make_reader(range));
+        readers.emplace_back(_cache.make_reader(range, slice));
     } else {
-        readers.emplace_back(make_sstable_reader(range));
+        readers.emplace_back(make_sstable_reader(range, slice));
     }
 
     return make_combined_reader(std::move(readers));
 }
 
+class streamed_range_reader final : public streamed_mutation_reader::impl {
+    const query::partition_range _pr;
+    lw_shared_ptr<sstable_list> _sstables;
+    streamed_mutation_reader _reader;
+public:
+    streamed_range_reader(schema_ptr s, const memtable_list& memtables,
+            lw_shared_ptr<sstable_list> sstables, const query::partition_range& pr)
+        : _pr(pr)
+        , _sstables(std::move(sstables))
+    {
+        std::vector<streamed_mutation_reader> readers;
+        readers.reserve(memtables.size() + _sstables->size());
+        for (auto&& mt : memtables) {
+            readers.emplace_back(make_fragmenting_reader(mt->make_reader(_pr)));
+        }
+        for (const lw_shared_ptr<sstables::sstable>& sst : *_sstables | boost::adaptors::map_values) {
+            auto reader = sst->read_range_rows_streamed(s, _pr);
+            if (sst->is_shared()) {
+                reader = make_filtering_reader(std::move(reader), [] (const dht::decorated_key& dk) {
+                    return dht::shard_of(dk.token()) == engine().cpu_id();
+                });
+            }
+            readers.emplace_back(std::move(reader));
+        }
+        _reader = make_combined_reader(std::move(s), std::move(readers));
+    }
+
+    streamed_range_reader(streamed_range_reader&&) = delete; // readers take reference to member fields
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        return _reader();
+    }
+};
+
+streamed_mutation_reader
+column_family::make_streamed_reader(const query::partition_range& range) const {
+    if (query::is_wrap_around(range, *_schema)) {
+        fail(unimplemented::cause::WRAP_AROUND);
+    }
+    return make_streamed_mutation_reader<streamed_range_reader>(_schema, *_memtables, _sstables, range);
+}
+
 template <typename Func>
 future<bool>
 column_family::for_all_partitions(Func&& func) const {
@@ -479,6 +525,7 @@ void column_family::add_sstable(lw_shared_ptr<sstables::sstable> sstable) {
     // allow in-progress reads to continue using old list
     _sstables = make_lw_shared<sstable_list>(*_sstables);
     update_stats_for_new_sstable(sstable->data_size());
+    _compaction_strategy.notify_sstables_changed({sstable}, {});
     _sstables->emplace(generation, std::move(sstable));
 }
 
@@ -518,21 +565,63 @@ column_family::seal_active_memtable() {
     || (_highest_flushed_rp == db::replay_position() && old->replay_position() == db::replay_position())
     );
     _highest_flushed_rp = old->replay_position();
+    _waiting_flush = old;
 
     return _flush_queue->run_cf_flush(old->replay_position(), [old, this] {
+      return compact_sealed_memtable(old).then([this, old] {
         return repeat([this, old] {
             return with_lock(_sstables_lock.for_read(), [this, old] {
                 _flush_queue->check_open_gate();
+                if (_waiting_flush == old) {
+                    _waiting_flush = {};
+                }
                 return try_flush_memtable_to_sstable(old);
             });
         });
+      });
     }, [old, this] {
         if (_commitlog) {
             _commitlog->discard_completed_segments(_schema->id(), old->replay_position());
         }
     });
     // FIXME: release commit log
-    // FIXME: provide back-pressure to upper layers
+}
+
+api::timestamp_type
+column_family::get_max_purgeable_timestamp(const memtable& memt, const dht::decorated_key& dk) const {
+    // Other memtables aren't tracked by timestamp, so tombstones are kept
+    // whenever they may shadow data in one of them.
+    for (auto&& mt : *_memtables) {
+        if (mt.get() != &memt && mt->contains(dk)) {
+            return api::min_timestamp;
+        }
+    }
+    auto timestamp = api::max_timestamp;
+    for (auto&& e : *_sstables) {
+        auto& sst = e.second;
+        if (sst->filter_has_key(*_schema, dk.key())) {
+            timestamp = std::min(timestamp, sst->get_stats_metadata().min_timestamp);
+        }
+    }
+    return timestamp;
+}
+
+// Shrinks a sealed memtable before it is written, so that data which would be
+// dropped by the first compaction of the new sstable isn't written at all.
+future<>
+column_family::compact_sealed_memtable(lw_shared_ptr<memtable> old) {
+    if (!_config.enable_in_memory_compaction) {
+        return make_ready_future<>();
+    }
+    return seastar::async([this, old] {
+        auto saved = old->compact(gc_clock::now(), [this, &old] (const dht::decorated_key& dk) {
+            return get_max_purgeable_timestamp(*old, dk);
+        });
+        ++_stats.memtable_compactions;
+        _stats.memtable_compaction_bytes_saved += saved;
+        dblog.debug("Compacted sealed memtable of {}.{}, {} bytes saved, partitions: {}, occupancy: {}",
+            _schema->ks_name(), _schema->cf_name(), saved, old->partition_count(), old->occupancy());
+    });
 }
 
 future<stop_iteration>
@@ -547,6 +636,11 @@ column_family::try_flush_memtable_to_sstable(lw_shared_ptr<memtable> old) {
         sstables::sstable::format_types::big);
 
     newtab->set_unshared();
+    newtab->set_column_index_size(_config.column_index_size);
+    newtab->set_write_throttle([this] (uint64_t bytes) {
+        _compaction_manager.charge_flush(bytes);
+        return make_ready_future<>();
+    });
     dblog.debug("Flushing to {}", newtab->get_filename());
     return newtab->write_components(*old).then([this, newtab, old] {
         return newtab->open_data().then([this, newtab] {
@@ -583,6 +677,9 @@ column_family::try_flush_memtable_to_sstable(lw_shared_ptr<memtable> old) {
 
             _memtables->erase(boost::range::find(*_memtables, old));
             dblog.debug("Memtable replaced");
+            if (_config.write_admission) {
+                _config.write_admission->on_memory_released();
+            }
             trigger_compaction();
 
             return make_ready_future<stop_iteration>(stop_iteration::yes);
@@ -670,12 +767,29 @@ column_family::compact_sstables(sstables::compaction_descriptor descriptor) {
         return make_ready_future<>();
     }
 
-    return with_lock(_sstables_lock.for_read(), [this, descriptor = std::move(descriptor)] {
+    for (auto& sst : descriptor.sstables) {
+        if (_compacting_sstables.count(sst)) {
+            dblog.debug("Sstable {} is already being compacted", sst->get_filename());
+            return make_ready_future<>();
+        }
+    }
+
+    auto info = make_lw_shared<sstables::compaction_info>();
+    info->ks = _schema->ks_name();
+    info->cf = _schema->cf_name();
+    for (auto& sst : descriptor.sstables) {
+        _compacting_sstables.insert(sst);
+        info->total_bytes += sst->data_size();
+    }
+    _compaction_manager.register_compaction(info);
+
+    auto compacted = descriptor.sstables;
+    return with_lock(_sstables_lock.for_read(), [this, info, descriptor = std::move(descriptor)] {
         auto sstables_to_compact = make_lw_shared<std::vector<sstables::shared_sstable>>(std::move(descriptor.sstables));
 
         auto new_tables = make_lw_shared<std::vector<
                 std::pair<unsigned, sstables::shared_sstable>>>();
-        auto create_sstable = [this, new_tables] {
+        auto create_sstable = [this, new_tables, info] {
                 // FIXME: this generation calculation should be in a function.
                 auto gen = _sstable_generation++ * smp::count + engine().cpu_id();
                 // FIXME: use "tmp" marker in names of incomplete sstable
@@ -683,44 +797,86 @@ column_family::compact_sstables(sstables::compaction_descriptor descriptor) {
                         sstables::sstable::version_types::ka,
                         sstables::sstable::format_types::big);
                 sst->set_unshared();
+                sst->set_column_index_size(_config.column_index_size);
+                sst->set_write_throttle([this, info] (uint64_t bytes) {
+                    info->written_bytes += bytes;
+                    return _compaction_manager.throttle_compaction(bytes);
+                });
                 new_tables->emplace_back(gen, sst);
                 return sst;
         };
         return sstables::compact_sstables(*sstables_to_compact, *this,
                 create_sstable, descriptor.max_sstable_bytes, descriptor.level).then([this, new_tables, sstables_to_compact] {
-            // Build a new list of _sstables: We remove from the existing list the
-            // tables we compacted (by now, there might be more sstables flushed
-            // later), and we add the new tables generated by the compaction.
-            // We create a new list rather than modifying it in-place, so that
-            // on-going reads can continue to use the old list.
-            auto current_sstables = _sstables;
-            _sstables = make_lw_shared<sstable_list>();
-
-            // zeroing live_disk_space_used and live_sstable_count because the
-            // sstable list is re-created below.
-            _stats.live_disk_space_used = 0;
-            _stats.live_sstable_count = 0;
-
-            std::unordered_set<sstables::shared_sstable> s(
-                    sstables_to_compact->begin(), sstables_to_compact->end());
-            for (const auto& oldtab : *current_sstables) {
-                if (!s.count(oldtab.second)) {
-                    update_stats_for_new_sstable(oldtab.second->data_size());
-                    _sstables->emplace(oldtab.first, oldtab.second);
-                }
-
-                for (const auto& newtab : *new_tables) {
-                    // FIXME: rename the new sstable(s). Verify a rename doesn't cause
-                    // problems for the sstable object.
-                    update_stats_for_new_sstable(newtab.second->data_size());
-                    _sstables->emplace(newtab.first, newtab.second);
-                }
-
-                for (const auto& oldtab : *sstables_to_compact) {
-                    oldtab->mark_for_deletion();
-                }
+            std::vector<sstables::shared_sstable> new_sstables;
+            for (auto& newtab : *new_tables) {
+                new_sstables.push_back(newtab.second);
             }
+            rebuild_sstable_list(new_sstables, *sstables_to_compact);
         });
+    }).finally([this, info, compacted = std::move(compacted)] {
+        for (auto& sst : compacted) {
+            _compacting_sstables.erase(sst);
+        }
+        _compaction_manager.deregister_compaction(info);
+    });
+}
+
+void
+column_family::rebuild_sstable_list(const std::vector<sstables::shared_sstable>& new_sstables,
+        const std::vector<sstables::shared_sstable>& sstables_to_remove) {
+    // Build a new list of _sstables: We remove from the existing list the
+    // tables we compacted (by now, there might be more sstables flushed
+    // later), and we add the new tables generated by the compaction.
+    // We create a new list rather than modifying it in-place, so that
+    // on-going reads can continue to use the old list.
+    auto current_sstables = _sstables;
+    _sstables = make_lw_shared<sstable_list>();
+
+    // zeroing live_disk_space_used and live_sstable_count because the
+    // sstable list is re-created below.
+    _stats.live_disk_space_used = 0;
+    _stats.live_sstable_count = 0;
+
+    std::unordered_set<sstables::shared_sstable> s(
+            sstables_to_remove.begin(), sstables_to_remove.end());
+    for (const auto& oldtab : *current_sstables) {
+        if (!s.count(oldtab.second)) {
+            update_stats_for_new_sstable(oldtab.second->data_size());
+            _sstables->emplace(oldtab.first, oldtab.second);
+        }
+    }
+
+    for (const auto& newtab : new_sstables) {
+        // FIXME: rename the new sstable(s). Verify a rename doesn't cause
+        // problems for the sstable object.
+        update_stats_for_new_sstable(newtab->data_size());
+        _sstables->emplace(newtab->generation(), newtab);
+    }
+
+    for (const auto& oldtab : sstables_to_remove) {
+        oldtab->mark_for_deletion();
+    }
+
+    _compaction_strategy.notify_sstables_changed(new_sstables, sstables_to_remove);
+}
+
+api::timestamp_type column_family::min_memtable_timestamp() const {
+    auto timestamp = api::max_timestamp;
+    for (auto&& mt : *_memtables) {
+        timestamp = std::min(timestamp, mt->min_timestamp());
+    }
+    return timestamp;
+}
+
+future<>
+column_family::drop_sstables(std::vector<sstables::shared_sstable> sstables) {
+    if (sstables.empty()) {
+        return make_ready_future<>();
+    }
+
+    return with_lock(_sstables_lock.for_read(), [this, sstables = std::move(sstables)] {
+        rebuild_sstable_list({}, sstables);
+        return make_ready_future<>();
     });
 }
 
@@ -741,9 +897,10 @@ column_family::load_new_sstables(std::vector<sstables::entry_descriptor> new_tab
 // Note: We assume that the column_family does not get destroyed during compaction.
 future<>
 column_family::compact_all_sstables() {
+    auto candidates = get_sstables_for_compaction();
     std::vector<sstables::shared_sstable> sstables;
-    sstables.reserve(_sstables->size());
-    for (auto&& entry : *_sstables) {
+    sstables.reserve(candidates->size());
+    for (auto&& entry : *candidates) {
         sstables.push_back(entry.second);
     }
     // FIXME: check if the lower bound min_compaction_threshold() from schema
@@ -788,6 +945,44 @@ bool column_family::pending_compactions() const {
     return _stats.pending_compactions > 0;
 }
 
+// The percentile is recomputed at most once per interval, and only once
+// enough reads were seen for it to be meaningful. Counts are then halved,
+// so that the delay follows changes of the latencies.
+static constexpr auto speculative_retry_delay_update_interval = std::chrono::seconds(1);
+static constexpr int64_t speculative_retry_min_samples = 100;
+
+std::experimental::optional<std::chrono::microseconds> column_family::speculative_retry_delay() {
+    auto& retry = _schema->speculative_retry();
+    if (retry.get_type() == speculative_retry::type::CUSTOM) {
+        return std::chrono::microseconds(int64_t(retry.get_value() * 1000));
+    }
+    auto now = lowres_clock::now();
+    if (now - _speculative_retry_delay_updated >= speculative_retry_delay_update_interval) {
+        auto& latencies = _stats.estimated_coordinator_read;
+        if (latencies.count() >= speculative_retry_min_samples) {
+            _speculative_retry_delay_updated = now;
+            _speculative_retry_delay = std::chrono::microseconds(latencies.percentile(retry.get_value()));
+            for (auto& b : latencies.buckets) {
+                b /= 2;
+            }
+        }
+    }
+    return _speculative_retry_delay;
+}
+
+lw_shared_ptr<sstable_list> column_family::get_sstables_for_compaction() {
+    if (_compacting_sstables.empty()) {
+        return _sstables;
+    }
+    auto candidates = make_lw_shared<sstable_list>();
+    for (auto& entry : *_sstables) {
+        if (!_compacting_sstables.count(entry.second)) {
+            candidates->emplace(entry);
+        }
+    }
+    return candidates;
+}
+
 size_t column_family::sstables_count() {
     return _sstables->size();
 }
@@ -799,6 +994,36 @@ int64_t column_family::get_unleveled_sstables() const {
     return 0;
 }
 
+uint64_t column_family::estimated_partitions() const {
+    uint64_t res = 0;
+    for (auto&& sst : *_sstables | boost::adaptors::map_values) {
+        res += sst->get_stats_metadata().estimated_row_size.count();
+    }
+    for (auto&& mt : *_memtables) {
+        res += mt->partition_count();
+    }
+    return res;
+}
+
+double column_family::estimated_rows_per_partition() const {
+    if (_schema->clustering_key_size() == 0 || _schema->is_dense()) {
+        return 1;
+    }
+    // As in Origin, assume every row has a cell for each regular column.
+    double cells = 0;
+    int64_t partitions = 0;
+    for (auto&& sst : *_sstables | boost::adaptors::map_values) {
+        auto& column_count = sst->get_stats_metadata().estimated_column_count;
+        auto c = column_count.count();
+        cells += double(column_count.mean()) * c;
+        partitions += c;
+    }
+    if (!partitions) {
+        return 1;
+    }
+    return std::max(1.0, cells / partitions / std::max(size_t(1), _schema->regular_columns_count()));
+}
+
 lw_shared_ptr<sstable_list> column_family::get_sstables() {
     return _sstables;
 }
@@ -892,10 +1117,21 @@ database::database(const db::config& cfg)
     if (!_memtable_total_space) {
         _memtable_total_space = memory::stats().total_memory() / 2;
     }
+    db::write_admission_controller::config wac_cfg;
+    wac_cfg.soft_limit = _memtable_total_space / 2;
+    wac_cfg.hard_limit = _memtable_total_space;
+    wac_cfg.timeout = std::chrono::milliseconds(_cfg->write_request_timeout_in_ms());
+    _write_admission = std::make_unique<db::write_admission_controller>(wac_cfg, [this] {
+        return _dirty_memory_region_group.memory_used();
+    });
     bool durable = cfg.data_file_directories().size() > 0;
     db::system_keyspace::make(*this, durable, _cfg->volatile_system_keyspace_for_testing());
-    // Start compaction manager with two tasks for handling compaction jobs.
-    _compaction_manager.start(2);
+    // Compaction throughput is configured for the whole node, so it is split
+    // among shards.
+    _compaction_manager.set_compaction_throughput((uint64_t(_cfg->compaction_throughput_mb_per_sec()) << 20) / smp::count);
+    // Start compaction manager with two tasks for handling compaction jobs,
+    // unless configured otherwise.
+    _compaction_manager.start(_cfg->concurrent_compactors() ? _cfg->concurrent_compactors() : 2);
     setup_collectd();
 
     dblog.info("Row: max_vector_size: {}, internal_count: {}", size_t(row::max_vector_size), size_t(row::internal_count));
@@ -910,6 +1146,46 @@ database::setup_collectd() {
                 , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
             return _dirty_memory_region_group.memory_used();
     })));
+
+    _collectd.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("database"
+                , scollectd::per_cpu_plugin_instance
+                , "queue_length", "queued_writes")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
+            return _write_admission->queued_writes();
+    })));
+
+    _collectd.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("database"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "delayed_writes")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, [this] {
+            return _write_admission->get_stats().delayed;
+    })));
+
+    _collectd.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("database"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "queued_writes")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, [this] {
+            return _write_admission->get_stats().queued;
+    })));
+
+    _collectd.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("database"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "rejected_writes")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, [this] {
+            return _write_admission->get_stats().rejected;
+    })));
+
+    _collectd.push_back(
+        scollectd::add_polled_metric(scollectd::type_instance_id("database"
+                , scollectd::per_cpu_plugin_instance
+                , "latency", "write_admission_wait")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, [this] {
+            return _write_admission->get_stats().wait_time.mean;
+    })));
 }
 
 database::~database() {
@@ -1243,7 +1519,10 @@ keyspace::make_column_family_config(const schema& s) const {
     cfg.enable_commitlog = _config.enable_commitlog;
     cfg.enable_cache = _config.enable_cache;
     cfg.max_memtable_size = _config.max_memtable_size;
+    cfg.column_index_size = _config.column_index_size;
+    cfg.enable_in_memory_compaction = _config.enable_in_memory_compaction;
     cfg.dirty_memory_region_group = _config.dirty_memory_region_group;
+    cfg.write_admission = _config.write_admission;
     cfg.enable_incremental_backups = _config.enable_incremental_backups;
 
     return cfg;
@@ -1387,7 +1666,7 @@ compare_atomic_cell_for_merge(atomic_cell_view left, atomic_cell_view right) {
 struct query_state {
     explicit query_state(const query::read_command& cmd, const std::vector<query::partition_range>& ranges)
             : cmd(cmd)
-            , builder(cmd.slice)
+            , builder(cmd.slice, cmd.digest_algo)
             , limit(cmd.row_limit)
             , current_partition_range(ranges.begin())
             , range_end(ranges.end()){
@@ -1411,7 +1690,7 @@ column_family::query(const query::read_command& cmd, const std::vector<query::pa
     return do_with(query_state(cmd, partition_ranges), [this] (query_state& qs) {
         return do_until(std::bind(&query_state::done, &qs), [this, &qs] {
             auto&& range = *qs.current_partition_range++;
-            qs.reader = make_reader(range);
+            qs.reader = make_reader(range, qs.cmd.slice);
             qs.range_empty = false;
             return do_until([&qs] { return !qs.limit || qs.range_empty; }, [this, &qs] {
                 return qs.reader().then([this, &qs](mutation_opt mo) {
@@ -1440,8 +1719,8 @@ column_family::query(const query::read_command& cmd, const std::vector<query::pa
 
 mutation_source
 column_family::as_mutation_source() const {
-    return [this] (const query::partition_range& range) {
-        return this->make_reader(range);
+    return [this] (const query::partition_range& range, const query::partition_slice& slice) {
+        return this->make_reader(range, slice);
     };
 }
 
@@ -1532,39 +1811,8 @@ future<> database::do_apply(const frozen_mutation& m) {
     return apply_in_memory(m, db::replay_position());
 }
 
-future<> database::throttle() {
-    if (_dirty_memory_region_group.memory_used() < _memtable_total_space
-            && _throttled_requests.empty()) {
-        // All is well, go ahead
-        return make_ready_future<>();
-    }
-    // We must throttle, wait a bit
-    if (_throttled_requests.empty()) {
-        _throttling_timer.arm_periodic(10ms);
-    }
-    _throttled_requests.emplace_back();
-    return _throttled_requests.back().get_future();
-}
-
-void database::unthrottle() {
-    // Release one request per free 1MB we have
-    // FIXME: improve this
-    if (_dirty_memory_region_group.memory_used() >= _memtable_total_space) {
-        return;
-    }
-    size_t avail = (_memtable_total_space - _dirty_memory_region_group.memory_used()) >> 20;
-    avail = std::min(_throttled_requests.size(), avail);
-    for (size_t i = 0; i < avail; ++i) {
-        _throttled_requests.front().set_value();
-        _throttled_requests.pop_front();
-    }
-    if (_throttled_requests.empty()) {
-        _throttling_timer.cancel();
-    }
-}
-
 future<> database::apply(const frozen_mutation& m) {
-    return throttle().then([this, &m] {
+    return _write_admission->admit(m.representation().size()).then([this, &m] {
         return do_apply(m);
     });
 }
@@ -1589,7 +1837,10 @@ database::make_keyspace_config(const keyspace_metadata& ksm) {
         cfg.max_memtable_size = std::numeric_limits<size_t>::max();
     }
     cfg.dirty_memory_region_group = &_dirty_memory_region_group;
+    cfg.write_admission = _write_admission.get();
     cfg.enable_incremental_backups = _cfg->incremental_backups();
+    cfg.column_index_size = _cfg->column_index_size_in_kb() * 1024;
+    cfg.enable_in_memory_compaction = _cfg->enable_in_memory_compaction();
     return cfg;
 }
 
@@ -2021,17 +2272,20 @@ future<db::replay_position> column_family::discard_sstables(db_clock::time_point
         auto gc_trunc = to_gc_clock(truncated_at);
 
         auto pruned = make_lw_shared<sstable_list>();
+        std::vector<sstables::shared_sstable> discarded;
 
         for (auto&p : *_sstables) {
             if (p.second->max_data_age() <= gc_trunc) {
                 rp = std::max(p.second->get_stats_metadata().position, rp);
                 p.second->mark_for_deletion();
+                discarded.push_back(p.second);
                 continue;
             }
             pruned->emplace(p.first, p.second);
         }
 
         _sstables = std::move(pruned);
+        _compaction_strategy.notify_sstables_changed({}, discarded);
 
         dblog.debug("cleaning out row cache");
         _cache.clear();
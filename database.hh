@@ -37,6 +37,7 @@
 #include <functional>
 #include <cstdint>
 #include <unordered_map>
+#include <unordered_set>
 #include <map>
 #include <set>
 #include <iostream>
@@ -49,6 +50,7 @@
 #include "core/gate.hh"
 #include "cql3/column_specification.hh"
 #include "db/commitlog/replay_position.hh"
+#include "db/write_admission_controller.hh"
 #include <limits>
 #include <cstddef>
 #include "schema.hh"
@@ -62,6 +64,7 @@
 #include "memtable.hh"
 #include <list>
 #include "mutation_reader.hh"
+#include "streamed_mutation.hh"
 #include "row_cache.hh"
 #include "compaction_strategy.hh"
 #include "utils/compaction_manager.hh"
@@ -112,7 +115,10 @@ class column_family {
         bool enable_commitlog = true;
         bool enable_incremental_backups = false;
         size_t max_memtable_size = 5'000'000;
+        size_t column_index_size = 64 * 1024;
+        bool enable_in_memory_compaction = false;
         logalloc::region_group* dirty_memory_region_group = nullptr;
+        db::write_admission_controller* write_admission = nullptr;
     };
     struct no_commitlog {};
     struct stats {
@@ -132,6 +138,16 @@ class column_family {
         sstables::estimated_histogram estimated_sstable_per_read;
         utils::ihistogram tombstone_scanned;
         utils::ihistogram live_scanned;
+        /** Number of sealed memtables compacted in memory before being flushed */
+        int64_t memtable_compactions = 0;
+        /** Bytes dropped from sealed memtables by in-memory compaction */
+        int64_t memtable_compaction_bytes_saved = 0;
+        /** Latencies of the reads coordinated by this shard, in microseconds */
+        sstables::estimated_histogram estimated_coordinator_read;
+        /** Number of reads speculatively sent to an extra replica */
+        int64_t speculative_retries = 0;
+        /** Number of speculative retries whose extra replica completed the consistency level */
+        int64_t speculative_retries_won = 0;
     };
 
     struct snapshot_details {
@@ -158,15 +174,33 @@ class column_family {
     compaction_manager& _compaction_manager;
     // Whether or not a cf is queued by its compaction manager.
     bool _compaction_manager_queued = false;
+    // Sstables being compacted. Compactions of a column family may run
+    // concurrently as long as they don't share sstables.
+    std::unordered_set<sstables::shared_sstable> _compacting_sstables;
     int _compaction_disabled = 0;
     class memtable_flush_queue;
     std::unique_ptr<memtable_flush_queue> _flush_queue;
+    // The last sealed memtable, until its flush gets to write it. Flushes
+    // wait for _sstables_lock, so sealed memtables may queue up meanwhile.
+    lw_shared_ptr<memtable> _waiting_flush;
+    // While a flush is waiting, the active memtable may grow up to this
+    // many times max_memtable_size before it is sealed anyway, so that a
+    // stalled flush doesn't let it pin commitlog segments indefinitely.
+    static constexpr size_t max_merged_memtable_size_factor = 2;
+    // Delay of PERCENTILE speculative retries, recomputed periodically
+    // from estimated_coordinator_read.
+    std::experimental::optional<std::chrono::microseconds> _speculative_retry_delay;
+    lowres_clock::time_point _speculative_retry_delay_updated;
 private:
     void update_stats_for_new_sstable(uint64_t new_sstable_data_size);
     void add_sstable(sstables::sstable&& sstable);
     void add_sstable(lw_shared_ptr<sstables::sstable> sstable);
     void add_memtable();
+    void rebuild_sstable_list(const std::vector<sstables::shared_sstable>& new_sstables,
+        const std::vector<sstables::shared_sstable>& sstables_to_remove);
     future<stop_iteration> try_flush_memtable_to_sstable(lw_shared_ptr<memtable> memt);
+    future<> compact_sealed_memtable(lw_shared_ptr<memtable> memt);
+    api::timestamp_type get_max_purgeable_timestamp(const memtable& memt, const dht::decorated_key& dk) const;
     future<> update_cache(memtable&, lw_shared_ptr<sstable_list> old_sstables);
     struct merge_comparator;
 
@@ -177,8 +211,9 @@ class column_family {
 private:
     // Creates a mutation reader which covers sstables.
     // Caller needs to ensure that column_family remains live (FIXME: relax this).
-    // The 'range' parameter must be live as long as the reader is used.
-    mutation_reader make_sstable_reader(const query::partition_range& range) const;
+    // The 'range' and 'slice' parameters must be live as long as the reader is used.
+    mutation_reader make_sstable_reader(const query::partition_range& range,
+        const query::partition_slice& slice = query::full_slice) const;
 
     mutation_source sstables_as_mutation_source();
     key_source sstables_as_key_source() const;
@@ -189,8 +224,19 @@ class column_family {
     // Creates a mutation reader which covers all data sources for this column family.
     // Caller needs to ensure that column_family remains live (FIXME: relax this).
     // Note: for data queries use query() instead.
-    // The 'range' parameter must be live as long as the reader is used.
-    mutation_reader make_reader(const query::partition_range& range = query::full_partition_range) const;
+    // Only clustering rows selected by the slice are guaranteed to be present
+    // in returned partitions, other rows may or may not be there.
+    // The 'range' and 'slice' parameters must be live as long as the reader is used.
+    mutation_reader make_reader(const query::partition_range& range = query::full_partition_range,
+        const query::partition_slice& slice = query::full_slice) const;
+
+    // Creates a reader which returns partitions of the memtables and sstables
+    // as fragments, bypassing the cache. Partitions read from sstables are
+    // never materialized as a whole, which makes it suitable for reading
+    // large amounts of data, like streaming does. Memtable partitions are
+    // already in memory and are only split into fragments.
+    // Caller needs to ensure that column_family remains live.
+    streamed_mutation_reader make_streamed_reader(const query::partition_range& range) const;
 
     mutation_source as_mutation_source() const;
 
@@ -270,6 +316,11 @@ class column_family {
     future<> compact_all_sstables();
     // Compact all sstables provided in the vector.
     future<> compact_sstables(sstables::compaction_descriptor descriptor);
+    // Lowest timestamp of the data in the memtables, which aren't flushed yet.
+    api::timestamp_type min_memtable_timestamp() const;
+    // Removes the given sstables without compacting them. Only for sstables
+    // whose data can be discarded, see sstables::get_fully_expired_sstables().
+    future<> drop_sstables(std::vector<sstables::shared_sstable> sstables);
 
     future<bool> snapshot_exists(sstring name);
 
@@ -286,7 +337,22 @@ class column_family {
         _config.enable_incremental_backups = val;
     }
 
+    // Estimated number of partitions held by this shard. Partitions present
+    // in several sstables or memtables are counted once per copy.
+    uint64_t estimated_partitions() const;
+    // Estimated mean number of CQL rows per partition, from the statistics
+    // of the sstables.
+    double estimated_rows_per_partition() const;
+
     lw_shared_ptr<sstable_list> get_sstables();
+    // Returns the sstables which aren't being compacted.
+    lw_shared_ptr<sstable_list> get_sstables_for_compaction();
+    bool compactions_in_progress() const {
+        return !_compacting_sstables.empty();
+    }
+    const std::unordered_set<sstables::shared_sstable>& compacting_sstables() const {
+        return _compacting_sstables;
+    }
     size_t sstables_count();
     int64_t get_unleveled_sstables() const;
 
@@ -306,6 +372,23 @@ class column_family {
     void set_compaction_manager_queued(bool compaction_manager_queued);
     bool pending_compactions() const;
 
+    void add_coordinator_read_latency(std::chrono::microseconds latency) {
+        _stats.estimated_coordinator_read.add(latency.count());
+    }
+
+    // How long coordinators wait for the replicas of a read before also
+    // sending it to an extra one, according to the speculative_retry option.
+    // Disengaged when too few reads were seen yet to know the percentile.
+    std::experimental::optional<std::chrono::microseconds> speculative_retry_delay();
+
+    void mark_speculative_retry() {
+        ++_stats.speculative_retries;
+    }
+
+    void mark_speculative_retry_won() {
+        ++_stats.speculative_retries_won;
+    }
+
     const stats& get_stats() const {
         return _stats;
     }
@@ -444,7 +527,10 @@ class keyspace {
         bool enable_cache = true;
         bool enable_incremental_backups = false;
         size_t max_memtable_size = 5'000'000;
+        size_t column_index_size = 64 * 1024;
+        bool enable_in_memory_compaction = false;
         logalloc::region_group* dirty_memory_region_group = nullptr;
+        db::write_admission_controller* write_admission = nullptr;
     };
 private:
     std::unique_ptr<locator::abstract_replication_strategy> _replication_strategy;
@@ -514,8 +600,7 @@ class database {
     // compaction_manager object is referenced by all column families of a database.
     compaction_manager _compaction_manager;
     std::vector<scollectd::registration> _collectd;
-    timer<> _throttling_timer{[this] { unthrottle(); }};
-    circular_buffer<promise<>> _throttled_requests;
+    std::unique_ptr<db::write_admission_controller> _write_admission;
 
     future<> init_commitlog();
     future<> apply_in_memory(const frozen_mutation&, const db::replay_position&);
@@ -529,9 +614,7 @@ class database {
     void create_in_memory_keyspace(const lw_shared_ptr<keyspace_metadata>& ksm);
     friend void db::system_keyspace::make(database& db, bool durable, bool volatile_testing_only);
     void setup_collectd();
-    future<> throttle();
     future<> do_apply(const frozen_mutation&);
-    void unthrottle();
 public:
     static utils::UUID empty_version;
 
@@ -630,6 +713,9 @@ class database {
     future<> truncate(db_clock::time_point truncated_at, sstring ksname, sstring cfname);
     future<> truncate(db_clock::time_point truncated_at, const keyspace& ks, column_family& cf);
 
+    const db::write_admission_controller& get_write_admission_controller() const {
+        return *_write_admission;
+    }
     const logalloc::region_group& dirty_memory_region_group() const {
         return _dirty_memory_region_group;
     }
@@ -655,9 +741,16 @@ inline
 void
 column_family::seal_on_overflow() {
     ++_mutation_count;
-    if (active_memtable().occupancy().total_space() >= _config.max_memtable_size) {
-        // FIXME: if sparse, do some in-memory compaction first
-        // FIXME: maybe merge with other in-memory memtables
+    auto space = active_memtable().occupancy().total_space();
+    if (space >= _config.max_memtable_size) {
+        // While the previously sealed memtable still waits to be flushed,
+        // sealing another one would only queue it behind. Keep writing to
+        // the active memtable instead, which merges what would have been
+        // several queued memtables into one, with overwritten data dropped.
+        if (_config.enable_in_memory_compaction && _waiting_flush
+                && space / max_merged_memtable_size_factor < _config.max_memtable_size) {
+            return;
+        }
         _mutation_count = 0;
         seal_active_memtable();
     }
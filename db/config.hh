@@ -259,7 +259,7 @@ class config {
             "Related information: Initializing a multiple node cluster (single data center) and Initializing a multiple node cluster (multiple data centers)."  \
     )                                                   \
     /* Common compaction settings */    \
-    val(compaction_throughput_mb_per_sec, uint32_t, 16, Unused,     \
+    val(compaction_throughput_mb_per_sec, uint32_t, 16, Used,     \
             "Throttles compaction to the specified total throughput across the entire system. The faster you insert data, the faster you need to compact in order to keep the SSTable count down. The recommended Value is 16 to 32 times the rate of write throughput (in MBs/second). Setting the value to 0 disables compaction throttling.\n"  \
             "Related information: Configuring compaction"   \
     )                                                   \
@@ -325,7 +325,7 @@ class config {
     val(compaction_preheat_key_cache, bool, true, Unused,                \
             "When set to true , cached row keys are tracked during compaction, and re-cached to their new positions in the compacted SSTable. If you have extremely large key caches for tables, set the value to false ; see Global row and key caches properties."  \
     )                                                   \
-    val(concurrent_compactors, uint32_t, 0, Invalid,     \
+    val(concurrent_compactors, uint32_t, 0, Used,     \
             "Sets the number of concurrent compaction processes allowed to run simultaneously on a node, not including validation compactions for anti-entropy repair. Simultaneous compactions help preserve read performance in a mixed read-write workload by mitigating the tendency of small SSTables to accumulate during a single long-running compaction. If compactions run too slowly or too fast, change compaction_throughput_mb_per_sec first."  \
     )                                                   \
     val(in_memory_compaction_limit_in_mb, uint32_t, 64, Invalid,     \
@@ -363,8 +363,11 @@ class config {
     val(memtable_offheap_space_in_mb, uint32_t, 0, Unused,     \
             "See memtable_heap_space_in_mb"  \
     )   \
+    val(enable_in_memory_compaction, bool, false, Used,     \
+            "Before a sealed memtable is flushed, drop the data shadowed by tombstones, expired cells and tombstones older than gc_grace_seconds from it, so that less data is written to sstables. While a sealed memtable waits to be flushed, writes keep going to the active memtable even past its size limit, instead of sealing more memtables behind it."  \
+    )   \
     /* Cache and index settings */  \
-    val(column_index_size_in_kb, uint32_t, 64, Unused,     \
+    val(column_index_size_in_kb, uint32_t, 64, Used,     \
             "Granularity of the index of rows within a partition. For huge rows, decrease this setting to improve seek time. If you use key cache, be careful not to make this setting too large because key cache will be overwhelmed. If you're unsure of the size of the rows, it's best to use the default setting."  \
     )   \
     val(index_summary_capacity_in_mb, uint32_t, 0, Unused,     \
@@ -433,6 +436,9 @@ class config {
     val(storage_port, uint16_t, 7000, Unused,                \
             "The port for inter-node communication."  \
     )                                                   \
+    val(shard_port_base, uint16_t, 17000, Used,                \
+            "The first of the per-shard ports for inter-node communication. Besides the storage_port, each shard listens on shard_port_base plus its cpu id, and other nodes connect there to reach the shard owning the data. Ports shard_port_base up to shard_port_base + smp - 1 must be open between nodes in firewalls, and the setting must be the same on all nodes of the cluster."  \
+    )                                                   \
     /* Advanced automatic backup setting */ \
     val(auto_snapshot, bool, true, Used,     \
             "Enable or disable whether a snapshot is taken of the data before keyspace truncation or dropping of tables. To prevent data loss, using the default setting is strongly advised. If you set to false, you will lose data on truncation or drop."  \
@@ -594,13 +600,13 @@ class config {
     )   \
     /* Advanced fault detection settings */ \
     /* Settings to handle poorly performing or failing nodes. */    \
-    val(dynamic_snitch_badness_threshold, double, 0, Unused,     \
+    val(dynamic_snitch_badness_threshold, double, 0.1, Used,     \
             "Sets the performance threshold for dynamically routing requests away from a poorly performing node. A value of 0.2 means Cassandra continues to prefer the static snitch values until the node response time is 20% worse than the best performing node. Until the threshold is reached, incoming client requests are statically routed to the closest replica (as determined by the snitch). Having requests consistently routed to a given replica can help keep a working set of data hot when read repair is less than 1."  \
     )   \
-    val(dynamic_snitch_reset_interval_in_ms, uint32_t, 60000, Unused,     \
+    val(dynamic_snitch_reset_interval_in_ms, uint32_t, 60000, Used,     \
             "Time interval in milliseconds to reset all node scores, which allows a bad node to recover."  \
     )   \
-    val(dynamic_snitch_update_interval_in_ms, uint32_t, 100, Unused,     \
+    val(dynamic_snitch_update_interval_in_ms, uint32_t, 100, Used,     \
             "The time interval for how often the snitch calculates node scores. Because score calculation is CPU intensive, be careful when reducing this interval."  \
     )   \
     val(hinted_handoff_enabled, bool, true, Unused,     \
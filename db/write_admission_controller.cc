@@ -0,0 +1,120 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <seastar/core/sleep.hh>
+
+#include "write_admission_controller.hh"
+#include "exceptions/exceptions.hh"
+
+using namespace std::chrono_literals;
+
+namespace db {
+
+static constexpr auto poll_period = 10ms;
+
+write_admission_controller::write_admission_controller(config cfg, std::function<size_t()> memory_used)
+    : _cfg(std::move(cfg))
+    , _memory_used(std::move(memory_used))
+    , _poll_timer([this] {
+        on_memory_released();
+        expire();
+    })
+{
+    assert(_cfg.soft_limit < _cfg.hard_limit);
+}
+
+write_admission_controller::~write_admission_controller() {
+    while (!_waiters.empty()) {
+        _waiters.front().pr.set_exception(exceptions::overloaded_exception("Write admission controller stopped"));
+        _waiters.pop_front();
+    }
+}
+
+std::chrono::microseconds write_admission_controller::delay_for(size_t memory_used) const {
+    auto excess = double(memory_used - _cfg.soft_limit) / (_cfg.hard_limit - _cfg.soft_limit);
+    return std::chrono::microseconds(int64_t(_cfg.max_delay.count() * excess));
+}
+
+future<> write_admission_controller::admit(size_t size) {
+    auto used = _memory_used();
+    // Writes which find others queued are queued too, to keep admission fair.
+    if (_waiters.empty()) {
+        if (used < _cfg.soft_limit) {
+            return make_ready_future<>();
+        }
+        if (used < _cfg.hard_limit) {
+            ++_stats.delayed;
+            utils::latency_counter lc;
+            lc.start();
+            return sleep(delay_for(used)).then([this, lc] () mutable {
+                _stats.wait_time.mark(lc);
+            });
+        }
+    }
+    if (_waiters.size() >= _cfg.max_queued_writes) {
+        ++_stats.rejected;
+        return make_exception_future<>(exceptions::overloaded_exception(
+            sprint("Too many writes waiting for memtable flushes: %lu", _waiters.size())));
+    }
+    ++_stats.queued;
+    // A write larger than what may ever become available would block the queue.
+    size = std::min(size, _cfg.hard_limit - _cfg.soft_limit);
+    _waiters.emplace_back(size, clock_type::now() + _cfg.timeout);
+    if (!_poll_timer.armed()) {
+        _poll_timer.arm_periodic(poll_period);
+    }
+    return _waiters.back().pr.get_future();
+}
+
+void write_admission_controller::on_memory_released() {
+    auto used = _memory_used();
+    if (used >= _cfg.hard_limit) {
+        return;
+    }
+    // Admit only as many writes as fit in the released memory, so that the
+    // queue doesn't overshoot the limit when it is drained.
+    size_t available = _cfg.hard_limit - used;
+    while (!_waiters.empty() && _waiters.front().size <= available) {
+        auto& w = _waiters.front();
+        available -= w.size;
+        _stats.wait_time.mark(w.lc);
+        w.pr.set_value();
+        _waiters.pop_front();
+    }
+    if (_waiters.empty()) {
+        _poll_timer.cancel();
+    }
+}
+
+void write_admission_controller::expire() {
+    auto now = clock_type::now();
+    while (!_waiters.empty() && _waiters.front().deadline <= now) {
+        auto& w = _waiters.front();
+        ++_stats.rejected;
+        w.pr.set_exception(exceptions::overloaded_exception("Timed out waiting for memtable flushes"));
+        _waiters.pop_front();
+    }
+    if (_waiters.empty()) {
+        _poll_timer.cancel();
+    }
+}
+
+}
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <seastar/core/future.hh>
+#include <seastar/core/timer.hh>
+#include <seastar/core/circular_buffer.hh>
+
+#include "utils/histogram.hh"
+
+namespace db {
+
+// Admission control of writes, driven by the amount of memory held by
+// memtables which were not flushed yet (dirty memory).
+//
+// Below the soft limit writes are admitted right away. Between the soft and
+// the hard limit each write is delayed in proportion to how far past the
+// soft limit we are, which slows writers down smoothly when flushes fall
+// behind. Past the hard limit writes are queued and admitted in order as
+// flushes release memory. Queued writes are rejected with
+// exceptions::overloaded_exception when the queue is full or when they wait
+// for longer than the timeout, since their coordinators would give up on
+// them anyway.
+//
+// There is one controller per shard.
+class write_admission_controller {
+public:
+    using clock_type = std::chrono::steady_clock;
+
+    struct config {
+        size_t soft_limit;
+        size_t hard_limit;
+        // Delay of writes just below the hard limit.
+        std::chrono::microseconds max_delay = std::chrono::milliseconds(10);
+        size_t max_queued_writes = 100000;
+        std::chrono::milliseconds timeout = std::chrono::milliseconds(2000);
+    };
+
+    struct stats {
+        // Writes which were delayed below the hard limit.
+        uint64_t delayed = 0;
+        // Writes which were queued past the hard limit.
+        uint64_t queued = 0;
+        uint64_t rejected = 0;
+        // Time spent by delayed and queued writes before admission, in nanoseconds.
+        utils::ihistogram wait_time{256};
+    };
+private:
+    struct waiter {
+        promise<> pr;
+        size_t size;
+        clock_type::time_point deadline;
+        utils::latency_counter lc;
+
+        waiter(size_t size, clock_type::time_point deadline)
+            : size(size)
+            , deadline(deadline)
+        {
+            lc.start();
+        }
+    };
+
+    config _cfg;
+    std::function<size_t()> _memory_used;
+    circular_buffer<waiter> _waiters;
+    // Memory may also be released by other means than flushes, e.g. when
+    // memtables are dropped, so queued writes are periodically rechecked.
+    timer<> _poll_timer;
+    stats _stats;
+private:
+    void expire();
+    std::chrono::microseconds delay_for(size_t memory_used) const;
+public:
+    // memory_used returns the current amount of dirty memory.
+    write_admission_controller(config cfg, std::function<size_t()> memory_used);
+    write_admission_controller(write_admission_controller&&) = delete;
+    ~write_admission_controller();
+
+    // Resolves when a write which adds about size bytes of dirty memory may
+    // proceed.
+    future<> admit(size_t size);
+
+    // Admits queued writes for which there is enough memory. Should be
+    // called whenever dirty memory is released, e.g. after a flush.
+    void on_memory_released();
+
+    size_t queued_writes() const {
+        return _waiters.size();
+    }
+
+    const stats& get_stats() const {
+        return _stats;
+    }
+};
+
+}
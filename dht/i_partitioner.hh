@@ -256,6 +256,12 @@ class i_partitioner {
      */
     virtual unsigned shard_of(const token& t) const = 0;
 
+    /**
+     * Calculates the shard that handles a particular token on a node
+     * running shard_count shards, which may differ from the local one.
+     */
+    virtual unsigned shard_of(const token& t, unsigned shard_count) const = 0;
+
     /**
      * @return bytes that represent the token as required by get_token_validator().
      */
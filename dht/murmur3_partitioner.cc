@@ -178,17 +178,22 @@ murmur3_partitioner::get_token_validator() {
 
 unsigned
 murmur3_partitioner::shard_of(const token& t) const {
+    return shard_of(t, smp::count);
+}
+
+unsigned
+murmur3_partitioner::shard_of(const token& t, unsigned shard_count) const {
     switch (t._kind) {
         case token::kind::before_all_keys:
             return 0;
         case token::kind::after_all_keys:
-            return smp::count - 1;
+            return shard_count - 1;
         case token::kind::key:
             int64_t l = long_token(t);
             // treat l as a fraction between 0 and 1 and use 128-bit arithmetic to
             // divide that range evenly among shards:
             uint64_t adjusted = uint64_t(l) + uint64_t(std::numeric_limits<int64_t>::min());
-            return (__int128(adjusted) * smp::count) >> 64;
+            return (__int128(adjusted) * shard_count) >> 64;
     }
     assert(0);
 }
@@ -40,6 +40,7 @@ class murmur3_partitioner final : public i_partitioner {
     virtual sstring to_sstring(const dht::token& t) const override;
     virtual dht::token from_sstring(const sstring& t) const override;
     virtual unsigned shard_of(const token& t) const override;
+    virtual unsigned shard_of(const token& t, unsigned shard_count) const override;
 private:
     static int64_t normalize(int64_t in);
     token get_token(bytes_view key);
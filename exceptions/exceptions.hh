@@ -155,6 +155,8 @@ struct mutation_write_timeout_exception : public request_timeout_exception {
 struct overloaded_exception : public cassandra_exception {
     overloaded_exception(size_t c) :
         cassandra_exception(exception_code::OVERLOADED, sprint("Too many in flight hints: %lu", c)) {}
+    overloaded_exception(sstring msg) :
+        cassandra_exception(exception_code::OVERLOADED, std::move(msg)) {}
 };
 
 class request_validation_exception : public cassandra_exception {
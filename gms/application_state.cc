@@ -60,8 +60,8 @@ static const std::map<application_state, sstring> application_state_names = {
     {application_state::NET_VERSION,            "NET_VERSION"},
     {application_state::HOST_ID,                "HOST_ID"},
     {application_state::TOKENS,                 "TOKENS"},
-    {application_state::X1,                     "X1"},
-    {application_state::X2,                     "X2"},
+    {application_state::SUPPORTED_FEATURES,     "SUPPORTED_FEATURES"},
+    {application_state::SHARD_COUNT,            "SHARD_COUNT"},
     {application_state::X3,                     "X3"},
     {application_state::X4,                     "X4"},
     {application_state::X5,                     "X5"},
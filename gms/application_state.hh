@@ -59,8 +59,8 @@ enum class application_state
     HOST_ID,
     TOKENS,
     // pad to allow adding new states to existing cluster
-    X1,
-    X2,
+    SUPPORTED_FEATURES,
+    SHARD_COUNT,
     X3,
     X4,
     X5,
@@ -233,6 +233,15 @@ class versioned_value {
         versioned_value severity(double value) {
             return versioned_value(to_sstring_sprintf(value, "%g"));
         }
+
+        // Comma-separated names of the features supported by the node
+        versioned_value supported_features(const sstring& features) {
+            return versioned_value(features);
+        }
+
+        versioned_value shard_count(unsigned count) {
+            return versioned_value(sprint("%d", count));
+        }
     };
 
     // The following replaces VersionedValueSerializer from the Java code
@@ -22,6 +22,9 @@
 #include "locator/abstract_replication_strategy.hh"
 #include "utils/class_registrator.hh"
 #include "exceptions/exceptions.hh"
+#include "core/future-util.hh"
+#include "core/reactor.hh"
+#include <boost/range/algorithm/find.hpp>
 
 namespace locator {
 
@@ -70,6 +73,13 @@ void abstract_replication_strategy::validate_replication_strategy(const sstring&
 }
 
 std::vector<inet_address> abstract_replication_strategy::get_natural_endpoints(const token& search_token) {
+    auto placement = current_placement();
+    if (placement) {
+        ++_cache_hits_count;
+        return boost::copy_range<std::vector<inet_address>>(placement->get_replicas(search_token));
+    }
+    maybe_update_placement();
+
     const token& key_token = _token_metadata.first_token(search_token);
     auto& cached_endpoints = get_cached_endpoints();
     auto res = cached_endpoints.find(key_token);
@@ -85,6 +95,68 @@ std::vector<inet_address> abstract_replication_strategy::get_natural_endpoints(c
     return res->second;
 }
 
+const replica_placement* abstract_replication_strategy::current_placement() const {
+    if (_placement && _placement->ring_version() == _token_metadata.get_ring_version()) {
+        return _placement.get();
+    }
+    return nullptr;
+}
+
+// Number of tokens whose replicas are computed between two yields
+static constexpr size_t placement_tokens_per_batch = 64;
+
+future<lw_shared_ptr<const replica_placement>> abstract_replication_strategy::build_placement() const {
+    auto ring_version = _token_metadata.get_ring_version();
+    auto placement = make_lw_shared<replica_placement>(ring_version);
+    auto tokens = make_lw_shared<std::vector<token>>(_token_metadata.sorted_tokens());
+    auto i = make_lw_shared<size_t>(0);
+    // Start with a yield, so that the caller doesn't wait for the first batch.
+    return later().then([this, alive = _alive, ring_version, placement, tokens, i] {
+        return repeat([this, alive, ring_version, placement, tokens, i] {
+            if (!*alive || _token_metadata.get_ring_version() != ring_version) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            auto end = std::min(tokens->size(), *i + placement_tokens_per_batch);
+            for (; *i < end; ++*i) {
+                auto& t = (*tokens)[*i];
+                placement->push_back(t, calculate_natural_endpoints(t, _token_metadata));
+            }
+            if (*i == tokens->size()) {
+                return make_ready_future<stop_iteration>(stop_iteration::yes);
+            }
+            return later().then([] { return stop_iteration::no; });
+        });
+    }).then([placement, tokens, i] {
+        if (*i != tokens->size()) {
+            return lw_shared_ptr<const replica_placement>();
+        }
+        return lw_shared_ptr<const replica_placement>(placement);
+    });
+}
+
+future<> abstract_replication_strategy::update_placement() {
+    return build_placement().then([this, alive = _alive] (lw_shared_ptr<const replica_placement> placement) {
+        if (*alive && placement && placement->ring_version() == _token_metadata.get_ring_version()) {
+            _placement = std::move(placement);
+        }
+    });
+}
+
+void abstract_replication_strategy::maybe_update_placement() {
+    auto ring_version = _token_metadata.get_ring_version();
+    if (_placement_ring_version == ring_version) {
+        return;
+    }
+    _placement_ring_version = ring_version;
+    update_placement().then_wrapped([ks_name = _ks_name] (future<> f) {
+        try {
+            f.get();
+        } catch (...) {
+            logger.warn("Failed to compute the replica placement of keyspace {}: {}", ks_name, std::current_exception());
+        }
+    });
+}
+
 void abstract_replication_strategy::validate_replication_factor(sstring rf) const
 {
     try {
@@ -108,21 +180,33 @@ abstract_replication_strategy::get_cached_endpoints() {
     return _cached_endpoints;
 }
 
+template <typename Func>
+void abstract_replication_strategy::for_each_natural_endpoints(token_metadata& tm, Func&& func) const {
+    auto placement = current_placement();
+    if (placement && &tm == &_token_metadata) {
+        for (size_t i = 0; i < placement->size(); ++i) {
+            func(placement->token_at(i), placement->replicas_at(i));
+        }
+        return;
+    }
+    for (auto& t : tm.sorted_tokens()) {
+        const auto eps = calculate_natural_endpoints(t, tm);
+        func(t, replica_placement::replica_range(eps.begin(), eps.end()));
+    }
+}
+
 std::vector<range<token>>
 abstract_replication_strategy::get_ranges(inet_address ep) const {
     std::vector<range<token>> ret;
     auto prev_tok = _token_metadata.sorted_tokens().back();
-    for (auto tok : _token_metadata.sorted_tokens()) {
-        for (inet_address a : calculate_natural_endpoints(tok, _token_metadata)) {
-            if (a == ep) {
-                ret.emplace_back(
-                        range<token>::bound(prev_tok, false),
-                        range<token>::bound(tok, true));
-                break;
-            }
+    for_each_natural_endpoints(_token_metadata, [&] (const token& tok, replica_placement::replica_range eps) {
+        if (boost::find(eps, ep) != eps.end()) {
+            ret.emplace_back(
+                    range<token>::bound(prev_tok, false),
+                    range<token>::bound(tok, true));
         }
         prev_tok = tok;
-    }
+    });
     return ret;
 }
 
@@ -130,41 +214,39 @@ std::vector<range<token>>
 abstract_replication_strategy::get_primary_ranges(inet_address ep) {
     std::vector<range<token>> ret;
     auto prev_tok = _token_metadata.sorted_tokens().back();
-    for (auto tok : _token_metadata.sorted_tokens()) {
-        auto&& eps = calculate_natural_endpoints(tok, _token_metadata);
+    for_each_natural_endpoints(_token_metadata, [&] (const token& tok, replica_placement::replica_range eps) {
         if (eps.size() > 0 && eps[0] == ep) {
             ret.emplace_back(
                     range<token>::bound(prev_tok, false),
                     range<token>::bound(tok, true));
         }
         prev_tok = tok;
-    }
+    });
     return ret;
 }
 
 std::unordered_multimap<inet_address, range<token>>
 abstract_replication_strategy::get_address_ranges(token_metadata& tm) const {
     std::unordered_multimap<inet_address, range<token>> ret;
-    for (auto& t : tm.sorted_tokens()) {
+    for_each_natural_endpoints(tm, [&] (const token& t, replica_placement::replica_range eps) {
         range<token> r = tm.get_primary_range_for(t);
-        auto eps = calculate_natural_endpoints(t, tm);
-        logger.debug("token={}, primary_range={}, address={}", t, r, eps);
+        logger.debug("token={}, primary_range={}, address={}", t, r, boost::copy_range<std::vector<inet_address>>(eps));
         for (auto ep : eps) {
             ret.emplace(ep, r);
         }
-    }
+    });
     return ret;
 }
 
 std::unordered_multimap<range<token>, inet_address>
 abstract_replication_strategy::get_range_addresses(token_metadata& tm) const {
     std::unordered_multimap<range<token>, inet_address> ret;
-    for (auto& t : tm.sorted_tokens()) {
+    for_each_natural_endpoints(tm, [&] (const token& t, replica_placement::replica_range eps) {
         range<token> r = tm.get_primary_range_for(t);
-        for (auto ep : calculate_natural_endpoints(t, tm)) {
+        for (auto ep : eps) {
             ret.emplace(r, ep);
         }
-    }
+    });
     return ret;
 }
 
@@ -28,6 +28,7 @@
 #include "dht/i_partitioner.hh"
 #include "token_metadata.hh"
 #include "snitch_base.hh"
+#include "replica_placement.hh"
 
 // forward declaration since database.hh includes this file
 class keyspace;
@@ -53,6 +54,23 @@ class abstract_replication_strategy {
 
     std::unordered_map<token, std::vector<inet_address>>&
     get_cached_endpoints();
+
+    // Replicas of every token of the current ring, built in the background
+    // after the ring changes. Until it is ready, get_natural_endpoints()
+    // falls back to _cached_endpoints.
+    lw_shared_ptr<const replica_placement> _placement;
+    long _placement_ring_version = -1; // last version whose build was started
+    // Tells background builds that this strategy was destroyed.
+    lw_shared_ptr<bool> _alive = make_lw_shared<bool>(true);
+
+    // Returns the placement if it is up to date with the ring, nullptr otherwise.
+    const replica_placement* current_placement() const;
+    void maybe_update_placement();
+
+    // Calls func(token, replica_placement::replica_range) for every token
+    // of the ring of tm, in order.
+    template <typename Func>
+    void for_each_natural_endpoints(token_metadata& tm, Func&& func) const;
 protected:
     sstring _ks_name;
     // TODO: Do we need this member at all?
@@ -87,7 +105,9 @@ class abstract_replication_strategy {
         const std::map<sstring, sstring>& config_options,
         replication_strategy_type my_type);
     virtual std::vector<inet_address> calculate_natural_endpoints(const token& search_token, token_metadata& tm) const = 0;
-    virtual ~abstract_replication_strategy() {}
+    virtual ~abstract_replication_strategy() {
+        *_alive = false;
+    }
     static std::unique_ptr<abstract_replication_strategy> create_replication_strategy(const sstring& ks_name, const sstring& strategy_name, token_metadata& token_metadata, const std::map<sstring, sstring>& config_options);
     static void validate_replication_strategy(const sstring& ks_name,
                                               const sstring& strategy_name,
@@ -98,11 +118,22 @@ class abstract_replication_strategy {
     virtual std::experimental::optional<std::set<sstring>> recognized_options() const = 0;
     virtual size_t get_replication_factor() const = 0;
     uint64_t get_cache_hits_count() const { return _cache_hits_count; }
+
+    // Computes the replica placement of the current ring, yielding between
+    // tokens. Resolves to nullptr if the ring changed in the meantime.
+    future<lw_shared_ptr<const replica_placement>> build_placement() const;
+
+    // Builds the placement of the current ring and uses it from then on,
+    // get_natural_endpoints() starts this in the background by itself.
+    future<> update_placement();
+
     replication_strategy_type get_type() const { return _my_type; }
 
     // get_ranges() returns the list of ranges held by the given endpoint.
     // It the analogue of Origin's getAddressRanges().get(endpoint).
-    // This function is not efficient, and not meant for the fast path.
+    // This function walks the whole ring, and is not meant for the fast path.
+    // Like the functions below, it reads the replica placement table when
+    // it is up to date, and computes the replicas of every token otherwise.
     std::vector<range<token>> get_ranges(inet_address ep) const;
     // get_primary_ranges() returns the list of "primary ranges" for the given
     // endpoint. "Primary ranges" are the ranges that the node is responsible
@@ -0,0 +1,131 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Modified by Cloudius Systems.
+ * Copyright 2015 Cloudius Systems.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "locator/dynamic_snitch.hh"
+#include "locator/snitch_base.hh"
+
+#include <algorithm>
+
+namespace locator {
+
+dynamic_snitch::dynamic_snitch(config cfg)
+    : _cfg(cfg)
+    , _update_timer([this] { update_scores(); })
+    , _reset_timer([this] { reset(); }) {
+    _update_timer.arm_periodic(_cfg.update_interval);
+    _reset_timer.arm_periodic(_cfg.reset_interval);
+}
+
+void dynamic_snitch::receive_timing(inet_address ep, std::chrono::microseconds latency) {
+    auto i = _latencies.emplace(ep, latency.count());
+    if (!i.second) {
+        i.first->second += alpha * (latency.count() - i.first->second);
+    }
+}
+
+void dynamic_snitch::set_severity(inet_address ep, double severity) {
+    _severities[ep] = severity;
+}
+
+void dynamic_snitch::remove_endpoint(inet_address ep) {
+    _latencies.erase(ep);
+    _severities.erase(ep);
+    _scores.erase(ep);
+}
+
+void dynamic_snitch::update_scores() {
+    double max_latency = 1;
+    for (auto&& x : _latencies) {
+        max_latency = std::max(max_latency, x.second);
+    }
+    _scores.clear();
+    for (auto&& x : _latencies) {
+        _scores[x.first] = x.second / max_latency;
+    }
+    for (auto&& x : _severities) {
+        _scores[x.first] += x.second;
+    }
+}
+
+void dynamic_snitch::reset() {
+    _latencies.clear();
+}
+
+// Endpoints we know nothing about are assumed to be fine
+double dynamic_snitch::score(inet_address ep) const {
+    auto i = _scores.find(ep);
+    return i == _scores.end() ? 0 : i->second;
+}
+
+void dynamic_snitch::sort_by_score(inet_address address, std::vector<inet_address>& addresses) {
+    // addresses are sorted by proximity already, which breaks ties.
+    std::stable_sort(addresses.begin(), addresses.end(), [this] (inet_address a1, inet_address a2) {
+        return score(a1) < score(a2);
+    });
+}
+
+void dynamic_snitch::sort_by_proximity(inet_address address, std::vector<inet_address>& addresses) {
+    i_endpoint_snitch::get_local_snitch_ptr()->sort_by_proximity(address, addresses);
+    if (addresses.size() < 2) {
+        return;
+    }
+    if (_cfg.badness_threshold == 0) {
+        sort_by_score(address, addresses);
+        return;
+    }
+
+    // Keep the order of the configured snitch, which keeps the working set
+    // of each replica hot, unless one of the replicas it prefers is much
+    // worse than what the same position would get if sorted by score.
+    std::vector<double> snitch_ordered_scores;
+    snitch_ordered_scores.reserve(addresses.size());
+    for (auto&& ep : addresses) {
+        snitch_ordered_scores.push_back(score(ep));
+    }
+    auto sorted_scores = snitch_ordered_scores;
+    std::sort(sorted_scores.begin(), sorted_scores.end());
+
+    for (size_t i = 0; i < sorted_scores.size(); ++i) {
+        if (snitch_ordered_scores[i] > sorted_scores[i] * (1.0 + _cfg.badness_threshold)) {
+            sort_by_score(address, addresses);
+            return;
+        }
+    }
+}
+
+} // namespace locator
@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements.  See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership.  The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License.  You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * Modified by Cloudius Systems.
+ * Copyright 2015 Cloudius Systems.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include <unordered_map>
+#include <vector>
+
+#include "gms/inet_address.hh"
+#include "core/timer.hh"
+#include "core/reactor.hh"
+
+namespace locator {
+
+using inet_address = gms::inet_address;
+
+/**
+ * Orders replicas by how fast they have recently been answering, on top of
+ * the proximity given by the configured snitch (Origin's
+ * DynamicEndpointSnitch).
+ *
+ * Every shard keeps its own instance, fed with the latencies of the
+ * requests it sends and with the severity each node gossips about itself.
+ * The score of an endpoint is its exponentially-decayed latency divided
+ * by the largest one, plus its severity; lower is better. Scores are only
+ * recomputed every update interval, and latencies are forgotten every
+ * reset interval so that a node which stopped receiving requests because
+ * it was slow gets a chance to recover.
+ */
+class dynamic_snitch {
+public:
+    struct config {
+        // How much worse than the best replica the one preferred by the
+        // configured snitch may be before it is passed over. 0 sorts
+        // replicas by their score only.
+        double badness_threshold = 0.1;
+        std::chrono::milliseconds update_interval = std::chrono::milliseconds(100);
+        std::chrono::milliseconds reset_interval = std::chrono::milliseconds(60000);
+    };
+private:
+    // Weight of a new sample in the moving average of the latencies of an endpoint
+    static constexpr double alpha = 0.25;
+
+    config _cfg;
+    // Moving averages of the latencies, in microseconds
+    std::unordered_map<inet_address, double> _latencies;
+    std::unordered_map<inet_address, double> _severities;
+    std::unordered_map<inet_address, double> _scores;
+    timer<lowres_clock> _update_timer;
+    timer<lowres_clock> _reset_timer;
+private:
+    double score(inet_address ep) const;
+    void sort_by_score(inet_address address, std::vector<inet_address>& addresses);
+public:
+    explicit dynamic_snitch(config cfg = config());
+
+    void receive_timing(inet_address ep, std::chrono::microseconds latency);
+
+    // Severity gossiped by ep, see application_state::SEVERITY.
+    void set_severity(inet_address ep, double severity);
+
+    void remove_endpoint(inet_address ep);
+
+    // Sorts addresses by proximity to address according to the configured
+    // snitch, then by score if the replicas it prefers are too slow.
+    void sort_by_proximity(inet_address address, std::vector<inet_address>& addresses);
+
+    // Computes the scores from the latencies and severities received so far.
+    // Normally called every update interval.
+    void update_scores();
+
+    // Forgets all latencies. Normally called every reset interval.
+    void reset();
+
+    const std::unordered_map<inet_address, double>& get_scores() const {
+        return _scores;
+    }
+};
+
+} // namespace locator
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2015 Cloudius Systems, Ltd.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "locator/replica_placement.hh"
+#include <algorithm>
+
+namespace locator {
+
+replica_placement::replica_range replica_placement::get_replicas(const dht::token& search_token) const {
+    if (_tokens.empty()) {
+        return replica_range(_replicas.end(), _replicas.end());
+    }
+    auto i = std::lower_bound(_tokens.begin(), _tokens.end(), search_token);
+    if (i == _tokens.end()) {
+        i = _tokens.begin();
+    }
+    return replicas_at(std::distance(_tokens.begin(), i));
+}
+
+}
@@ -0,0 +1,81 @@
+/*
+ * Copyright (C) 2015 Cloudius Systems, Ltd.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <boost/range/iterator_range.hpp>
+#include "gms/inet_address.hh"
+#include "dht/i_partitioner.hh"
+
+namespace locator {
+
+// The replicas of every token of the ring, as computed by a replication
+// strategy for one version of the ring (token_metadata::get_ring_version()).
+//
+// Tokens are kept sorted, and the replicas of all tokens are stored in a
+// single vector, so a lookup is a binary search and no allocation. Once
+// built, a placement is only accessed through a pointer to const and may be
+// shared by all users of the ring version it was built for.
+class replica_placement {
+public:
+    using replica_range = boost::iterator_range<std::vector<gms::inet_address>::const_iterator>;
+private:
+    long _ring_version;
+    std::vector<dht::token> _tokens;
+    std::vector<gms::inet_address> _replicas;
+    // The replicas of _tokens[i] are _replicas[_offsets[i], _offsets[i + 1])
+    std::vector<uint32_t> _offsets;
+public:
+    explicit replica_placement(long ring_version)
+        : _ring_version(ring_version)
+        , _offsets({0})
+    { }
+
+    // Adds the next token of the ring, tokens have to be added in order.
+    void push_back(dht::token t, const std::vector<gms::inet_address>& replicas) {
+        _tokens.push_back(std::move(t));
+        _replicas.insert(_replicas.end(), replicas.begin(), replicas.end());
+        _offsets.push_back(_replicas.size());
+    }
+
+    long ring_version() const {
+        return _ring_version;
+    }
+
+    size_t size() const {
+        return _tokens.size();
+    }
+
+    const dht::token& token_at(size_t i) const {
+        return _tokens[i];
+    }
+
+    replica_range replicas_at(size_t i) const {
+        return replica_range(_replicas.begin() + _offsets[i], _replicas.begin() + _offsets[i + 1]);
+    }
+
+    // Replicas of search_token, which belongs to the first token of the ring
+    // not smaller than it, wrapping around.
+    replica_range get_replicas(const dht::token& search_token) const;
+};
+
+}
@@ -201,6 +201,7 @@ int main(int ac, char** av) {
             ctx.api_doc = cfg->api_doc_dir();
             sstring cluster_name = cfg->cluster_name();
             sstring listen_address = cfg->listen_address();
+            uint16_t shard_port_base = cfg->shard_port_base();
             sstring rpc_address = cfg->rpc_address();
             sstring api_address = cfg->api_address() != "" ? cfg->api_address() : rpc_address;
             auto seed_provider= cfg->seed_provider();
@@ -224,8 +225,8 @@ int main(int ac, char** av) {
                         });
                     });
                 });
-            }).then([listen_address, seed_provider, cluster_name] {
-                return init_ms_fd_gossiper(listen_address, seed_provider, cluster_name);
+            }).then([listen_address, shard_port_base, seed_provider, cluster_name] {
+                return init_ms_fd_gossiper(listen_address, shard_port_base, seed_provider, cluster_name);
             }).then([&db] {
                 return streaming::stream_session::init_streaming_service(db);
             }).then([&proxy, &db] {
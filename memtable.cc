@@ -21,7 +21,9 @@
 
 #include "memtable.hh"
 #include "frozen_mutation.hh"
+#include "mutation_partition_applier.hh"
 #include "sstable_mutation_readers.hh"
+#include "core/thread.hh"
 
 namespace stdx = std::experimental;
 
@@ -101,6 +103,7 @@ memtable::slice(const query::partition_range& range) const {
 class scanning_reader final : public mutation_reader::impl {
     lw_shared_ptr<const memtable> _memtable;
     const query::partition_range& _range;
+    const query::partition_slice& _slice;
     stdx::optional<dht::decorated_key> _last;
     memtable::partitions_type::const_iterator _i;
     memtable::partitions_type::const_iterator _end;
@@ -141,9 +144,10 @@ class scanning_reader final : public mutation_reader::impl {
         _last_reclaim_counter = current_reclaim_counter;
     }
 public:
-    scanning_reader(lw_shared_ptr<const memtable> m, const query::partition_range& range)
+    scanning_reader(lw_shared_ptr<const memtable> m, const query::partition_range& range, const query::partition_slice& slice)
         : _memtable(std::move(m))
         , _range(range)
+        , _slice(slice)
     { }
 
     virtual future<mutation_opt> operator()() override {
@@ -156,7 +160,7 @@ class scanning_reader final : public mutation_reader::impl {
             // FIXME: Use cache. See column_family::make_reader().
             _delegate_range = _last ? _range.split_after(*_last, dht::ring_position_comparator(*_memtable->_schema)) : _range;
             _delegate = make_mutation_reader<sstable_range_wrapping_reader>(
-                _memtable->_sstable, _memtable->_schema, *_delegate_range);
+                _memtable->_sstable, _memtable->_schema, *_delegate_range, _slice);
             _memtable = {};
             _last = {};
             return _delegate();
@@ -170,12 +174,13 @@ class scanning_reader final : public mutation_reader::impl {
         const partition_entry& e = *_i;
         ++_i;
         _last = e.key();
-        return make_ready_future<mutation_opt>(mutation(_memtable->_schema, e.key(), e.partition()));
+        auto& s = *_memtable->_schema;
+        return make_ready_future<mutation_opt>(mutation(_memtable->_schema, e.key(), mutation_partition(e.partition(), s, _slice.row_ranges)));
     }
 };
 
 mutation_reader
-memtable::make_reader(const query::partition_range& range) const {
+memtable::make_reader(const query::partition_range& range, const query::partition_slice& slice) const {
     if (query::is_wrap_around(range, *_schema)) {
         fail(unimplemented::cause::WRAP_AROUND);
     }
@@ -185,12 +190,12 @@ memtable::make_reader(const query::partition_range& range) const {
         auto i = partitions.find(pos, partition_entry::compare(_schema));
         if (i != partitions.end()) {
             logalloc::reclaim_lock _(_region);
-            return make_reader_returning(mutation(_schema, i->key(), i->partition()));
+            return make_reader_returning(mutation(_schema, i->key(), mutation_partition(i->partition(), *_schema, slice.row_ranges)));
         } else {
             return make_empty_reader();
         }
     } else {
-        return make_mutation_reader<scanning_reader>(shared_from_this(), range);
+        return make_mutation_reader<scanning_reader>(shared_from_this(), range, slice);
     }
 }
 
@@ -201,6 +206,101 @@ memtable::update(const db::replay_position& rp) {
     }
 }
 
+// Lowers the tracked timestamp to the timestamps of the given data.
+class min_timestamp_tracker {
+    const schema& _schema;
+    api::timestamp_type& _min;
+public:
+    min_timestamp_tracker(const schema& s, api::timestamp_type& min)
+        : _schema(s), _min(min) { }
+
+    void update(api::timestamp_type t) {
+        _min = std::min(_min, t);
+    }
+    void update(tombstone t) {
+        if (t) {
+            update(t.timestamp);
+        }
+    }
+    void update(const row_marker& rm) {
+        if (!rm.is_missing()) {
+            update(rm.timestamp());
+        }
+    }
+    void update(atomic_cell_view cell) {
+        update(cell.timestamp());
+    }
+    void update(const column_definition& def, collection_mutation::view collection) {
+        auto ctype = static_pointer_cast<const collection_type_impl>(def.type);
+        auto mview = ctype->deserialize_mutation_form(collection);
+        update(mview.tomb);
+        for (auto& cp : mview.cells) {
+            update(cp.second);
+        }
+    }
+    void update(const row& cells, column_kind kind) {
+        cells.for_each_cell([this, kind] (column_id id, const atomic_cell_or_collection& c) {
+            auto& def = _schema.column_at(kind, id);
+            if (def.is_atomic()) {
+                update(c.as_atomic_cell());
+            } else {
+                update(def, c.as_collection_mutation());
+            }
+        });
+    }
+    void update(const mutation_partition& p) {
+        update(p.partition_tombstone());
+        update(p.static_row(), column_kind::static_column);
+        for (auto&& rt : p.row_tombstones()) {
+            update(rt.t());
+        }
+        for (auto&& re : p.clustered_rows()) {
+            update(re.row().deleted_at());
+            update(re.row().marker());
+            update(re.row().cells(), column_kind::regular_column);
+        }
+    }
+};
+
+// Applies a frozen partition and tracks its min timestamp in a single pass.
+class min_timestamp_tracking_applier final : public mutation_partition_applier {
+    const schema& _schema;
+    min_timestamp_tracker _tracker;
+public:
+    min_timestamp_tracking_applier(const schema& s, mutation_partition& target, api::timestamp_type& min)
+        : mutation_partition_applier(s, target), _schema(s), _tracker(s, min) { }
+
+    virtual void accept_partition_tombstone(tombstone t) override {
+        _tracker.update(t);
+        mutation_partition_applier::accept_partition_tombstone(t);
+    }
+    virtual void accept_static_cell(column_id id, atomic_cell_view cell) override {
+        _tracker.update(cell);
+        mutation_partition_applier::accept_static_cell(id, cell);
+    }
+    virtual void accept_static_cell(column_id id, collection_mutation::view collection) override {
+        _tracker.update(_schema.column_at(column_kind::static_column, id), collection);
+        mutation_partition_applier::accept_static_cell(id, collection);
+    }
+    virtual void accept_row_tombstone(clustering_key_prefix_view prefix, tombstone t) override {
+        _tracker.update(t);
+        mutation_partition_applier::accept_row_tombstone(prefix, t);
+    }
+    virtual void accept_row(clustering_key_view key, tombstone deleted_at, const row_marker& rm) override {
+        _tracker.update(deleted_at);
+        _tracker.update(rm);
+        mutation_partition_applier::accept_row(key, deleted_at, rm);
+    }
+    virtual void accept_row_cell(column_id id, atomic_cell_view cell) override {
+        _tracker.update(cell);
+        mutation_partition_applier::accept_row_cell(id, cell);
+    }
+    virtual void accept_row_cell(column_id id, collection_mutation::view collection) override {
+        _tracker.update(_schema.column_at(column_kind::regular_column, id), collection);
+        mutation_partition_applier::accept_row_cell(id, collection);
+    }
+};
+
 void
 memtable::apply(const mutation& m, const db::replay_position& rp) {
     with_allocator(_region.allocator(), [this, &m] {
@@ -208,6 +308,7 @@ memtable::apply(const mutation& m, const db::replay_position& rp) {
         mutation_partition& p = find_or_create_partition(m.decorated_key());
         p.apply(*_schema, m.partition());
     });
+    min_timestamp_tracker(*_schema, _min_timestamp).update(m.partition());
     update(rp);
 }
 
@@ -216,7 +317,8 @@ memtable::apply(const frozen_mutation& m, const db::replay_position& rp) {
     with_allocator(_region.allocator(), [this, &m] {
         logalloc::reclaim_lock _(_region);
         mutation_partition& p = find_or_create_partition_slow(m.key(*_schema));
-        p.apply(*_schema, m.partition());
+        min_timestamp_tracking_applier applier(*_schema, p, _min_timestamp);
+        m.partition().accept(*_schema, applier);
     });
     update(rp);
 }
@@ -226,8 +328,8 @@ logalloc::occupancy_stats memtable::occupancy() const {
 }
 
 mutation_source memtable::as_data_source() {
-    return [mt = shared_from_this()] (const query::partition_range& range) {
-        return mt->make_reader(range);
+    return [mt = shared_from_this()] (const query::partition_range& range, const query::partition_slice& slice) {
+        return mt->make_reader(range, slice);
     };
 }
 
@@ -251,6 +353,42 @@ partition_entry::partition_entry(partition_entry&& o) noexcept
     container_type::node_algorithms::init(o._link.this_ptr());
 }
 
+bool memtable::contains(const dht::decorated_key& key) const {
+    return partitions.find(key, partition_entry::compare(_schema)) != partitions.end();
+}
+
+size_t memtable::compact(gc_clock::time_point compaction_time,
+        std::function<api::timestamp_type(const dht::decorated_key&)> max_purgeable) {
+    auto cmp = partition_entry::compare(_schema);
+    auto before = _region.occupancy().used_space();
+    stdx::optional<dht::decorated_key> last;
+    // Partitions are compacted one at a time, yielding in between, so we look
+    // up the next one each time, as iterators may be invalidated meanwhile.
+    while (true) {
+        {
+            logalloc::reclaim_lock _(_region);
+            auto i = last ? partitions.upper_bound(*last, cmp) : partitions.begin();
+            if (i == partitions.end()) {
+                break;
+            }
+            last = i->key();
+            auto max_ts = max_purgeable(i->key());
+            with_allocator(_region.allocator(), [&] {
+                i->partition().compact_for_compaction(*_schema, max_ts, compaction_time);
+                if (i->partition().empty()) {
+                    partitions.erase_and_dispose(i, current_deleter<partition_entry>());
+                }
+            });
+        }
+        if (seastar::thread::should_yield()) {
+            seastar::thread::yield();
+        }
+    }
+    _region.full_compaction();
+    auto after = _region.occupancy().used_space();
+    return before > after ? before - after : 0;
+}
+
 void memtable::mark_flushed(lw_shared_ptr<sstables::sstable> sst) {
     _sstable = std::move(sst);
 }
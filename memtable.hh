@@ -95,6 +95,8 @@ class memtable final : public enable_lw_shared_from_this<memtable> {
     mutable logalloc::region _region;
     partitions_type partitions;
     db::replay_position _replay_position;
+    // Lowest timestamp of the data applied to the memtable
+    api::timestamp_type _min_timestamp = api::max_timestamp;
     lw_shared_ptr<sstables::sstable> _sstable;
     void update(const db::replay_position&);
     friend class row_cache;
@@ -120,13 +122,28 @@ class memtable final : public enable_lw_shared_from_this<memtable> {
     // Live readers share ownership of the memtable instance, so caller
     // doesn't need to ensure that memtable remains live.
     //
-    // The 'range' parameter must be live as long as the reader is being used
-    mutation_reader make_reader(const query::partition_range& range = query::full_partition_range) const;
+    // Only clustering rows which fall into the slice's row ranges are returned.
+    //
+    // The 'range' and 'slice' parameters must be live as long as the reader is being used
+    mutation_reader make_reader(const query::partition_range& range = query::full_partition_range,
+                                const query::partition_slice& slice = query::full_slice) const;
 
     mutation_source as_data_source();
     key_source as_key_source();
 
     bool empty() const { return partitions.empty(); }
+    bool contains(const dht::decorated_key& key) const;
+
+    // Drops data shadowed by tombstones, expired cells and tombstones which
+    // can be purged (see mutation_partition::compact_for_compaction()) from
+    // all partitions, and compacts the region. max_purgeable returns the
+    // timestamp below which tombstones of a given partition may be purged.
+    //
+    // Returns by how many bytes the data held in the region shrank.
+    // Must be called from a seastar thread. Concurrent readers are allowed.
+    size_t compact(gc_clock::time_point compaction_time,
+        std::function<api::timestamp_type(const dht::decorated_key&)> max_purgeable);
+
     void mark_flushed(lw_shared_ptr<sstables::sstable> sst);
     bool is_flushed() const;
 
@@ -134,5 +151,10 @@ class memtable final : public enable_lw_shared_from_this<memtable> {
         return _replay_position;
     }
 
+    // Lower bound of the timestamps of the data in this memtable.
+    api::timestamp_type min_timestamp() const {
+        return _min_timestamp;
+    }
+
     friend class scanning_reader;
 };
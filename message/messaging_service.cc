@@ -106,19 +106,27 @@ query::read_command net::serializer::read(Input& in, rpc::type<query::read_comma
     return read_gms<query::read_command>(in);
 }
 
+// Results are written and read fragment by fragment, large range scan pages
+// would otherwise need contiguous buffers of their size.
 template <typename Output>
 void net::serializer::write(Output& out, const query::result& v) const {
-    // FIXME: allow const call to query::result::serialize()
     uint32_t sz = v.serialized_size();
     write(out, sz);
-    bytes b(bytes::initialized_later(), sz);
-    auto _out = b.begin();
-    const_cast<query::result&>(v).serialize(_out);
-    out.write(reinterpret_cast<const char*>(b.c_str()), sz);
+    for (bytes_view f : v.buf().fragments()) {
+        out.write(reinterpret_cast<const char*>(f.begin()), f.size());
+    }
 }
 template <typename Input>
 query::result net::serializer::read(Input& in, rpc::type<query::result>) const {
-    return read_gms<query::result>(in);
+    static constexpr uint32_t max_fragment_size = 128 * 1024;
+    auto sz = read(in, rpc::type<uint32_t>());
+    bytes_ostream w;
+    while (sz) {
+        auto n = std::min(sz, max_fragment_size);
+        in.read(reinterpret_cast<char*>(w.write_place_holder(n)), n);
+        sz -= n;
+    }
+    return query::result(std::move(w));
 }
 
 template <typename Output>
@@ -191,16 +199,16 @@ constexpr int32_t messaging_service::current_version;
 distributed<messaging_service> _the_messaging_service;
 
 bool operator==(const shard_id& x, const shard_id& y) {
-    // Ignore cpu id for now since we do not really support shard to shard connections
-    return x.addr == y.addr;
+    return x.addr == y.addr && x.cpu_id == y.cpu_id;
 }
 
 bool operator<(const shard_id& x, const shard_id& y) {
-    // Ignore cpu id for now since we do not really support shard to shard connections
     if (x.addr < y.addr) {
         return true;
-    } else {
+    } else if (y.addr < x.addr) {
         return false;
+    } else {
+        return x.cpu_id < y.cpu_id;
     }
 }
 
@@ -209,8 +217,7 @@ std::ostream& operator<<(std::ostream& os, const shard_id& x) {
 }
 
 size_t shard_id::hash::operator()(const shard_id& id) const {
-    // Ignore cpu id for now since we do not really support // shard to shard connections
-    return std::hash<uint32_t>()(id.addr.raw_addr());
+    return std::hash<uint64_t>()((uint64_t(id.addr.raw_addr()) << 32) | id.cpu_id);
 }
 
 messaging_service::shard_info::shard_info(shared_ptr<rpc_protocol_client_wrapper>&& client)
@@ -251,11 +258,13 @@ bool messaging_service::knows_version(const gms::inet_address& endpoint) const {
     return true;
 }
 
-messaging_service::messaging_service(gms::inet_address ip)
+messaging_service::messaging_service(gms::inet_address ip, uint16_t shard_port_base)
     : _listen_address(ip)
     , _port(_default_port)
+    , _shard_port_base(shard_port_base)
     , _rpc(new rpc_protocol_wrapper(serializer{}))
-    , _server(new rpc_protocol_server_wrapper(*_rpc, ipv4_addr{_listen_address.raw_addr(), _port})) {
+    , _server(new rpc_protocol_server_wrapper(*_rpc, ipv4_addr{_listen_address.raw_addr(), _port}))
+    , _shard_server(new rpc_protocol_server_wrapper(*_rpc, ipv4_addr{_listen_address.raw_addr(), shard_port(engine().cpu_id())})) {
 }
 
 messaging_service::~messaging_service() = default;
@@ -270,6 +279,7 @@ gms::inet_address messaging_service::listen_address() {
 
 future<> messaging_service::stop() {
     return when_all(_server->stop(),
+        _shard_server->stop(),
         parallel_for_each(_clients[0], [](std::pair<const shard_id, shard_info>& c) {
             return c.second.rpc_client->stop();
         }),
@@ -295,8 +305,45 @@ static unsigned get_rpc_client_idx(messaging_verb verb) {
     return idx;
 }
 
+void messaging_service::set_shard_count(inet_address ep, unsigned shard_count) {
+    auto& count = _shard_counts[ep];
+    if (count == shard_count) {
+        return;
+    }
+    count = shard_count;
+    // Existing clients may be connected to the wrong port or shard
+    for (auto& clients : _clients) {
+        for (auto it = clients.begin(); it != clients.end();) {
+            it = it->first.addr == ep ? clients.erase(it) : std::next(it);
+        }
+    }
+}
+
+void messaging_service::remove_shard_count(inet_address ep) {
+    _shard_counts.erase(ep);
+}
+
+unsigned messaging_service::get_shard_count(inet_address ep) const {
+    auto it = _shard_counts.find(ep);
+    return it == _shard_counts.end() ? 0 : it->second;
+}
+
+uint16_t messaging_service::shard_port(unsigned cpu_id) const {
+    return _shard_port_base + cpu_id;
+}
+
+// Nodes which did not advertise their shard count only listen on the
+// common port, on which connections land on arbitrary shards.
+messaging_service::shard_id messaging_service::route(shard_id id) const {
+    if (id.cpu_id >= get_shard_count(id.addr)) {
+        id.cpu_id = 0;
+    }
+    return id;
+}
+
 shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::get_rpc_client(messaging_verb verb, shard_id id) {
     auto idx = get_rpc_client_idx(verb);
+    id = route(id);
     auto it = _clients[idx].find(id);
 
     if (it != _clients[idx].end()) {
@@ -307,7 +354,8 @@ shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::ge
         remove_rpc_client(verb, id);
     }
 
-    auto remote_addr = ipv4_addr(id.addr.raw_addr(), _port);
+    auto port = get_shard_count(id.addr) ? shard_port(id.cpu_id) : _port;
+    auto remote_addr = ipv4_addr(id.addr.raw_addr(), port);
     auto client = make_shared<rpc_protocol_client_wrapper>(*_rpc, remote_addr, ipv4_addr{_listen_address.raw_addr(), 0});
     it = _clients[idx].emplace(id, shard_info(std::move(client))).first;
     return it->second.rpc_client;
@@ -315,7 +363,7 @@ shared_ptr<messaging_service::rpc_protocol_client_wrapper> messaging_service::ge
 
 void messaging_service::remove_rpc_client(messaging_verb verb, shard_id id) {
     auto idx = get_rpc_client_idx(verb);
-    _clients[idx].erase(id);
+    _clients[idx].erase(route(id));
 }
 
 std::unique_ptr<messaging_service::rpc_protocol_wrapper>& messaging_service::rpc() {
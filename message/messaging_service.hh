@@ -431,16 +431,29 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     static constexpr uint16_t _default_port = 7000;
     gms::inet_address _listen_address;
     uint16_t _port;
+    // Each shard also listens on _shard_port_base + its cpu id, so that
+    // other nodes can connect to a given shard.
+    uint16_t _shard_port_base;
     std::unique_ptr<rpc_protocol_wrapper> _rpc;
     std::unique_ptr<rpc_protocol_server_wrapper> _server;
+    std::unique_ptr<rpc_protocol_server_wrapper> _shard_server;
     std::unordered_map<shard_id, shard_info, shard_id::hash> _clients[2];
+    // Shard counts advertised by other nodes through gossip
+    std::unordered_map<inet_address, unsigned> _shard_counts;
     uint64_t _dropped_messages[static_cast<int32_t>(messaging_verb::LAST)] = {};
 public:
-    messaging_service(gms::inet_address ip = gms::inet_address("0.0.0.0"));
+    messaging_service(gms::inet_address ip = gms::inet_address("0.0.0.0"), uint16_t shard_port_base = 17000);
     ~messaging_service();
 public:
     uint16_t port();
+    uint16_t shard_port(unsigned cpu_id) const;
     gms::inet_address listen_address();
+    // Messages for a shard of a node whose shard count is known are sent
+    // straight to that shard, others go to the common port.
+    void set_shard_count(inet_address ep, unsigned shard_count);
+    void remove_shard_count(inet_address ep);
+    // Returns 0 when the shard count of the node is unknown
+    unsigned get_shard_count(inet_address ep) const;
     future<> stop();
     static rpc::no_wait_type no_wait();
 public:
@@ -543,6 +556,8 @@ class messaging_service : public seastar::async_sharded_service<messaging_servic
     shared_ptr<rpc_protocol_client_wrapper> get_rpc_client(messaging_verb verb, shard_id id);
     void remove_rpc_client(messaging_verb verb, shard_id id);
     std::unique_ptr<rpc_protocol_wrapper>& rpc();
+private:
+    shard_id route(shard_id id) const;
 };
 
 extern distributed<messaging_service> _the_messaging_service;
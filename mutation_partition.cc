@@ -104,6 +104,33 @@ mutation_partition::mutation_partition(const mutation_partition& x)
     }
 }
 
+mutation_partition::mutation_partition(const mutation_partition& x, const schema& schema,
+        const query::clustering_row_ranges& ck_ranges)
+        : _tombstone(x._tombstone)
+        , _static_row(x._static_row)
+        , _rows(x._rows.value_comp())
+        , _row_tombstones(x._row_tombstones.value_comp()) {
+    auto cloner = [] (const auto& x) {
+        return current_allocator().construct<std::remove_const_t<std::remove_reference_t<decltype(x)>>>(x);
+    };
+    try {
+        for (auto&& r : ck_ranges) {
+            for (const rows_entry& e : x.range(schema, r)) {
+                // Ranges are usually ordered, in which case rows are appended.
+                // Overlapping ranges may yield rows which were already copied.
+                auto i = _rows.empty() || _rows.value_comp()(*_rows.rbegin(), e) ? _rows.end() : _rows.lower_bound(e);
+                if (i == _rows.end() || _rows.value_comp()(e, *i)) {
+                    _rows.insert_before(i, *cloner(e));
+                }
+            }
+        }
+        _row_tombstones.clone_from(x._row_tombstones, cloner, current_deleter<row_tombstones_entry>());
+    } catch (...) {
+        _rows.clear_and_dispose(current_deleter<rows_entry>());
+        throw;
+    }
+}
+
 mutation_partition::~mutation_partition() {
     _rows.clear_and_dispose(current_deleter<rows_entry>());
     _row_tombstones.clear_and_dispose(current_deleter<row_tombstones_entry>());
@@ -405,6 +432,81 @@ static void get_row_slice(const schema& s,
     }
 }
 
+// Accumulates a live CQL row into the aggregates. "cells" is null for a
+// partition which has only live static cells.
+static void aggregate_row(const schema& s,
+    const row& static_cells,
+    tombstone static_tomb,
+    const row* cells,
+    tombstone tomb,
+    gc_clock::time_point now,
+    query::partial_aggregates& aggregates)
+{
+    auto&& specs = aggregates.aggregates();
+    for (size_t i = 0; i < specs.size(); ++i) {
+        auto&& a = specs[i];
+        if (a.type == query::aggregate::kind::count_rows) {
+            aggregates.add_row(i);
+            continue;
+        }
+        auto is_static = a.column == column_kind::static_column;
+        const row* r = is_static ? &static_cells : cells;
+        if (!r) {
+            continue;
+        }
+        const atomic_cell_or_collection* cell = r->find_cell(a.id);
+        if (!cell) {
+            continue;
+        }
+        auto c = cell->as_atomic_cell();
+        if (c.is_live(is_static ? static_tomb : tomb, now)) {
+            aggregates.add_value(i, s.column_at(a.column, a.id), c.value());
+        }
+    }
+}
+
+// Writes a live CQL row in the CQL binary protocol format. "key" and "cells"
+// are null for a partition which has only live static cells.
+static void write_cql_row(const schema& s,
+    const row& static_cells,
+    tombstone static_tomb,
+    const clustering_key* key,
+    const row* cells,
+    tombstone tomb,
+    gc_clock::time_point now,
+    query::result::partition_writer& pw)
+{
+    for (auto&& c : pw.slice().cql_columns) {
+        switch (c.kind) {
+        case column_kind::partition_key:
+            pw.add_cql_value(pw.key().get_component(s, c.id));
+            continue;
+        case column_kind::clustering_key:
+            if (key) {
+                pw.add_cql_value(key->get_component(s, c.id));
+            } else {
+                pw.add_cql_null();
+            }
+            continue;
+        default:
+            break;
+        }
+        auto is_static = c.kind == column_kind::static_column;
+        const row* r = is_static ? &static_cells : cells;
+        const atomic_cell_or_collection* cell = r ? r->find_cell(c.id) : nullptr;
+        if (!cell) {
+            pw.add_cql_null();
+            continue;
+        }
+        auto ac = cell->as_atomic_cell();
+        if (ac.is_live(is_static ? static_tomb : tomb, now)) {
+            pw.add_cql_value(ac.value());
+        } else {
+            pw.add_cql_null();
+        }
+    }
+}
+
 bool has_any_live_data(const schema& s, column_kind kind, const row& cells, tombstone tomb, gc_clock::time_point now) {
     bool any_live = false;
     cells.for_each_cell_until([&] (column_id id, const atomic_cell_or_collection& cell_or_collection) {
@@ -440,8 +542,10 @@ mutation_partition::query(query::result::partition_writer& pw,
     assert(limit > 0);
 
     bool any_live = has_any_live_data(s, column_kind::static_column, static_row(), _tombstone, now);
+    auto aggregates = pw.aggregates();
+    auto cql_rows = pw.writes_cql_rows();
 
-    if (!slice.static_columns.empty()) {
+    if (!slice.static_columns.empty() && !aggregates && !cql_rows) {
         auto row_builder = pw.add_static_row();
         get_row_slice(s, column_kind::static_column, static_row(), slice.static_columns, partition_tombstone(), now, row_builder);
         row_builder.finish();
@@ -462,9 +566,17 @@ mutation_partition::query(query::result::partition_writer& pw,
 
             if (row.is_live(s, row_tombstone, now)) {
                 any_live = true;
-                auto row_builder = pw.add_row(e.key());
-                get_row_slice(s, column_kind::regular_column, row.cells(), slice.regular_columns, row_tombstone, now, row_builder);
-                row_builder.finish();
+                if (aggregates) {
+                    pw.add_aggregated_row();
+                    aggregate_row(s, static_row(), partition_tombstone(), &row.cells(), row_tombstone, now, *aggregates);
+                } else if (cql_rows) {
+                    pw.add_cql_row();
+                    write_cql_row(s, static_row(), partition_tombstone(), &e.key(), &row.cells(), row_tombstone, now, pw);
+                } else {
+                    auto row_builder = pw.add_row(e.key());
+                    get_row_slice(s, column_kind::regular_column, row.cells(), slice.regular_columns, row_tombstone, now, row_builder);
+                    row_builder.finish();
+                }
                 if (--limit == 0) {
                     return stop_iteration::yes;
                 }
@@ -476,6 +588,12 @@ mutation_partition::query(query::result::partition_writer& pw,
     if (!any_live) {
         pw.retract();
     } else {
+        if (aggregates && !pw.row_count()) {
+            // Only the static row is live, it counts as one row.
+            aggregate_row(s, static_row(), partition_tombstone(), nullptr, {}, now, *aggregates);
+        } else if (cql_rows && !pw.row_count()) {
+            write_cql_row(s, static_row(), partition_tombstone(), nullptr, nullptr, {}, now, pw);
+        }
         pw.finish();
     }
 }
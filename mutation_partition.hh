@@ -557,6 +557,9 @@ class mutation_partition final {
     { }
     mutation_partition(mutation_partition&&) = default;
     mutation_partition(const mutation_partition&);
+    // Copies only clustering rows which fall into given ranges. Everything
+    // else, including all row tombstones, is copied in full.
+    mutation_partition(const mutation_partition&, const schema&, const query::clustering_row_ranges&);
     ~mutation_partition();
     mutation_partition& operator=(const mutation_partition& x);
     mutation_partition& operator=(mutation_partition&& x) = default;
@@ -654,7 +657,9 @@ class mutation_partition final {
     const row& static_row() const { return _static_row; }
     // return a set of rows_entry where each entry represents a CQL row sharing the same clustering key.
     const rows_type& clustered_rows() const { return _rows; }
+    rows_type& clustered_rows() { return _rows; }
     const row_tombstones_type& row_tombstones() const { return _row_tombstones; }
+    row_tombstones_type& row_tombstones() { return _row_tombstones; }
     const row* find_row(const clustering_key& key) const;
     const rows_entry* find_entry(const schema& schema, const clustering_key_prefix& key) const;
     tombstone range_tombstone_for_row(const schema& schema, const clustering_key& key) const;
@@ -142,7 +142,7 @@ mutation_query(const mutation_source& source,
     }
 
     return do_with(query_state(range, slice, row_limit, query_time), [&source] (query_state& state) -> future<reconcilable_result> {
-        state.reader = source(state.range);
+        state.reader = source(state.range, state.slice);
         return consume(state.reader, [&state] (mutation&& m) {
             // FIXME: Make data sources respect row_ranges so that we don't have to filter them out here.
             auto is_distinct = state.slice.options.contains(query::partition_slice::option::distinct);
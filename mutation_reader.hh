@@ -24,6 +24,7 @@
 #include <vector>
 
 #include "mutation.hh"
+#include "query-request.hh"
 #include "core/future.hh"
 #include "core/future-util.hh"
 #include "core/do_with.hh"
@@ -147,7 +148,39 @@ future<> consume(mutation_reader& reader, Consumer consumer) {
 // mutation_source represents source of data in mutation form. The data source
 // can be queried multiple times and in parallel. For each query it returns
 // independent mutation_reader.
-using mutation_source = std::function<mutation_reader(const query::partition_range& range)>;
+//
+// A source may be given a partition_slice, in which case it is allowed to
+// omit clustering rows outside of the slice's row ranges. Sources which are
+// constructed from a function which takes only a partition_range ignore the
+// slice and always return whole partitions.
+class mutation_source {
+    using func_type = std::function<mutation_reader(const query::partition_range&, const query::partition_slice&)>;
+    func_type _fn;
+private:
+    template <typename Func>
+    static auto make_func(Func&& fn, int)
+            -> decltype(fn(std::declval<const query::partition_range&>(), std::declval<const query::partition_slice&>()), func_type()) {
+        return func_type(std::forward<Func>(fn));
+    }
+    template <typename Func>
+    static func_type make_func(Func&& fn, long) {
+        return [fn = std::forward<Func>(fn)] (const query::partition_range& range, const query::partition_slice&) mutable {
+            return fn(range);
+        };
+    }
+public:
+    template <typename Func, typename = std::enable_if_t<!std::is_same<std::decay_t<Func>, mutation_source>::value>>
+    mutation_source(Func&& fn) : _fn(make_func(std::forward<Func>(fn), 0)) { }
+    mutation_source(const mutation_source&) = default;
+    mutation_source(mutation_source&&) = default;
+    mutation_source& operator=(const mutation_source&) = default;
+    mutation_source& operator=(mutation_source&&) = default;
+
+    // The range and the slice must be live as long as the reader is used.
+    mutation_reader operator()(const query::partition_range& range, const query::partition_slice& slice = query::full_slice) const {
+        return _fn(range, slice);
+    }
+};
 
 /// A partition_presence_checker quickly returns whether a key is known not to exist
 /// in a data source (it may return false positives, but not false negatives).
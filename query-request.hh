@@ -36,6 +36,7 @@ using range = ::range<T>;
 using ring_position = dht::ring_position;
 using partition_range = range<ring_position>;
 using clustering_range = range<clustering_key_prefix>;
+using clustering_row_ranges = std::vector<clustering_range>;
 
 extern const partition_range full_partition_range;
 
@@ -52,6 +53,31 @@ bool is_single_partition(const query::partition_range& range) {
     return range.is_singular() && range.start()->value().has_key();
 }
 
+// An aggregate function computed by replicas over the rows selected by a
+// partition_slice. When a slice carries aggregates, the query returns their
+// partial states instead of the rows, see query-result-aggregates.hh.
+// Only int and bigint columns can be aggregated.
+struct aggregate {
+    enum class kind : uint8_t { count_rows, count, sum, avg, min, max };
+    kind type;
+    // The aggregated column, not used by count_rows.
+    column_kind column = column_kind::regular_column;
+    column_id id = 0;
+};
+
+std::ostream& operator<<(std::ostream& out, const aggregate& a);
+
+// A column of the rows which replicas send already serialized in the CQL
+// binary protocol format, see query-result.hh. Key columns are identified by
+// their component index. Collections and counters, whose storage format
+// differs from the protocol one, can't be sent this way.
+struct cql_column {
+    column_kind kind;
+    column_id id;
+};
+
+std::ostream& operator<<(std::ostream& out, const cql_column& c);
+
 // Specifies subset of rows, columns and cell attributes to be returned in a query.
 // Can be accessed across cores.
 class partition_slice {
@@ -68,19 +94,41 @@ class partition_slice {
     std::vector<column_id> static_columns; // TODO: consider using bitmap
     std::vector<column_id> regular_columns;  // TODO: consider using bitmap
     option_set options;
+    std::vector<aggregate> aggregates;
+    // When not empty, the rows are returned in the CQL format, with these columns.
+    std::vector<cql_column> cql_columns;
 public:
     partition_slice(std::vector<clustering_range> row_ranges, std::vector<column_id> static_columns,
-        std::vector<column_id> regular_columns, option_set options)
+        std::vector<column_id> regular_columns, option_set options, std::vector<aggregate> aggregates = {},
+        std::vector<cql_column> cql_columns = {})
         : row_ranges(std::move(row_ranges))
         , static_columns(std::move(static_columns))
         , regular_columns(std::move(regular_columns))
         , options(options)
+        , aggregates(std::move(aggregates))
+        , cql_columns(std::move(cql_columns))
     { }
     friend std::ostream& operator<<(std::ostream& out, const partition_slice& ps);
 };
 
+// Selects all clustering rows. Readers return all columns regardless of the
+// slice, so the column selections are left empty.
+extern const partition_slice full_slice;
+
+// Returns true iff the clustering row with given key falls into any of the ranges.
+bool is_in_ranges(const schema& s, const clustering_row_ranges& ranges, const clustering_key& key);
+
 constexpr auto max_rows = std::numeric_limits<uint32_t>::max();
 
+// Hash used by replicas to compute the digests of query results. All
+// replicas queried for a read must use the same one, murmur3 is only
+// requested once every node in the cluster supports it.
+enum class digest_algorithm : uint8_t {
+    md5,
+    // 128-bit murmur3, much cheaper than MD5
+    murmur3,
+};
+
 // Full specification of a query to the database.
 // Intended for passing across replicas.
 // Can be accessed across cores.
@@ -90,6 +138,7 @@ class read_command {
     partition_slice slice;
     uint32_t row_limit;
     gc_clock::time_point timestamp;
+    digest_algorithm digest_algo = digest_algorithm::md5;
 public:
     read_command(const utils::UUID& cf_id, partition_slice slice, uint32_t row_limit = max_rows, gc_clock::time_point now = gc_clock::now())
         : cf_id(cf_id)
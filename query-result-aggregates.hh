@@ -0,0 +1,130 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "types.hh"
+#include "bytes_ostream.hh"
+#include "query-request.hh"
+
+namespace query {
+
+class result;
+
+//
+// Partial states of the aggregates requested by a partition_slice.
+//
+// Replicas accumulate the rows they query into it and return the states
+// instead of the rows. Queries with aggregates produce results in the
+// following form:
+//
+// <result>          ::= <states>*
+// <states>          ::= <state>{number of aggregates in the slice}
+// <state>           ::= <count> <value>
+// <count>           ::= <int64_t>
+// <value>           ::= <int64_t>
+//
+// Each query::result::builder emits exactly one <states>, so results
+// from different shards and ranges can still be simply concatenated, the
+// coordinator merges all of them before computing the final values.
+//
+// <count> is the number of rows (count_rows) or of non-null values of the
+// column (other aggregates). <value> is the minimum or maximum value, or
+// the sum of the values for sum and avg. The sum wraps around like the
+// coordinator-side aggregates do.
+//
+class partial_aggregates {
+public:
+    struct state {
+        int64_t count = 0;
+        int64_t value = 0;
+    };
+    static constexpr size_t serialized_state_size = 2 * sizeof(int64_t);
+private:
+    const std::vector<aggregate>& _aggregates;
+    std::vector<state> _states;
+public:
+    explicit partial_aggregates(const std::vector<aggregate>& aggregates)
+        : _aggregates(aggregates)
+        , _states(aggregates.size())
+    { }
+
+    const std::vector<aggregate>& aggregates() const {
+        return _aggregates;
+    }
+
+    const std::vector<state>& states() const {
+        return _states;
+    }
+
+    // Accounts for a live row in the i-th aggregate, which is count_rows.
+    void add_row(size_t i) {
+        ++_states[i].count;
+    }
+
+    // Accounts for a live value of the column of the i-th aggregate.
+    void add_value(size_t i, const column_definition& def, bytes_view v) {
+        if (v.empty()) {
+            return;
+        }
+        add(i, state{1, def.type == int32_type ? read_simple_exactly<int32_t>(v) : read_simple_exactly<int64_t>(v)});
+    }
+
+    void add(size_t i, const state& other) {
+        if (!other.count) {
+            return;
+        }
+        auto& st = _states[i];
+        switch (_aggregates[i].type) {
+        case aggregate::kind::count_rows:
+        case aggregate::kind::count:
+            break;
+        case aggregate::kind::sum:
+        case aggregate::kind::avg:
+            st.value = static_cast<int64_t>(static_cast<uint64_t>(st.value) + static_cast<uint64_t>(other.value));
+            break;
+        case aggregate::kind::min:
+            st.value = st.count ? std::min(st.value, other.value) : other.value;
+            break;
+        case aggregate::kind::max:
+            st.value = st.count ? std::max(st.value, other.value) : other.value;
+            break;
+        }
+        st.count += other.count;
+    }
+
+    void write(bytes_ostream& w) const {
+        for (auto&& st : _states) {
+            w.write<int64_t>(st.count);
+            w.write<int64_t>(st.value);
+        }
+    }
+
+    // Merges all partial states contained in the result of a query with
+    // these aggregates.
+    void merge(const result& r);
+
+    // Computes the final values of the aggregates, serialized with the
+    // return types of the corresponding CQL functions.
+    std::vector<bytes_opt> finish(const schema& s) const;
+};
+
+}
@@ -139,18 +139,121 @@ struct result_visitor {
     void accept_partition_end(const result_row_view& static_row) {}
 };
 
+// Reads serialized data from the fragments of a bytes_ostream without
+// linearizing it. Only the values which straddle fragments are copied.
+class scattered_reader {
+    bytes_ostream::fragment_iterator _next;
+    bytes_ostream::fragment_iterator _end;
+    bytes_view _current;
+    size_t _position = 0;
+private:
+    void ensure_current() {
+        while (_current.empty()) {
+            if (_next == _end) {
+                throw std::out_of_range("Buffer underflow");
+            }
+            _current = *_next++;
+        }
+    }
+
+    template <typename Func>
+    void consume(size_t n, Func&& func) {
+        _position += n;
+        while (n) {
+            ensure_current();
+            auto chunk = std::min(n, _current.size());
+            func(bytes_view(_current.begin(), chunk));
+            _current.remove_prefix(chunk);
+            n -= chunk;
+        }
+    }
+public:
+    explicit scattered_reader(const bytes_ostream& buf)
+        : _next(buf.begin())
+        , _end(buf.end())
+    { }
+
+    bool has_next() {
+        while (_current.empty() && _next != _end) {
+            _current = *_next++;
+        }
+        return !_current.empty();
+    }
+
+    // Number of bytes read so far.
+    size_t position() const {
+        return _position;
+    }
+
+    template <typename T>
+    std::enable_if_t<std::is_fundamental<T>::value, T> read() {
+        if (_current.size() >= sizeof(T)) {
+            _position += sizeof(T);
+            return read_simple<T>(_current);
+        }
+        int8_t buf[sizeof(T)];
+        read(buf, sizeof(T));
+        return net::ntoh(*reinterpret_cast<const net::packed<T>*>(buf));
+    }
+
+    void read(int8_t* out, size_t n) {
+        consume(n, [&out] (bytes_view v) {
+            out = std::copy(v.begin(), v.end(), out);
+        });
+    }
+
+    // Returns a view of the next "len" bytes. The view points into the
+    // fragment if it holds all of them, into "scratch" otherwise, so it is
+    // valid until "scratch" is reused.
+    bytes_view read_view(size_t len, bytes& scratch) {
+        if (!len) {
+            return bytes_view();
+        }
+        ensure_current();
+        if (_current.size() >= len) {
+            _position += len;
+            return read_simple_bytes(_current, len);
+        }
+        if (scratch.size() < len) {
+            scratch = bytes(bytes::initialized_later(), len);
+        }
+        read(scratch.begin(), len);
+        return bytes_view(scratch.begin(), len);
+    }
+
+    template <typename SizeType>
+    bytes_view read_view_to_blob(bytes& scratch) {
+        auto len = read<SizeType>();
+        return read_view(len, scratch);
+    }
+
+    void skip(size_t n) {
+        consume(n, [] (bytes_view) { });
+    }
+};
+
 class result_view {
-    bytes_view _v;
+    const bytes_ostream& _buf;
 public:
-    result_view(bytes_view v) : _v(v) {}
+    result_view(const bytes_ostream& buf) : _buf(buf) {}
+
+    // Consumes a whole query result.
+    template <typename ResultVisitor>
+    static void consume(const query::result& res, const partition_slice& slice, ResultVisitor&& visitor) {
+        result_view(res.buf()).consume(slice, std::forward<ResultVisitor>(visitor));
+    }
 
+    // Rows are handed to the visitor in place, unless they straddle
+    // fragments of the result, in which case they are copied.
     template <typename ResultVisitor>
     void consume(const partition_slice& slice, ResultVisitor&& visitor) {
-        data_input in(_v);
+        scattered_reader in(_buf);
+        bytes static_row_scratch;
+        bytes scratch;
         while (in.has_next()) {
             auto row_count = in.read<uint32_t>();
             if (slice.options.contains<partition_slice::option::send_partition_key>()) {
-                auto key = partition_key::from_bytes(to_bytes(in.read_view_to_blob<uint32_t>()));
+                auto key = partition_key::from_bytes(to_bytes(in.read_view_to_blob<uint32_t>(scratch)));
                 visitor.accept_new_partition(key, row_count);
             } else {
                 visitor.accept_new_partition(row_count);
@@ -158,17 +261,17 @@ class result_view {
 
             bytes_view static_row_view;
             if (!slice.static_columns.empty()) {
-                static_row_view = in.read_view_to_blob<uint32_t>();
+                static_row_view = in.read_view_to_blob<uint32_t>(static_row_scratch);
             }
             result_row_view static_row(static_row_view, slice);
 
             while (row_count--) {
                 if (slice.options.contains<partition_slice::option::send_clustering_key>()) {
-                    auto key = clustering_key::from_bytes(to_bytes(in.read_view_to_blob<uint32_t>()));
-                    result_row_view row(in.read_view_to_blob<uint32_t>(), slice);
+                    auto key = clustering_key::from_bytes(to_bytes(in.read_view_to_blob<uint32_t>(scratch)));
+                    result_row_view row(in.read_view_to_blob<uint32_t>(scratch), slice);
                     visitor.accept_new_row(key, static_row, row);
                 } else {
-                    result_row_view row(in.read_view_to_blob<uint32_t>(), slice);
+                    result_row_view row(in.read_view_to_blob<uint32_t>(scratch), slice);
                     visitor.accept_new_row(static_row, row);
                 }
             }
@@ -178,4 +281,56 @@ class result_view {
     }
 };
 
+// Reads the rows of a result of a query whose slice has cql_columns.
+class cql_rows_reader {
+    scattered_reader _in;
+public:
+    explicit cql_rows_reader(const bytes_ostream& buf)
+        : _in(buf)
+    { }
+
+    bool has_next() {
+        return _in.has_next();
+    }
+
+    // Number of bytes read so far.
+    size_t position() const {
+        return _in.position();
+    }
+
+    bytes_opt read_value() {
+        auto len = _in.read<int32_t>();
+        if (len < 0) {
+            return {};
+        }
+        bytes b(bytes::initialized_later(), len);
+        _in.read(b.begin(), len);
+        return { std::move(b) };
+    }
+
+    void skip_value() {
+        auto len = _in.read<int32_t>();
+        if (len > 0) {
+            _in.skip(len);
+        }
+    }
+};
+
+// Counts the rows, of "column_count" values each, of a result of a query
+// whose slice has cql_columns. Counts at most "limit" rows. Returns the
+// number of rows and the number of bytes they take.
+inline
+std::pair<uint32_t, size_t> count_cql_rows(const bytes_ostream& buf, size_t column_count, uint32_t limit) {
+    assert(column_count);
+    cql_rows_reader reader(buf);
+    uint32_t rows = 0;
+    while (rows < limit && reader.has_next()) {
+        for (size_t i = 0; i < column_count; ++i) {
+            reader.skip_value();
+        }
+        ++rows;
+    }
+    return { rows, reader.position() };
+}
+
 }
@@ -25,6 +25,7 @@
 #include "atomic_cell.hh"
 #include "query-request.hh"
 #include "query-result.hh"
+#include "query-result-aggregates.hh"
 
 // Refer to query-result.hh for the query result format
 
@@ -85,6 +86,8 @@ class result::partition_writer {
     const partition_slice& _slice;
     bytes_ostream::place_holder<uint32_t> _count_ph;
     bytes_ostream::position _pos;
+    partial_aggregates* _aggregates = nullptr;
+    std::experimental::optional<partition_key> _key;
     uint32_t _row_count = 0;
     bool _static_row_added = false;
 public:
@@ -99,6 +102,58 @@ class result::partition_writer {
         , _pos(pos)
     { }
 
+    // Writer of a partition which is only accumulated into the aggregates
+    partition_writer(const partition_slice& slice, partial_aggregates& aggregates, bytes_ostream& w)
+        : _w(w)
+        , _slice(slice)
+        , _count_ph{nullptr}
+        , _pos(w.pos())
+        , _aggregates(&aggregates)
+    { }
+
+    // Writer of a partition whose rows are written in the CQL format
+    partition_writer(const partition_slice& slice, const partition_key& key, bytes_ostream& w)
+        : _w(w)
+        , _slice(slice)
+        , _count_ph{nullptr}
+        , _pos(w.pos())
+        , _key(key)
+    { }
+
+    // Non-null when the slice has aggregates. Rows should then be
+    // accumulated there and counted with add_aggregated_row() instead
+    // of being added.
+    partial_aggregates* aggregates() const {
+        return _aggregates;
+    }
+
+    void add_aggregated_row() {
+        ++_row_count;
+    }
+
+    // True when the slice has cql_columns. Rows should then be written with
+    // add_cql_value() and add_cql_null(), one call per cql column, and
+    // clustered rows counted with add_cql_row().
+    bool writes_cql_rows() const {
+        return bool(_key);
+    }
+
+    const partition_key& key() const {
+        return *_key;
+    }
+
+    void add_cql_row() {
+        ++_row_count;
+    }
+
+    void add_cql_value(bytes_view v) {
+        _w.write_blob(v);
+    }
+
+    void add_cql_null() {
+        _w.write<int32_t>(-1);
+    }
+
     row_writer add_row(const clustering_key& key) {
         if (_slice.options.contains<partition_slice::option::send_clustering_key>()) {
             _w.write_blob(key);
@@ -122,7 +177,9 @@ class result::partition_writer {
     }
 
     void finish() {
-        _w.set(_count_ph, _row_count);
+        if (_count_ph.ptr) {
+            _w.set(_count_ph, _row_count);
+        }
 
         // The partition is live. If there are no clustered rows, there
         // must be something live in the static row, which counts as one row.
@@ -132,7 +189,9 @@ class result::partition_writer {
 
     void retract() {
         _row_count = 0;
-        _w.retract(_pos);
+        if (!_aggregates) {
+            _w.retract(_pos);
+        }
     }
 
     const partition_slice& slice() const {
@@ -143,12 +202,45 @@ class result::partition_writer {
 class result::builder {
     bytes_ostream _w;
     const partition_slice& _slice;
+    std::experimental::optional<partial_aggregates> _aggregates;
+    // With digest_algorithm::murmur3 the digest is computed while the
+    // result is written. Data before _digested is already hashed.
+    std::experimental::optional<utils::murmur_hash::hasher3_x64_128> _hasher;
+    bytes_ostream::position _digested;
+private:
+    // Hashes the data written since the last call. Everything written so far
+    // must be final, i.e. no partition_writer may be in progress.
+    void update_digest() {
+        if (_hasher) {
+            _w.for_each_fragment_since(_digested, [this] (bytes_view f) {
+                _hasher->update(f);
+            });
+            _digested = _w.pos();
+        }
+    }
 public:
-    builder(const partition_slice& slice) : _slice(slice) { }
+    builder(const partition_slice& slice, digest_algorithm digest_algo = digest_algorithm::md5)
+        : _slice(slice)
+        , _digested(_w.pos())
+    {
+        if (!slice.aggregates.empty()) {
+            _aggregates.emplace(slice.aggregates);
+        }
+        if (digest_algo == digest_algorithm::murmur3) {
+            _hasher.emplace();
+        }
+    }
 
     // Starts new partition and returns a builder for its contents.
     // Invalidates all previously obtained builders
     partition_writer add_partition(const partition_key& key) {
+        update_digest();
+        if (_aggregates) {
+            return partition_writer(_slice, *_aggregates, _w);
+        }
+        if (!_slice.cql_columns.empty()) {
+            return partition_writer(_slice, key, _w);
+        }
         auto pos = _w.pos();
         auto count_place_holder = _w.write_place_holder<uint32_t>();
         if (_slice.options.contains<partition_slice::option::send_partition_key>()) {
@@ -158,6 +250,13 @@ class result::builder {
     }
 
     result build() {
+        if (_aggregates) {
+            _aggregates->write(_w);
+        }
+        if (_hasher) {
+            update_digest();
+            return result(std::move(_w), result_digest::from_murmur3(*_hasher));
+        }
         return result(std::move(_w));
     };
 
@@ -25,6 +25,8 @@
 #include <cryptopp/md5.h>
 #include "bytes_ostream.hh"
 #include "query-request.hh"
+#include "utils/murmur_hash.hh"
+#include "utils/serialization.hh"
 
 namespace query {
 
@@ -48,6 +50,15 @@ class result_digest {
         in.remove_prefix(in.size());
         return result;
     }
+    // Digest of digest_algorithm::murmur3, the 128-bit hash in big-endian order.
+    static result_digest from_murmur3(const utils::murmur_hash::hasher3_x64_128& h) {
+        auto hash = h.finalize();
+        bytes b(bytes::initialized_later(), 2 * sizeof(uint64_t));
+        auto out = b.begin();
+        serialize_int64(out, hash[0]);
+        serialize_int64(out, hash[1]);
+        return result_digest(std::move(b));
+    }
 };
 
 //
@@ -95,6 +106,7 @@ class result_digest {
 // Related headers:
 //  - query-result-reader.hh
 //  - query-result-writer.hh
+//  - query-result-aggregates.hh
 
 //
 // Query results are serialized to the following form:
@@ -116,8 +128,27 @@ class result_digest {
 // <row-count>       ::= <uint32_t>
 // <blob-length>     ::= <uint32_t>
 //
+// Queries whose slice carries aggregates use the format described in
+// query-result-aggregates.hh instead.
+//
+// Queries whose slice has cql_columns get the rows already serialized the
+// way a ROWS message of the CQL binary protocol holds them:
+//
+// <result>          ::= <cql-row>*
+// <cql-row>         ::= <cql-value>{number of cql columns in the slice}
+// <cql-value>       ::= <cql-value-length> <uint8_t>*
+// <cql-value-length> ::= <int32_t>
+//
+// A negative <cql-value-length> denotes a null value. A partition with no
+// live clustered rows but live static cells yields one row, with null
+// clustering and regular columns. Rows don't carry partition boundaries, so
+// results can be concatenated and sent to the client without parsing them.
+// See cql_rows_reader in query-result-reader.hh.
+//
 class result {
     bytes_ostream _w;
+    // murmur3 digest computed by the builder while writing the result
+    std::experimental::optional<result_digest> _digest;
 public:
     class builder;
     class partition_writer;
@@ -126,23 +157,37 @@ class result {
 
     result() {}
     result(bytes_ostream&& w) : _w(std::move(w)) {}
+    result(bytes_ostream&& w, result_digest digest) : _w(std::move(w)), _digest(std::move(digest)) {}
 
     const bytes_ostream& buf() const {
         return _w;
     }
 
-    result_digest digest() {
+    result_digest digest(digest_algorithm algo = digest_algorithm::md5) const {
+        if (algo == digest_algorithm::murmur3) {
+            if (_digest) {
+                return *_digest;
+            }
+            utils::murmur_hash::hasher3_x64_128 h;
+            for (bytes_view f : _w.fragments()) {
+                h.update(f);
+            }
+            return result_digest::from_murmur3(h);
+        }
         CryptoPP::Weak::MD5 hash;
+        for (bytes_view f : _w.fragments()) {
+            hash.Update(reinterpret_cast<const unsigned char*>(f.begin()), f.size());
+        }
         bytes b(bytes::initialized_later(), CryptoPP::Weak::MD5::DIGESTSIZE);
-        bytes_view v = _w.linearize();
-        hash.CalculateDigest(reinterpret_cast<unsigned char*>(b.begin()), reinterpret_cast<const unsigned char*>(v.begin()), v.size());
+        hash.Final(reinterpret_cast<unsigned char*>(b.begin()));
         return result_digest(std::move(b));
     }
     sstring pretty_print(schema_ptr, const query::partition_slice&) const;
     size_t serialized_size() const { return _w.size(); }
-    void serialize(bytes::iterator& out) {
-        auto v = _w.linearize();
-        out = std::copy(v.begin(), v.end(), out);
+    void serialize(bytes::iterator& out) const {
+        for (bytes_view f : _w.fragments()) {
+            out = std::copy(f.begin(), f.end(), out);
+        }
     }
     static result deserialize(bytes_view& in) {
         bytes_ostream w;
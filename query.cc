@@ -23,22 +23,74 @@
 #include "query-request.hh"
 #include "query-result.hh"
 #include "query-result-set.hh"
+#include "query-result-reader.hh"
+#include "query-result-aggregates.hh"
 #include "to_string.hh"
 #include "bytes.hh"
 #include "mutation.hh"
 #include "mutation_partition_serializer.hh"
+#include <boost/algorithm/cxx11/any_of.hpp>
 
 namespace query {
 
 const partition_range full_partition_range = partition_range::make_open_ended_both_sides();
 
+const partition_slice full_slice = partition_slice({ clustering_range::make_open_ended_both_sides() }, { }, { },
+    partition_slice::option_set());
+
+bool is_in_ranges(const schema& s, const clustering_row_ranges& ranges, const clustering_key& key) {
+    // Same ordering as mutation_partition::range(), a bound prefix is equal to
+    // all the keys it is a prefix of.
+    clustering_key::prefix_equality_less_compare less(s);
+    return boost::algorithm::any_of(ranges, [&] (const clustering_range& r) {
+        if (r.start() && (less(key, r.start()->value())
+                || (!r.start()->is_inclusive() && !less(r.start()->value(), key)))) {
+            return false;
+        }
+        if (r.end() && (less(r.end()->value(), key)
+                || (!r.end()->is_inclusive() && !less(key, r.end()->value())))) {
+            return false;
+        }
+        return true;
+    });
+}
+
+static const char* to_string(aggregate::kind k) {
+    switch (k) {
+    case aggregate::kind::count_rows: return "count_rows";
+    case aggregate::kind::count: return "count";
+    case aggregate::kind::sum: return "sum";
+    case aggregate::kind::avg: return "avg";
+    case aggregate::kind::min: return "min";
+    case aggregate::kind::max: return "max";
+    }
+    abort();
+}
+
+std::ostream& operator<<(std::ostream& out, const aggregate& a) {
+    if (a.type == aggregate::kind::count_rows) {
+        return out << to_string(a.type);
+    }
+    return out << to_string(a.type) << "(" << to_sstring(a.column) << " " << a.id << ")";
+}
+
+std::ostream& operator<<(std::ostream& out, const cql_column& c) {
+    return out << to_sstring(c.kind) << " " << c.id;
+}
+
 std::ostream& operator<<(std::ostream& out, const partition_slice& ps) {
-    return out << "{"
+    out << "{"
         << "regular_cols=[" << join(", ", ps.regular_columns) << "]"
         << ", static_cols=[" << join(", ", ps.static_columns) << "]"
         << ", rows=[" << join(", ", ps.row_ranges) << "]"
-        << ", options=" << sprint("%x", ps.options.mask()) // FIXME: pretty print options
-        << "}";
+        << ", options=" << sprint("%x", ps.options.mask()); // FIXME: pretty print options
+    if (!ps.aggregates.empty()) {
+        out << ", aggregates=[" << join(", ", ps.aggregates) << "]";
+    }
+    if (!ps.cql_columns.empty()) {
+        out << ", cql_columns=[" << join(", ", ps.cql_columns) << "]";
+    }
+    return out << "}";
 }
 
 std::ostream& operator<<(std::ostream& out, const read_command& r) {
@@ -46,7 +98,8 @@ std::ostream& operator<<(std::ostream& out, const read_command& r) {
         << "cf_id=" << r.cf_id
         << ", slice=" << r.slice << ""
         << ", limit=" << r.row_limit
-        << ", timestamp=" << r.timestamp.time_since_epoch().count() << "}";
+        << ", timestamp=" << r.timestamp.time_since_epoch().count()
+        << ", digest=" << (r.digest_algo == digest_algorithm::murmur3 ? "murmur3" : "md5") << "}";
 }
 
 size_t read_command::serialized_size() const {
@@ -60,7 +113,12 @@ size_t read_command::serialized_size() const {
             + serialize_int64_size // slice.options
             + (slice.static_columns.size() + 1) * serialize_int32_size
             + (slice.regular_columns.size() + 1) * serialize_int32_size
-            + row_range_size;
+            + row_range_size
+            + serialize_int32_size // slice.aggregates
+            + slice.aggregates.size() * (2 * serialize_int8_size + serialize_int32_size)
+            + serialize_int32_size // slice.cql_columns
+            + slice.cql_columns.size() * (serialize_int8_size + serialize_int32_size)
+            + serialize_int8_size; // digest_algo
 }
 
 void read_command::serialize(bytes::iterator& out) const {
@@ -81,6 +139,18 @@ void read_command::serialize(bytes::iterator& out) const {
     for (auto&& i : slice.row_ranges) {
         i.serialize(out);
     }
+    serialize_int32(out, slice.aggregates.size());
+    for (auto&& a : slice.aggregates) {
+        serialize_int8(out, static_cast<uint8_t>(a.type));
+        serialize_int8(out, static_cast<uint8_t>(a.column));
+        serialize_int32(out, a.id);
+    }
+    serialize_int32(out, slice.cql_columns.size());
+    for (auto&& c : slice.cql_columns) {
+        serialize_int8(out, static_cast<uint8_t>(c.kind));
+        serialize_int32(out, c.id);
+    }
+    serialize_int8(out, static_cast<uint8_t>(digest_algo));
 }
 
 read_command read_command::deserialize(bytes_view& v) {
@@ -112,7 +182,38 @@ read_command read_command::deserialize(bytes_view& v) {
         row_ranges.emplace_back(clustering_range::deserialize(v));
     };
 
-    return read_command(std::move(uuid), partition_slice(std::move(row_ranges), std::move(static_columns), std::move(regular_columns), options), row_limit, timestamp);
+    // Commands sent by nodes which don't know about aggregates end here.
+    std::vector<aggregate> aggregates;
+    if (!v.empty()) {
+        size = read_simple<uint32_t>(v);
+        aggregates.reserve(size);
+        while (size--) {
+            aggregate a;
+            a.type = static_cast<aggregate::kind>(read_simple<uint8_t>(v));
+            a.column = static_cast<column_kind>(read_simple<uint8_t>(v));
+            a.id = read_simple<uint32_t>(v);
+            aggregates.push_back(a);
+        }
+    }
+
+    std::vector<cql_column> cql_columns;
+    if (!v.empty()) {
+        size = read_simple<uint32_t>(v);
+        cql_columns.reserve(size);
+        while (size--) {
+            cql_column c;
+            c.kind = static_cast<column_kind>(read_simple<uint8_t>(v));
+            c.id = read_simple<uint32_t>(v);
+            cql_columns.push_back(c);
+        }
+    }
+
+    read_command cmd(std::move(uuid), partition_slice(std::move(row_ranges), std::move(static_columns), std::move(regular_columns), options,
+            std::move(aggregates), std::move(cql_columns)), row_limit, timestamp);
+    if (!v.empty()) {
+        cmd.digest_algo = static_cast<digest_algorithm>(read_simple<uint8_t>(v));
+    }
+    return cmd;
 }
 
 
@@ -139,8 +240,74 @@ to_partition_range(query::range<dht::token> r) {
 sstring
 result::pretty_print(schema_ptr s, const query::partition_slice& slice) const {
     std::ostringstream out;
+    if (!slice.aggregates.empty()) {
+        partial_aggregates aggregates(slice.aggregates);
+        aggregates.merge(*this);
+        out << "{aggregates: ";
+        for (size_t i = 0; i < aggregates.states().size(); ++i) {
+            auto&& st = aggregates.states()[i];
+            out << (i ? ", " : "") << slice.aggregates[i] << "={count=" << st.count << ", value=" << st.value << "}";
+        }
+        out << "}";
+        return out.str();
+    }
+    if (!slice.cql_columns.empty()) {
+        auto rows = count_cql_rows(_w, slice.cql_columns.size(), max_rows);
+        out << "{cql rows: " << rows.first << ", " << rows.second << " bytes}";
+        return out.str();
+    }
     out << "{" << result_set::from_raw_result(s, slice, *this) << "}";
     return out.str();
 }
 
+void partial_aggregates::merge(const result& r) {
+    if (_states.empty()) {
+        return;
+    }
+    scattered_reader in(r.buf());
+    while (in.has_next()) {
+        for (size_t i = 0; i < _states.size(); ++i) {
+            state st;
+            st.count = in.read<int64_t>();
+            st.value = in.read<int64_t>();
+            add(i, st);
+        }
+    }
+}
+
+template <typename Type>
+static bytes_opt finish_aggregate(aggregate::kind k, const partial_aggregates::state& st) {
+    auto type = data_type_for<Type>();
+    switch (k) {
+    case aggregate::kind::count_rows:
+    case aggregate::kind::count:
+        return long_type->decompose(st.count);
+    case aggregate::kind::sum:
+        return type->decompose(static_cast<Type>(st.value));
+    case aggregate::kind::avg:
+        return type->decompose(st.count ? static_cast<Type>(static_cast<Type>(st.value) / st.count) : Type(0));
+    case aggregate::kind::min:
+    case aggregate::kind::max:
+        if (!st.count) {
+            return {};
+        }
+        return type->decompose(static_cast<Type>(st.value));
+    }
+    abort();
+}
+
+std::vector<bytes_opt> partial_aggregates::finish(const schema& s) const {
+    std::vector<bytes_opt> values;
+    values.reserve(_states.size());
+    for (size_t i = 0; i < _states.size(); ++i) {
+        auto&& a = _aggregates[i];
+        if (a.type != aggregate::kind::count_rows && s.column_at(a.column, a.id).type == int32_type) {
+            values.emplace_back(finish_aggregate<int32_t>(a.type, _states[i]));
+        } else {
+            values.emplace_back(finish_aggregate<int64_t>(a.type, _states[i]));
+        }
+    }
+    return values;
+}
+
 }
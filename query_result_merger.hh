@@ -53,8 +53,12 @@ class result_merger {
         bytes_ostream w;
         w.reserve(total_size);
 
+        // Copy fragment by fragment, bytes_ostream::append() would allocate
+        // the whole partial result contiguously.
         for (auto&& r : _partial) {
-            w.append(r->_w);
+            for (bytes_view f : r->_w.fragments()) {
+                w.write(f);
+            }
         }
 
         return make_foreign(make_lw_shared<query::result>(std::move(w)));
@@ -51,9 +51,14 @@ cache_tracker::cache_tracker() {
             if (_lru.empty()) {
                 return memory::reclaiming_result::reclaimed_nothing;
             }
-            _lru.pop_back_and_dispose(current_deleter<cache_entry>());
-            --_partitions;
-            ++_modification_count;
+            _lru.pop_back_and_dispose([this] (lru_entry* e) {
+                if (e->lru_kind() == lru_entry::kind::index_page) {
+                    ++_index_page_evictions;
+                } else if (e->lru_kind() == lru_entry::kind::clustering_range) {
+                    ++_clustering_range_evictions;
+                }
+                dispose(e);
+            });
             return memory::reclaiming_result::reclaimed_something;
         });
     });
@@ -86,6 +91,11 @@ cache_tracker::setup_collectd() {
                 , "total_operations", "misses")
                 , scollectd::make_typed(scollectd::data_type::DERIVE, _misses)
         ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "negative_hits")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _negative_hits)
+        ),
         scollectd::add_polled_metric(scollectd::type_instance_id("cache"
                 , scollectd::per_cpu_plugin_instance
                 , "total_operations", "insertions")
@@ -101,18 +111,90 @@ cache_tracker::setup_collectd() {
                 , "objects", "partitions")
                 , scollectd::make_typed(scollectd::data_type::GAUGE, _partitions)
         ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "objects", "clustering_ranges")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, _clustering_ranges)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "clustering_range_evictions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _clustering_range_evictions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_hits")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_hits)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_misses")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_misses)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_insertions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_insertions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "total_operations", "index_page_evictions")
+                , scollectd::make_typed(scollectd::data_type::DERIVE, _index_page_evictions)
+        ),
+        scollectd::add_polled_metric(scollectd::type_instance_id("cache"
+                , scollectd::per_cpu_plugin_instance
+                , "objects", "index_pages")
+                , scollectd::make_typed(scollectd::data_type::GAUGE, _index_pages)
+        ),
     }));
 }
 
+void cache_tracker::dispose(lru_entry* e) noexcept {
+    switch (e->lru_kind()) {
+    case lru_entry::kind::partition: {
+        auto ce = static_cast<cache_entry*>(e);
+        _clustering_ranges -= ce->_ranges.size();
+        current_deleter<cache_entry>()(ce);
+        --_partitions;
+        ++_modification_count;
+        break;
+    }
+    case lru_entry::kind::clustering_range: {
+        auto r = static_cast<cached_range*>(e);
+        r->entry().on_evicted(*r);
+        current_deleter<cached_range>()(r);
+        --_clustering_ranges;
+        break;
+    }
+    case lru_entry::kind::index_page:
+        current_deleter<sstables::cached_index_page>()(static_cast<sstables::cached_index_page*>(e));
+        --_index_pages;
+        break;
+    }
+}
+
 void cache_tracker::clear() {
     with_allocator(_region.allocator(), [this] {
-        _lru.clear_and_dispose(current_deleter<cache_entry>());
+        _lru.clear_and_dispose([this] (lru_entry* e) {
+            dispose(e);
+        });
     });
     _partitions = 0;
+    _clustering_ranges = 0;
+    _index_pages = 0;
     ++_modification_count;
 }
 
-void cache_tracker::touch(cache_entry& e) {
+void cache_tracker::clear(sstables::cached_index_page::container_type& pages) {
+    with_allocator(_region.allocator(), [this, &pages] {
+        pages.clear_and_dispose([this, deleter = current_deleter<sstables::cached_index_page>()] (auto&& p) mutable {
+            --_index_pages;
+            deleter(p);
+        });
+    });
+}
+
+void cache_tracker::touch(lru_entry& e) {
     _lru.erase(_lru.iterator_to(e));
     _lru.push_front(e);
 }
@@ -124,11 +206,27 @@ void cache_tracker::insert(cache_entry& entry) {
     _lru.push_front(entry);
 }
 
-void cache_tracker::on_erase() {
+void cache_tracker::insert(cached_range& r) {
+    ++_clustering_ranges;
+    _lru.push_front(r);
+}
+
+void cache_tracker::insert(sstables::cached_index_page& page) {
+    ++_index_page_insertions;
+    ++_index_pages;
+    _lru.push_front(page);
+}
+
+void cache_tracker::on_erase(const cache_entry& e) {
+    _clustering_ranges -= e._ranges.size();
     --_partitions;
     ++_modification_count;
 }
 
+void cache_tracker::on_range_erase() {
+    --_clustering_ranges;
+}
+
 void cache_tracker::on_merge() {
     ++_merges;
 }
@@ -141,6 +239,18 @@ void cache_tracker::on_miss() {
     ++_misses;
 }
 
+void cache_tracker::on_negative_hit() {
+    ++_negative_hits;
+}
+
+void cache_tracker::on_index_page_hit() {
+    ++_index_page_hits;
+}
+
+void cache_tracker::on_index_page_miss() {
+    ++_index_page_misses;
+}
+
 allocation_strategy& cache_tracker::allocator() {
     return _region.allocator();
 }
@@ -153,21 +263,34 @@ const logalloc::region& cache_tracker::region() const {
     return _region;
 }
 
-// Reader which populates the cache using data from the delegate.
+// Reader which populates the cache using data from the delegate, which
+// returns given partition complete within given clustering ranges.
 class populating_reader final : public mutation_reader::impl {
     row_cache& _cache;
+    const dht::decorated_key& _key;
+    uint64_t _update_phase;
     mutation_reader _delegate;
+    const query::clustering_row_ranges& _ranges;
+    bool _first = true;
 public:
-    populating_reader(row_cache& cache, mutation_reader delegate)
+    populating_reader(row_cache& cache, const dht::decorated_key& key, mutation_reader delegate, const query::clustering_row_ranges& ranges)
         : _cache(cache)
+        , _key(key)
+        , _update_phase(cache._update_phase)
         , _delegate(std::move(delegate))
+        , _ranges(ranges)
     { }
 
     virtual future<mutation_opt> operator()() override {
         return _delegate().then([this] (mutation_opt&& mo) {
             if (mo) {
-                _cache.populate(*mo);
+                _cache.populate(*mo, _ranges);
+            } else if (_first && _update_phase == _cache._update_phase) {
+                // If update() ran in the meantime, the delegate could have
+                // missed data which was flushed after it was created.
+                _cache.populate_absent(_key);
             }
+            _first = false;
             return std::move(mo);
         });
     }
@@ -183,11 +306,18 @@ void row_cache::on_miss() {
     _tracker.on_miss();
 }
 
+void row_cache::on_negative_hit() {
+    on_hit();
+    ++_stats.negative_hits;
+    _tracker.on_negative_hit();
+}
+
 class just_cache_scanning_reader final : public mutation_reader::impl {
     row_cache& _cache;
-    row_cache::partitions_type::const_iterator _it;
-    row_cache::partitions_type::const_iterator _end;
+    row_cache::partitions_type::iterator _it;
+    row_cache::partitions_type::iterator _end;
     const query::partition_range& _range;
+    const query::partition_slice& _slice;
     stdx::optional<dht::decorated_key> _last;
     uint64_t _last_reclaim_count;
     size_t _last_modification_count;
@@ -227,17 +357,23 @@ class just_cache_scanning_reader final : public mutation_reader::impl {
         _last_modification_count = modification_count;
     }
 public:
-    just_cache_scanning_reader(row_cache& cache, const query::partition_range& range) : _cache(cache), _range(range) { }
+    just_cache_scanning_reader(row_cache& cache, const query::partition_range& range, const query::partition_slice& slice)
+        : _cache(cache), _range(range), _slice(slice) { }
+    // Partitions which don't have all rows of the slice cached are skipped,
+    // as if they were not in cache. So are absent partitions.
     virtual future<mutation_opt> operator()() override {
         return _cache._read_section(_cache._tracker.region(), [this] {
             update_iterators();
-            if (_it == _end) {
-                return make_ready_future<mutation_opt>();
+            while (_it != _end) {
+                cache_entry& ce = *_it;
+                ++_it;
+                _last = ce.key();
+                if (!ce.is_absent() && ce.covers(_cache._tracker, _slice.row_ranges)) {
+                    return make_ready_future<mutation_opt>(mutation(_cache._schema, ce.key(),
+                        mutation_partition(ce.partition(), *_cache._schema, _slice.row_ranges)));
+                }
             }
-            auto& ce = *_it;
-            ++_it;
-            _last = ce.key();
-            return make_ready_future<mutation_opt>(mutation(_cache._schema, ce.key(), ce.partition()));
+            return make_ready_future<mutation_opt>();
         });
     }
 };
@@ -245,6 +381,7 @@ class just_cache_scanning_reader final : public mutation_reader::impl {
 class scanning_and_populating_reader final : public mutation_reader::impl {
     row_cache& _cache;
     schema_ptr _schema;
+    const query::partition_slice& _slice;
     mutation_reader _primary;
     bool _secondary_only = false;
     mutation_opt _next_primary;
@@ -256,9 +393,9 @@ class scanning_and_populating_reader final : public mutation_reader::impl {
     key_reader _keys;
     dht::decorated_key_opt _next_key;
 public:
-    scanning_and_populating_reader(row_cache& cache, const query::partition_range& range)
-        : _cache(cache), _schema(cache._schema),
-          _primary(make_mutation_reader<just_cache_scanning_reader>(cache, range)),
+    scanning_and_populating_reader(row_cache& cache, const query::partition_range& range, const query::partition_slice& slice)
+        : _cache(cache), _schema(cache._schema), _slice(slice),
+          _primary(make_mutation_reader<just_cache_scanning_reader>(cache, range, slice)),
           _underlying(cache._underlying), _original_range(range), _underlying_keys(cache._underlying_keys),
           _keys(_underlying_keys(range))
     { }
@@ -293,7 +430,7 @@ class scanning_and_populating_reader final : public mutation_reader::impl {
                     end = _original_range.end();
                 }
                 _range = query::partition_range(query::partition_range::bound { std::move(*dk), true }, std::move(end));
-                _secondary = _underlying(_range);
+                _secondary = _underlying(_range, _slice);
                 _secondary_only = true;
                 return next_secondary();
             });
@@ -311,7 +448,7 @@ class scanning_and_populating_reader final : public mutation_reader::impl {
                 return std::move(_next_primary);
             }
             if (mo) {
-                _cache.populate(*mo);
+                _cache.populate(*mo, _slice.row_ranges);
             }
             _cache.on_miss();
             return std::move(mo);
@@ -326,35 +463,39 @@ class scanning_and_populating_reader final : public mutation_reader::impl {
 };
 
 mutation_reader
-row_cache::make_scanning_reader(const query::partition_range& range) {
-    return make_mutation_reader<scanning_and_populating_reader>(*this, range);
+row_cache::make_scanning_reader(const query::partition_range& range, const query::partition_slice& slice) {
+    return make_mutation_reader<scanning_and_populating_reader>(*this, range, slice);
 }
 
 mutation_reader
-row_cache::make_reader(const query::partition_range& range) {
+row_cache::make_reader(const query::partition_range& range, const query::partition_slice& slice) {
     if (range.is_singular()) {
         const query::ring_position& pos = range.start()->value();
 
         if (!pos.has_key()) {
-            return make_scanning_reader(range);
+            return make_scanning_reader(range, slice);
         }
 
         return _read_section(_tracker.region(), [&] {
             const dht::decorated_key& dk = pos.as_decorated_key();
             auto i = _partitions.find(dk, cache_entry::compare(_schema));
-            if (i != _partitions.end()) {
+            if (i != _partitions.end() && i->covers(_tracker, slice.row_ranges)) {
                 cache_entry& e = *i;
                 _tracker.touch(e);
+                if (e.is_absent()) {
+                    on_negative_hit();
+                    return make_empty_reader();
+                }
                 on_hit();
-                return make_reader_returning(mutation(_schema, dk, e.partition()));
+                return make_reader_returning(mutation(_schema, dk, mutation_partition(e.partition(), *_schema, slice.row_ranges)));
             } else {
                 on_miss();
-                return make_mutation_reader<populating_reader>(*this, _underlying(range));
+                return make_mutation_reader<populating_reader>(*this, dk, _underlying(range, slice), slice.row_ranges);
             }
         });
     }
 
-    return make_scanning_reader(range);
+    return make_scanning_reader(range, slice);
 }
 
 row_cache::~row_cache() {
@@ -362,32 +503,63 @@ row_cache::~row_cache() {
 }
 
 void row_cache::populate(const mutation& m) {
-    with_allocator(_tracker.allocator(), [this, &m] {
+    populate(m, query::full_slice.row_ranges);
+}
+
+void row_cache::populate(const mutation& m, const query::clustering_row_ranges& ranges) {
+    with_allocator(_tracker.allocator(), [this, &m, &ranges] {
         _populate_section(_tracker.region(), [&] {
         auto i = _partitions.lower_bound(m.decorated_key(), cache_entry::compare(_schema));
+        if (i != _partitions.end() && i->is_absent() && i->key().equal(*_schema, m.decorated_key())) {
+            // The partition was written since it was found absent, the
+            // entry is stale.
+            _tracker.on_erase(*i);
+            i = _partitions.erase_and_dispose(i, current_deleter<cache_entry>());
+        }
         if (i == _partitions.end() || !i->key().equal(*_schema, m.decorated_key())) {
-            cache_entry* entry = current_allocator().construct<cache_entry>(m.decorated_key(), m.partition());
+            cache_entry* entry = current_allocator().construct<cache_entry>(_schema, dht::decorated_key(m.decorated_key()),
+                mutation_partition(m.partition(), *_schema, ranges));
             _tracker.insert(*entry);
             _partitions.insert(i, *entry);
+            entry->add_ranges(_tracker, ranges);
+        } else if (!i->covers(_tracker, ranges)) {
+            // Rows already in cache are complete, so merging gives the same
+            // result as replacing them.
+            i->partition().apply(*_schema, mutation_partition(m.partition(), *_schema, ranges));
+            i->add_ranges(_tracker, ranges);
+            _tracker.touch(*i);
         } else {
             _tracker.touch(*i);
-            // We cache whole partitions right now, so if cache already has this partition,
-            // it must be complete, so do nothing.
         }
         });
     });
 }
 
+void row_cache::populate_absent(const dht::decorated_key& dk) {
+    with_allocator(_tracker.allocator(), [this, &dk] {
+        _populate_section(_tracker.region(), [&] {
+            auto i = _partitions.lower_bound(dk, cache_entry::compare(_schema));
+            if (i == _partitions.end() || !i->key().equal(*_schema, dk)) {
+                cache_entry* entry = current_allocator().construct<cache_entry>(_schema, dk, cache_entry::absent_tag());
+                _tracker.insert(*entry);
+                _partitions.insert(i, *entry);
+                entry->add_ranges(_tracker, query::full_slice.row_ranges);
+            }
+        });
+    });
+}
+
 void row_cache::clear() {
     with_allocator(_tracker.allocator(), [this] {
         _partitions.clear_and_dispose([this, deleter = current_deleter<cache_entry>()] (auto&& p) mutable {
-            _tracker.on_erase();
+            _tracker.on_erase(*p);
             deleter(p);
         });
     });
 }
 
 future<> row_cache::update(memtable& m, partition_presence_checker presence_checker) {
+    ++_update_phase;
     _tracker.region().merge(m._region); // Now all data in memtable belongs to cache
     auto attr = seastar::thread_attributes();
     attr.scheduling_group = &_update_thread_scheduling_group;
@@ -413,16 +585,19 @@ future<> row_cache::update(memtable& m, partition_presence_checker presence_chec
                         // FIXME: keep a bitmap indicating which sstables we do cover, so we don't have to
                         //        search it.
                         if (cache_i != _partitions.end() && cache_i->key().equal(s, mem_e.key())) {
+                            // Absent entries are complete, so they are turned into
+                            // present ones holding just the memtable's data.
                             cache_entry& entry = *cache_i;
-                            entry.partition().apply(s, std::move(mem_e.partition()));
+                            entry.apply(s, std::move(mem_e.partition()));
                             _tracker.touch(entry);
                             _tracker.on_merge();
                         } else if (presence_checker(mem_e.key().key()) ==
                                    partition_presence_checker_result::definitely_doesnt_exist) {
-                            cache_entry* entry = current_allocator().construct<cache_entry>(
+                            cache_entry* entry = current_allocator().construct<cache_entry>(_schema,
                                 std::move(mem_e.key()), std::move(mem_e.partition()));
                             _tracker.insert(*entry);
                             _partitions.insert(cache_i, *entry);
+                            entry->add_ranges(_tracker, query::full_slice.row_ranges);
                         }
                         i = m.partitions.erase(i);
                         current_allocator().destroy(&mem_e);
@@ -439,8 +614,8 @@ future<> row_cache::update(memtable& m, partition_presence_checker presence_chec
                 auto i = m.partitions.begin();
                 auto cache_i = _partitions.find(i->key(), cmp);
                 if (cache_i != _partitions.end()) {
+                    _tracker.on_erase(*cache_i);
                     _partitions.erase_and_dispose(cache_i, current_deleter<cache_entry>());
-                    _tracker.on_erase();
                 }
                 throw;
             }
@@ -470,20 +645,169 @@ row_cache::row_cache(schema_ptr s, mutation_source fallback_factory, key_source
 { }
 
 cache_entry::cache_entry(cache_entry&& o) noexcept
-    : _key(std::move(o._key))
+    : lru_entry(std::move(o))
+    , _schema(std::move(o._schema))
+    , _key(std::move(o._key))
     , _p(std::move(o._p))
-    , _lru_link()
     , _cache_link()
+    , _ranges(std::move(o._ranges))
+    , _absent(o._absent)
+{
+    using container_type = row_cache::partitions_type;
+    container_type::node_algorithms::replace_node(o._cache_link.this_ptr(), _cache_link.this_ptr());
+    container_type::node_algorithms::init(o._cache_link.this_ptr());
+    for (auto&& r : _ranges) {
+        r._entry = this;
+    }
+}
+
+cache_entry::~cache_entry() {
+    _ranges.clear_and_dispose(current_deleter<cached_range>());
+}
+
+cached_range::cached_range(cached_range&& o) noexcept
+    : lru_entry(std::move(o))
+    , _entry_link()
+    , _entry(o._entry)
+    , _range(std::move(o._range))
 {
-    {
-        auto prev = o._lru_link.prev_;
-        o._lru_link.unlink();
-        cache_tracker::lru_type::node_algorithms::link_after(prev, _lru_link.this_ptr());
+    auto prev = o._entry_link.prev_;
+    o._entry_link.unlink();
+    container_type::node_algorithms::link_after(prev, _entry_link.this_ptr());
+}
+
+// Bounds of clustering ranges are prefixes, which stand for all the rows
+// they prefix, so a bound is positioned either right before or right after
+// all such rows. An absent bound is at -inf or +inf.
+struct bound_position {
+    const clustering_key_prefix* prefix;
+    int weight;
+};
+
+using clustering_bound_opt = stdx::optional<query::clustering_range::bound>;
+
+static bound_position start_position(const clustering_bound_opt& b) {
+    if (!b) {
+        return { nullptr, -1 };
+    }
+    return { &b->value(), b->is_inclusive() ? -1 : 1 };
+}
+
+static bound_position end_position(const clustering_bound_opt& b) {
+    if (!b) {
+        return { nullptr, 1 };
     }
+    return { &b->value(), b->is_inclusive() ? 1 : -1 };
+}
+
+static bound_position start_position(const query::clustering_range& r) {
+    return start_position(r.start());
+}
 
-    {
-        using container_type = row_cache::partitions_type;
-        container_type::node_algorithms::replace_node(o._cache_link.this_ptr(), _cache_link.this_ptr());
-        container_type::node_algorithms::init(o._cache_link.this_ptr());
+static bound_position end_position(const query::clustering_range& r) {
+    return end_position(r.end());
+}
+
+static int tri_compare(const schema& s, const bound_position& a, const bound_position& b) {
+    if (!a.prefix || !b.prefix) {
+        return (a.prefix ? 0 : a.weight) - (b.prefix ? 0 : b.weight);
     }
+    auto type = s.clustering_key_prefix_type()->types().begin();
+    auto i1 = a.prefix->begin(s);
+    auto e1 = a.prefix->end(s);
+    auto i2 = b.prefix->begin(s);
+    auto e2 = b.prefix->end(s);
+    while (i1 != e1 && i2 != e2) {
+        auto c = ::tri_compare(*type, *i1, *i2);
+        if (c) {
+            return c;
+        }
+        ++i1;
+        ++i2;
+        ++type;
+    }
+    if (i1 == e1 && i2 == e2) {
+        return a.weight - b.weight;
+    }
+    return i1 == e1 ? a.weight : -b.weight;
+}
+
+cached_range* cache_entry::find_covering_range(const query::clustering_range& r) {
+    auto& s = *_schema;
+    for (auto&& cr : _ranges) {
+        if (tri_compare(s, start_position(cr.range()), start_position(r)) <= 0
+                && tri_compare(s, end_position(r), end_position(cr.range())) <= 0) {
+            return &cr;
+        }
+    }
+    return nullptr;
+}
+
+bool cache_entry::covers(cache_tracker& tracker, const query::clustering_row_ranges& ranges) {
+    std::vector<cached_range*> covering;
+    for (auto&& r : ranges) {
+        auto cr = find_covering_range(r);
+        if (!cr) {
+            return false;
+        }
+        covering.push_back(cr);
+    }
+    for (auto cr : covering) {
+        tracker.touch(*cr);
+    }
+    return true;
+}
+
+void cache_entry::add_ranges(cache_tracker& tracker, const query::clustering_row_ranges& ranges) {
+    auto& s = *_schema;
+    for (auto&& r : ranges) {
+        clustering_bound_opt start = r.start();
+        clustering_bound_opt end = r.end();
+        std::vector<cached_range*> merged;
+        for (auto&& cr : _ranges) {
+            auto& other = cr.range();
+            // Adjacent ranges are merged as well, their bounds are at the same position.
+            if (tri_compare(s, start_position(other), end_position(r)) > 0
+                    || tri_compare(s, start_position(r), end_position(other)) > 0) {
+                continue;
+            }
+            if (tri_compare(s, start_position(other), start_position(start)) < 0) {
+                start = other.start();
+            }
+            if (tri_compare(s, end_position(end), end_position(other)) < 0) {
+                end = other.end();
+            }
+            merged.push_back(&cr);
+        }
+        auto cr = current_allocator().construct<cached_range>(*this, query::clustering_range(std::move(start), std::move(end)));
+        _ranges.push_back(*cr);
+        tracker.insert(*cr);
+        for (auto m : merged) {
+            current_allocator().destroy(m);
+            tracker.on_range_erase();
+        }
+    }
+}
+
+query::clustering_row_ranges cache_entry::ranges() const {
+    query::clustering_row_ranges ret;
+    for (auto&& cr : _ranges) {
+        ret.push_back(cr.range());
+    }
+    return ret;
+}
+
+void cache_entry::apply(const schema& s, mutation_partition&& p) {
+    _absent = false;
+    auto rs = ranges();
+    if (rs.size() == 1 && rs.front().is_full()) {
+        _p.apply(s, std::move(p));
+    } else {
+        _p.apply(s, mutation_partition(p, s, rs));
+    }
+}
+
+void cache_entry::on_evicted(cached_range& r) noexcept {
+    auto rows = _p.range(*_schema, r.range());
+    _p.clustered_rows().erase_and_dispose(rows.begin(), rows.end(), current_deleter<rows_entry>());
 }
@@ -30,7 +30,9 @@
 #include "mutation_reader.hh"
 #include "mutation_partition.hh"
 #include "utils/logalloc.hh"
+#include "utils/lru.hh"
 #include "key_reader.hh"
+#include "sstables/index_page_cache.hh"
 
 namespace scollectd {
 
@@ -40,44 +42,127 @@ struct registrations;
 
 namespace bi = boost::intrusive;
 
+class cache_entry;
+class cache_tracker;
+
+// A clustering range of a cached partition for which the cache holds all
+// rows present in the underlying data source. Such ranges of a single
+// cache_entry never overlap.
+//
+// Ranges are linked into cache_tracker's LRU, so that rows can be evicted
+// without evicting the whole partition. Evicting a range removes rows which
+// fall into it from the partition.
+class cached_range final : public lru_entry {
+    using entry_link_type = bi::list_member_hook<bi::link_mode<bi::auto_unlink>>;
+
+    entry_link_type _entry_link;
+    cache_entry* _entry;
+    query::clustering_range _range;
+    friend class cache_entry;
+public:
+    cached_range(cache_entry& e, query::clustering_range range)
+        : lru_entry(kind::clustering_range)
+        , _entry(&e)
+        , _range(std::move(range))
+    { }
+    cached_range(cached_range&&) noexcept;
+
+    const query::clustering_range& range() const { return _range; }
+    cache_entry& entry() { return *_entry; }
+
+    using container_type = bi::list<cached_range,
+        bi::member_hook<cached_range, entry_link_type, &cached_range::_entry_link>,
+        bi::constant_time_size<false>>; // we need this to have bi::auto_unlink on hooks.
+};
+
 // Intrusive set entry which holds partition data.
 //
+// The partition tombstone, the static row and range tombstones are always
+// complete. Clustering rows are complete only within ranges listed in
+// _ranges, and the partition holds no rows outside of them.
+//
+// An entry may also record that the partition is absent from the underlying
+// data source, so that reads of nonexistent keys don't have to reach it.
+// Such entry has an empty partition which is complete in the full range.
+//
 // TODO: Make memtables use this format too.
-class cache_entry {
+class cache_entry final : public lru_entry {
     // We need auto_unlink<> option on the _cache_link because when entry is
     // evicted from cache via LRU we don't have a reference to the container
     // and don't want to store it with each entry. As for the _lru_link, we
     // have a global LRU, so technically we could not use auto_unlink<> on
     // _lru_link, but it's convenient to do so too. We may also want to have
     // multiple eviction spaces in the future and thus multiple LRUs.
-    using lru_link_type = bi::list_member_hook<bi::link_mode<bi::auto_unlink>>;
     using cache_link_type = bi::set_member_hook<bi::link_mode<bi::auto_unlink>>;
 
+    schema_ptr _schema;
     dht::decorated_key _key;
     mutation_partition _p;
-    lru_link_type _lru_link;
     cache_link_type _cache_link;
+    cached_range::container_type _ranges;
+    bool _absent = false;
     friend class size_calculator;
+private:
+    cached_range* find_covering_range(const query::clustering_range&);
 public:
     friend class row_cache;
     friend class cache_tracker;
 
-    cache_entry(const dht::decorated_key& key, const mutation_partition& p)
-        : _key(key)
+    cache_entry(schema_ptr s, const dht::decorated_key& key, const mutation_partition& p)
+        : lru_entry(kind::partition)
+        , _schema(std::move(s))
+        , _key(key)
         , _p(p)
     { }
 
-    cache_entry(dht::decorated_key&& key, mutation_partition&& p) noexcept
-        : _key(std::move(key))
+    cache_entry(schema_ptr s, dht::decorated_key&& key, mutation_partition&& p) noexcept
+        : lru_entry(kind::partition)
+        , _schema(std::move(s))
+        , _key(std::move(key))
         , _p(std::move(p))
     { }
 
+    struct absent_tag { };
+
+    // Creates an entry for a partition which doesn't exist in the underlying
+    // data source. The caller must mark the full range as complete.
+    cache_entry(schema_ptr s, const dht::decorated_key& key, absent_tag)
+        : lru_entry(kind::partition)
+        , _schema(s)
+        , _key(key)
+        , _p(std::move(s))
+        , _absent(true)
+    { }
+
     cache_entry(cache_entry&&) noexcept;
+    ~cache_entry();
+
+    // Returns true iff the partition is known not to exist in the underlying data source.
+    bool is_absent() const { return _absent; }
 
     const dht::decorated_key& key() const { return _key; }
     const mutation_partition& partition() const { return _p; }
     mutation_partition& partition() { return _p; }
 
+    // Returns true iff all rows in given ranges are present. Moves the
+    // ranges which cover them to the front of the LRU.
+    bool covers(cache_tracker&, const query::clustering_row_ranges&);
+
+    // Marks given ranges as complete, merging them with overlapping and
+    // adjacent ranges. Rows in them must have been already applied to
+    // partition().
+    void add_ranges(cache_tracker&, const query::clustering_row_ranges&);
+
+    // Returns the complete ranges, in no particular order.
+    query::clustering_row_ranges ranges() const;
+
+    // Merges p into the entry, dropping rows which fall outside of the
+    // complete ranges. An absent entry becomes present.
+    void apply(const schema&, mutation_partition&& p);
+
+    // Called when given range is evicted from the cache, before it is destroyed.
+    void on_evicted(cached_range&) noexcept;
+
     struct compare {
         dht::decorated_key::less_comparator _c;
 
@@ -108,37 +193,62 @@ class cache_entry {
 };
 
 // Tracks accesses and performs eviction of cache entries.
+//
+// Besides partitions of row_cache and their clustering ranges, the tracker
+// also manages pages of Index.db cached by sstables (see
+// sstables::cached_index_page). All of them live in the same region and
+// share the LRU.
 class cache_tracker final {
 public:
-    using lru_type = bi::list<cache_entry,
-        bi::member_hook<cache_entry, cache_entry::lru_link_type, &cache_entry::_lru_link>,
-        bi::constant_time_size<false>>; // we need this to have bi::auto_unlink on hooks.
+    using lru_type = lru_entry::lru_type;
 private:
     uint64_t _hits = 0;
     uint64_t _misses = 0;
+    uint64_t _negative_hits = 0;
     uint64_t _insertions = 0;
     uint64_t _merges = 0;
     uint64_t _partitions = 0;
+    uint64_t _clustering_ranges = 0;
+    uint64_t _clustering_range_evictions = 0;
+    uint64_t _index_page_hits = 0;
+    uint64_t _index_page_misses = 0;
+    uint64_t _index_page_insertions = 0;
+    uint64_t _index_page_evictions = 0;
+    uint64_t _index_pages = 0;
     uint64_t _modification_count = 0;
     std::unique_ptr<scollectd::registrations> _collectd_registrations;
     logalloc::region _region;
     lru_type _lru;
 private:
     void setup_collectd();
+    void dispose(lru_entry*) noexcept;
 public:
     cache_tracker();
     ~cache_tracker();
     void clear();
-    void touch(cache_entry&);
+    void touch(lru_entry&);
     void insert(cache_entry&);
-    void on_erase();
+    void insert(cached_range&);
+    void insert(sstables::cached_index_page&);
+    void on_erase(const cache_entry&);
+    void on_range_erase();
     void on_merge();
     void on_hit();
     void on_miss();
+    void on_negative_hit();
+    void on_index_page_hit();
+    void on_index_page_miss();
+    // Frees all pages of given sstable's index.
+    void clear(sstables::cached_index_page::container_type&);
     allocation_strategy& allocator();
     logalloc::region& region();
     const logalloc::region& region() const;
     uint64_t modification_count() const { return _modification_count; }
+    uint64_t partitions() const { return _partitions; }
+    uint64_t clustering_ranges() const { return _clustering_ranges; }
+    uint64_t negative_hits() const { return _negative_hits; }
+    uint64_t index_page_hits() const { return _index_page_hits; }
+    uint64_t index_page_misses() const { return _index_page_misses; }
 };
 
 // Returns a reference to shard-wide cache_tracker.
@@ -166,20 +276,27 @@ class row_cache final {
     struct stats {
         uint64_t hits;
         uint64_t misses;
+        uint64_t negative_hits; // Included in hits.
     };
 private:
     cache_tracker& _tracker;
     stats _stats{};
     schema_ptr _schema;
-    partitions_type _partitions; // Cached partitions are complete.
+    partitions_type _partitions; // Cached partitions may hold only some of the rows, see cache_entry.
     mutation_source _underlying;
     key_source _underlying_keys;
     logalloc::allocating_section _update_section;
     logalloc::allocating_section _populate_section;
     logalloc::allocating_section _read_section;
-    mutation_reader make_scanning_reader(const query::partition_range&);
+    // Incremented by each update(). Lets readers detect that the underlying
+    // data source could have changed since they were created.
+    uint64_t _update_phase = 0;
+    mutation_reader make_scanning_reader(const query::partition_range&, const query::partition_slice&);
     void on_hit();
     void on_miss();
+    void on_negative_hit();
+    // Records that given partition doesn't exist in the underlying data source.
+    void populate_absent(const dht::decorated_key&);
     static thread_local seastar::thread_scheduling_group _update_thread_scheduling_group;
 public:
     ~row_cache();
@@ -188,13 +305,25 @@ class row_cache final {
     row_cache(const row_cache&) = delete;
     row_cache& operator=(row_cache&&) = default;
 public:
-    mutation_reader make_reader(const query::partition_range&);
+    // Partitions are returned with only those clustering rows which fall into
+    // the slice's row ranges, unless they are read from an underlying source
+    // which ignores the slice. A partition is served from cache only if all
+    // rows in the slice are present. Otherwise the slice is read from the
+    // underlying source and the rows are cached. Single-partition reads
+    // which find nothing in the underlying source are cached too.
+    //
+    // The 'range' and 'slice' parameters must be live as long as the reader is used.
+    mutation_reader make_reader(const query::partition_range&, const query::partition_slice& slice = query::full_slice);
     const stats& stats() const { return _stats; }
 public:
     // Populate cache from given mutation. The mutation must contain all
     // information there is for its partition in the underlying data sources.
     void populate(const mutation& m);
 
+    // Like populate(m), but the mutation needs to be complete only within
+    // given clustering ranges. Rows outside of them are not cached.
+    void populate(const mutation& m, const query::clustering_row_ranges& ranges);
+
     // Clears the cache.
     void clear();
 
@@ -133,9 +133,15 @@ struct speculative_retry {
         } else if (str.compare(str.size() - ms.size(), ms.size(), ms) == 0) {
             t = type::CUSTOM;
             v = convert(ms);
+            if (v < 0) {
+                throw std::invalid_argument(sprint("speculative_retry delay must not be negative: %s\n", str));
+            }
         } else if (str.compare(str.size() - percentile.size(), percentile.size(), percentile) == 0) {
             t = type::PERCENTILE;
             v = convert(percentile) / 100;
+            if (v < 0 || v > 1) {
+                throw std::invalid_argument(sprint("speculative_retry percentile must be between 0 and 100: %s\n", str));
+            }
         } else {
             throw std::invalid_argument(sprint("cannot convert %s to speculative_retry\n", str));
         }
@@ -43,6 +43,7 @@
 namespace service {
 
 constexpr std::chrono::milliseconds load_broadcaster::BROADCAST_INTERVAL;
+constexpr std::chrono::milliseconds load_broadcaster::SEVERITY_INTERVAL;
 
 logging::logger logger("load_broadcaster");
 
@@ -68,11 +69,30 @@ void load_broadcaster::start_broadcasting() {
     });
 
     _timer.arm(2 * gms::gossiper::INTERVAL);
+
+    // The severity is the fraction of shards busy compacting, which makes
+    // reads slower. Other nodes' dynamic snitches add it to our score.
+    _severity_done = make_ready_future<>();
+    _severity_timer.set_callback([this] {
+        _severity_done = _db.map_reduce0([](database& db) {
+            return db.get_compaction_manager().get_stats().active_tasks ? 1u : 0u;
+        }, 0u, std::plus<unsigned>()).then([this](unsigned compacting) {
+            double severity = double(compacting) / smp::count;
+            if (severity != _severity) {
+                _severity = severity;
+                gms::versioned_value::factory value_factory;
+                _gossiper.add_local_application_state(gms::application_state::SEVERITY, value_factory.severity(severity));
+            }
+            _severity_timer.arm(SEVERITY_INTERVAL);
+        });
+    });
+    _severity_timer.arm(2 * gms::gossiper::INTERVAL);
 }
 
 future<> load_broadcaster::stop_broadcasting() {
     _timer.cancel();
-    return std::move(_done);
+    _severity_timer.cancel();
+    return when_all(std::move(_done), std::move(_severity_done)).discard_result();
 }
 
 }
@@ -41,12 +41,15 @@
 #include "database.hh"
 #include "gms/i_endpoint_state_change_subscriber.hh"
 #include "gms/gossiper.hh"
+#include "service/storage_proxy.hh"
 
 namespace service {
 class load_broadcaster : public gms::i_endpoint_state_change_subscriber
 {
 public:
     static constexpr std::chrono::milliseconds BROADCAST_INTERVAL{60 * 1000};
+    // Severity changes faster than the load, and is only gossiped when it changes.
+    static constexpr std::chrono::milliseconds SEVERITY_INTERVAL{1000};
 
 private:
     distributed<database>& _db;
@@ -54,6 +57,9 @@ class load_broadcaster : public gms::i_endpoint_state_change_subscriber
     std::unordered_map<gms::inet_address, double> _load_info;
     timer<> _timer;
     future<> _done = make_ready_future<>();
+    timer<> _severity_timer;
+    future<> _severity_done = make_ready_future<>();
+    double _severity = 0;
 
 public:
     load_broadcaster(distributed<database>& db, gms::gossiper& g) : _db(db), _gossiper(g) {
@@ -66,6 +72,11 @@ class load_broadcaster : public gms::i_endpoint_state_change_subscriber
     void on_change(gms::inet_address endpoint, gms::application_state state, gms::versioned_value value) {
         if (state == gms::application_state::LOAD) {
             _load_info[endpoint] = std::stod(value.value);
+        } else if (state == gms::application_state::SEVERITY) {
+            auto severity = std::stod(value.value);
+            get_storage_proxy().invoke_on_all([endpoint, severity] (storage_proxy& p) {
+                p.get_dynamic_snitch().set_severity(endpoint, severity);
+            });
         }
     }
 
@@ -74,6 +85,10 @@ class load_broadcaster : public gms::i_endpoint_state_change_subscriber
         if (local_value) {
             on_change(endpoint, gms::application_state::LOAD, local_value.value());
         }
+        auto severity = ep_state.get_application_state(gms::application_state::SEVERITY);
+        if (severity) {
+            on_change(endpoint, gms::application_state::SEVERITY, severity.value());
+        }
     }
     
     void before_change(gms::inet_address endpoint, gms::endpoint_state current_state, gms::application_state new_state_key, gms::versioned_value newValue) {}
@@ -86,6 +101,9 @@ class load_broadcaster : public gms::i_endpoint_state_change_subscriber
 
     void on_remove(gms::inet_address endpoint) {
         _load_info.erase(endpoint);
+        get_storage_proxy().invoke_on_all([endpoint] (storage_proxy& p) {
+            p.get_dynamic_snitch().remove_endpoint(endpoint);
+        });
     }
 
     const std::unordered_map<gms::inet_address, double> get_load_info() const {
@@ -95,6 +95,18 @@ const dht::token& end_token(const query::partition_range& r) {
     return r.end() ? r.end()->value().token() : max_token;
 }
 
+// The shard of "ep" which owns "t", so that the request doesn't have to be
+// passed to another core once it arrives there.
+static net::messaging_service::shard_id owner_shard(gms::inet_address ep, const dht::token& t) {
+    auto shard_count = net::get_local_messaging_service().get_shard_count(ep);
+    return net::messaging_service::shard_id{ep, shard_count ? dht::global_partitioner().shard_of(t, shard_count) : 0};
+}
+
+static dht::token token_of(database& db, const frozen_mutation& m) {
+    auto schema = db.find_schema(m.column_family_id());
+    return dht::global_partitioner().get_token(*schema, m.key(*schema));
+}
+
 class abstract_write_response_handler {
 protected:
     semaphore _ready; // available when cl is achieved
@@ -271,7 +283,17 @@ storage_proxy::response_id_type storage_proxy::create_write_response_handler(key
 }
 
 storage_proxy::~storage_proxy() {}
-storage_proxy::storage_proxy(distributed<database>& db) : _db(db) {
+static locator::dynamic_snitch::config dynamic_snitch_config(const db::config& cfg) {
+    locator::dynamic_snitch::config c;
+    c.badness_threshold = cfg.dynamic_snitch_badness_threshold();
+    c.update_interval = std::chrono::milliseconds(cfg.dynamic_snitch_update_interval_in_ms());
+    c.reset_interval = std::chrono::milliseconds(cfg.dynamic_snitch_reset_interval_in_ms());
+    return c;
+}
+
+storage_proxy::storage_proxy(distributed<database>& db)
+    : _db(db)
+    , _dynamic_snitch(dynamic_snitch_config(db.local().get_config())) {
     init_messaging_service();
 }
 
@@ -993,9 +1015,10 @@ future<> storage_proxy::send_to_live_endpoints(storage_proxy::response_id_type r
     auto mptr = get_write_response_handler(response_id).get_mutation();
     auto& m = *mptr;
     auto all = boost::range::join(local, dc_groups);
+    auto token = token_of(_db.local(), m);
 
     // OK, now send and/or apply locally
-    return parallel_for_each(all.begin(), all.end(), [response_id, &m, this] (typename decltype(dc_groups)::value_type& dc_targets) {
+    return parallel_for_each(all.begin(), all.end(), [response_id, &m, &token, this] (typename decltype(dc_groups)::value_type& dc_targets) {
         auto my_address = utils::fb_utilities::get_broadcast_address();
         auto& forward = dc_targets.second;
 
@@ -1009,7 +1032,7 @@ future<> storage_proxy::send_to_live_endpoints(storage_proxy::response_id_type r
             });
         } else {
             auto& ms = net::get_local_messaging_service();
-            return ms.send_mutation(net::messaging_service::shard_id{coordinator, 0}, m,
+            return ms.send_mutation(owner_shard(coordinator, token), m,
                 std::move(forward), my_address, engine().cpu_id(), response_id);
         }
     }).handle_exception([mptr] (std::exception_ptr eptr) {
@@ -1284,8 +1307,10 @@ class digest_read_resolver : public abstract_read_resolver {
     size_t _cl_responses = 0;
     promise<> _cl_promise; // cl is reached
     bool _cl_reported = false;
+    gms::inet_address _cl_reached_by; // replica whose response completed cl
     std::vector<foreign_ptr<lw_shared_ptr<query::result>>> _data_results;
     std::vector<query::result_digest> _digest_results;
+    query::digest_algorithm _digest_algo;
 
     virtual void on_timeout() override {
         if (_cl_responses < _block_for) {
@@ -1307,11 +1332,12 @@ class digest_read_resolver : public abstract_read_resolver {
         return std::find_if(_digest_results.begin() + 1, _digest_results.end(), [&first] (query::result_digest digest) { return digest != first; }) == _digest_results.end();
     }
 public:
-    digest_read_resolver(db::consistency_level cl, size_t block_for, std::chrono::high_resolution_clock::time_point timeout) : abstract_read_resolver(cl, 0, timeout), _block_for(block_for) {}
+    digest_read_resolver(db::consistency_level cl, size_t block_for, query::digest_algorithm digest_algo, std::chrono::high_resolution_clock::time_point timeout)
+        : abstract_read_resolver(cl, 0, timeout), _block_for(block_for), _digest_algo(digest_algo) {}
     void add_data(gms::inet_address from, foreign_ptr<lw_shared_ptr<query::result>> result) {
         if (!_timedout) {
             // if only one target was queried digest_check() will be skipped so we can also skip digest calculation
-            _digest_results.emplace_back(_targets_count == 1 ? query::result_digest(bytes()) : result->digest());
+            _digest_results.emplace_back(_targets_count == 1 ? query::result_digest(bytes()) : result->digest(_digest_algo));
             _data_results.emplace_back(std::move(result));
             got_response(from);
         }
@@ -1339,6 +1365,7 @@ class digest_read_resolver : public abstract_read_resolver {
             }
             if (_cl_responses >= _block_for && _data_results.size()) {
                 _cl_reported = true;
+                _cl_reached_by = ep;
                 _cl_promise.set_value();
             }
         }
@@ -1350,6 +1377,9 @@ class digest_read_resolver : public abstract_read_resolver {
     future<> has_cl() {
         return _cl_promise.get_future();
     }
+    bool cl_reached_by(gms::inet_address ep) const {
+        return _cl_reported && _cl_reached_by == ep;
+    }
     bool has_data() {
         return _data_results.size() != 0;
     }
@@ -1469,6 +1499,9 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     using digest_resolver_ptr = ::shared_ptr<digest_read_resolver>;
     using data_resolver_ptr = ::shared_ptr<data_read_resolver>;
 
+    // Shared, so that a concurrent DROP TABLE does not free the column
+    // family while the read is in flight.
+    lw_shared_ptr<column_family> _cf;
     shared_ptr<storage_proxy> _proxy;
     lw_shared_ptr<query::read_command> _cmd;
     lw_shared_ptr<query::read_command> _retry_cmd;
@@ -1477,20 +1510,30 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     size_t _block_for;
     std::vector<gms::inet_address> _targets;
     promise<foreign_ptr<lw_shared_ptr<query::result>>> _result_promise;
+    uint32_t _result_row_count = 0; // live rows of a reconciled result
 
 public:
-    abstract_read_executor(shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl, size_t block_for,
+    abstract_read_executor(lw_shared_ptr<column_family> cf, shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl, size_t block_for,
             std::vector<gms::inet_address> targets) :
-                           _proxy(std::move(proxy)), _cmd(std::move(cmd)), _partition_range(std::move(pr)), _cl(cl), _block_for(block_for), _targets(std::move(targets)) {}
+                           _cf(std::move(cf)), _proxy(std::move(proxy)), _cmd(std::move(cmd)), _partition_range(std::move(pr)), _cl(cl), _block_for(block_for), _targets(std::move(targets)) {}
     virtual ~abstract_read_executor() {};
 
+    uint32_t result_row_count() const {
+        return _result_row_count;
+    }
+
 protected:
+    using latency_clock = std::chrono::high_resolution_clock;
+    // Feeds the dynamic snitch with the time ep took to answer
+    static void receive_timing(storage_proxy& p, gms::inet_address ep, latency_clock::time_point start) {
+        p._dynamic_snitch.receive_timing(ep, std::chrono::duration_cast<std::chrono::microseconds>(latency_clock::now() - start));
+    }
     future<foreign_ptr<lw_shared_ptr<reconcilable_result>>> make_mutation_data_request(lw_shared_ptr<query::read_command> cmd, gms::inet_address ep) {
         if (is_me(ep)) {
             return _proxy->query_mutations_locally(cmd, _partition_range);
         } else {
             auto& ms = net::get_local_messaging_service();
-            return ms.send_read_mutation_data(net::messaging_service::shard_id{ep, 0}, *cmd, _partition_range).then([this](reconcilable_result&& result) {
+            return ms.send_read_mutation_data(owner_shard(ep, start_token(_partition_range)), *cmd, _partition_range).then([this](reconcilable_result&& result) {
                     return make_foreign(::make_lw_shared<reconcilable_result>(std::move(result)));
             });
         }
@@ -1500,7 +1543,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
             return _proxy->query_singular_local(_cmd, _partition_range);
         } else {
             auto& ms = net::get_local_messaging_service();
-            return ms.send_read_data(net::messaging_service::shard_id{ep, 0}, *_cmd, _partition_range).then([this](query::result&& result) {
+            return ms.send_read_data(owner_shard(ep, start_token(_partition_range)), *_cmd, _partition_range).then([this](query::result&& result) {
                 return make_foreign(::make_lw_shared<query::result>(std::move(result)));
             });
         }
@@ -1510,14 +1553,16 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
             return _proxy->query_singular_local_digest(_cmd, _partition_range);
         } else {
             auto& ms = net::get_local_messaging_service();
-            return ms.send_read_digest(net::messaging_service::shard_id{ep, 0}, *_cmd, _partition_range);
+            return ms.send_read_digest(owner_shard(ep, start_token(_partition_range)), *_cmd, _partition_range);
         }
     }
     future<> make_mutation_data_requests(lw_shared_ptr<query::read_command> cmd, data_resolver_ptr resolver, targets_iterator begin, targets_iterator end) {
         return parallel_for_each(begin, end, [this, &cmd, resolver = std::move(resolver)] (gms::inet_address ep) {
-            return make_mutation_data_request(cmd, ep).then_wrapped([resolver, ep] (future<foreign_ptr<lw_shared_ptr<reconcilable_result>>> f) {
+            return make_mutation_data_request(cmd, ep).then_wrapped([p = _proxy, start = latency_clock::now(), resolver, ep] (future<foreign_ptr<lw_shared_ptr<reconcilable_result>>> f) {
                 try {
-                    resolver->add_mutate_data(ep, f.get0());
+                    auto result = f.get0();
+                    receive_timing(*p, ep, start);
+                    resolver->add_mutate_data(ep, std::move(result));
                 } catch(...) {
                     resolver->error(ep, std::current_exception());
                 }
@@ -1526,9 +1571,11 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_data_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver)] (gms::inet_address ep) {
-            return make_data_request(ep).then_wrapped([resolver, ep] (future<foreign_ptr<lw_shared_ptr<query::result>>> f) {
+            return make_data_request(ep).then_wrapped([p = _proxy, start = latency_clock::now(), resolver, ep] (future<foreign_ptr<lw_shared_ptr<query::result>>> f) {
                 try {
-                    resolver->add_data(ep, f.get0());
+                    auto result = f.get0();
+                    receive_timing(*p, ep, start);
+                    resolver->add_data(ep, std::move(result));
                 } catch(...) {
                     resolver->error(ep, std::current_exception());
                 }
@@ -1537,9 +1584,11 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
     }
     future<> make_digest_requests(digest_resolver_ptr resolver, targets_iterator begin, targets_iterator end) {
         return parallel_for_each(begin, end, [this, resolver = std::move(resolver)] (gms::inet_address ep) {
-            return make_digest_request(ep).then_wrapped([resolver, ep] (future<query::result_digest> f) {
+            return make_digest_request(ep).then_wrapped([p = _proxy, start = latency_clock::now(), resolver, ep] (future<query::result_digest> f) {
                 try {
-                    resolver->add_digest(ep, f.get0());
+                    auto digest = f.get0();
+                    receive_timing(*p, ep, start);
+                    resolver->add_digest(ep, std::move(digest));
                 } catch(...) {
                     resolver->error(ep, std::current_exception());
                 }
@@ -1571,6 +1620,7 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
                 // than the total number of column we are interested in (which may be < count on a retry).
                 // So in particular, if no host returned count live columns, we know it's not a short read.
                 if (data_resolver->max_live_count() < cmd->row_limit || rr.row_count() >= original_row_limit()) {
+                    _result_row_count = rr.row_count();
                     auto result = ::make_foreign(::make_lw_shared(to_data_query_result(std::move(rr), std::move(s), _cmd->slice)));
                     _result_promise.set_value(std::move(result));
                 } else {
@@ -1593,18 +1643,20 @@ class abstract_read_executor : public enable_shared_from_this<abstract_read_exec
 
 public:
     virtual future<foreign_ptr<lw_shared_ptr<query::result>>> execute(std::chrono::high_resolution_clock::time_point timeout) {
-        digest_resolver_ptr digest_resolver = ::make_shared<digest_read_resolver>(_cl, _block_for, timeout);
+        digest_resolver_ptr digest_resolver = ::make_shared<digest_read_resolver>(_cl, _block_for, _cmd->digest_algo, timeout);
         auto exec = shared_from_this();
+        auto start = std::chrono::high_resolution_clock::now();
 
         make_requests(digest_resolver).finally([exec]() {
             // hold on to executor until all queries are complete
         });
 
-        digest_resolver->has_cl().then_wrapped([this, exec, digest_resolver, timeout] (future<> f) {
+        digest_resolver->has_cl().then_wrapped([this, exec, digest_resolver, timeout, start] (future<> f) {
             try {
                 got_cl();
                 f.get();
                 exec->_result_promise.set_value(digest_resolver->resolve()); // can throw digest missmatch exception
+                _cf->add_coordinator_read_latency(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - start));
                 auto done = digest_resolver->done();
                 if (exec->_block_for < exec->_targets.size()) { // if there are more targets then needed for cl, check digest in background
                     done.then_wrapped([exec, digest_resolver] (future<>&& f){
@@ -1650,11 +1702,16 @@ class always_speculating_read_executor : public abstract_read_executor {
 // this executor sends request to an additional replica after some time below timeout
 class speculating_read_executor : public abstract_read_executor {
     timer<> _speculate_timer;
+    digest_resolver_ptr _resolver;
+    bool _speculated = false;
 public:
     using abstract_read_executor::abstract_read_executor;
     virtual future<> make_requests(digest_resolver_ptr resolver) {
+        _resolver = resolver;
         _speculate_timer.set_callback([this, resolver] {
             if (!resolver->is_completed()) { // at the time the callback runs request may be completed already
+                _speculated = true;
+                _cf->mark_speculative_retry();
                 resolver->add_wait_targets(1); // we send one more request so wait for it too
                 future<> f = resolver->has_data() ?
                         make_digest_requests(resolver, _targets.end() - 1, _targets.end()) :
@@ -1662,9 +1719,14 @@ class speculating_read_executor : public abstract_read_executor {
                 f.finally([exec = shared_from_this()]{});
             }
         });
-        // FIXME: the timeout should come from previous latency statistics for a partition
-        auto timeout = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(_proxy->get_db().local().get_config().read_request_timeout_in_ms()/2);
-        _speculate_timer.arm(timeout);
+        // Wait for the usual latency of reads of this column family, but
+        // never longer than half of the timeout.
+        std::chrono::microseconds delay = std::chrono::milliseconds(_proxy->get_db().local().get_config().read_request_timeout_in_ms()/2);
+        auto retry_delay = _cf->speculative_retry_delay();
+        if (retry_delay) {
+            delay = std::min(delay, *retry_delay);
+        }
+        _speculate_timer.arm(std::chrono::high_resolution_clock::now() + delay);
 
         // if CL + RR result in covering all replicas, getReadExecutor forces AlwaysSpeculating.  So we know
         // that the last replica in our list is "extra."
@@ -1684,13 +1746,16 @@ class speculating_read_executor : public abstract_read_executor {
     }
     virtual void got_cl() override {
         _speculate_timer.cancel();
+        if (_speculated && _resolver->cl_reached_by(_targets.back())) {
+            _cf->mark_speculative_retry_won();
+        }
     }
 };
 
 class range_slice_read_executor : public abstract_read_executor {
 public:
-    range_slice_read_executor(shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl, std::vector<gms::inet_address> targets) :
-                                    abstract_read_executor(std::move(proxy), std::move(cmd), std::move(pr), cl, targets.size(), std::move(targets)) {}
+    range_slice_read_executor(lw_shared_ptr<column_family> cf, shared_ptr<storage_proxy> proxy, lw_shared_ptr<query::read_command> cmd, query::partition_range pr, db::consistency_level cl, std::vector<gms::inet_address> targets) :
+                                    abstract_read_executor(std::move(cf), std::move(proxy), std::move(cmd), std::move(pr), cl, targets.size(), std::move(targets)) {}
     virtual future<foreign_ptr<lw_shared_ptr<query::result>>> execute(std::chrono::high_resolution_clock::time_point timeout) override {
         reconciliate(_cl, timeout);
         return _result_promise.get_future();
@@ -1727,23 +1792,21 @@ ::shared_ptr<abstract_read_executor> storage_proxy::get_read_executor(lw_shared_
         ReadRepairMetrics.attempted.mark();
 #endif
 
-#if 0
-    ColumnFamilyStore cfs = keyspace.getColumnFamilyStore(command.cfName);
-#endif
+    auto cf = _db.local().get_column_families().at(schema->id());
     speculative_retry::type retry_type = schema->speculative_retry().get_type();
 
     size_t block_for = db::block_for(ks, cl);
     auto p = shared_from_this();
     // Speculative retry is disabled *OR* there are simply no extra replicas to speculate.
     if (retry_type == speculative_retry::type::NONE || db::block_for(ks, cl) == all_replicas.size()) {
-        return ::make_shared<never_speculating_read_executor>(p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
+        return ::make_shared<never_speculating_read_executor>(cf, p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
     }
 
     if (target_replicas.size() == all_replicas.size()) {
         // CL.ALL, RRD.GLOBAL or RRD.DC_LOCAL and a single-DC.
         // We are going to contact every node anyway, so ask for 2 full data requests instead of 1, for redundancy
         // (same amount of requests in total, but we turn 1 digest request into a full blown data request).
-        return ::make_shared<always_speculating_read_executor>(/*cfs, */p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
+        return ::make_shared<always_speculating_read_executor>(cf, p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
     }
 
     // RRD.NONE or RRD.DC_LOCAL w/ multiple DCs.
@@ -1759,16 +1822,16 @@ ::shared_ptr<abstract_read_executor> storage_proxy::get_read_executor(lw_shared_
     target_replicas.push_back(extra_replica);
 
     if (retry_type == speculative_retry::type::ALWAYS) {
-        return ::make_shared<always_speculating_read_executor>(/*cfs,*/p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
+        return ::make_shared<always_speculating_read_executor>(cf, p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
     } else {// PERCENTILE or CUSTOM.
-        return ::make_shared<speculating_read_executor>(/*cfs,*/p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
+        return ::make_shared<speculating_read_executor>(cf, p, cmd, std::move(pr), cl, block_for, std::move(target_replicas));
     }
 }
 
 future<query::result_digest>
 storage_proxy::query_singular_local_digest(lw_shared_ptr<query::read_command> cmd, const query::partition_range& pr) {
-    return query_singular_local(cmd, pr).then([] (foreign_ptr<lw_shared_ptr<query::result>> result) {
-        return result->digest();
+    return query_singular_local(cmd, pr).then([cmd] (foreign_ptr<lw_shared_ptr<query::result>> result) {
+        return result->digest(cmd->digest_algo);
     });
 }
 
@@ -1782,12 +1845,32 @@ storage_proxy::query_singular_local(lw_shared_ptr<query::read_command> cmd, cons
     });
 }
 
+future<foreign_ptr<lw_shared_ptr<query::result>>>
+storage_proxy::query_local(lw_shared_ptr<query::read_command> cmd, std::vector<query::partition_range>&& partition_ranges) {
+    for (auto&& pr : partition_ranges) {
+        if (!pr.is_singular()) {
+            throw std::runtime_error("local queries support only singular ranges");
+        }
+    }
+    return do_with(std::move(partition_ranges), [this, cmd] (std::vector<query::partition_range>& prs) {
+        query::result_merger merger;
+        merger.reserve(prs.size());
+        return ::map_reduce(prs.begin(), prs.end(), [this, cmd] (const query::partition_range& pr) {
+            return query_singular_local(cmd, pr);
+        }, std::move(merger));
+    });
+}
+
 future<foreign_ptr<lw_shared_ptr<query::result>>>
 storage_proxy::query_singular(lw_shared_ptr<query::read_command> cmd, std::vector<query::partition_range>&& partition_ranges, db::consistency_level cl) {
     std::vector<::shared_ptr<abstract_read_executor>> exec;
     exec.reserve(partition_ranges.size());
     auto timeout = std::chrono::high_resolution_clock::now() + std::chrono::milliseconds(_db.local().get_config().read_request_timeout_in_ms());
 
+    // Replicas compare digests of their results, so they must all hash them the same way
+    cmd->digest_algo = get_local_storage_service().cluster_supports_murmur3_digest()
+            ? query::digest_algorithm::murmur3 : query::digest_algorithm::md5;
+
     for (auto&& pr: partition_ranges) {
         if (!pr.is_singular()) {
             throw std::runtime_error("mixed singular and non singular range are not supported");
@@ -1807,17 +1890,22 @@ storage_proxy::query_singular(lw_shared_ptr<query::read_command> cmd, std::vecto
     });
 }
 
+int storage_proxy::range_concurrency_factor(double ranges_needed, size_t ranges_left) {
+    return int(std::max(1.0, std::min(double(ranges_left), ranges_needed)));
+}
+
 future<std::vector<foreign_ptr<lw_shared_ptr<query::result>>>>
 storage_proxy::query_partition_key_range_concurrent(std::chrono::high_resolution_clock::time_point timeout, std::vector<foreign_ptr<lw_shared_ptr<query::result>>>&& results,
         lw_shared_ptr<query::read_command> cmd, db::consistency_level cl, std::vector<query::partition_range>::iterator&& i,
-        std::vector<query::partition_range>&& ranges, int concurrency_factor) {
+        std::vector<query::partition_range>&& ranges, int concurrency_factor, uint32_t rows_returned) {
     schema_ptr schema = _db.local().find_schema(cmd->cf_id);
     keyspace& ks = _db.local().find_keyspace(schema->ks_name());
+    auto cf = _db.local().get_column_families().at(schema->id());
     std::vector<::shared_ptr<abstract_read_executor>> exec;
     auto concurrent_fetch_starting_index = i;
     auto p = shared_from_this();
 
-    while (i != ranges.end() && std::distance(i, concurrent_fetch_starting_index) < concurrency_factor) {
+    while (i != ranges.end() && std::distance(concurrent_fetch_starting_index, i) < concurrency_factor) {
         query::partition_range& range = *i;
         std::vector<gms::inet_address> live_endpoints = get_live_sorted_endpoints(ks, end_token(range));
         std::vector<gms::inet_address> filtered_endpoints = filter_for_query(cl, ks, live_endpoints);
@@ -1864,7 +1952,7 @@ storage_proxy::query_partition_key_range_concurrent(std::chrono::high_resolution
             ++i;
         }
         db::assure_sufficient_live_nodes(cl, ks, filtered_endpoints);
-        exec.push_back(::make_shared<range_slice_read_executor>(p, cmd, std::move(range), cl, std::move(filtered_endpoints)));
+        exec.push_back(::make_shared<range_slice_read_executor>(cf, p, cmd, std::move(range), cl, std::move(filtered_endpoints)));
     }
 
     query::result_merger merger;
@@ -1874,14 +1962,28 @@ storage_proxy::query_partition_key_range_concurrent(std::chrono::high_resolution
         return rex->execute(timeout);
     }, std::move(merger));
 
-    return f.then([p, exec = std::move(exec), results = std::move(results), i = std::move(i), ranges = std::move(ranges), cl, cmd, concurrency_factor, timeout]
+    return f.then([p, exec = std::move(exec), results = std::move(results), i = std::move(i), ranges = std::move(ranges), cl, cmd, concurrency_factor, rows_returned, timeout]
                    (foreign_ptr<lw_shared_ptr<query::result>>&& result) mutable {
         results.emplace_back(std::move(result));
-        if (i == ranges.end()) {
+        for (auto&& rex : exec) {
+            rows_returned += rex->result_row_count();
+        }
+        // Ranges are queried in order, so the rows of the remaining ones would be past the limit.
+        if (i == ranges.end() || rows_returned >= cmd->row_limit) {
             return make_ready_future<std::vector<foreign_ptr<lw_shared_ptr<query::result>>>>(std::move(results));
+        }
+
+        // Our estimate was off: size the next round after the rows the previous ones returned.
+        auto ranges_queried = std::distance(ranges.begin(), i);
+        auto ranges_left = std::distance(i, ranges.end());
+        if (rows_returned == 0) {
+            // Nothing yet, so query all remaining ranges at once
+            concurrency_factor = ranges_left;
         } else {
-            return p->query_partition_key_range_concurrent(timeout, std::move(results), cmd, cl, std::move(i), std::move(ranges), concurrency_factor);
+            double rows_per_range = double(rows_returned) / ranges_queried;
+            concurrency_factor = range_concurrency_factor(std::round((cmd->row_limit - rows_returned) / rows_per_range), ranges_left);
         }
+        return p->query_partition_key_range_concurrent(timeout, std::move(results), cmd, cl, std::move(i), std::move(ranges), concurrency_factor, rows_returned);
     });
 }
 
@@ -1905,12 +2007,12 @@ storage_proxy::query_partition_key_range(lw_shared_ptr<query::read_command> cmd,
     // underestimate how many rows we will get per-range in order to increase the likelihood that we'll
     // fetch enough rows in the first round
     result_rows_per_range -= result_rows_per_range * CONCURRENT_SUBREQUESTS_MARGIN;
-    int concurrency_factor = result_rows_per_range == 0.0 ? 1 : std::max(1, std::min(int(ranges.size()), int(std::ceil(cmd->row_limit / result_rows_per_range))));
+    int concurrency_factor = result_rows_per_range == 0.0 ? 1 : range_concurrency_factor(std::ceil(double(cmd->row_limit) / result_rows_per_range), ranges.size());
 
     std::vector<foreign_ptr<lw_shared_ptr<query::result>>> results;
     results.reserve(ranges.size()/concurrency_factor + 1);
 
-    return query_partition_key_range_concurrent(timeout, std::move(results), cmd, cl, ranges.begin(), std::move(ranges), concurrency_factor)
+    return query_partition_key_range_concurrent(timeout, std::move(results), cmd, cl, ranges.begin(), std::move(ranges), concurrency_factor, 0)
             .then([](std::vector<foreign_ptr<lw_shared_ptr<query::result>>> results) {
         query::result_merger merger;
         merger.reserve(results.size());
@@ -2056,7 +2158,7 @@ std::vector<gms::inet_address> storage_proxy::get_live_sorted_endpoints(keyspace
     std::vector<gms::inet_address> eps = rs.get_natural_endpoints(token);
     auto itend = boost::range::remove_if(eps, std::not1(std::bind1st(std::mem_fn(&gms::failure_detector::is_alive), &gms::get_local_failure_detector())));
     eps.erase(itend, eps.end());
-    locator::i_endpoint_snitch::get_local_snitch_ptr()->sort_by_proximity(utils::fb_utilities::get_broadcast_address(), eps);
+    _dynamic_snitch.sort_by_proximity(utils::fb_utilities::get_broadcast_address(), eps);
     return eps;
 }
 
@@ -2076,58 +2178,18 @@ std::vector<gms::inet_address> storage_proxy::intersection(const std::vector<gms
  */
 float storage_proxy::estimate_result_rows_per_range(lw_shared_ptr<query::read_command> cmd, keyspace& ks)
 {
-    return 1.0;
-#if 0
-    ColumnFamilyStore cfs = keyspace.getColumnFamilyStore(command.columnFamily);
-    float resultRowsPerRange = Float.POSITIVE_INFINITY;
-    if (command.rowFilter != null && !command.rowFilter.isEmpty())
-    {
-        List<SecondaryIndexSearcher> searchers = cfs.indexManager.getIndexSearchersForQuery(command.rowFilter);
-        if (searchers.isEmpty())
-        {
-            resultRowsPerRange = calculateResultRowsUsingEstimatedKeys(cfs);
-        }
-        else
-        {
-            // Secondary index query (cql3 or otherwise).  Estimate result rows based on most selective 2ary index.
-            for (SecondaryIndexSearcher searcher : searchers)
-            {
-                // use our own mean column count as our estimate for how many matching rows each node will have
-                SecondaryIndex highestSelectivityIndex = searcher.highestSelectivityIndex(command.rowFilter);
-                resultRowsPerRange = Math.min(resultRowsPerRange, highestSelectivityIndex.estimateResultRows());
-            }
-        }
-    }
-    else if (!command.countCQL3Rows())
-    {
-        // non-cql3 query
-        resultRowsPerRange = cfs.estimateKeys();
-    }
-    else
-    {
-        resultRowsPerRange = calculateResultRowsUsingEstimatedKeys(cfs);
-    }
-
-    // adjust resultRowsPerRange by the number of tokens this node has and the replication factor for this ks
-    return (resultRowsPerRange / DatabaseDescriptor.getNumTokens()) / keyspace.getReplicationStrategy().getReplicationFactor();
-#endif
+    // FIXME: secondary index queries should be estimated from the most selective index
+    auto& cf = _db.local().find_column_family(cmd->cf_id);
+    // Partitions are spread evenly among shards, so this shard stands for all of them.
+    float result_rows_per_range = float(cf.estimated_partitions()) * smp::count * cf.estimated_rows_per_partition();
+
+    // adjust result_rows_per_range by the number of tokens this node has and the replication factor for this ks
+    auto num_tokens = std::max(1u, _db.local().get_config().num_tokens());
+    auto rf = std::max(size_t(1), ks.get_replication_strategy().get_replication_factor());
+    return (result_rows_per_range / num_tokens) / rf;
 }
 
 #if 0
-    private static float calculateResultRowsUsingEstimatedKeys(ColumnFamilyStore cfs)
-    {
-        if (cfs.metadata.comparator.isDense())
-        {
-            // one storage row per result row, so use key estimate directly
-            return cfs.estimateKeys();
-        }
-        else
-        {
-            float resultRowsPerStorageRow = ((float) cfs.getMeanColumns()) / cfs.metadata.regularColumns().size();
-            return resultRowsPerStorageRow * (cfs.estimateKeys());
-        }
-    }
-
     private static List<Row> trim(AbstractRangeCommand command, List<Row> rows)
     {
         // When maxIsColumns, we let the caller trim the result.
@@ -2472,9 +2534,9 @@ void storage_proxy::init_messaging_service() {
                         });
                         // return void, no need to wait for send to complete
                     }),
-                    parallel_for_each(forward.begin(), forward.end(), [reply_to, shard, response_id, &m] (gms::inet_address forward) {
+                    parallel_for_each(forward.begin(), forward.end(), [reply_to, shard, response_id, &m, &p] (gms::inet_address forward) {
                         auto& ms = net::get_local_messaging_service();
-                        return ms.send_mutation(net::messaging_service::shard_id{forward, 0}, m, {}, reply_to, shard, response_id).then_wrapped([] (future<> f) {
+                        return ms.send_mutation(owner_shard(forward, token_of(p->get_db().local(), m)), m, {}, reply_to, shard, response_id).then_wrapped([] (future<> f) {
                             f.ignore_ready_future();
                         });
                     })
@@ -2713,6 +2775,135 @@ class shard_reader final : public mutation_reader::impl {
     }
 };
 
+// Reads fragments of a column family on another shard. Fragments are moved
+// to this shard in batches of at most max_fragments_per_batch, frozen as a
+// piece of the partition they belong to.
+class shard_streamed_reader final : public streamed_mutation_reader::impl {
+    static constexpr size_t max_fragments_per_batch = 128;
+    distributed<database>& _db;
+    unsigned _shard;
+    utils::UUID _cf_id;
+    const query::partition_range _range;
+    schema_ptr _local_schema;
+    struct remote_state {
+        streamed_mutation_reader reader;
+        std::experimental::optional<dht::decorated_key> current_key;
+        std::experimental::optional<frozen_mutation> batch;
+        bool starts_partition = false;
+        bool ends_partition = false;
+    };
+    foreign_ptr<std::unique_ptr<remote_state>> _remote;
+    std::deque<mutation_fragment> _buffer;
+private:
+    future<> init() {
+        _local_schema = _db.local().find_column_family(_cf_id).schema();
+        return _db.invoke_on(_shard, [this] (database& db) {
+            column_family& cf = db.find_column_family(_cf_id);
+            auto rs = std::make_unique<remote_state>();
+            rs->reader = cf.make_streamed_reader(_range);
+            return make_foreign(std::move(rs));
+        }).then([this] (auto&& ptr) {
+            _remote = std::move(ptr);
+        });
+    }
+
+    // Runs on the remote shard
+    static future<> read_batch(remote_state& rs, schema_ptr s) {
+        rs.batch = {};
+        rs.starts_partition = false;
+        rs.ends_partition = false;
+        auto m = make_lw_shared<std::experimental::optional<mutation>>();
+        if (rs.current_key) {
+            *m = mutation(*rs.current_key, s);
+        }
+        auto fragments = make_lw_shared<size_t>(0);
+        return repeat([&rs, s, m, fragments] {
+            return rs.reader().then([&rs, s, m, fragments] (mutation_fragment_opt&& mfo) {
+                if (!mfo) {
+                    return stop_iteration::yes;
+                }
+                if (mfo->is_partition_start()) {
+                    auto& ps = mfo->as_partition_start();
+                    rs.current_key = ps.key();
+                    rs.starts_partition = true;
+                    *m = mutation(std::move(ps.key()), s);
+                    (*m)->partition().apply(ps.partition_tombstone());
+                } else if (mfo->is_partition_end()) {
+                    rs.current_key = {};
+                    rs.ends_partition = true;
+                    return stop_iteration::yes;
+                } else {
+                    apply_fragment(**m, std::move(*mfo));
+                }
+                return ++*fragments < max_fragments_per_batch ? stop_iteration::no : stop_iteration::yes;
+            });
+        }).then([&rs, m] {
+            if (*m) {
+                rs.batch = freeze(**m);
+            }
+        });
+    }
+public:
+    shard_streamed_reader(utils::UUID cf_id, distributed<database>& db, unsigned shard, const query::partition_range& range)
+        : _db(db)
+        , _shard(shard)
+        , _cf_id(cf_id)
+        , _range(range)
+    { }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (!_buffer.empty()) {
+            auto mf = std::move(_buffer.front());
+            _buffer.pop_front();
+            return make_ready_future<mutation_fragment_opt>(std::move(mf));
+        }
+        if (!_remote) {
+            return init().then([this] {
+                return (*this)();
+            });
+        }
+        return _db.invoke_on(_shard, [this] (database& db) {
+            return read_batch(*_remote, db.find_column_family(_cf_id).schema());
+        }).then([this] () -> future<mutation_fragment_opt> {
+            if (!_remote->batch) {
+                return make_ready_future<mutation_fragment_opt>();
+            }
+            // The batch is a piece of a partition, drop the partition
+            // boundaries which fragment_mutation() adds around it but which
+            // do not belong to the piece.
+            _buffer = fragment_mutation(_remote->batch->unfreeze(_local_schema));
+            if (!_remote->starts_partition) {
+                _buffer.pop_front();
+            }
+            if (!_remote->ends_partition) {
+                _buffer.pop_back();
+            }
+            return (*this)();
+        });
+    }
+};
+
+streamed_mutation_reader
+storage_proxy::make_local_streamed_reader(utils::UUID cf_id, const query::partition_range& range) {
+    auto schema = _db.local().find_column_family(cf_id).schema();
+    if (range.is_wrap_around(dht::ring_position_comparator(*schema))) {
+        auto unwrapped = range.unwrap();
+        std::vector<streamed_mutation_reader> both;
+        both.reserve(2);
+        both.push_back(make_local_streamed_reader(cf_id, unwrapped.second));
+        both.push_back(make_local_streamed_reader(cf_id, unwrapped.first));
+        return make_joining_reader(std::move(both));
+    }
+
+    unsigned first_shard = range.start() ? dht::shard_of(range.start()->value().token()) : 0;
+    unsigned last_shard = range.end() ? dht::shard_of(range.end()->value().token()) : smp::count - 1;
+    std::vector<streamed_mutation_reader> readers;
+    for (auto cpu = first_shard; cpu <= last_shard; ++cpu) {
+        readers.emplace_back(make_streamed_mutation_reader<shard_streamed_reader>(cf_id, _db, cpu, range));
+    }
+    return make_joining_reader(std::move(readers));
+}
+
 mutation_reader
 storage_proxy::make_local_reader(utils::UUID cf_id, const query::partition_range& range) {
     // Split ranges which wrap around, because the individual readers created
@@ -50,6 +50,7 @@
 #include "db/write_type.hh"
 #include "utils/histogram.hh"
 #include "sstables/estimated_histogram.hh"
+#include "locator/dynamic_snitch.hh"
 
 namespace service {
 
@@ -92,6 +93,7 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     // for read repair chance calculation
     std::default_random_engine _urandom;
     std::uniform_real_distribution<> _read_repair_chance = std::uniform_real_distribution<>(0,1);
+    locator::dynamic_snitch _dynamic_snitch;
 private:
     void init_messaging_service();
     void uninit_messaging_service();
@@ -123,7 +125,7 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
     static std::vector<gms::inet_address> intersection(const std::vector<gms::inet_address>& l1, const std::vector<gms::inet_address>& l2);
     future<std::vector<foreign_ptr<lw_shared_ptr<query::result>>>> query_partition_key_range_concurrent(std::chrono::high_resolution_clock::time_point timeout,
             std::vector<foreign_ptr<lw_shared_ptr<query::result>>>&& results, lw_shared_ptr<query::read_command> cmd, db::consistency_level cl, std::vector<query::partition_range>::iterator&& i,
-            std::vector<query::partition_range>&& ranges, int concurrency_factor);
+            std::vector<query::partition_range>&& ranges, int concurrency_factor, uint32_t rows_returned);
 
     future<foreign_ptr<lw_shared_ptr<query::result>>> do_query(schema_ptr,
         lw_shared_ptr<query::read_command> cmd,
@@ -142,6 +144,16 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
         return _db;
     }
 
+    locator::dynamic_snitch& get_dynamic_snitch() {
+        return _dynamic_snitch;
+    }
+
+    // Number of ranges of a range scan to query in the next round, so that
+    // ranges_needed of them are queried, but at least one and at most
+    // ranges_left. ranges_needed is estimated from the wanted row count, which
+    // may be query::max_rows, so it is clamped before converting it to int.
+    static int range_concurrency_factor(double ranges_needed, size_t ranges_left);
+
     future<> mutate_locally(const mutation& m);
     future<> mutate_locally(const frozen_mutation& m);
     future<> mutate_locally(std::vector<mutation> mutations);
@@ -190,6 +202,10 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
         std::vector<query::partition_range>&& partition_ranges,
         db::consistency_level cl);
 
+    /*
+     * Executes data query on this node only, ignoring the replication. Only
+     * singular ranges are supported.
+     */
     future<foreign_ptr<lw_shared_ptr<query::result>>> query_local(lw_shared_ptr<query::read_command> cmd, std::vector<query::partition_range>&& partition_ranges);
 
     future<foreign_ptr<lw_shared_ptr<reconcilable_result>>> query_mutations_locally(
@@ -201,6 +217,13 @@ class storage_proxy : public seastar::async_sharded_service<storage_proxy> /*imp
      */
     mutation_reader make_local_reader(utils::UUID cf_id, const query::partition_range&);
 
+    /*
+     * Like make_local_reader(), but returns partitions as fragments, which
+     * are read from memtables and sstables of each shard and sent to this
+     * shard in bounded batches, so partitions are never materialized whole.
+     */
+    streamed_mutation_reader make_local_streamed_reader(utils::UUID cf_id, const query::partition_range&);
+
     future<> stop();
 
     friend class abstract_read_executor;
@@ -60,6 +60,7 @@
 #include "dht/range_streamer.hh"
 #include <boost/range/adaptors.hpp>
 #include <boost/range/algorithm.hpp>
+#include <boost/lexical_cast.hpp>
 #include "service/load_broadcaster.hh"
 
 using token = dht::token;
@@ -176,6 +177,9 @@ future<> storage_service::prepare_to_join() {
         app_states.emplace(gms::application_state::HOST_ID, value_factory.host_id(local_host_id));
         app_states.emplace(gms::application_state::RPC_ADDRESS, value_factory.rpcaddress(broadcast_rpc_address));
         app_states.emplace(gms::application_state::RELEASE_VERSION, value_factory.release_version());
+        app_states.emplace(gms::application_state::SUPPORTED_FEATURES, value_factory.supported_features(
+                versioned_value::version_string({MURMUR3_DIGEST_FEATURE, AGGREGATE_PUSHDOWN_FEATURE, CQL_COLUMNS_FEATURE})));
+        app_states.emplace(gms::application_state::SHARD_COUNT, value_factory.shard_count(smp::count));
         logger.info("Starting up server gossip");
 
         auto& gossiper = gms::get_local_gossiper();
@@ -716,10 +720,26 @@ void storage_service::on_change(inet_address endpoint, application_state state,
             return;
         }
         do_update_system_peers_table(endpoint, state, value);
+        if (state == application_state::LOAD || state == application_state::SEVERITY) {
+            // These change all the time, but affect neither the token
+            // metadata nor the features copied to all cores below.
+            return;
+        }
         if (state == application_state::SCHEMA) {
             get_local_migration_manager().schedule_schema_pull(endpoint, *ep_state).handle_exception([endpoint] (auto ep) {
                 logger.warn("Fail to pull schmea from {}: {}", endpoint, ep);
             });
+        } else if (state == application_state::SHARD_COUNT) {
+            unsigned shard_count;
+            try {
+                shard_count = boost::lexical_cast<unsigned>(value.value.begin(), value.value.size());
+            } catch (const boost::bad_lexical_cast&) {
+                logger.error("invalid shard count {} for {}", value.value, endpoint);
+                return;
+            }
+            net::get_messaging_service().invoke_on_all([endpoint, shard_count] (auto&& ms) {
+                ms.set_shard_count(endpoint, shard_count);
+            }).get();
         }
     }
     replicate_to_all_cores().get();
@@ -730,6 +750,11 @@ void storage_service::on_remove(gms::inet_address endpoint) {
     logger.debug("on_remove endpoint={}", endpoint);
     _token_metadata.remove_endpoint(endpoint);
     get_local_pending_range_calculator_service().update().get();
+    net::get_messaging_service().invoke_on_all([endpoint] (auto&& ms) {
+        ms.remove_shard_count(endpoint);
+    }).get();
+    // The removed node may have been the last one lacking a feature
+    replicate_to_all_cores().get();
 }
 
 void storage_service::on_dead(gms::inet_address endpoint, gms::endpoint_state state) {
@@ -990,15 +1015,48 @@ future<> storage_service::init_server(int delay) {
     });
 }
 
+// Nodes which are not known to gossip yet, like ring members loaded from
+// system.peers, are assumed not to support the feature.
+bool storage_service::all_nodes_support(const sstring& feature) {
+    auto& gossiper = gms::get_local_gossiper();
+    for (auto&& x : gossiper.endpoint_state_map) {
+        if (gossiper.is_dead_state(x.second)) {
+            continue;
+        }
+        auto features = x.second.get_application_state(application_state::SUPPORTED_FEATURES);
+        if (!features) {
+            return false;
+        }
+        std::vector<sstring> names;
+        boost::split(names, features->value, boost::is_any_of(sstring(versioned_value::DELIMITER_STR)));
+        if (boost::range::find(names, feature) == names.end()) {
+            return false;
+        }
+    }
+    for (auto&& endpoint : _token_metadata.get_all_endpoints()) {
+        if (!gossiper.endpoint_state_map.count(endpoint)) {
+            return false;
+        }
+    }
+    return true;
+}
+
 future<> storage_service::replicate_to_all_cores() {
     assert(engine().cpu_id() == 0);
+    _murmur3_digest_supported = all_nodes_support(MURMUR3_DIGEST_FEATURE);
+    _aggregate_pushdown_supported = all_nodes_support(AGGREGATE_PUSHDOWN_FEATURE);
+    _cql_columns_supported = all_nodes_support(CQL_COLUMNS_FEATURE);
     // FIXME: There is no back pressure. If the remote cores are slow, and
     // replication is called often, it will queue tasks to the semaphore
     // without end.
     return _replicate_task.wait().then([this] {
-        return _the_storage_service.invoke_on_all([tm = _token_metadata] (storage_service& local_ss) {
+        return _the_storage_service.invoke_on_all([tm = _token_metadata, murmur3_digest = _murmur3_digest_supported,
+                aggregate_pushdown = _aggregate_pushdown_supported, cql_columns = _cql_columns_supported] (storage_service& local_ss) {
             if (engine().cpu_id() != 0) {
                 local_ss._token_metadata = tm;
+                local_ss._murmur3_digest_supported = murmur3_digest;
+                local_ss._aggregate_pushdown_supported = aggregate_pushdown;
+                local_ss._cql_columns_supported = cql_columns;
             }
         });
     }).then_wrapped([this] (auto&& f) {
@@ -121,6 +121,29 @@ class storage_service : public gms::i_endpoint_state_change_subscriber, public s
     distributed<database>& db() {
         return _db;
     }
+
+    // Names of the features this node advertises in the SUPPORTED_FEATURES
+    // gossip state.
+    static constexpr const char* MURMUR3_DIGEST_FEATURE = "MURMUR3_DIGEST";
+    static constexpr const char* AGGREGATE_PUSHDOWN_FEATURE = "AGGREGATE_PUSHDOWN";
+    static constexpr const char* CQL_COLUMNS_FEATURE = "CQL_COLUMNS";
+
+    // True once every node of the cluster can compute murmur3 result digests.
+    bool cluster_supports_murmur3_digest() const {
+        return _murmur3_digest_supported;
+    }
+
+    // True once every node of the cluster understands the aggregates of
+    // partition_slice. Older nodes ignore them and return plain rows.
+    bool cluster_supports_aggregate_pushdown() const {
+        return _aggregate_pushdown_supported;
+    }
+
+    // True once every node of the cluster can return rows in the CQL
+    // format requested by the cql_columns of partition_slice.
+    bool cluster_supports_cql_columns() const {
+        return _cql_columns_supported;
+    }
 private:
     bool is_auto_bootstrap();
     inet_address get_broadcast_address() {
@@ -140,6 +163,9 @@ class storage_service : public gms::i_endpoint_state_change_subscriber, public s
     }
     /* This abstraction maintains the token/endpoint metadata information */
     token_metadata _token_metadata;
+    bool _murmur3_digest_supported = false;
+    bool _aggregate_pushdown_supported = false;
+    bool _cql_columns_supported = false;
 public:
     gms::versioned_value::factory value_factory;
 #if 0
@@ -723,6 +749,7 @@ class storage_service : public gms::i_endpoint_state_change_subscriber, public s
     void do_update_system_peers_table(gms::inet_address endpoint, const application_state& state, const versioned_value& value);
     sstring get_application_state_value(inet_address endpoint, application_state appstate);
     std::unordered_set<token> get_tokens_for(inet_address endpoint);
+    bool all_nodes_support(const sstring& feature);
     future<> replicate_to_all_cores();
     semaphore _replicate_task{1};
 private:
@@ -30,9 +30,9 @@ class sstable_range_wrapping_reader final : public mutation_reader::impl {
     sstables::mutation_reader _smr;
 public:
     sstable_range_wrapping_reader(lw_shared_ptr<sstables::sstable> sst,
-        schema_ptr s, const query::partition_range& pr)
+        schema_ptr s, const query::partition_range& pr, const query::partition_slice& slice = query::full_slice)
         : _sst(sst)
-        , _smr(sst->read_range_rows(std::move(s), pr)) {
+        , _smr(sst->read_range_rows(std::move(s), pr, slice)) {
     }
     virtual future<mutation_opt> operator()() override {
         return _smr.read();
@@ -54,9 +54,11 @@
 #include "database.hh"
 #include "compaction_strategy.hh"
 #include "mutation_reader.hh"
+#include "streamed_mutation.hh"
 #include "schema.hh"
 #include "cql3/statements/property_definitions.hh"
 #include "leveled_manifest.hh"
+#include "hyperloglog.hh"
 
 namespace sstables {
 
@@ -71,14 +73,14 @@ struct compaction_stats {
     std::vector<shared_sstable> new_sstables;
 };
 
-class sstable_reader final : public ::mutation_reader::impl {
+class sstable_reader final : public ::streamed_mutation_reader::impl {
     shared_sstable _sst;
-    mutation_reader _reader;
+    ::streamed_mutation_reader _reader;
 public:
     sstable_reader(shared_sstable sst, schema_ptr schema)
-            : _sst(std::move(sst)), _reader(_sst->read_rows(schema)) {}
-    virtual future<mutation_opt> operator()() override {
-        return _reader.read();
+            : _sst(std::move(sst)), _reader(_sst->read_rows_streamed(schema)) {}
+    virtual future<mutation_fragment_opt> operator()() override {
+        return _reader();
     }
 };
 
@@ -94,13 +96,168 @@ static api::timestamp_type get_max_purgeable_timestamp(schema_ptr schema,
     return timestamp;
 }
 
+// Performs the same work as mutation_partition::compact_for_compaction(), but
+// one fragment at a time, so that compacting a partition doesn't require
+// holding it in memory:
+//   - expires cells based on compaction time
+//   - drops cells covered by higher-level tombstones
+//   - drops expired tombstones which timestamp is before max_purgeable
+//   - drops partitions which end up empty
+class compacting_reader final : public ::streamed_mutation_reader::impl {
+    schema_ptr _schema;
+    ::streamed_mutation_reader _reader;
+    std::vector<shared_sstable> _not_compacted_sstables;
+    gc_clock::time_point _now;
+    gc_clock::time_point _gc_before;
+    api::timestamp_type _max_purgeable = api::min_timestamp;
+    tombstone _partition_tombstone;
+    // Partition and range tombstones of the current partition, used for
+    // finding tombstones covering a row.
+    std::experimental::optional<mutation_partition> _tombstones;
+    // partition_start is held back until the partition turns out to have
+    // something left after compaction.
+    mutation_fragment_opt _pending_start;
+    std::deque<mutation_fragment> _output;
+private:
+    bool can_purge_tombstone(const tombstone& t) const {
+        return t.timestamp < _max_purgeable && t.deletion_time < _gc_before;
+    }
+
+    void emit(mutation_fragment&& mf) {
+        if (_pending_start) {
+            _output.emplace_back(std::move(*_pending_start));
+            _pending_start = {};
+        }
+        _output.emplace_back(std::move(mf));
+    }
+
+    void consume(mutation_fragment&& mf) {
+        auto& s = *_schema;
+        switch (mf.fragment_kind()) {
+        case mutation_fragment::kind::partition_start: {
+            auto& ps = mf.as_partition_start();
+            _max_purgeable = get_max_purgeable_timestamp(_schema, _not_compacted_sstables, ps.key());
+            _partition_tombstone = ps.partition_tombstone();
+            _tombstones = mutation_partition(_schema);
+            _tombstones->apply(_partition_tombstone);
+            if (can_purge_tombstone(_partition_tombstone)) {
+                ps.set_partition_tombstone(tombstone());
+            }
+            _pending_start = std::move(mf);
+            break;
+        }
+        case mutation_fragment::kind::static_row: {
+            auto& sr = mf.as_static_row();
+            sr.cells().compact_and_expire(s, column_kind::static_column, _partition_tombstone, _now, _max_purgeable, _gc_before);
+            if (!sr.empty()) {
+                emit(std::move(mf));
+            }
+            break;
+        }
+        case mutation_fragment::kind::range_tombstone: {
+            auto& rt = mf.as_range_tombstone();
+            _tombstones->apply_row_tombstone(s, rt.prefix(), rt.tomb());
+            if (!can_purge_tombstone(rt.tomb()) && rt.tomb().timestamp > _partition_tombstone.timestamp) {
+                emit(std::move(mf));
+            }
+            break;
+        }
+        case mutation_fragment::kind::clustering_row: {
+            auto& cr = mf.as_clustering_row();
+            auto& row = cr.row();
+            tombstone tomb = _tombstones->range_tombstone_for_row(s, cr.key());
+            tomb.apply(row.deleted_at());
+            row.cells().compact_and_expire(s, column_kind::regular_column, tomb, _now, _max_purgeable, _gc_before);
+            row.marker().compact_and_expire(tomb, _now, _max_purgeable, _gc_before);
+            if (!cr.empty()) {
+                emit(std::move(mf));
+            }
+            break;
+        }
+        case mutation_fragment::kind::partition_end:
+            if (!_pending_start || _pending_start->as_partition_start().partition_tombstone()) {
+                emit(std::move(mf));
+            }
+            _pending_start = {};
+            _tombstones = {};
+            break;
+        }
+    }
+public:
+    compacting_reader(schema_ptr schema, ::streamed_mutation_reader reader, std::vector<shared_sstable> not_compacted_sstables)
+        : _schema(std::move(schema))
+        , _reader(std::move(reader))
+        , _not_compacted_sstables(std::move(not_compacted_sstables))
+        , _now(gc_clock::now())
+        , _gc_before(_now - _schema->gc_grace_seconds())
+    { }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (!_output.empty()) {
+            auto mf = std::move(_output.front());
+            _output.pop_front();
+            return make_ready_future<mutation_fragment_opt>(std::move(mf));
+        }
+        return _reader().then([this] (mutation_fragment_opt mf) {
+            if (!mf) {
+                return make_ready_future<mutation_fragment_opt>();
+            }
+            consume(std::move(*mf));
+            return operator()();
+        });
+    }
+};
+
+uint64_t estimate_partitions_after_compaction(const std::vector<shared_sstable>& sstables) {
+    uint64_t sum = 0;
+    for (auto& sst : sstables) {
+        sum += sst->get_estimated_key_count();
+    }
+    if (sstables.empty()) {
+        return sum;
+    }
+    // Merging the cardinality of the input sstables gives the number of
+    // distinct keys among them, which is much lower than the sum of their
+    // key counts if they overlap. If any of them lacks a usable cardinality,
+    // fall back to the sum. So do sstables written before the collector
+    // honoured its precision: their 16-register estimators are too coarse
+    // to size bloom filters by, even when they can be merged.
+    try {
+        std::experimental::optional<hll::HyperLogLog> merged;
+        for (auto& sst : sstables) {
+            auto& cardinality = sst->get_compaction_metadata().cardinality.elements;
+            temporary_buffer<uint8_t> bytes(cardinality.size());
+            std::copy(cardinality.begin(), cardinality.end(), bytes.get_write());
+            auto hll = hll::HyperLogLog::from_bytes(std::move(bytes));
+            if (hll.registerSize() != 1u << metadata_collector::cardinality_precision) {
+                return sum;
+            }
+            if (!merged) {
+                merged = std::move(hll);
+            } else {
+                merged->merge(hll);
+            }
+        }
+        if (!merged) {
+            return sum;
+        }
+        auto estimate = merged->estimate();
+        if (!std::isfinite(estimate)) {
+            return sum;
+        }
+        return std::max(uint64_t(1), std::min(sum, uint64_t(ceil(estimate))));
+    } catch (...) {
+        logger.debug("Unable to merge cardinality of sstables being compacted: {}", std::current_exception());
+        return sum;
+    }
+}
+
 // compact_sstables compacts the given list of sstables creating one
 // (currently) or more (in the future) new sstables. The new sstables
 // are created using the "sstable_creator" object passed by the caller.
 future<> compact_sstables(std::vector<shared_sstable> sstables,
         column_family& cf, std::function<shared_sstable()> creator, uint64_t max_sstable_size, uint32_t sstable_level) {
-    std::vector<::mutation_reader> readers;
-    uint64_t estimated_partitions = 0;
+    std::vector<::streamed_mutation_reader> readers;
     auto ancestors = make_lw_shared<std::vector<unsigned long>>();
     auto stats = make_lw_shared<compaction_stats>();
     sstring sstable_logger_msg = "[";
@@ -122,11 +279,7 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
     auto schema = cf.schema();
     for (auto sst : sstables) {
         // We also capture the sstable, so we keep it alive while the read isn't done
-        readers.emplace_back(make_mutation_reader<sstable_reader>(sst, schema));
-        // FIXME: If the sstables have cardinality estimation bitmaps, use that
-        // for a better estimate for the number of partitions in the merged
-        // sstable than just adding up the lengths of individual sstables.
-        estimated_partitions += sst->get_estimated_key_count();
+        readers.emplace_back(make_streamed_mutation_reader<sstable_reader>(sst, schema));
         stats->total_partitions += sst->get_estimated_key_count();
         // Compacted sstable keeps track of its ancestors.
         ancestors->push_back(sst->generation());
@@ -142,42 +295,25 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
         rp = std::max(rp, sst->get_stats_metadata().position);
     }
 
-    uint64_t estimated_sstables = std::max(1UL, uint64_t(ceil(double(stats->start_size) / max_sstable_size)));
+    // Partitions overwritten across the input sstables are written only once,
+    // so expect the output to shrink in the same proportion as the number of
+    // partitions. Both are used to size the filter of each new sstable.
+    uint64_t estimated_partitions = estimate_partitions_after_compaction(sstables);
+    uint64_t estimated_size = stats->start_size;
+    if (stats->total_partitions > 0) {
+        estimated_size = ceil(double(stats->start_size) * estimated_partitions / stats->total_partitions);
+    }
+    uint64_t estimated_sstables = std::max(1UL, uint64_t(ceil(double(estimated_size) / max_sstable_size)));
     uint64_t partitions_per_sstable = ceil(double(estimated_partitions) / estimated_sstables);
+    logger.debug("Estimated {} partitions in {} new sstables, from {} partitions in the input sstables",
+        estimated_partitions, estimated_sstables, stats->total_partitions);
 
     sstable_logger_msg += "]";
     stats->sstables = sstables.size();
     logger.info("Compacting {}", sstable_logger_msg);
 
-    class compacting_reader final : public ::mutation_reader::impl {
-    private:
-        schema_ptr _schema;
-        ::mutation_reader _reader;
-        std::vector<shared_sstable> _not_compacted_sstables;
-        gc_clock::time_point _now;
-    public:
-        compacting_reader(schema_ptr schema, std::vector<::mutation_reader> readers, std::vector<shared_sstable> not_compacted_sstables)
-            : _schema(std::move(schema))
-            , _reader(make_combined_reader(std::move(readers)))
-            , _not_compacted_sstables(std::move(not_compacted_sstables))
-            , _now(gc_clock::now())
-        { }
-
-        virtual future<mutation_opt> operator()() override {
-            return _reader().then([this] (mutation_opt m) {
-                if (!bool(m)) {
-                    return make_ready_future<mutation_opt>(std::move(m));
-                }
-                auto max_purgeable = get_max_purgeable_timestamp(_schema, _not_compacted_sstables, m->decorated_key());
-                m->partition().compact_for_compaction(*_schema, max_purgeable, _now);
-                if (!m->partition().empty()) {
-                    return make_ready_future<mutation_opt>(std::move(m));
-                }
-                return operator()();
-            });
-        }
-    };
-    auto reader = make_mutation_reader<compacting_reader>(schema, std::move(readers), std::move(not_compacted_sstables));
+    auto reader = make_streamed_mutation_reader<compacting_reader>(schema,
+        make_combined_reader(schema, std::move(readers)), std::move(not_compacted_sstables));
 
     auto start_time = std::chrono::high_resolution_clock::now();
 
@@ -188,17 +324,20 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
     // prefer to do less work in the writer (which is a seastar::thread),
     // and also want the extra buffer to ensure we do fewer context switches
     // to that seastar::thread.
-    // TODO: better tuning for the size of the pipe. Perhaps should take into
-    // account the size of the individual mutations?
-    seastar::pipe<mutation> output{16};
-    auto output_reader = make_lw_shared<seastar::pipe_reader<mutation>>(std::move(output.reader));
-    auto output_writer = make_lw_shared<seastar::pipe_writer<mutation>>(std::move(output.writer));
+    // The pipe carries mutation fragments rather than whole partitions, so
+    // memory used by it doesn't depend on partition size.
+    // TODO: better tuning for the size of the pipe.
+    seastar::pipe<mutation_fragment> output{128};
+    auto output_reader = make_lw_shared<seastar::pipe_reader<mutation_fragment>>(std::move(output.reader));
+    auto output_writer = make_lw_shared<seastar::pipe_writer<mutation_fragment>>(std::move(output.writer));
 
     auto done = make_lw_shared<bool>(false);
     future<> read_done = do_until([done] { return *done; }, [done, output_writer, reader = std::move(reader), stats] () mutable {
         return reader().then([done, output_writer, stats] (auto mopt) {
             if (mopt) {
-                stats->total_keys_written++;
+                if (mopt->is_partition_start()) {
+                    stats->total_keys_written++;
+                }
                 return output_writer->write(std::move(*mopt));
             } else {
                 *done = true;
@@ -207,13 +346,11 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
         });
     }).then([output_writer, done] {});
 
-    struct queue_reader final : public ::mutation_reader::impl {
-        lw_shared_ptr<seastar::pipe_reader<mutation>> pr;
-        queue_reader(lw_shared_ptr<seastar::pipe_reader<mutation>> pr) : pr(std::move(pr)) {}
-        virtual future<mutation_opt> operator()() override {
-            return pr->read().then([] (std::experimental::optional<mutation> m) mutable {
-                return make_ready_future<mutation_opt>(std::move(m));
-            });
+    struct queue_reader final : public ::streamed_mutation_reader::impl {
+        lw_shared_ptr<seastar::pipe_reader<mutation_fragment>> pr;
+        queue_reader(lw_shared_ptr<seastar::pipe_reader<mutation_fragment>> pr) : pr(std::move(pr)) {}
+        virtual future<mutation_fragment_opt> operator()() override {
+            return pr->read();
         }
     };
 
@@ -222,11 +359,11 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
     future<> write_done = repeat([creator, ancestors, rp, max_sstable_size, sstable_level, output_reader, stats, partitions_per_sstable, schema] {
         return output_reader->read().then(
                 [creator, ancestors, rp, max_sstable_size, sstable_level, output_reader, stats, partitions_per_sstable, schema] (auto mut) {
-            // Check if mutation is available from the pipe for a new sstable to be written. If not, just stop writing.
+            // Check if a fragment is available from the pipe for a new sstable to be written. If not, just stop writing.
             if (!mut) {
                 return make_ready_future<stop_iteration>(stop_iteration::yes);
             }
-            // If a mutation is available, we must unread it for write_components to read it afterwards.
+            // If a fragment is available, we must unread it for write_components to read it afterwards.
             output_reader->unread(std::move(*mut));
 
             auto newtab = creator();
@@ -236,7 +373,7 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
                 newtab->add_ancestor(ancestor);
             }
 
-            ::mutation_reader mutation_queue_reader = make_mutation_reader<queue_reader>(output_reader);
+            ::streamed_mutation_reader mutation_queue_reader = make_streamed_mutation_reader<queue_reader>(output_reader);
 
             return newtab->write_components(std::move(mutation_queue_reader), partitions_per_sstable, schema, max_sstable_size).then([newtab, stats] {
                 return newtab->open_data().then([newtab, stats] {
@@ -293,11 +430,128 @@ future<> compact_sstables(std::vector<shared_sstable> sstables,
     });
 }
 
+class tombstone_compaction_options {
+    static constexpr double DEFAULT_TOMBSTONE_THRESHOLD = 0.2;
+    static constexpr int64_t DEFAULT_TOMBSTONE_COMPACTION_INTERVAL = 86400;
+    const sstring TOMBSTONE_THRESHOLD_KEY = "tombstone_threshold";
+    const sstring TOMBSTONE_COMPACTION_INTERVAL_KEY = "tombstone_compaction_interval";
+    const sstring UNCHECKED_TOMBSTONE_COMPACTION_KEY = "unchecked_tombstone_compaction";
+
+    // An sstable is compacted on its own once the estimated ratio of its
+    // droppable tombstones goes beyond this threshold.
+    double tombstone_threshold = DEFAULT_TOMBSTONE_THRESHOLD;
+    // Minimum age of an sstable before it's compacted on its own, so the
+    // same sstable isn't rewritten over and over.
+    std::chrono::seconds tombstone_compaction_interval = std::chrono::seconds(DEFAULT_TOMBSTONE_COMPACTION_INTERVAL);
+    // Don't check whether other sstables would keep the tombstones from
+    // being purged.
+    bool unchecked_tombstone_compaction = false;
+
+    static std::experimental::optional<sstring> get_value(const std::map<sstring, sstring>& options, const sstring& name) {
+        auto it = options.find(name);
+        if (it == options.end()) {
+            return std::experimental::nullopt;
+        }
+        return it->second;
+    }
+public:
+    tombstone_compaction_options(const std::map<sstring, sstring>& options) {
+        using namespace cql3::statements;
+
+        auto tmp_value = get_value(options, TOMBSTONE_THRESHOLD_KEY);
+        tombstone_threshold = property_definitions::to_double(TOMBSTONE_THRESHOLD_KEY, tmp_value, DEFAULT_TOMBSTONE_THRESHOLD);
+        if (tombstone_threshold < 0) {
+            throw exceptions::configuration_exception(sprint("%s must be greater than 0, but was %f", TOMBSTONE_THRESHOLD_KEY, tombstone_threshold));
+        }
+
+        tmp_value = get_value(options, TOMBSTONE_COMPACTION_INTERVAL_KEY);
+        auto interval = property_definitions::to_long(TOMBSTONE_COMPACTION_INTERVAL_KEY, tmp_value, DEFAULT_TOMBSTONE_COMPACTION_INTERVAL);
+        if (interval < 0) {
+            throw exceptions::configuration_exception(sprint("%s must be greater than 0, but was %d", TOMBSTONE_COMPACTION_INTERVAL_KEY, interval));
+        }
+        tombstone_compaction_interval = std::chrono::seconds(interval);
+
+        tmp_value = get_value(options, UNCHECKED_TOMBSTONE_COMPACTION_KEY);
+        if (tmp_value) {
+            if (*tmp_value != "true" && *tmp_value != "false") {
+                throw exceptions::configuration_exception(sprint("%s should either be 'true' or 'false', not %s", UNCHECKED_TOMBSTONE_COMPACTION_KEY, *tmp_value));
+            }
+            unchecked_tombstone_compaction = *tmp_value == "true";
+        }
+    }
+
+    tombstone_compaction_options() = default;
+
+    friend shared_sstable get_tombstone_compaction_candidate(column_family& cf, const tombstone_compaction_options& options);
+};
+
+// Returns true if some other sstable, overlapping the given one, may hold
+// data older than its tombstones. Such tombstones can't be purged.
+static bool overlaps_older_data(const schema& s, const shared_sstable& sst, const sstable_list& sstables) {
+    auto first = sst->get_first_decorated_key(s);
+    auto last = sst->get_last_decorated_key(s);
+    auto max_timestamp = sst->get_stats_metadata().max_timestamp;
+    for (auto& entry : sstables) {
+        auto& other = entry.second;
+        if (other == sst || other->get_stats_metadata().min_timestamp > max_timestamp) {
+            continue;
+        }
+        if (first.tri_compare(s, other->get_last_decorated_key(s)) <= 0
+                && last.tri_compare(s, other->get_first_decorated_key(s)) >= 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Returns the sstable with the highest ratio of droppable tombstones, among
+// the ones which aren't being compacted and whose ratio is beyond the
+// threshold, or nullptr if there is none.
+shared_sstable get_tombstone_compaction_candidate(column_family& cf, const tombstone_compaction_options& options) {
+    auto now = gc_clock::now();
+    auto gc_before = now - cf.schema()->gc_grace_seconds();
+    auto all_sstables = cf.get_sstables();
+
+    shared_sstable candidate;
+    double candidate_ratio = options.tombstone_threshold;
+    for (auto& entry : *cf.get_sstables_for_compaction()) {
+        auto& sst = entry.second;
+        // max_data_age() is the time the sstable was written or loaded.
+        if (sst->max_data_age() + options.tombstone_compaction_interval > now) {
+            continue;
+        }
+        auto ratio = sst->estimate_droppable_tombstone_ratio(gc_before);
+        if (ratio <= candidate_ratio) {
+            continue;
+        }
+        if (!options.unchecked_tombstone_compaction && overlaps_older_data(*cf.schema(), sst, *all_sstables)) {
+            continue;
+        }
+        candidate = sst;
+        candidate_ratio = ratio;
+    }
+    if (candidate) {
+        logger.debug("Droppable tombstone ratio of {} is {}", candidate->get_filename(), candidate_ratio);
+    }
+    return candidate;
+}
+
+shared_sstable get_tombstone_compaction_candidate(column_family& cf, const std::map<sstring, sstring>& options) {
+    return get_tombstone_compaction_candidate(cf, tombstone_compaction_options(options));
+}
+
 class compaction_strategy_impl {
+protected:
+    tombstone_compaction_options _tombstone_options;
+
+    compaction_strategy_impl() = default;
+    explicit compaction_strategy_impl(const std::map<sstring, sstring>& options)
+        : _tombstone_options(options) {}
 public:
     virtual ~compaction_strategy_impl() {}
     virtual future<> compact(column_family& cfs) = 0;
     virtual compaction_strategy_type type() const = 0;
+    virtual void notify_sstables_changed(const std::vector<shared_sstable>& added, const std::vector<shared_sstable>& removed) {}
 };
 
 //
@@ -454,11 +708,13 @@ class size_tiered_compaction_strategy : public compaction_strategy_impl {
 public:
     size_tiered_compaction_strategy() = default;
     size_tiered_compaction_strategy(const std::map<sstring, sstring>& options) :
+        compaction_strategy_impl(options),
         _options(options) {}
 
     virtual future<> compact(column_family& cfs) override;
 
     friend std::vector<sstables::shared_sstable> size_tiered_most_interesting_bucket(lw_shared_ptr<sstable_list>);
+    friend class time_window_compaction_strategy;
 
     virtual compaction_strategy_type type() const {
         return compaction_strategy_type::size_tiered;
@@ -578,7 +834,7 @@ future<> size_tiered_compaction_strategy::compact(column_family& cfs) {
     int min_threshold = cfs.schema()->min_compaction_threshold();
     int max_threshold = cfs.schema()->max_compaction_threshold();
 
-    auto candidates = cfs.get_sstables();
+    auto candidates = cfs.get_sstables_for_compaction();
 
     // TODO: Add support to filter cold sstables (for reference: SizeTieredCompactionStrategy::filterColdSSTables).
 
@@ -589,8 +845,14 @@ future<> size_tiered_compaction_strategy::compact(column_family& cfs) {
     printf("size-tiered: Compacting %ld out of %ld sstables\n", most_interesting.size(), candidates->size());
 #endif
     if (most_interesting.empty()) {
-        // nothing to do
-        return make_ready_future<>();
+        // If there is nothing to compact, try to purge tombstones of a single sstable.
+        auto sst = get_tombstone_compaction_candidate(cfs, _tombstone_options);
+        if (!sst) {
+            // nothing to do
+            return make_ready_future<>();
+        }
+        logger.debug("size-tiered: Compacting {} to drop tombstones", sst->get_filename());
+        most_interesting.push_back(std::move(sst));
     }
 
     return cfs.compact_sstables(sstables::compaction_descriptor(std::move(most_interesting)));
@@ -608,27 +870,58 @@ std::vector<sstables::shared_sstable> size_tiered_most_interesting_bucket(lw_sha
 }
 
 class leveled_compaction_strategy : public compaction_strategy_impl {
-    // FIXME: User may choose to change this value; add support.
-    static constexpr uint32_t max_sstable_size_in_mb = 160;
+    static constexpr int32_t DEFAULT_MAX_SSTABLE_SIZE_IN_MB = 160;
+    const sstring SSTABLE_SIZE_OPTION = "sstable_size_in_mb";
+
+    int32_t _max_sstable_size_in_mb = DEFAULT_MAX_SSTABLE_SIZE_IN_MB;
+    // Built from the sstables of the column family on the first compaction,
+    // and from then on kept up to date through notify_sstables_changed().
+    std::experimental::optional<leveled_manifest> _manifest;
 public:
+    leveled_compaction_strategy(const std::map<sstring, sstring>& options)
+        : compaction_strategy_impl(options) {
+        using namespace cql3::statements;
+
+        auto it = options.find(SSTABLE_SIZE_OPTION);
+        if (it != options.end()) {
+            _max_sstable_size_in_mb = property_definitions::to_int(SSTABLE_SIZE_OPTION, it->second, DEFAULT_MAX_SSTABLE_SIZE_IN_MB);
+            if (_max_sstable_size_in_mb <= 0) {
+                throw exceptions::configuration_exception(sprint("%s must be larger than 0, but was %d", SSTABLE_SIZE_OPTION, _max_sstable_size_in_mb));
+            }
+        }
+    }
+
     virtual future<> compact(column_family& cfs) override;
 
+    virtual void notify_sstables_changed(const std::vector<shared_sstable>& added, const std::vector<shared_sstable>& removed) override {
+        if (_manifest) {
+            _manifest->replace(removed, added);
+        }
+    }
+
     virtual compaction_strategy_type type() const {
         return compaction_strategy_type::leveled;
     }
 };
 
 future<> leveled_compaction_strategy::compact(column_family& cfs) {
-    // NOTE: leveled_manifest creation may be slightly expensive, so later on,
-    // we may want to store it in the strategy itself. However, the sstable
-    // lists managed by the manifest may become outdated. For example, one
-    // sstable in it may be marked for deletion after compacted.
-    // Currently, we create a new manifest whenever it's time for compaction.
-    leveled_manifest manifest = leveled_manifest::create(cfs, max_sstable_size_in_mb);
-    auto candidate = manifest.get_compaction_candidates();
+    if (!_manifest) {
+        _manifest.emplace(leveled_manifest::create(cfs, _max_sstable_size_in_mb));
+    }
+    // sstables being compacted are left out, so leveled compactions of
+    // disjoint sets of sstables may run concurrently.
+    auto candidate = _manifest->get_compaction_candidates(cfs.compacting_sstables());
 
     if (candidate.sstables.empty()) {
-        return make_ready_future<>();
+        // If no level needs compaction, try to purge tombstones of a single
+        // sstable, keeping it in its level.
+        auto sst = get_tombstone_compaction_candidate(cfs, _tombstone_options);
+        if (!sst) {
+            return make_ready_future<>();
+        }
+        logger.debug("leveled: Compacting {} to drop tombstones", sst->get_filename());
+        auto level = sst->get_sstable_level();
+        candidate = sstables::compaction_descriptor({ std::move(sst) }, level, uint64_t(_max_sstable_size_in_mb) * 1024 * 1024);
     }
 
     logger.debug("leveled: Compacting {} out of {} sstables", candidate.sstables.size(), cfs.get_sstables()->size());
@@ -636,6 +929,216 @@ future<> leveled_compaction_strategy::compact(column_family& cfs) {
     return cfs.compact_sstables(std::move(candidate));
 }
 
+std::vector<sstables::shared_sstable>
+get_fully_expired_sstables(column_family& cf, gc_clock::time_point gc_before) {
+    std::vector<sstables::shared_sstable> candidates;
+    // Data in memtables may be shadowed by tombstones of the candidates too.
+    auto min_timestamp = cf.min_memtable_timestamp();
+
+    auto not_compacting = cf.get_sstables_for_compaction();
+    for (auto& entry : *cf.get_sstables()) {
+        auto& sst = entry.second;
+        auto& stats = sst->get_stats_metadata();
+        auto max_deletion_time = gc_clock::time_point(gc_clock::duration(stats.max_local_deletion_time));
+        // Older sstables written by Scylla have max_local_deletion_time of
+        // partition tombstones only, so it says nothing about their cells.
+        if (sst->has_full_max_local_deletion_time() && max_deletion_time < gc_before && not_compacting->count(entry.first)) {
+            candidates.push_back(sst);
+        } else {
+            min_timestamp = std::min(min_timestamp, stats.min_timestamp);
+        }
+    }
+
+    // Tombstones of a candidate may shadow data in the remaining sstables
+    // only if they are newer than some of that data.
+    std::vector<sstables::shared_sstable> expired;
+    for (auto& sst : candidates) {
+        if (sst->get_stats_metadata().max_timestamp < min_timestamp) {
+            expired.push_back(sst);
+        }
+    }
+    return expired;
+}
+
+class time_window_compaction_strategy_options {
+    static constexpr int64_t DEFAULT_COMPACTION_WINDOW_SIZE = 1;
+    const sstring COMPACTION_WINDOW_UNIT_KEY = "compaction_window_unit";
+    const sstring COMPACTION_WINDOW_SIZE_KEY = "compaction_window_size";
+    const sstring TIMESTAMP_RESOLUTION_KEY = "timestamp_resolution";
+
+    std::chrono::seconds window_size = std::chrono::hours(24);
+    // Timestamps are in microseconds unless configured otherwise.
+    int64_t timestamp_units_per_second = 1000000;
+
+    static std::experimental::optional<sstring> get_value(const std::map<sstring, sstring>& options, const sstring& name) {
+        auto it = options.find(name);
+        if (it == options.end()) {
+            return std::experimental::nullopt;
+        }
+        return it->second;
+    }
+
+    static std::chrono::seconds window_unit(const sstring& name) {
+        static const std::map<sstring, std::chrono::seconds> units = {
+            { "MINUTES", std::chrono::minutes(1) },
+            { "HOURS", std::chrono::hours(1) },
+            { "DAYS", std::chrono::hours(24) },
+        };
+        auto it = units.find(name);
+        if (it == units.end()) {
+            throw exceptions::configuration_exception(sprint("%s is not valid for compaction_window_unit", name));
+        }
+        return it->second;
+    }
+
+    static int64_t units_per_second(const sstring& name) {
+        static const std::map<sstring, int64_t> resolutions = {
+            { "SECONDS", 1 },
+            { "MILLISECONDS", 1000 },
+            { "MICROSECONDS", 1000000 },
+            { "NANOSECONDS", 1000000000 },
+        };
+        auto it = resolutions.find(name);
+        if (it == resolutions.end()) {
+            throw exceptions::configuration_exception(sprint("%s is not valid for timestamp_resolution", name));
+        }
+        return it->second;
+    }
+public:
+    time_window_compaction_strategy_options(const std::map<sstring, sstring>& options) {
+        using namespace cql3::statements;
+
+        auto unit = window_unit(get_value(options, COMPACTION_WINDOW_UNIT_KEY).value_or("DAYS"));
+
+        auto tmp_value = get_value(options, COMPACTION_WINDOW_SIZE_KEY);
+        auto size = property_definitions::to_long(COMPACTION_WINDOW_SIZE_KEY, tmp_value, DEFAULT_COMPACTION_WINDOW_SIZE);
+        if (size <= 0) {
+            throw exceptions::configuration_exception(sprint("%s must be greater than 0, but was %d", COMPACTION_WINDOW_SIZE_KEY, size));
+        }
+        window_size = unit * size;
+
+        timestamp_units_per_second = units_per_second(get_value(options, TIMESTAMP_RESOLUTION_KEY).value_or("MICROSECONDS"));
+    }
+
+    time_window_compaction_strategy_options() = default;
+
+    friend class time_window_compaction_strategy;
+};
+
+//
+// Time-window compaction strategy is meant for time series, whose sstables
+// hold data written at about the same time. It groups sstables into windows
+// of fixed size by the maximum timestamp of their data and never compacts
+// sstables of different windows together, so data which was compacted once
+// its window got old isn't rewritten anymore. The newest window, which keeps
+// receiving flushed sstables, is compacted with the size-tiered strategy;
+// older windows are compacted into a single sstable each.
+//
+// Sstables whose data has all expired are dropped without being read.
+//
+class time_window_compaction_strategy : public compaction_strategy_impl {
+    time_window_compaction_strategy_options _options;
+    size_tiered_compaction_strategy _stcs;
+
+    // Returns the lower bound, in seconds, of the window the timestamp falls into.
+    int64_t get_window_lower_bound(api::timestamp_type ts) const {
+        auto window = _options.window_size.count();
+        auto seconds = ts / _options.timestamp_units_per_second;
+        return seconds - (seconds % window);
+    }
+public:
+    time_window_compaction_strategy() = default;
+    time_window_compaction_strategy(const std::map<sstring, sstring>& options)
+        : compaction_strategy_impl(options)
+        , _options(options)
+        , _stcs(options) {}
+
+    // Group sstables into windows, keyed by their lower bound.
+    std::map<int64_t, std::vector<sstables::shared_sstable>> get_buckets(const sstable_list& sstables) const {
+        std::map<int64_t, std::vector<sstables::shared_sstable>> buckets;
+        for (auto& entry : sstables) {
+            auto& sst = entry.second;
+            buckets[get_window_lower_bound(sst->get_stats_metadata().max_timestamp)].push_back(sst);
+        }
+        return buckets;
+    }
+
+    std::vector<sstables::shared_sstable>
+    newest_bucket(std::map<int64_t, std::vector<sstables::shared_sstable>> buckets, unsigned min_threshold, unsigned max_threshold);
+
+    virtual future<> compact(column_family& cfs) override;
+
+    virtual compaction_strategy_type type() const {
+        return compaction_strategy_type::time_window;
+    }
+};
+
+std::vector<sstables::shared_sstable>
+time_window_compaction_strategy::newest_bucket(std::map<int64_t, std::vector<sstables::shared_sstable>> buckets,
+        unsigned min_threshold, unsigned max_threshold) {
+    for (auto it = buckets.rbegin(); it != buckets.rend(); ++it) {
+        auto& bucket = it->second;
+        if (it == buckets.rbegin()) {
+            // The current window is still being written to, so we only
+            // compact sstables of similar size in it, like size-tiered does.
+            sstable_list list;
+            for (auto& sst : bucket) {
+                list.emplace(sst->generation(), sst);
+            }
+            auto most_interesting = _stcs.most_interesting_bucket(_stcs.get_buckets(list, max_threshold),
+                min_threshold, max_threshold);
+            if (!most_interesting.empty()) {
+                return most_interesting;
+            }
+        } else if (bucket.size() >= 2) {
+            // Older windows are compacted into one sstable, smallest sstables first.
+            std::sort(bucket.begin(), bucket.end(), [] (auto& i, auto& j) {
+                return i->data_size() < j->data_size();
+            });
+            if (bucket.size() > max_threshold) {
+                bucket.resize(max_threshold);
+            }
+            return std::move(bucket);
+        }
+    }
+    return {};
+}
+
+future<> time_window_compaction_strategy::compact(column_family& cfs) {
+    auto gc_before = gc_clock::now() - cfs.schema()->gc_grace_seconds();
+    auto expired = get_fully_expired_sstables(cfs, gc_before);
+    if (!expired.empty()) {
+        logger.debug("time-window: Dropping {} fully expired sstables", expired.size());
+        return cfs.drop_sstables(std::move(expired));
+    }
+
+    int min_threshold = cfs.schema()->min_compaction_threshold();
+    int max_threshold = cfs.schema()->max_compaction_threshold();
+
+    auto candidates = cfs.get_sstables_for_compaction();
+    auto most_interesting = newest_bucket(get_buckets(*candidates), min_threshold, max_threshold);
+    if (most_interesting.empty()) {
+        // If no window needs compaction, try to purge tombstones of a single sstable.
+        auto sst = get_tombstone_compaction_candidate(cfs, _tombstone_options);
+        if (!sst) {
+            return make_ready_future<>();
+        }
+        logger.debug("time-window: Compacting {} to drop tombstones", sst->get_filename());
+        most_interesting.push_back(std::move(sst));
+    }
+
+    logger.debug("time-window: Compacting {} out of {} sstables", most_interesting.size(), candidates->size());
+
+    return cfs.compact_sstables(sstables::compaction_descriptor(std::move(most_interesting)));
+}
+
+std::vector<sstables::shared_sstable> time_window_most_interesting_bucket(lw_shared_ptr<sstable_list> candidates,
+        const std::map<sstring, sstring>& options) {
+    time_window_compaction_strategy cs(options);
+
+    return cs.newest_bucket(cs.get_buckets(*candidates), DEFAULT_MIN_COMPACTION_THRESHOLD, DEFAULT_MAX_COMPACTION_THRESHOLD);
+}
+
 compaction_strategy::compaction_strategy(::shared_ptr<compaction_strategy_impl> impl)
     : _compaction_strategy_impl(std::move(impl)) {}
 compaction_strategy::compaction_strategy() = default;
@@ -650,6 +1153,12 @@ compaction_strategy_type compaction_strategy::type() const {
 future<> compaction_strategy::compact(column_family& cfs) {
     return _compaction_strategy_impl->compact(cfs);
 }
+void compaction_strategy::notify_sstables_changed(const std::vector<shared_sstable>& added, const std::vector<shared_sstable>& removed) {
+    // No strategy is set before compaction of the column family is started.
+    if (_compaction_strategy_impl) {
+        _compaction_strategy_impl->notify_sstables_changed(added, removed);
+    }
+}
 
 compaction_strategy make_compaction_strategy(compaction_strategy_type strategy, const std::map<sstring, sstring>& options) {
     ::shared_ptr<compaction_strategy_impl> impl;
@@ -665,7 +1174,10 @@ compaction_strategy make_compaction_strategy(compaction_strategy_type strategy,
         impl = make_shared<size_tiered_compaction_strategy>(size_tiered_compaction_strategy(options));
         break;
     case compaction_strategy_type::leveled:
-        impl = make_shared<leveled_compaction_strategy>(leveled_compaction_strategy());
+        impl = make_shared<leveled_compaction_strategy>(leveled_compaction_strategy(options));
+        break;
+    case compaction_strategy_type::time_window:
+        impl = make_shared<time_window_compaction_strategy>(time_window_compaction_strategy(options));
         break;
     default:
         throw std::runtime_error("strategy not supported");
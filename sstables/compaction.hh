@@ -23,7 +23,9 @@
 #pragma once
 
 #include "sstables.hh"
+#include "utils/UUID.hh"
 #include <functional>
+#include <chrono>
 
 namespace sstables {
 
@@ -46,6 +48,24 @@ namespace sstables {
             : sstables(std::move(sstables)) {}
     };
 
+    // Progress of a running compaction.
+    struct compaction_info {
+        utils::UUID id = utils::make_random_uuid();
+        sstring ks;
+        sstring cf;
+        // Size of the data of the sstables being compacted.
+        uint64_t total_bytes = 0;
+        // Bytes written to the new sstables so far.
+        uint64_t written_bytes = 0;
+        std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+
+        // Write throughput so far, in MB/s.
+        double throughput() const {
+            auto elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+            return elapsed > 0 ? (double(written_bytes) / (1024*1024)) / elapsed : 0;
+        }
+    };
+
     // Compact a list of N sstables into M sstables.
     // creator is used to get a sstable object for a new sstable that will be written.
     // max_sstable_size is a relaxed limit size for a sstable to be generated.
@@ -56,8 +76,31 @@ namespace sstables {
             column_family& cf, std::function<shared_sstable()> creator,
             uint64_t max_sstable_size, uint32_t sstable_level);
 
+    // Estimate the number of partitions left after compacting the given
+    // sstables together, using the cardinality stored in their metadata.
+    uint64_t estimate_partitions_after_compaction(const std::vector<shared_sstable>& sstables);
+
     // Return the most interesting bucket applying the size-tiered strategy.
     // NOTE: currently used for purposes of testing. May also be used by leveled compaction strategy.
     std::vector<sstables::shared_sstable>
     size_tiered_most_interesting_bucket(lw_shared_ptr<sstable_list> candidates);
+
+    // Return the sstables the time-window strategy would compact next.
+    // NOTE: currently used for purposes of testing.
+    std::vector<sstables::shared_sstable>
+    time_window_most_interesting_bucket(lw_shared_ptr<sstable_list> candidates, const std::map<sstring, sstring>& options);
+
+    // Return the sstables of a column family which aren't being compacted
+    // and hold only expired data and tombstones older than gc_before, and
+    // which can't shadow data in any other sstable or in memtables, so they
+    // can be dropped without being compacted.
+    std::vector<sstables::shared_sstable>
+    get_fully_expired_sstables(column_family& cf, gc_clock::time_point gc_before);
+
+    // Return the sstable of a column family which holds the most droppable
+    // tombstones, if that is enough for it to be compacted on its own with
+    // the given strategy options, or nullptr otherwise.
+    // NOTE: currently used for purposes of testing.
+    sstables::shared_sstable
+    get_tombstone_compaction_candidate(column_family& cf, const std::map<sstring, sstring>& options);
 }
@@ -258,33 +258,30 @@ struct estimated_histogram {
         return 0;
     }
 
+#endif
+
     /**
      * @param percentile
-     * @return estimated value at given percentile
+     * @return estimated value at given percentile, INT64_MAX if it falls
+     * among the values larger than the last offset.
      */
-    public long percentile(double percentile)
-    {
-        assert percentile >= 0 && percentile <= 1.0;
-        int lastBucket = buckets.length() - 1;
-        if (buckets.get(lastBucket) > 0)
-            throw new IllegalStateException("Unable to compute when histogram overflowed");
-
-        long pcount = (long) Math.floor(count() * percentile);
-        if (pcount == 0)
+    int64_t percentile(double percentile) const {
+        assert(percentile >= 0 && percentile <= 1.0);
+        auto last_bucket = buckets.size() - 1;
+        int64_t pcount = std::floor(count() * percentile);
+        if (pcount == 0) {
             return 0;
-
-        long elements = 0;
-        for (int i = 0; i < lastBucket; i++)
-        {
-            elements += buckets.get(i);
-            if (elements >= pcount)
-                return bucketOffsets[i];
         }
-        return 0;
+        int64_t elements = 0;
+        for (size_t i = 0; i < last_bucket; i++) {
+            elements += buckets[i];
+            if (elements >= pcount) {
+                return bucket_offsets[i];
+            }
+        }
+        return INT64_MAX;
     }
 
-#endif
-
     /**
      * @return the mean histogram value (average of bucket offsets, weighted by count)
      */
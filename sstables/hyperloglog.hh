@@ -97,6 +97,23 @@ static inline size_t write_unsigned_var_int(unsigned int value, uint8_t* to) {
     return size;
 }
 
+static inline unsigned int read_unsigned_var_int(const uint8_t*& from, const uint8_t* end) {
+    unsigned int value = 0;
+    unsigned int shift = 0;
+    while (from != end) {
+        uint8_t b = *from++;
+        value |= unsigned(b & 0x7F) << shift;
+        if (!(b & 0x80)) {
+            return value;
+        }
+        shift += 7;
+        if (shift >= 32) {
+            break;
+        }
+    }
+    throw std::invalid_argument("malformed unsigned var int");
+}
+
 /** @class HyperLogLog
  *  @brief Implement of 'HyperLogLog' estimate cardinality algorithm
  */
@@ -136,11 +153,38 @@ class HyperLogLog {
         alphaMM_ = alpha * m_ * m_;
     }
 
-    static HyperLogLog from_bytes(temporary_buffer<uint8_t> bytes) {
-        // FIXME: implement class that creates a HyperLogLog from an array of bytes.
-        // This will useful if we need to work with the cardinality data from the
-        // compaction metadata.
-        abort();
+    /**
+     * Restores an estimator from the output of get_bytes(), e.g. the
+     * cardinality stored in the compaction metadata of a sstable.
+     *
+     * @exception std::invalid_argument the bytes are malformed or use a
+     *            format which isn't supported.
+     */
+    static HyperLogLog from_bytes(temporary_buffer<uint8_t> bytes) throw (std::invalid_argument) {
+        static constexpr int version = 2;
+
+        const uint8_t* p = bytes.get();
+        const uint8_t* end = p + bytes.size();
+        if (size_t(end - p) < sizeof(int) || int(ntohl(*unaligned_cast<const int*>(p))) != -version) {
+            throw std::invalid_argument("unsupported cardinality format version");
+        }
+        p += sizeof(int);
+
+        auto b = read_unsigned_var_int(p, end);
+        read_unsigned_var_int(p, end); // sp; sparse set isn't supported.
+        if (read_unsigned_var_int(p, end) != 0) {
+            throw std::invalid_argument("only NORMAL cardinality format is supported");
+        }
+        auto size = read_unsigned_var_int(p, end);
+        if (b < 4 || b > 16) {
+            throw std::invalid_argument("bit width must be in the range [4,16]");
+        }
+        HyperLogLog hll(b);
+        if (size != hll.m_ || size_t(end - p) < size) {
+            throw std::invalid_argument("cardinality register size doesn't match its bit width");
+        }
+        std::copy(p, p + size, hll.M_.begin());
+        return hll;
     }
 
     /**
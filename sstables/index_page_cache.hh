@@ -0,0 +1,122 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <vector>
+#include <boost/intrusive/set.hpp>
+
+#include "types.hh"
+#include "utils/lru.hh"
+#include "utils/managed_bytes.hh"
+#include "utils/managed_vector.hh"
+
+namespace sstables {
+
+// An Index.db entry, kept in LSA memory.
+class cached_index_entry {
+    managed_bytes _key;
+    uint64_t _position;
+    managed_bytes _promoted_index;
+public:
+    explicit cached_index_entry(const index_entry& e)
+        : _key(e.get_key_bytes())
+        , _position(e.position())
+        , _promoted_index(e.get_promoted_index_bytes())
+    { }
+
+    index_entry to_index_entry() const {
+        auto copy = [] (bytes_view v) {
+            temporary_buffer<char> buf(v.size());
+            std::copy(v.begin(), v.end(), buf.get_write());
+            return buf;
+        };
+        return index_entry(copy(_key), _position, copy(_promoted_index));
+    }
+};
+
+// Parsed entries of the Index.db page which starts at given summary entry.
+//
+// Pages are allocated using cache_tracker's allocator and are linked into its
+// LRU, so they are evicted together with row_cache partitions. Each sstable
+// holds the pages of its own index in a container_type.
+class cached_index_page final : public lru_entry {
+    using page_link_type = boost::intrusive::set_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+
+    page_link_type _page_link;
+    uint64_t _summary_idx;
+    managed_vector<cached_index_entry> _entries;
+public:
+    cached_index_page(uint64_t summary_idx, const std::vector<index_entry>& entries)
+        : lru_entry(kind::index_page)
+        , _summary_idx(summary_idx)
+    {
+        _entries.reserve(entries.size());
+        for (auto&& e : entries) {
+            _entries.emplace_back(e);
+        }
+    }
+
+    cached_index_page(cached_index_page&& o) noexcept;
+
+    uint64_t summary_idx() const {
+        return _summary_idx;
+    }
+
+    std::vector<index_entry> to_index_list() const {
+        std::vector<index_entry> il;
+        il.reserve(_entries.size());
+        for (auto&& e : _entries) {
+            il.push_back(e.to_index_entry());
+        }
+        return il;
+    }
+
+    struct compare {
+        bool operator()(const cached_index_page& a, const cached_index_page& b) const {
+            return a._summary_idx < b._summary_idx;
+        }
+        bool operator()(uint64_t a, const cached_index_page& b) const {
+            return a < b._summary_idx;
+        }
+        bool operator()(const cached_index_page& a, uint64_t b) const {
+            return a._summary_idx < b;
+        }
+    };
+
+    using container_type = boost::intrusive::set<cached_index_page,
+        boost::intrusive::member_hook<cached_index_page, page_link_type, &cached_index_page::_page_link>,
+        boost::intrusive::constant_time_size<false>, // we need this to have bi::auto_unlink on hooks
+        boost::intrusive::compare<compare>>;
+};
+
+inline
+cached_index_page::cached_index_page(cached_index_page&& o) noexcept
+    : lru_entry(std::move(o))
+    , _page_link()
+    , _summary_idx(o._summary_idx)
+    , _entries(std::move(o._entries))
+{
+    container_type::node_algorithms::replace_node(o._page_link.this_ptr(), _page_link.this_ptr());
+    container_type::node_algorithms::init(o._page_link.this_ptr());
+}
+
+}
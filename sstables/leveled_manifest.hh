@@ -45,6 +45,8 @@
 #include "compaction.hh"
 #include "range.hh"
 #include "log.hh"
+#include <unordered_set>
+#include <experimental/optional>
 
 class leveled_manifest {
     logging::logger logger;
@@ -157,36 +159,16 @@ class leveled_manifest {
         }
     }
 
-#if 0
-    public synchronized void replace(Collection<SSTableReader> removed, Collection<SSTableReader> added)
-    {
-        assert !removed.isEmpty(); // use add() instead of promote when adding new sstables
-        logDistribution();
-        if (logger.isDebugEnabled())
-            logger.debug("Replacing [{}]", toString(removed));
-
-        // the level for the added sstables is the max of the removed ones,
-        // plus one if the removed were all on the same level
-        int minLevel = Integer.MAX_VALUE;
-
-        for (SSTableReader sstable : removed)
-        {
-            int thisLevel = remove(sstable);
-            minLevel = Math.min(minLevel, thisLevel);
+    // Keeps the manifest in sync with the column family when sstables are
+    // added to it (e.g. flushed or loaded) or replaced by a compaction.
+    void replace(const std::vector<sstables::shared_sstable>& removed, const std::vector<sstables::shared_sstable>& added) {
+        for (auto sstable : removed) {
+            remove(sstable);
+        }
+        for (auto sstable : added) {
+            add(sstable);
         }
-
-        // it's valid to do a remove w/o an add (e.g. on truncate)
-        if (added.isEmpty())
-            return;
-
-        if (logger.isDebugEnabled())
-            logger.debug("Adding [{}]", toString(added));
-
-        for (SSTableReader ssTableReader : added)
-            add(ssTableReader);
-        lastCompactedKeys[minLevel] = SSTableReader.sstableOrdering.max(added).last;
     }
-#endif
 
     void repair_overlapping_sstables(int level) {
         const sstables::sstable *previous = nullptr;
@@ -233,23 +215,15 @@ class leveled_manifest {
             return true;
         }
 
-        auto copy_level = _generations[level];
-        copy_level.push_back(sstable);
-        copy_level.sort([&s] (auto& i, auto& j) {
-            return i->compare_by_first_key(s, *j) < 0;
-        });
-
-        const sstables::sstable *previous = nullptr;
-        for (auto& current : copy_level) {
-            if (previous != nullptr) {
-                auto current_first = current->get_first_decorated_key(s);
-                auto previous_last = previous->get_last_decorated_key(s);
-
-                if (current_first.tri_compare(s, previous_last) <= 0) {
-                    return false;
-                }
+        // The sstables of a level don't overlap each other, so it's enough to
+        // check the new sstable against each of them.
+        auto first = sstable->get_first_decorated_key(s);
+        auto last = sstable->get_last_decorated_key(s);
+        for (auto& current : _generations[level]) {
+            if (first.tri_compare(s, current->get_last_decorated_key(s)) <= 0
+                    && last.tri_compare(s, current->get_first_decorated_key(s)) >= 0) {
+                return false;
             }
-            previous = &*current;
         }
 
         return true;
@@ -307,11 +281,14 @@ class leveled_manifest {
         return max_bytes_for_level(level, _max_sstable_size_in_bytes);
     }
 
+    using compacting_set = std::unordered_set<sstables::shared_sstable>;
+
     /**
      * @return highest-priority sstables to compact, and level to compact them to
      * If no compactions are necessary, will return null
+     * @param compacting sstables which are being compacted already and thus cannot be candidates
      */
-    sstables::compaction_descriptor get_compaction_candidates() {
+    sstables::compaction_descriptor get_compaction_candidates(const compacting_set& compacting = {}) {
 #if 0
         // during bootstrap we only do size tiering in L0 to make sure
         // the streamed files can be placed in their original levels
@@ -358,12 +335,14 @@ class leveled_manifest {
             if (sstables.empty()) {
                 continue; // mostly this just avoids polluting the debug log with zero scores
             }
-#if 0
             // we want to calculate score excluding compacting ones
-            Set<SSTableReader> sstablesInLevel = Sets.newHashSet(sstables);
-            Set<SSTableReader> remaining = Sets.difference(sstablesInLevel, cfs.getDataTracker().getCompacting());
-#endif
-            double score = (double) get_total_bytes(sstables) / (double) max_bytes_for_level(i);
+            uint64_t remaining_bytes = 0;
+            for (auto& sstable : sstables) {
+                if (!compacting.count(sstable)) {
+                    remaining_bytes += sstable->data_size();
+                }
+            }
+            double score = (double) remaining_bytes / (double) max_bytes_for_level(i);
 
             logger.debug("Compaction score for level {} is {}", i, score);
 
@@ -381,7 +360,7 @@ class leveled_manifest {
                 }
 #endif
                 // L0 is fine, proceed with this level
-                auto candidates = get_candidates_for(i);
+                auto candidates = get_candidates_for(i, compacting);
                 if (!candidates.empty()) {
                     int next_level = get_next_level(candidates);
 #if 0
@@ -401,7 +380,7 @@ class leveled_manifest {
         if (get_level(0).empty()) {
             return sstables::compaction_descriptor();
         }
-        auto candidates = get_candidates_for(0);
+        auto candidates = get_candidates_for(0, compacting);
         if (candidates.empty()) {
             return sstables::compaction_descriptor();
         }
@@ -525,7 +504,15 @@ class leveled_manifest {
         if (level >= _generations.size()) {
             throw std::runtime_error("Invalid level");
         }
-        _generations[level].remove(sstable);
+        auto& sstables = _generations[level];
+        auto it = std::find(sstables.begin(), sstables.end(), sstable);
+        if (it == sstables.end()) {
+            // sstables which would overlap their level are kept in L0.
+            level = 0;
+            _generations[0].remove(sstable);
+        } else {
+            sstables.erase(it);
+        }
         return level;
     }
 
@@ -561,6 +548,11 @@ class leveled_manifest {
         return overlapping(first, last, others);
     }
 
+    ::range<dht::token> token_range_of(const sstables::shared_sstable& sstable) const {
+        const schema& s = *_schema;
+        return ::range<dht::token>::make(sstable->get_first_decorated_key(s)._token, sstable->get_last_decorated_key(s)._token);
+    }
+
     std::vector<sstables::shared_sstable>
     overlapping(sstables::shared_sstable& sstable, std::list<sstables::shared_sstable>& others) {
         const schema& s = *_schema;
@@ -602,28 +594,36 @@ class leveled_manifest {
      * If no compactions are possible (because of concurrent compactions or because some sstables are blacklisted
      * for prior failure), will return an empty list.  Never returns null.
      */
-    std::vector<sstables::shared_sstable> get_candidates_for(int level) {
+    std::vector<sstables::shared_sstable> get_candidates_for(int level, const compacting_set& compacting = {}) {
         const schema& s = *_schema;
         assert(!get_level(level).empty());
-#if 0
+
         logger.debug("Choosing candidates for L{}", level);
 
-        final Set<SSTableReader> compacting = cfs.getDataTracker().getCompacting();
-#endif
-        if (level == 0) {
-#if 0
-            Set<SSTableReader> compactingL0 = ImmutableSet.copyOf(Iterables.filter(getLevel(0), Predicates.in(compacting)));
+        auto is_compacting = [&compacting] (const sstables::shared_sstable& sstable) {
+            return compacting.count(sstable) > 0;
+        };
 
-            RowPosition lastCompactingKey = null;
-            RowPosition firstCompactingKey = null;
-            for (SSTableReader candidate : compactingL0)
-            {
-                if (firstCompactingKey == null || candidate.first.compareTo(firstCompactingKey) < 0)
-                    firstCompactingKey = candidate.first;
-                if (lastCompactingKey == null || candidate.last.compareTo(lastCompactingKey) > 0)
-                    lastCompactingKey = candidate.last;
+        if (level == 0) {
+            std::vector<sstables::shared_sstable> compacting_l0;
+            for (auto& sstable : get_level(0)) {
+                if (is_compacting(sstable)) {
+                    compacting_l0.push_back(sstable);
+                }
+            }
+            // Token range spanned by the L0 sstables being compacted. The result of
+            // that compaction may overlap anything within it, so new candidates
+            // must stay out of it.
+            std::experimental::optional<::range<dht::token>> compacting_range;
+            if (!compacting_l0.empty()) {
+                auto first = compacting_l0.front()->get_first_decorated_key(s)._token;
+                auto last = compacting_l0.front()->get_last_decorated_key(s)._token;
+                for (auto& sstable : compacting_l0) {
+                    first = std::min(first, sstable->get_first_decorated_key(s)._token);
+                    last = std::max(last, sstable->get_last_decorated_key(s)._token);
+                }
+                compacting_range = ::range<dht::token>::make(first, last);
             }
-#endif
 
             // L0 is the dumping ground for new sstables which thus may overlap each other.
             //
@@ -655,18 +655,14 @@ class leveled_manifest {
                     overlappedL0.push_back(sstable);
                 }
 
-#if 0
-                if (!Sets.intersection(overlappedL0, compactingL0).isEmpty())
+                if (std::any_of(overlappedL0.begin(), overlappedL0.end(), is_compacting)) {
                     continue;
-#endif
+                }
 
                 for (auto& new_candidate : overlappedL0) {
-#if 0
-                    if (firstCompactingKey == null || lastCompactingKey == null || overlapping(firstCompactingKey.getToken(), lastCompactingKey.getToken(), Arrays.asList(newCandidate)).size() == 0)
-                        candidates.add(newCandidate);
-#else
-                    candidates.push_back(new_candidate);
-#endif
+                    if (!compacting_range || !compacting_range->overlaps(token_range_of(new_candidate), dht::token_comparator())) {
+                        candidates.push_back(new_candidate);
+                    }
                     remaining.remove(new_candidate);
                 }
 
@@ -682,10 +678,20 @@ class leveled_manifest {
 
             // leave everything in L0 if we didn't end up with a full sstable's worth of data
             if (get_total_bytes(candidates) > _max_sstable_size_in_bytes) {
-                // add sstables from L1 that overlap candidates
-                // if the overlapping ones are already busy in a compaction, leave it out.
-                // TODO try to find a set of L0 sstables that only overlaps with non-busy L1 sstables
+                // add sstables from L1 that overlap candidates.
+                // if some of the overlapping ones are already busy in a compaction, drop the
+                // newest candidates until the remaining ones only overlap non-busy L1 sstables.
                 auto l1overlapping = overlapping(candidates, get_level(1));
+                while (std::any_of(l1overlapping.begin(), l1overlapping.end(), is_compacting)) {
+                    auto newest = std::max_element(candidates.begin(), candidates.end(), [] (auto& i, auto& j) {
+                        return i->compare_by_max_timestamp(*j) < 0;
+                    });
+                    candidates.erase(newest);
+                    if (candidates.empty()) {
+                        return {};
+                    }
+                    l1overlapping = overlapping(candidates, get_level(1));
+                }
                 for (auto candidate : l1overlapping) {
                     auto it = std::find(candidates.begin(), candidates.end(), candidate);
                     if (it != candidates.end()) {
@@ -731,9 +737,10 @@ class leveled_manifest {
 #if 0
             if (Iterables.any(candidates, suspectP))
                 continue;
-            if (Sets.intersection(candidates, compacting).isEmpty())
-                return candidates;
 #endif
+            if (std::any_of(candidates.begin(), candidates.end(), is_compacting)) {
+                continue;
+            }
             if (candidates.size() < 2) {
                 return {};
             } else {
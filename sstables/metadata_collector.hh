@@ -192,10 +192,12 @@ struct column_stats {
 class metadata_collector {
 public:
     static constexpr double NO_COMPRESSION_RATIO = -1.0;
+    // Bit width of the cardinality estimator of the sstables we write.
+    static constexpr int cardinality_precision = 13;
 
     static hll::HyperLogLog hyperloglog(int p, int sp) {
-        // FIXME: hll::HyperLogLog doesn't support sparse format, so ignoring parameters by the time being.
-        return hll::HyperLogLog();
+        // FIXME: hll::HyperLogLog doesn't support sparse format, so ignoring sp by the time being.
+        return hll::HyperLogLog(p);
     }
 private:
     // EH of 150 can track a max value of 1697806495183, i.e., > 1.5PB
@@ -221,7 +223,7 @@ class metadata_collector {
      * while lowering bytes required to hold information.
      * See CASSANDRA-5906 for detail.
      */
-    hll::HyperLogLog _cardinality = hyperloglog(13, 25);
+    hll::HyperLogLog _cardinality = hyperloglog(cardinality_precision, 25);
 private:
     /*
      * Convert a vector of bytes into a disk array of disk_string<uint16_t>.
@@ -26,6 +26,7 @@
 #include "keys.hh"
 #include "core/do_with.hh"
 #include "unimplemented.hh"
+#include <boost/algorithm/cxx11/any_of.hpp>
 
 #include "dht/i_partitioner.hh"
 
@@ -100,6 +101,11 @@ class mp_row_consumer : public row_consumer {
     schema_ptr _schema;
     key_view _key;
     std::function<future<> (mutation&& m)> _mutation_to_subscription;
+    const query::partition_slice& _slice;
+    // Atoms of a clustering row are adjacent, so we remember the outcome of
+    // the last slice check and reuse it for the rest of the row.
+    std::experimental::optional<std::vector<bytes>> _last_checked_prefix;
+    bool _last_prefix_in_slice = true;
 
     struct column {
         bool is_static;
@@ -195,6 +201,10 @@ class mp_row_consumer : public row_consumer {
 
         collection_mutation() : _cdef(nullptr) {}
 
+        bool is_static() const {
+            return _cdef && _cdef->is_static();
+        }
+
         bool is_new_collection(const exploded_clustering_prefix& prefix, const column_definition *c) {
             if (prefix.components() != _clustering_prefix.components()) {
                 return true;
@@ -248,22 +258,47 @@ class mp_row_consumer : public row_consumer {
             _pending_collection = {};
         }
     }
+
+    // Returns true if atoms of the clustering row with given prefix should
+    // be included in the mutation.
+    bool is_in_slice(const exploded_clustering_prefix& prefix) {
+        if (&_slice == &query::full_slice) {
+            return true;
+        }
+        if (!_last_checked_prefix || *_last_checked_prefix != prefix.components()) {
+            auto ck = clustering_key::from_clustering_prefix(*_schema, prefix);
+            _last_prefix_in_slice = query::is_in_ranges(*_schema, _slice.row_ranges, ck);
+            _last_checked_prefix = prefix.components();
+        }
+        return _last_prefix_in_slice;
+    }
+protected:
+    const schema_ptr& get_schema() const {
+        return _schema;
+    }
+
+    bool has_pending_static_collection() const {
+        return _pending_collection && _pending_collection->is_static();
+    }
 public:
     mutation_opt mut;
 
-    mp_row_consumer(const key& key, const schema_ptr _schema)
+    mp_row_consumer(const key& key, const schema_ptr _schema, const query::partition_slice& slice = query::full_slice)
             : _schema(_schema)
             , _key(key_view(key))
+            , _slice(slice)
             , mut(mutation(partition_key::from_exploded(*_schema, key.explode(*_schema)), _schema))
     { }
 
-    mp_row_consumer(const schema_ptr _schema)
+    mp_row_consumer(const schema_ptr _schema, const query::partition_slice& slice = query::full_slice)
             : _schema(_schema)
+            , _slice(slice)
     { }
 
     mp_row_consumer(const schema_ptr _schema, std::function<future<> (mutation&& m)> sub_fn)
             : _schema(_schema)
             , _mutation_to_subscription(sub_fn)
+            , _slice(query::full_slice)
     { }
 
     virtual void consume_row_start(sstables::key_view key, sstables::deletion_time deltime) override {
@@ -290,14 +325,24 @@ class mp_row_consumer : public row_consumer {
     virtual void consume_cell(bytes_view col_name, bytes_view value, int64_t timestamp, int32_t ttl, int32_t expiration) override {
         struct column col(*_schema, col_name);
 
-        auto ac = make_atomic_cell(timestamp, value, ttl, expiration);
         auto clustering_prefix = exploded_clustering_prefix(std::move(col.clustering));
+        if (!col.is_static && !is_in_slice(clustering_prefix)) {
+            flush_pending_collection(*_schema, *mut);
+            return;
+        }
+
+        auto ac = make_atomic_cell(timestamp, value, ttl, expiration);
 
         if (col.collection_extra_data.size()) {
             update_pending_collection(clustering_prefix, col.cdef, std::move(col.collection_extra_data), std::move(ac));
             return;
         }
 
+        // Atoms are sorted, so a pending collection is complete once an atom
+        // not belonging to it shows up. Flushing it early keeps everything
+        // but the last row final, which streamed consumers rely on.
+        flush_pending_collection(*_schema, *mut);
+
         if (col.is_static) {
             mut->set_static_cell(*(col.cdef), std::move(ac));
             return;
@@ -322,12 +367,19 @@ class mp_row_consumer : public row_consumer {
     }
 
     void consume_deleted_cell(column &col, int64_t timestamp, gc_clock::time_point ttl) {
-        auto ac = atomic_cell::make_dead(timestamp, ttl);
-
         auto clustering_prefix = exploded_clustering_prefix(std::move(col.clustering));
+        if (!col.is_static && !is_in_slice(clustering_prefix)) {
+            flush_pending_collection(*_schema, *mut);
+            return;
+        }
+
+        auto ac = atomic_cell::make_dead(timestamp, ttl);
         if (col.collection_extra_data.size()) {
             update_pending_collection(clustering_prefix, col.cdef, std::move(col.collection_extra_data), std::move(ac));
-        } else if (col.is_static) {
+            return;
+        }
+        flush_pending_collection(*_schema, *mut);
+        if (col.is_static) {
             mut->set_static_cell(*(col.cdef), atomic_cell_or_collection(std::move(ac)));
         } else if (col.cell.size() == 0) {
             auto clustering_key = clustering_key::from_clustering_prefix(*_schema, clustering_prefix);
@@ -378,12 +430,18 @@ class mp_row_consumer : public row_consumer {
         // Still, it is enough to check if we're dealing with a collection, since any other tombstone
         // won't have a full clustering prefix (otherwise it isn't a range)
         if (start.size() <= _schema->clustering_key_size()) {
+            flush_pending_collection(*_schema, *mut);
             mut->partition().apply_delete(*_schema, exploded_clustering_prefix(std::move(start)), tombstone(deltime));
         } else {
             auto&& column = pop_back(start);
 
             auto clustering_prefix = exploded_clustering_prefix(std::move(start));
-            update_pending_collection(clustering_prefix, _schema->get_column_definition(column), tombstone(deltime));
+            auto cdef = _schema->get_column_definition(column);
+            if (!cdef->is_static() && !is_in_slice(clustering_prefix)) {
+                flush_pending_collection(*_schema, *mut);
+                return;
+            }
+            update_pending_collection(clustering_prefix, cdef, tombstone(deltime));
         }
     }
 };
@@ -419,8 +477,138 @@ future<uint64_t> sstables::sstable::data_end_position(uint64_t summary_idx) {
     });
 }
 
+template <typename T>
+static T read_be(bytes_view& v) {
+    if (v.size() < sizeof(T)) {
+        throw malformed_sstable_exception("promoted index is truncated");
+    }
+    T i = net::ntoh(*unaligned_cast<const T*>(v.data()));
+    v.remove_prefix(sizeof(T));
+    return i;
+}
+
+static bytes read_name(bytes_view& v) {
+    auto len = read_be<uint16_t>(v);
+    if (v.size() < len) {
+        throw malformed_sstable_exception("promoted index is truncated");
+    }
+    auto name = bytes(v.data(), len);
+    v.remove_prefix(len);
+    return name;
+}
+
+static promoted_index parse_promoted_index(bytes_view v) {
+    promoted_index pi;
+    pi.del_time.local_deletion_time = read_be<int32_t>(v);
+    pi.del_time.marked_for_delete_at = read_be<int64_t>(v);
+    auto count = read_be<uint32_t>(v);
+    for (uint32_t i = 0; i < count; ++i) {
+        promoted_index_block b;
+        b.first_name = read_name(v);
+        b.last_name = read_name(v);
+        b.offset = read_be<uint64_t>(v);
+        b.width = read_be<uint64_t>(v);
+        pi.blocks.push_back(std::move(b));
+    }
+    return pi;
+}
+
+// Clustering position of a column name found in the promoted index. Static
+// columns sort before all clustering rows.
+struct promoted_index_position {
+    bool is_static;
+    clustering_key_prefix prefix;
+
+    promoted_index_position(const schema& s, bytes_view name)
+        : is_static(name.size() >= 2 && name[0] == bytes::value_type(0xff) && name[1] == bytes::value_type(0xff))
+        , prefix(clustering_key_prefix::make_empty(s))
+    {
+        if (!is_static) {
+            auto components = composite_view(name).explode();
+            components.resize(std::min(components.size(), size_t(s.clustering_key_size())));
+            prefix = clustering_key_prefix::from_exploded(s, std::move(components));
+        }
+    }
+};
+
+// Prefix-equality comparison, so a range bound matches all blocks
+// containing keys it is a prefix of.
+static int prefix_tri_compare(const schema& s, const clustering_key_prefix& a, const clustering_key_prefix& b) {
+    auto t = clustering_key_prefix::get_compound_type(s);
+    return prefix_equality_tri_compare(t->types().begin(), t->begin(a), t->end(a), t->begin(b), t->end(b), ::tri_compare);
+}
+
+// Returns byte ranges, relative to the partition start, of the blocks which
+// need to be read to get the static row and all rows within given ranges.
+static std::vector<std::pair<uint64_t, uint64_t>>
+select_promoted_index_blocks(const schema& s, const promoted_index& pi, const query::clustering_row_ranges& ranges) {
+    auto overlaps = [&] (const promoted_index_block& b) {
+        promoted_index_position first(s, b.first_name);
+        promoted_index_position last(s, b.last_name);
+        if (last.is_static) {
+            return false;
+        }
+        return boost::algorithm::any_of(ranges, [&] (const query::clustering_range& r) {
+            if (r.start() && prefix_tri_compare(s, last.prefix, r.start()->value()) < 0) {
+                return false;
+            }
+            if (r.end() && !first.is_static && prefix_tri_compare(s, first.prefix, r.end()->value()) > 0) {
+                return false;
+            }
+            return true;
+        });
+    };
+
+    int static_end = -1;
+    while (static_end + 1 < int(pi.blocks.size()) && promoted_index_position(s, pi.blocks[static_end + 1].first_name).is_static) {
+        ++static_end;
+    }
+    int lo = -1;
+    int hi = -1;
+    for (int i = 0; i < int(pi.blocks.size()); ++i) {
+        if (overlaps(pi.blocks[i])) {
+            lo = lo < 0 ? i : lo;
+            hi = i;
+        }
+    }
+
+    auto byte_range = [&] (int first, int last) {
+        auto& l = pi.blocks[last];
+        return std::make_pair(pi.blocks[first].offset, l.offset + l.width);
+    };
+    std::vector<std::pair<uint64_t, uint64_t>> ret;
+    if (static_end >= 0 && hi >= 0 && lo <= static_end + 1) {
+        ret.push_back(byte_range(0, hi));
+        return ret;
+    }
+    if (static_end >= 0) {
+        ret.push_back(byte_range(0, static_end));
+    }
+    if (hi >= 0) {
+        ret.push_back(byte_range(lo, hi));
+    }
+    return ret;
+}
+
 future<mutation_opt>
-sstables::sstable::read_row(schema_ptr schema, const sstables::key& key) {
+sstables::sstable::read_row_blocks(schema_ptr schema, const sstables::key& key, const query::partition_slice& slice,
+        uint64_t position, promoted_index pi) {
+    auto ranges = select_promoted_index_blocks(*schema, pi, slice.row_ranges);
+    return do_with(std::move(ranges), [this, schema, &key, &slice, position, del_time = pi.del_time] (auto& ranges) {
+        return do_with(mp_row_consumer(key, schema, slice), [this, &key, &ranges, position, del_time] (auto& c) {
+            c.consume_row_start(key_view(key), del_time);
+            return do_for_each(ranges, [this, &c, position] (auto& r) {
+                return this->data_consume_atoms_at_once(c, position + r.first, position + r.second);
+            }).then([&c] {
+                c.consume_row_end();
+                return make_ready_future<mutation_opt>(std::move(c.mut));
+            });
+        });
+    });
+}
+
+future<mutation_opt>
+sstables::sstable::read_row(schema_ptr schema, const sstables::key& key, const query::partition_slice& slice) {
 
     assert(schema);
 
@@ -438,7 +626,7 @@ sstables::sstable::read_row(schema_ptr schema, const sstables::key& key) {
         return make_ready_future<mutation_opt>();
     }
 
-    return read_indexes(summary_idx).then([this, schema, &key, token, summary_idx] (auto index_list) {
+    return read_indexes(summary_idx).then([this, schema, &key, &slice, token, summary_idx] (auto index_list) {
         auto index_idx = this->binary_search(index_list, key, token);
         if (index_idx < 0) {
             _filter_tracker.add_false_positive();
@@ -447,8 +635,13 @@ sstables::sstable::read_row(schema_ptr schema, const sstables::key& key) {
         _filter_tracker.add_true_positive();
 
         auto position = index_list[index_idx].position();
-        return this->data_end_position(summary_idx, index_idx, index_list).then([&key, schema, this, position] (uint64_t end) {
-            return do_with(mp_row_consumer(key, schema), [this, position, end] (auto& c) {
+        auto promoted_index_bytes = index_list[index_idx].get_promoted_index_bytes();
+        if (!promoted_index_bytes.empty() && &slice != &query::full_slice
+                && schema->is_compound() && schema->clustering_key_size()) {
+            return this->read_row_blocks(schema, key, slice, position, parse_promoted_index(promoted_index_bytes));
+        }
+        return this->data_end_position(summary_idx, index_idx, index_list).then([&key, &slice, schema, this, position] (uint64_t end) {
+            return do_with(mp_row_consumer(key, schema, slice), [this, position, end] (auto& c) {
                 return this->data_consume_rows_at_once(c, position, end).then([&c] {
                     return make_ready_future<mutation_opt>(std::move(c.mut));
                 });
@@ -469,8 +662,9 @@ class mutation_reader::impl {
     impl(sstable& sst, schema_ptr schema)
         : _consumer(schema)
         , _context(sst.data_consume_rows(_consumer)) { }
-    impl(sstable& sst, schema_ptr schema, future<uint64_t> start, future<uint64_t> end)
-        : _consumer(schema)
+    impl(sstable& sst, schema_ptr schema, future<uint64_t> start, future<uint64_t> end,
+            const query::partition_slice& slice = query::full_slice)
+        : _consumer(schema, slice)
         , _context_future(start.then([this, &sst, end = std::move(end)] (uint64_t start) mutable {
                       return end.then([this, &sst, start] (uint64_t end) mutable {
                           return sst.data_consume_rows(_consumer, start, end);
@@ -607,8 +801,8 @@ mutation_reader sstable::read_range_rows(schema_ptr schema,
             dht::ring_position::ending_at(max_token)));
 }
 
-mutation_reader
-sstable::read_range_rows(schema_ptr schema, const query::partition_range& range) {
+std::pair<future<uint64_t>, future<uint64_t>>
+sstable::data_range_positions(schema_ptr schema, const query::partition_range& range) {
     if (query::is_wrap_around(range, *schema)) {
         fail(unimplemented::cause::WRAP_AROUND);
     }
@@ -625,8 +819,179 @@ sstable::read_range_rows(schema_ptr schema, const query::partition_range& range)
                  : lower_bound(schema, range.end()->value()))
         : make_ready_future<uint64_t>(data_size());
 
+    return { std::move(start), std::move(end) };
+}
+
+mutation_reader
+sstable::read_range_rows(schema_ptr schema, const query::partition_range& range, const query::partition_slice& slice) {
+    auto positions = data_range_positions(schema, range);
     return std::make_unique<mutation_reader::impl>(
-        *this, std::move(schema), std::move(start), std::move(end));
+        *this, std::move(schema), std::move(positions.first), std::move(positions.second), slice);
+}
+
+// Row consumer which, instead of building whole partitions, hands out
+// fragments as soon as they are complete. Only the clustering row which is
+// currently being read (and the fragments which follow it in clustering
+// order) are kept in mut.
+class mp_fragment_consumer : public mp_row_consumer {
+    // Consumption is paused once this many fragments are waiting to be
+    // returned, which bounds memory used by wide partitions.
+    static constexpr size_t max_buffered_fragments = 64;
+
+    std::deque<mutation_fragment> _buffer;
+    bool _static_row_emitted = false;
+private:
+    void emit_static_row() {
+        if (_static_row_emitted) {
+            return;
+        }
+        auto& sr = mut->partition().static_row();
+        if (sr.size()) {
+            _buffer.emplace_back(static_row(std::move(sr)));
+            sr = row();
+        }
+        _static_row_emitted = true;
+    }
+
+    // Moves out of mut everything which precedes the last clustering row,
+    // or everything if the partition is complete.
+    void drain(bool partition_complete) {
+        auto& p = mut->partition();
+        auto& rows = p.clustered_rows();
+        auto& tombstones = p.row_tombstones();
+        if (!partition_complete && (rows.empty() || has_pending_static_collection())) {
+            return;
+        }
+        emit_static_row();
+
+        mutation_fragment_less_compare less(*get_schema());
+        auto rows_end = partition_complete ? rows.end() : std::prev(rows.end());
+        auto ri = rows.begin();
+        auto ti = tombstones.begin();
+        while (true) {
+            bool has_row = ri != rows_end;
+            bool has_tombstone = ti != tombstones.end()
+                && (partition_complete || less(ti->prefix(), rows_end->key()));
+            if (has_tombstone && (!has_row || less(ti->prefix(), ri->key()))) {
+                _buffer.emplace_back(range_tombstone(std::move(ti->prefix()), ti->t()));
+                ti = tombstones.erase_and_dispose(ti, current_deleter<row_tombstones_entry>());
+            } else if (has_row) {
+                _buffer.emplace_back(clustering_row(std::move(ri->key()), std::move(ri->row())));
+                ri = rows.erase_and_dispose(ri, current_deleter<rows_entry>());
+            } else {
+                break;
+            }
+        }
+    }
+public:
+    mp_fragment_consumer(const schema_ptr schema)
+        : mp_row_consumer(schema)
+    { }
+
+    bool has_fragments() const {
+        return !_buffer.empty();
+    }
+
+    mutation_fragment_opt pop_fragment() {
+        auto mf = std::move(_buffer.front());
+        _buffer.pop_front();
+        return mutation_fragment_opt(std::move(mf));
+    }
+
+    virtual void consume_row_start(sstables::key_view key, sstables::deletion_time deltime) override {
+        mp_row_consumer::consume_row_start(key, deltime);
+        _buffer.emplace_back(partition_start(mut->decorated_key(), mut->partition().partition_tombstone()));
+        _static_row_emitted = false;
+    }
+
+    virtual void consume_range_tombstone(bytes_view start_col, bytes_view end_col, sstables::deletion_time deltime) override {
+        // Blocks of the promoted index start with repetitions of the range
+        // tombstones which are open at that point. They sort before the
+        // clustering row preceding them, which may have been already handed
+        // out, so we drop them instead of emitting out of order fragments.
+        auto& rows = mut->partition().clustered_rows();
+        if (!rows.empty()) {
+            auto& s = *get_schema();
+            auto start = composite_view(start_col).explode();
+            if (start.size() < s.clustering_key_size()) {
+                auto prefix = clustering_key_prefix::from_exploded(s, std::move(start));
+                if (mutation_fragment_less_compare(s)(prefix, rows.rbegin()->key())) {
+                    return;
+                }
+            }
+        }
+        mp_row_consumer::consume_range_tombstone(start_col, end_col, deltime);
+    }
+
+    virtual proceed consume_atom_end() override {
+        drain(false);
+        return _buffer.size() < max_buffered_fragments ? proceed::yes : proceed::no;
+    }
+
+    virtual proceed consume_row_end() override {
+        mp_row_consumer::consume_row_end();
+        drain(true);
+        _buffer.emplace_back(partition_end());
+        mut = {};
+        return proceed::no;
+    }
+};
+
+class streamed_reader final : public ::streamed_mutation_reader::impl {
+    mp_fragment_consumer _consumer;
+    std::experimental::optional<data_consume_context> _context;
+    std::experimental::optional<future<data_consume_context>> _context_future;
+    bool _eof = false;
+public:
+    streamed_reader(sstable& sst, schema_ptr schema)
+        : _consumer(schema)
+        , _context(sst.data_consume_rows(_consumer)) { }
+    streamed_reader(sstable& sst, schema_ptr schema, future<uint64_t> start, future<uint64_t> end)
+        : _consumer(schema)
+        , _context_future(start.then([this, &sst, end = std::move(end)] (uint64_t start) mutable {
+                      return end.then([this, &sst, start] (uint64_t end) mutable {
+                          return sst.data_consume_rows(_consumer, start, end);
+                      });
+                    })) { }
+
+    // Reference to _consumer is passed to data_consume_rows() in the constructor so we must not allow move/copy
+    streamed_reader(streamed_reader&&) = delete;
+    streamed_reader(const streamed_reader&) = delete;
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (_consumer.has_fragments()) {
+            return make_ready_future<mutation_fragment_opt>(_consumer.pop_fragment());
+        }
+        if (_eof) {
+            return make_ready_future<mutation_fragment_opt>();
+        }
+        if (!_context) {
+            return _context_future->then([this] (auto context) {
+                _context = std::move(context);
+                return this->operator()();
+            });
+        }
+        return _context->read().then([this] {
+            // read() returns either because the consumer paused with some
+            // fragments buffered, or because the data range ended.
+            if (!_consumer.has_fragments()) {
+                _eof = true;
+                return mutation_fragment_opt();
+            }
+            return _consumer.pop_fragment();
+        });
+    }
+};
+
+::streamed_mutation_reader sstable::read_rows_streamed(schema_ptr schema) {
+    return make_streamed_mutation_reader<streamed_reader>(*this, std::move(schema));
+}
+
+::streamed_mutation_reader
+sstable::read_range_rows_streamed(schema_ptr schema, const query::partition_range& range) {
+    auto positions = data_range_positions(schema, range);
+    return make_streamed_mutation_reader<streamed_reader>(
+        *this, std::move(schema), std::move(positions.first), std::move(positions.second));
 }
 
 
@@ -253,6 +253,9 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
                 _key.release();
                 _val.release();
                 _state = state::ATOM_START;
+                if (_consumer.consume_atom_end() == row_consumer::proceed::no) {
+                    return row_consumer::proceed::no;
+                }
             } else {
                 _state = state::CELL_VALUE_BYTES_2;
             }
@@ -275,6 +278,9 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
             _key.release();
             _val.release();
             _state = state::ATOM_START;
+            if (_consumer.consume_atom_end() == row_consumer::proceed::no) {
+                return row_consumer::proceed::no;
+            }
             break;
         case state::RANGE_TOMBSTONE:
             if (read_16(data) != read_status::ready) {
@@ -307,6 +313,9 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
             _key.release();
             _val.release();
             _state = state::ATOM_START;
+            if (_consumer.consume_atom_end() == row_consumer::proceed::no) {
+                return row_consumer::proceed::no;
+            }
             break;
         }
         default:
@@ -322,11 +331,27 @@ class data_consume_rows_context : public data_consumer::continuous_data_consumer
             , _consumer(consumer) {
     }
 
+    struct in_partition_tag { };
+
+    // Starts consuming at an atom boundary inside of a partition.
+    data_consume_rows_context(in_partition_tag, row_consumer& consumer,
+            input_stream<char> && input, uint64_t maxlen) :
+            continuous_data_consumer(std::move(input), maxlen)
+            , _state(state::ATOM_START)
+            , _consumer(consumer) {
+    }
+
     void verify_end_state() {
         if (_state != state::ROW_START || _prestate != prestate::NONE) {
             throw malformed_sstable_exception("end of input, but not end of row");
         }
     }
+
+    void verify_atom_end_state() {
+        if ((_state != state::ROW_START && _state != state::ATOM_START) || _prestate != prestate::NONE) {
+            throw malformed_sstable_exception("end of input, but not end of atom");
+        }
+    }
 };
 
 // data_consume_rows() and data_consume_rows_at_once() both can read just a
@@ -375,4 +400,14 @@ future<> sstable::data_consume_rows_at_once(row_consumer& consumer,
     });
 }
 
+future<> sstable::data_consume_atoms_at_once(row_consumer& consumer,
+        uint64_t start, uint64_t end) {
+    return data_read(start, end - start).then([&consumer]
+                                               (temporary_buffer<char> buf) {
+        data_consume_rows_context ctx(data_consume_rows_context::in_partition_tag(), consumer, input_stream<char>(), -1);
+        ctx.process(buf);
+        ctx.verify_atom_end_state();
+    });
+}
+
 }
@@ -75,6 +75,14 @@ class row_consumer {
             bytes_view start_col, bytes_view end_col,
             sstables::deletion_time deltime) = 0;
 
+    // Called after each cell, deleted cell or range tombstone was consumed.
+    // Returning proceed::no pauses consumption in the middle of the row, so
+    // that a consumer can hand off what it has accumulated so far before the
+    // whole row is read. The next read() resumes with the following atom.
+    virtual proceed consume_atom_end() {
+        return proceed::yes;
+    }
+
     // Called at the end of the row, after all cells.
     // Returns a flag saying whether the sstable consumer should stop now, or
     // proceed consuming more data.
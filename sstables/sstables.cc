@@ -39,6 +39,7 @@
 #include "index_reader.hh"
 #include "remove.hh"
 #include "memtable.hh"
+#include "row_cache.hh"
 #include "downsampling.hh"
 #include <boost/filesystem/operations.hpp>
 #include <boost/algorithm/string.hpp>
@@ -113,6 +114,7 @@ std::unordered_map<sstable::component_type, sstring, enum_hash<sstable::componen
     { component_type::Filter, "Filter.db" },
     { component_type::Statistics, "Statistics.db" },
     { component_type::TemporaryTOC, "TOC.txt.tmp" },
+    { component_type::Scylla, "Scylla.db" },
 };
 
 // This assumes that the mappings are small enough, and called unfrequent
@@ -707,6 +709,7 @@ void sstable::generate_toc(compressor c, double filter_fp_chance) {
     _components.insert(component_type::Index);
     _components.insert(component_type::Summary);
     _components.insert(component_type::Data);
+    _components.insert(component_type::Scylla);
     if (filter_fp_chance != 1.0) {
         _components.insert(component_type::Filter);
     }
@@ -787,11 +790,50 @@ void write_digest(const sstring file_path, uint32_t full_checksum) {
 thread_local std::array<std::vector<int>, downsampling::BASE_SAMPLING_LEVEL> downsampling::_sample_pattern_cache;
 thread_local std::array<std::vector<int>, downsampling::BASE_SAMPLING_LEVEL> downsampling::_original_index_cache;
 
+static thread_local logalloc::allocating_section index_page_section;
+
 future<index_list> sstable::read_indexes(uint64_t summary_idx) {
     if (summary_idx >= _summary.header.size) {
         return make_ready_future<index_list>(index_list());
     }
 
+    auto& tracker = global_cache_tracker();
+    auto i = _index_pages.find(summary_idx, cached_index_page::compare());
+    if (i != _index_pages.end()) {
+        tracker.on_index_page_hit();
+        tracker.touch(*i);
+        logalloc::reclaim_lock _(tracker.region());
+        return make_ready_future<index_list>(i->to_index_list());
+    }
+    tracker.on_index_page_miss();
+    return read_indexes_from_disk(summary_idx).then([this, summary_idx] (index_list il) {
+        cache_index_page(summary_idx, il);
+        return make_ready_future<index_list>(std::move(il));
+    });
+}
+
+void sstable::cache_index_page(uint64_t summary_idx, const index_list& il) {
+    auto& tracker = global_cache_tracker();
+    try {
+        with_allocator(tracker.allocator(), [&] {
+            index_page_section(tracker.region(), [&] {
+                auto i = _index_pages.lower_bound(summary_idx, cached_index_page::compare());
+                if (i != _index_pages.end() && i->summary_idx() == summary_idx) {
+                    // Populated by a concurrent read.
+                    return;
+                }
+                auto page = current_allocator().construct<cached_index_page>(summary_idx, il);
+                tracker.insert(*page);
+                _index_pages.insert(i, *page);
+            });
+        });
+    } catch (const std::bad_alloc&) {
+        // Caching is an optimization, the read itself succeeded.
+        sstlog.debug("Failed to cache index page {} of {}", summary_idx, filename(component_type::Index));
+    }
+}
+
+future<index_list> sstable::read_indexes_from_disk(uint64_t summary_idx) {
     uint64_t position = _summary.entries[summary_idx].position;
     uint64_t quantity = downsampling::get_effective_index_interval_after_index(summary_idx, _summary.header.sampling_level,
         _summary.header.min_index_interval);
@@ -877,6 +919,18 @@ void sstable::write_statistics() {
     write_simple<component_type::Statistics>(_statistics);
 }
 
+future<> sstable::read_scylla_metadata() {
+    if (!has_component(component_type::Scylla)) {
+        return make_ready_future<>();
+    }
+    return read_simple<component_type::Scylla>(_scylla_metadata);
+}
+
+void sstable::write_scylla_metadata() {
+    _scylla_metadata.set_feature(sstable_feature::full_max_local_deletion_time);
+    write_simple<component_type::Scylla>(_scylla_metadata);
+}
+
 future<> sstable::open_data() {
     return when_all(engine().open_file_dma(filename(component_type::Index), open_flags::ro),
                     engine().open_file_dma(filename(component_type::Data), open_flags::ro)).then([this] (auto files) {
@@ -913,6 +967,8 @@ future<> sstable::create_data() {
 future<> sstable::load() {
     return read_toc().then([this] {
         return read_statistics();
+    }).then([this] {
+        return read_scylla_metadata();
     }).then([this] {
         return read_compression();
     }).then([this] {
@@ -946,6 +1002,14 @@ void sstable::write_column_name(file_writer& out, const composite& clustering_ke
     }
     uint16_t sz = ck_bview.size() + c.size();
     write(out, sz, ck_bview, c);
+
+    if (_pi_write.block_open) {
+        bytes name(bytes::initialized_later(), sz);
+        auto i = std::copy(ck_bview.begin(), ck_bview.end(), name.begin());
+        auto c_bview = bytes_view(c);
+        std::copy(c_bview.begin(), c_bview.end(), i);
+        record_column_name(name);
+    }
 }
 
 void sstable::write_column_name(file_writer& out, bytes_view column_names) {
@@ -953,6 +1017,65 @@ void sstable::write_column_name(file_writer& out, bytes_view column_names) {
 
     uint16_t sz = column_names.size();
     write(out, sz, column_names);
+
+    if (_pi_write.block_open) {
+        record_column_name(column_names);
+    }
+}
+
+void sstable::record_column_name(bytes_view name) {
+    if (_pi_write.block_first_name.empty()) {
+        _pi_write.block_first_name = bytes(name);
+    }
+    _pi_write.block_last_name = bytes(name);
+}
+
+void sstable::start_promoted_index(uint64_t partition_start, deletion_time del_time) {
+    _pi_write.partition_start = partition_start;
+    _pi_write.del_time = del_time;
+    _pi_write.blocks.clear();
+    _pi_write.block_open = false;
+    _pi_write.open_tombstones.clear();
+}
+
+void sstable::maybe_start_promoted_index_block(file_writer& out, const schema& schema) {
+    if (_pi_write.block_open) {
+        return;
+    }
+    _pi_write.block_open = true;
+    _pi_write.block_start = out.offset();
+    _pi_write.block_first_name = bytes();
+    for (auto&& rt : _pi_write.open_tombstones) {
+        write_range_tombstone(out, composite::from_clustering_element(schema, rt.prefix()), {}, rt.tomb());
+    }
+}
+
+void sstable::maybe_end_promoted_index_block(file_writer& out, bool partition_end) {
+    if (!_pi_write.block_open) {
+        return;
+    }
+    auto width = out.offset() - _pi_write.block_start;
+    if (!partition_end && width < _column_index_size) {
+        return;
+    }
+    _pi_write.blocks.push_back(promoted_index_block{
+        std::move(_pi_write.block_first_name),
+        std::move(_pi_write.block_last_name),
+        _pi_write.block_start - _pi_write.partition_start,
+        width
+    });
+    _pi_write.block_open = false;
+}
+
+// Forgets range tombstones which don't cover given position. Tombstones are
+// written before the rows they cover, so those which remain open always
+// form a chain of prefixes of the current position.
+template <typename Position>
+void sstable::close_open_tombstones(const schema& schema, const Position& pos) {
+    auto& open = _pi_write.open_tombstones;
+    while (!open.empty() && !pos.is_prefixed_by(schema, open.back().prefix())) {
+        open.pop_back();
+    }
 }
 
 
@@ -978,6 +1101,7 @@ void sstable::write_cell(file_writer& out, atomic_cell_view cell) {
         uint32_t deletion_time = cell.deletion_time().time_since_epoch().count();
 
         _c_stats.tombstone_histogram.update(deletion_time);
+        _c_stats.update_max_local_deletion_time(deletion_time);
 
         write(out, mask, timestamp, deletion_time_size, deletion_time);
     } else if (cell.is_live_and_has_ttl()) {
@@ -988,10 +1112,14 @@ void sstable::write_cell(file_writer& out, atomic_cell_view cell) {
         uint32_t expiration = cell.expiry().time_since_epoch().count();
         disk_string_view<uint32_t> cell_value { cell.value() };
 
+        _c_stats.update_max_local_deletion_time(expiration);
+
         write(out, mask, ttl, expiration, timestamp, cell_value);
     } else {
         // regular cell
 
+        _c_stats.update_max_local_deletion_time(std::numeric_limits<int32_t>::max());
+
         column_mask mask = column_mask::none;
         disk_string_view<uint32_t> cell_value { cell.value() };
 
@@ -999,8 +1127,8 @@ void sstable::write_cell(file_writer& out, atomic_cell_view cell) {
     }
 }
 
-void sstable::write_row_marker(file_writer& out, const rows_entry& clustered_row, const composite& clustering_key) {
-    const auto& marker = clustered_row.row().marker();
+void sstable::write_row_marker(file_writer& out, const deletable_row& clustered_row, const composite& clustering_key) {
+    const auto& marker = clustered_row.marker();
     if (marker.is_missing()) {
         return;
     }
@@ -1018,14 +1146,17 @@ void sstable::write_row_marker(file_writer& out, const rows_entry& clustered_row
         uint32_t deletion_time = marker.deletion_time().time_since_epoch().count();
 
         _c_stats.tombstone_histogram.update(deletion_time);
+        _c_stats.update_max_local_deletion_time(deletion_time);
 
         write(out, mask, timestamp, deletion_time_size, deletion_time);
     } else if (marker.is_expiring()) {
         column_mask mask = column_mask::expiration;
         uint32_t ttl = marker.ttl().count();
         uint32_t expiration = marker.expiry().time_since_epoch().count();
+        _c_stats.update_max_local_deletion_time(expiration);
         write(out, mask, ttl, expiration, timestamp, value_length);
     } else {
+        _c_stats.update_max_local_deletion_time(std::numeric_limits<int32_t>::max());
         column_mask mask = column_mask::none;
         write(out, mask, timestamp, value_length);
     }
@@ -1045,6 +1176,7 @@ void sstable::write_range_tombstone(file_writer& out, const composite& clusterin
 
     update_cell_stats(_c_stats, timestamp);
     _c_stats.tombstone_histogram.update(deletion_time);
+    _c_stats.update_max_local_deletion_time(deletion_time);
 
     write(out, deletion_time, timestamp);
 }
@@ -1063,19 +1195,19 @@ void sstable::write_collection(file_writer& out, const composite& clustering_key
 
 // write_datafile_clustered_row() is about writing a clustered_row to data file according to SSTables format.
 // clustered_row contains a set of cells sharing the same clustering key.
-void sstable::write_clustered_row(file_writer& out, const schema& schema, const rows_entry& clustered_row) {
-    auto clustering_key = composite::from_clustering_element(schema, clustered_row.key());
+void sstable::write_clustered_row(file_writer& out, const schema& schema, const ::clustering_key& key, const deletable_row& clustered_row) {
+    auto clustering_key = composite::from_clustering_element(schema, key);
 
     if (schema.is_compound() && !schema.is_dense()) {
         write_row_marker(out, clustered_row, clustering_key);
     }
     // Before writing cells, range tombstone must be written if the row has any (deletable_row::t).
-    if (clustered_row.row().deleted_at()) {
-        write_range_tombstone(out, clustering_key, {}, clustered_row.row().deleted_at());
+    if (clustered_row.deleted_at()) {
+        write_range_tombstone(out, clustering_key, {}, clustered_row.deleted_at());
     }
 
     // Write all cells of a partition's row.
-    clustered_row.row().cells().for_each_cell([&] (column_id id, const atomic_cell_or_collection& c) {
+    clustered_row.cells().for_each_cell([&] (column_id id, const atomic_cell_or_collection& c) {
         auto&& column_definition = schema.regular_column_at(id);
         // non atomic cell isn't supported yet. atomic cell maps to a single trift cell.
         // non atomic cell maps to multiple trift cell, e.g. collection.
@@ -1095,7 +1227,7 @@ void sstable::write_clustered_row(file_writer& out, const schema& schema, const
             }
         } else {
             if (schema.is_dense()) {
-                write_column_name(out, bytes_view(clustered_row.key()));
+                write_column_name(out, bytes_view(key));
             } else {
                 write_column_name(out, bytes_view(column_name));
             }
@@ -1120,11 +1252,30 @@ void sstable::write_static_row(file_writer& out, const schema& schema, const row
     });
 }
 
-static void write_index_entry(file_writer& out, disk_string_view<uint16_t>& key, uint64_t pos) {
-    // FIXME: support promoted indexes.
-    uint32_t promoted_index_size = 0;
+static void write_index_entry(file_writer& out, disk_string_view<uint16_t>& key, uint64_t pos,
+        deletion_time& del_time, std::deque<promoted_index_block>& blocks) {
+    // Like Origin, we only write the promoted index if the partition spans
+    // more than one block. Otherwise reading the whole partition is as cheap.
+    if (blocks.size() < 2) {
+        uint32_t promoted_index_size = 0;
+        write(out, key, pos, promoted_index_size);
+        return;
+    }
 
-    write(out, key, pos, promoted_index_size);
+    uint32_t promoted_index_size = sizeof(deletion_time::local_deletion_time)
+        + sizeof(deletion_time::marked_for_delete_at) + sizeof(uint32_t);
+    for (auto&& b : blocks) {
+        promoted_index_size += 2 * sizeof(uint16_t) + b.first_name.size() + b.last_name.size() + 2 * sizeof(uint64_t);
+    }
+    uint32_t block_count = blocks.size();
+    write(out, key, pos, promoted_index_size, del_time, block_count);
+    for (auto&& b : blocks) {
+        disk_string_view<uint16_t> first_name;
+        first_name.value = bytes_view(b.first_name);
+        disk_string_view<uint16_t> last_name;
+        last_name.value = bytes_view(b.last_name);
+        write(out, first_name, last_name, b.offset, b.width);
+    }
 }
 
 static constexpr int BASE_SAMPLING_LEVEL = 128;
@@ -1224,12 +1375,21 @@ static void seal_statistics(statistics& s, metadata_collector& collector,
     s.hash.map[metadata_type::Stats] = offset;
 }
 
+// With write-behind, serialization and compression of the next buffer
+// overlap with disk writes of the previous ones.
+file_output_stream_options sstable::write_stream_options() const {
+    file_output_stream_options options;
+    options.buffer_size = sstable_buffer_size;
+    options.write_behind = _write_behind;
+    return options;
+}
+
 ///
 ///  @param out holds an output stream to data file.
 ///
-void sstable::do_write_components(::mutation_reader mr,
+void sstable::do_write_components(::streamed_mutation_reader mr,
         uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size, file_writer& out) {
-    auto index = make_shared<file_writer>(_index_file, sstable_buffer_size);
+    auto index = make_shared<file_writer>(_index_file, write_stream_options());
 
     auto filter_fp_chance = schema->bloom_filter_fp_chance();
     _filter = utils::i_filter::get_filter(estimated_partitions, filter_fp_chance);
@@ -1240,80 +1400,154 @@ void sstable::do_write_components(::mutation_reader mr,
 
     // Remember first and last keys, which we need for the summary file.
     std::experimental::optional<key> first_key, last_key;
-
-    // Iterate through CQL partitions, then CQL rows, then CQL columns.
-    // Each mt.all_partitions() entry is a set of clustered rows sharing the same partition key.
-    while (out.offset() < max_sstable_size) {
-        mutation_opt mut = mr().get0();
-        if (!mut) {
-            break;
+    std::experimental::optional<key> partition_key;
+    // The index entry is written after the partition, when its promoted
+    // index is known.
+    uint64_t partition_position = 0;
+
+    // Iterate through partition fragments: the partition header, then the
+    // static row, then range tombstones and CQL rows in clustering order.
+    // The size limit is only checked between partitions, so that a partition
+    // is never split across sstables.
+    //
+    // The next fragment is requested before the current one is written, so
+    // that reading from the source overlaps with waiting for the disk. We
+    // don't read past a partition end, as it may be the last one written.
+    // The read in flight, if any. It is reset once consumed.
+    std::experimental::optional<future<mutation_fragment_opt>> next_fragment = mr();
+
+    // Written bytes are reported to the throttle in batches, to keep its
+    // overhead low.
+    static constexpr uint64_t throttle_granularity = 128*1024;
+    uint64_t throttled = 0;
+    auto maybe_throttle = [&] (bool force) {
+        auto written = out.offset() + index->offset();
+        if (_write_throttle && (force || written - throttled >= throttle_granularity)) {
+            _write_throttle(written - throttled).get();
+            throttled = written;
         }
+    };
 
-        // Set current index of data to later compute row size.
-        _c_stats.start_offset = out.offset();
-
-        auto partition_key = key::from_partition_key(*schema, mut->key());
+    try {
+        while (true) {
+            auto f = std::move(*next_fragment);
+            next_fragment = {};
+            mutation_fragment_opt mf = f.get0();
+            if (!mf) {
+                break;
+            }
+            if (!mf->is_partition_end()) {
+                next_fragment = mr();
+            }
 
-        maybe_add_summary_entry(_summary, bytes_view(partition_key), index->offset());
-        _filter->add(bytes_view(partition_key));
-        _collector.add_key(bytes_view(partition_key));
+            switch (mf->fragment_kind()) {
+            case mutation_fragment::kind::partition_start: {
+                auto& ps = mf->as_partition_start();
 
-        auto p_key = disk_string_view<uint16_t>();
-        p_key.value = bytes_view(partition_key);
+                // Set current index of data to later compute row size.
+                _c_stats.start_offset = out.offset();
 
-        // Write index file entry from partition key into index file.
-        write_index_entry(*index, p_key, out.offset());
+                partition_key = key::from_partition_key(*schema, ps.key()._key);
 
-        // Write partition key into data file.
-        write(out, p_key);
+                maybe_add_summary_entry(_summary, bytes_view(*partition_key), index->offset());
+                _filter->add(bytes_view(*partition_key));
+                _collector.add_key(bytes_view(*partition_key));
 
-        auto tombstone = mut->partition().partition_tombstone();
-        deletion_time d;
+                auto p_key = disk_string_view<uint16_t>();
+                p_key.value = bytes_view(*partition_key);
+                partition_position = out.offset();
 
-        if (tombstone) {
-            d.local_deletion_time = tombstone.deletion_time.time_since_epoch().count();
-            d.marked_for_delete_at = tombstone.timestamp;
+                // Write partition key into data file.
+                write(out, p_key);
 
-            _c_stats.tombstone_histogram.update(d.local_deletion_time);
-            _c_stats.update_max_local_deletion_time(d.local_deletion_time);
-            _c_stats.update_min_timestamp(d.marked_for_delete_at);
-            _c_stats.update_max_timestamp(d.marked_for_delete_at);
-        } else {
-            // Default values for live, undeleted rows.
-            d.local_deletion_time = std::numeric_limits<int32_t>::max();
-            d.marked_for_delete_at = std::numeric_limits<int64_t>::min();
-        }
-        write(out, d);
+                auto tombstone = ps.partition_tombstone();
+                deletion_time d;
 
-        auto& partition = mut->partition();
-        auto& static_row = partition.static_row();
+                if (tombstone) {
+                    d.local_deletion_time = tombstone.deletion_time.time_since_epoch().count();
+                    d.marked_for_delete_at = tombstone.timestamp;
 
-        write_static_row(out, *schema, static_row);
-        for (const auto& rt: partition.row_tombstones()) {
-            auto prefix = composite::from_clustering_element(*schema, rt.prefix());
-            write_range_tombstone(out, prefix, {}, rt.t());
-        }
+                    _c_stats.tombstone_histogram.update(d.local_deletion_time);
+                    _c_stats.update_max_local_deletion_time(d.local_deletion_time);
+                    _c_stats.update_min_timestamp(d.marked_for_delete_at);
+                    _c_stats.update_max_timestamp(d.marked_for_delete_at);
+                } else {
+                    // Default values for live, undeleted rows.
+                    d.local_deletion_time = std::numeric_limits<int32_t>::max();
+                    d.marked_for_delete_at = std::numeric_limits<int64_t>::min();
+                }
+                write(out, d);
+                start_promoted_index(partition_position, d);
+                break;
+            }
+            case mutation_fragment::kind::static_row:
+                maybe_start_promoted_index_block(out, *schema);
+                write_static_row(out, *schema, mf->as_static_row().cells());
+                maybe_end_promoted_index_block(out, false);
+                break;
+            case mutation_fragment::kind::range_tombstone: {
+                auto& rt = mf->as_range_tombstone();
+                close_open_tombstones(*schema, rt.prefix());
+                maybe_start_promoted_index_block(out, *schema);
+                auto prefix = composite::from_clustering_element(*schema, rt.prefix());
+                write_range_tombstone(out, prefix, {}, rt.tomb());
+                _pi_write.open_tombstones.emplace_back(rt.prefix(), rt.tomb());
+                maybe_end_promoted_index_block(out, false);
+                break;
+            }
+            case mutation_fragment::kind::clustering_row: {
+                auto& cr = mf->as_clustering_row();
+                close_open_tombstones(*schema, cr.key());
+                maybe_start_promoted_index_block(out, *schema);
+                write_clustered_row(out, *schema, cr.key(), cr.row());
+                maybe_end_promoted_index_block(out, false);
+                break;
+            }
+            case mutation_fragment::kind::partition_end: {
+                maybe_end_promoted_index_block(out, true);
+
+                // Write index file entry from partition key into index file.
+                auto p_key = disk_string_view<uint16_t>();
+                p_key.value = bytes_view(*partition_key);
+                write_index_entry(*index, p_key, partition_position, _pi_write.del_time, _pi_write.blocks);
+
+                int16_t end_of_row = 0;
+                write(out, end_of_row);
+
+                // compute size of the current row.
+                _c_stats.row_size = out.offset() - _c_stats.start_offset;
+                // update is about merging column_stats with the data being stored by collector.
+                _collector.update(std::move(_c_stats));
+                _c_stats.reset();
+
+                if (!first_key) {
+                    first_key = std::move(partition_key);
+                } else {
+                    last_key = std::move(partition_key);
+                }
+                partition_key = {};
+                break;
+            }
+            }
 
-        // Write all CQL rows from a given mutation partition.
-        for (auto& clustered_row: partition.clustered_rows()) {
-            write_clustered_row(out, *schema, clustered_row);
+            if (mf->is_partition_end()) {
+                maybe_throttle(false);
+                if (out.offset() >= max_sstable_size) {
+                    break;
+                }
+                next_fragment = mr();
+            }
         }
-        int16_t end_of_row = 0;
-        write(out, end_of_row);
-
-        // compute size of the current row.
-        _c_stats.row_size = out.offset() - _c_stats.start_offset;
-        // update is about merging column_stats with the data being stored by collector.
-        _collector.update(std::move(_c_stats));
-        _c_stats.reset();
-
-        if (!first_key) {
-            first_key = std::move(partition_key);
-        } else {
-            last_key = std::move(partition_key);
+    } catch (...) {
+        // The pending read refers to mr, so it must complete before mr is destroyed.
+        if (next_fragment) {
+            try {
+                next_fragment->get();
+            } catch (...) { }
         }
-
+        throw;
     }
+    maybe_throttle(true);
     seal_summary(_summary, std::move(first_key), std::move(last_key), *schema);
 
     index->close().get();
@@ -1328,13 +1562,13 @@ void sstable::do_write_components(::mutation_reader mr,
     seal_statistics(_statistics, _collector, dht::global_partitioner().name(), filter_fp_chance);
 }
 
-void sstable::prepare_write_components(::mutation_reader mr, uint64_t estimated_partitions, schema_ptr schema,
+void sstable::prepare_write_components(::streamed_mutation_reader mr, uint64_t estimated_partitions, schema_ptr schema,
         uint64_t max_sstable_size) {
     // CRC component must only be present when compression isn't enabled.
     bool checksum_file = has_component(sstable::component_type::CRC);
 
     if (checksum_file) {
-        auto w = make_shared<checksummed_file_writer>(_data_file, sstable_buffer_size, checksum_file);
+        auto w = make_shared<checksummed_file_writer>(_data_file, write_stream_options(), checksum_file);
         this->do_write_components(std::move(mr), estimated_partitions, std::move(schema), max_sstable_size, *w);
         w->close().get();
         _data_file = file(); // w->close() closed _data_file
@@ -1343,7 +1577,7 @@ void sstable::prepare_write_components(::mutation_reader mr, uint64_t estimated_
         write_crc(filename(sstable::component_type::CRC), w->finalize_checksum());
     } else {
         prepare_compression(_compression, *schema);
-        auto w = make_shared<file_writer>(make_compressed_file_output_stream(_data_file, &_compression));
+        auto w = make_shared<file_writer>(make_compressed_file_output_stream(_data_file, &_compression, write_stream_options()));
         this->do_write_components(std::move(mr), estimated_partitions, std::move(schema), max_sstable_size, *w);
         w->close().get();
         _data_file = file(); // w->close() closed _data_file
@@ -1360,17 +1594,30 @@ future<> sstable::write_components(const memtable& mt) {
 
 future<> sstable::write_components(::mutation_reader mr,
         uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size) {
+    return write_components(make_fragmenting_reader(std::move(mr)), estimated_partitions, std::move(schema), max_sstable_size);
+}
+
+future<> sstable::write_components(::streamed_mutation_reader mr,
+        uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size) {
     return seastar::async([this, mr = std::move(mr), estimated_partitions, schema = std::move(schema), max_sstable_size] () mutable {
         // FIXME: write all components
         generate_toc(schema->get_compressor_params().get_compressor(), schema->bloom_filter_fp_chance());
         write_toc();
         create_data().get();
         prepare_write_components(std::move(mr), estimated_partitions, std::move(schema), max_sstable_size);
-        write_summary();
-        write_filter();
-        write_statistics();
-        // NOTE: write_compression means maybe_write_compression.
-        write_compression();
+        // The remaining components are independent of each other, so they
+        // are written concurrently.
+        std::vector<std::function<void ()>> writers = {
+            [this] { write_summary(); },
+            [this] { write_filter(); },
+            [this] { write_statistics(); },
+            [this] { write_scylla_metadata(); },
+            // NOTE: write_compression means maybe_write_compression.
+            [this] { write_compression(); },
+        };
+        parallel_for_each(writers, [] (auto& w) {
+            return seastar::async(w);
+        }).get();
         seal_sstable();
     });
 }
@@ -1608,7 +1855,23 @@ int sstable::compare_by_max_timestamp(const sstable& other) const {
     return (ts1 > ts2 ? 1 : (ts1 == ts2 ? 0 : -1));
 }
 
+double sstable::estimate_droppable_tombstone_ratio(gc_clock::time_point gc_before) const {
+    auto& st = get_stats_metadata();
+    auto partitions = st.estimated_column_count.count();
+    if (partitions == 0) {
+        return 0.0f;
+    }
+    double estimated_count = st.estimated_column_count.mean() * partitions;
+    if (estimated_count > 0) {
+        double droppable = st.estimated_tombstone_drop_time.sum(gc_before.time_since_epoch().count());
+        return droppable / estimated_count;
+    }
+    return 0.0f;
+}
+
 sstable::~sstable() {
+    global_cache_tracker().clear(_index_pages);
+
     if (_index_file) {
         _index_file.close().handle_exception([save = _index_file] (auto ep) {
             sstlog.warn("sstable close index_file failed: {}", ep);
@@ -45,8 +45,10 @@
 #include "filter.hh"
 #include "exceptions.hh"
 #include "mutation_reader.hh"
+#include "streamed_mutation.hh"
 #include "query-request.hh"
 #include "key_reader.hh"
+#include "index_page_cache.hh"
 
 namespace sstables {
 
@@ -124,6 +126,7 @@ class sstable {
         Filter,
         Statistics,
         TemporaryTOC,
+        Scylla,
     };
     enum class version_types { ka, la };
     enum class format_types { big };
@@ -193,7 +196,11 @@ class sstable {
         return _generation;
     }
 
-    future<mutation_opt> read_row(schema_ptr schema, const key& k);
+    // Only clustering rows which fall into the slice's row ranges are
+    // included in the returned mutation. The key and the slice must be kept
+    // alive until the returned future resolves.
+    future<mutation_opt> read_row(schema_ptr schema, const key& k,
+            const query::partition_slice& slice = query::full_slice);
     /**
      * @param schema a schema_ptr object describing this table
      * @param min the minimum token we want to search for (inclusive)
@@ -204,8 +211,11 @@ class sstable {
     mutation_reader read_range_rows(schema_ptr schema,
             const dht::token& min, const dht::token& max);
 
-    // Returns a mutation_reader for given range of partitions
-    mutation_reader read_range_rows(schema_ptr schema, const query::partition_range& range);
+    // Returns a mutation_reader for given range of partitions, restricted to
+    // clustering rows selected by the slice. The range and the slice must
+    // be kept alive as long as the reader is used.
+    mutation_reader read_range_rows(schema_ptr schema, const query::partition_range& range,
+            const query::partition_slice& slice = query::full_slice);
 
     // read_rows() returns each of the rows in the sstable, in sequence,
     // converted to a "mutation" data structure.
@@ -220,10 +230,24 @@ class sstable {
     // progress (i.e., returned a future which hasn't completed yet).
     mutation_reader read_rows(schema_ptr schema);
 
+    // Like read_rows() and read_range_rows(), but partitions are returned
+    // piecewise, as mutation fragments, so that reading a wide partition
+    // does not require holding all of it in memory.
+    //
+    // The caller must keep the sstable alive as long as the returned reader
+    // is in use.
+    ::streamed_mutation_reader read_rows_streamed(schema_ptr schema);
+    ::streamed_mutation_reader read_range_rows_streamed(schema_ptr schema, const query::partition_range& range);
+
     // Write sstable components from a memtable.
     future<> write_components(const memtable& mt);
     future<> write_components(::mutation_reader mr,
             uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size);
+    // Like above, but consumes partitions fragment by fragment. When the
+    // data file reaches max_sstable_size, writing stops at the next partition
+    // boundary, leaving the remaining fragments in the reader.
+    future<> write_components(::streamed_mutation_reader mr,
+            uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size);
 
     uint64_t get_estimated_key_count() const {
         return ((uint64_t)_summary.header.size_at_full_sampling + 1) *
@@ -253,6 +277,25 @@ class sstable {
         _shared = false;
     }
 
+    // Sets the approximate size of blocks described by the promoted index of
+    // partitions written to this sstable.
+    void set_column_index_size(size_t size) {
+        _column_index_size = size;
+    }
+
+    // Sets how many buffers of Data.db and Index.db may be written to disk
+    // concurrently while the sstable is being written.
+    void set_write_behind(unsigned write_behind) {
+        _write_behind = write_behind;
+    }
+
+    // Sets a function which is called as data is written to this sstable,
+    // with the number of bytes written since the previous call. Writing
+    // waits for the future it returns, which allows limiting throughput.
+    void set_write_throttle(std::function<future<> (uint64_t)> throttle) {
+        _write_throttle = std::move(throttle);
+    }
+
     uint64_t data_size();
     uint64_t index_size() {
         return _index_file_size;
@@ -282,6 +325,10 @@ class sstable {
     // Return values are those of a trichotomic comparison.
     int compare_by_max_timestamp(const sstable& other) const;
 
+    // Estimated fraction of the cells of this sstable which are tombstones
+    // that may be purged, given their gc_grace_seconds ended by gc_before.
+    double estimate_droppable_tombstone_ratio(gc_clock::time_point gc_before) const;
+
     const sstring get_filename() const {
         return filename(component_type::Data);
     }
@@ -323,11 +370,37 @@ class sstable {
     { }
 
     size_t sstable_buffer_size = 128*1024;
-
-    void do_write_components(::mutation_reader mr,
+    size_t _column_index_size = 64*1024;
+    unsigned _write_behind = 4;
+    std::function<future<> (uint64_t)> _write_throttle;
+
+    // State of the promoted index of the partition being written.
+    struct promoted_index_writer {
+        uint64_t partition_start;
+        deletion_time del_time;
+        std::deque<promoted_index_block> blocks;
+        bool block_open = false;
+        uint64_t block_start;
+        bytes block_first_name;
+        bytes block_last_name;
+        // Range tombstones covering the current write position. They are
+        // repeated at the start of each block, so that reading can start
+        // from any block.
+        std::vector<::range_tombstone> open_tombstones;
+    } _pi_write;
+
+    void start_promoted_index(uint64_t partition_start, deletion_time del_time);
+    void maybe_start_promoted_index_block(file_writer& out, const schema& schema);
+    void maybe_end_promoted_index_block(file_writer& out, bool partition_end);
+    template <typename Position>
+    void close_open_tombstones(const schema& schema, const Position& pos);
+    void record_column_name(bytes_view name);
+
+    void do_write_components(::streamed_mutation_reader mr,
             uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size, file_writer& out);
-    void prepare_write_components(::mutation_reader mr,
+    void prepare_write_components(::streamed_mutation_reader mr,
             uint64_t estimated_partitions, schema_ptr schema, uint64_t max_sstable_size);
+    file_output_stream_options write_stream_options() const;
     static future<> shared_remove_by_toc_name(sstring toc_name, bool shared);
     static std::unordered_map<version_types, sstring, enum_hash<version_types>> _version_string;
     static std::unordered_map<format_types, sstring, enum_hash<format_types>> _format_string;
@@ -341,6 +414,7 @@ class sstable {
     utils::filter_ptr _filter;
     summary _summary;
     statistics _statistics;
+    scylla_metadata _scylla_metadata;
     // NOTE: _collector and _c_stats are used to generation of statistics file
     // when writing a new sstable.
     metadata_collector _collector;
@@ -361,6 +435,10 @@ class sstable {
 
     filter_tracker _filter_tracker;
 
+    // Parsed pages of Index.db, indexed by summary entry. Managed by
+    // global_cache_tracker().
+    cached_index_page::container_type _index_pages;
+
     bool _marked_for_deletion = false;
 
     gc_clock::time_point _now;
@@ -396,9 +474,16 @@ class sstable {
     future<> read_statistics();
     void write_statistics();
 
+    future<> read_scylla_metadata();
+    void write_scylla_metadata();
+
     future<> create_data();
 
+    // Returns the entries of Index.db covered by given summary entry. Pages
+    // are cached, see _index_pages.
     future<index_list> read_indexes(uint64_t summary_idx);
+    future<index_list> read_indexes_from_disk(uint64_t summary_idx);
+    void cache_index_page(uint64_t summary_idx, const index_list& il);
 
     input_stream<char> data_stream_at(uint64_t pos, uint64_t buf_size = 8192);
 
@@ -412,6 +497,17 @@ class sstable {
 
     future<uint64_t> data_end_position(uint64_t summary_idx, uint64_t index_idx, const index_list& il);
 
+    // Like data_consume_rows_at_once(), but the byte range starts and ends
+    // at atom boundaries inside a single partition, as described by its
+    // promoted index. consume_row_start() and consume_row_end() are not
+    // called, unless the range extends to the end of the partition.
+    future<> data_consume_atoms_at_once(row_consumer& consumer, uint64_t pos, uint64_t end);
+
+    // Reads only those blocks of the partition at given position which may
+    // contain its static row or rows within the slice.
+    future<mutation_opt> read_row_blocks(schema_ptr schema, const key& k, const query::partition_slice& slice,
+            uint64_t position, promoted_index pi);
+
     // Returns data file position for an entry right after all entries mapped by given summary page.
     future<uint64_t> data_end_position(uint64_t summary_idx);
 
@@ -437,6 +533,9 @@ class sstable {
     // The ring_position doesn't have to survive deferring.
     future<uint64_t> upper_bound(schema_ptr, const dht::ring_position&);
 
+    // Returns the data file positions delimiting the given range of partitions.
+    std::pair<future<uint64_t>, future<uint64_t>> data_range_positions(schema_ptr, const query::partition_range&);
+
     future<summary_entry&> read_summary_entry(size_t i);
 
     // FIXME: pending on Bloom filter implementation
@@ -444,8 +543,8 @@ class sstable {
     bool filter_has_key(const schema& s, const dht::decorated_key& dk) { return filter_has_key(key::from_partition_key(s, dk._key)); }
 
     // NOTE: functions used to generate sstable components.
-    void write_row_marker(file_writer& out, const rows_entry& clustered_row, const composite& clustering_key);
-    void write_clustered_row(file_writer& out, const schema& schema, const rows_entry& clustered_row);
+    void write_row_marker(file_writer& out, const deletable_row& clustered_row, const composite& clustering_key);
+    void write_clustered_row(file_writer& out, const schema& schema, const clustering_key& key, const deletable_row& clustered_row);
     void write_static_row(file_writer& out, const schema& schema, const row& static_row);
     void write_cell(file_writer& out, atomic_cell_view cell);
     void write_column_name(file_writer& out, const composite& clustering_key, const std::vector<bytes_view>& column_names, composite_marker m = composite_marker::none);
@@ -505,6 +604,15 @@ class sstable {
         return get_stats_metadata().sstable_level;
     }
 
+    // Whether max_local_deletion_time of the stats metadata covers all data
+    // of the sstable. Cassandra writers of the la format do so. Scylla
+    // recorded it only for partition tombstones, until the writer started
+    // marking sstables with sstable_feature::full_max_local_deletion_time.
+    bool has_full_max_local_deletion_time() const {
+        return _version == version_types::la
+            || _scylla_metadata.has_feature(sstable_feature::full_max_local_deletion_time);
+    }
+
     future<> mutate_sstable_level(uint32_t);
 
     // Allow the test cases from sstable_test.cc to test private methods. We use
@@ -75,6 +75,10 @@ class index_entry {
         return _position;
     }
 
+    bytes_view get_promoted_index_bytes() const {
+        return bytes_view(reinterpret_cast<const bytes::value_type *>(_promoted_index.get()), _promoted_index.size());
+    }
+
     index_entry(temporary_buffer<char>&& key, uint64_t position, temporary_buffer<char>&& promoted_index)
         : _key(std::move(key)), _position(position), _promoted_index(std::move(promoted_index)) {}
 
@@ -242,6 +246,29 @@ struct statistics {
     std::unordered_map<metadata_type, std::unique_ptr<metadata>> contents;
 };
 
+// Features of the sstable writer which can't be told from the sstable format
+// version, as they were added by Scylla without changing the format.
+enum class sstable_feature : uint64_t {
+    // max_local_deletion_time in the stats metadata covers cells, row
+    // markers and range tombstones, not only partition tombstones.
+    full_max_local_deletion_time = 0x1,
+};
+
+// Contents of Scylla.db, which Cassandra ignores.
+struct scylla_metadata {
+    uint64_t features = 0;
+
+    template <typename Describer>
+    auto describe_type(Describer f) { return f(features); }
+
+    bool has_feature(sstable_feature f) const {
+        return features & static_cast<uint64_t>(f);
+    }
+    void set_feature(sstable_feature f) {
+        features |= static_cast<uint64_t>(f);
+    }
+};
+
 struct deletion_time {
     int32_t local_deletion_time;
     int64_t marked_for_delete_at;
@@ -259,6 +286,23 @@ struct deletion_time {
     }
 };
 
+// Describes a block of a partition's atoms in the data file. Blocks are
+// stored in the partition's index entry (the "promoted index") so that
+// reads of a slice of a large partition can seek directly to the
+// relevant part of it.
+struct promoted_index_block {
+    bytes first_name;
+    bytes last_name;
+    // Relative to the position of the partition in the data file.
+    uint64_t offset;
+    uint64_t width;
+};
+
+struct promoted_index {
+    deletion_time del_time;
+    std::deque<promoted_index_block> blocks;
+};
+
 enum class column_mask : uint8_t {
     none = 0x0,
     deletion = 0x01,
@@ -0,0 +1,451 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "streamed_mutation.hh"
+#include "core/future-util.hh"
+#include "utils/move.hh"
+
+namespace stdx = std::experimental;
+
+void mutation_fragment::destroy() noexcept {
+    switch (_kind) {
+    case kind::partition_start:
+        _data.partition_start.~partition_start();
+        break;
+    case kind::static_row:
+        _data.static_row.~static_row();
+        break;
+    case kind::clustering_row:
+        _data.clustering_row.~clustering_row();
+        break;
+    case kind::range_tombstone:
+        _data.range_tombstone.~range_tombstone();
+        break;
+    case kind::partition_end:
+        break;
+    }
+}
+
+void mutation_fragment::move_from(mutation_fragment&& o) noexcept {
+    _kind = o._kind;
+    switch (_kind) {
+    case kind::partition_start:
+        new (&_data.partition_start) ::partition_start(std::move(o._data.partition_start));
+        break;
+    case kind::static_row:
+        new (&_data.static_row) ::static_row(std::move(o._data.static_row));
+        break;
+    case kind::clustering_row:
+        new (&_data.clustering_row) ::clustering_row(std::move(o._data.clustering_row));
+        break;
+    case kind::range_tombstone:
+        new (&_data.range_tombstone) ::range_tombstone(std::move(o._data.range_tombstone));
+        break;
+    case kind::partition_end:
+        break;
+    }
+}
+
+void mutation_fragment::apply(const schema& s, mutation_fragment&& other) {
+    assert(_kind == other._kind);
+    switch (_kind) {
+    case kind::partition_start:
+        _data.partition_start.apply(other._data.partition_start.partition_tombstone());
+        break;
+    case kind::static_row:
+        _data.static_row.apply(s, std::move(other._data.static_row));
+        break;
+    case kind::clustering_row:
+        _data.clustering_row.apply(s, std::move(other._data.clustering_row));
+        break;
+    case kind::range_tombstone:
+        _data.range_tombstone.apply(other._data.range_tombstone.tomb());
+        break;
+    case kind::partition_end:
+        break;
+    }
+}
+
+std::ostream& operator<<(std::ostream& os, const mutation_fragment& mf) {
+    switch (mf._kind) {
+    case mutation_fragment::kind::partition_start:
+        return os << "{partition_start: " << mf._data.partition_start.key()
+                  << " " << mf._data.partition_start.partition_tombstone() << "}";
+    case mutation_fragment::kind::static_row:
+        return os << "{static_row: " << mf._data.static_row.cells() << "}";
+    case mutation_fragment::kind::clustering_row:
+        return os << "{clustering_row: " << mf._data.clustering_row.key()
+                  << " " << mf._data.clustering_row.row() << "}";
+    case mutation_fragment::kind::range_tombstone:
+        return os << "{range_tombstone: " << mf._data.range_tombstone.prefix()
+                  << " " << mf._data.range_tombstone.tomb() << "}";
+    case mutation_fragment::kind::partition_end:
+        return os << "{partition_end}";
+    }
+    abort();
+}
+
+int mutation_fragment_less_compare::rank(const mutation_fragment& mf) {
+    switch (mf.fragment_kind()) {
+    case mutation_fragment::kind::partition_start:
+        return 0;
+    case mutation_fragment::kind::static_row:
+        return 1;
+    case mutation_fragment::kind::clustering_row:
+    case mutation_fragment::kind::range_tombstone:
+        return 2;
+    case mutation_fragment::kind::partition_end:
+        return 3;
+    }
+    abort();
+}
+
+bool mutation_fragment_less_compare::operator()(const mutation_fragment& a, const mutation_fragment& b) const {
+    auto ra = rank(a);
+    auto rb = rank(b);
+    if (ra != rb || ra != 2) {
+        return ra < rb;
+    }
+    if (a.is_clustering_row()) {
+        if (b.is_clustering_row()) {
+            return _rows(a.as_clustering_row().key(), b.as_clustering_row().key());
+        }
+        return _mixed(a.as_clustering_row().key(), b.as_range_tombstone().prefix());
+    }
+    if (b.is_clustering_row()) {
+        return _mixed(a.as_range_tombstone().prefix(), b.as_clustering_row().key());
+    }
+    return _prefixes(a.as_range_tombstone().prefix(), b.as_range_tombstone().prefix());
+}
+
+std::deque<mutation_fragment> fragment_mutation(mutation&& m) {
+    std::deque<mutation_fragment> result;
+    auto& p = m.partition();
+    mutation_fragment_less_compare less(*m.schema());
+
+    result.emplace_back(partition_start(m.decorated_key(), p.partition_tombstone()));
+    if (p.static_row().size()) {
+        result.emplace_back(static_row(std::move(p.static_row())));
+    }
+
+    auto& rows = p.clustered_rows();
+    auto& tombstones = p.row_tombstones();
+    auto ri = rows.begin();
+    auto ti = tombstones.begin();
+    while (ri != rows.end() || ti != tombstones.end()) {
+        if (ti != tombstones.end() && (ri == rows.end() || less(ti->prefix(), ri->key()))) {
+            result.emplace_back(range_tombstone(std::move(ti->prefix()), ti->t()));
+            ti = tombstones.erase_and_dispose(ti, current_deleter<row_tombstones_entry>());
+        } else {
+            result.emplace_back(clustering_row(std::move(ri->key()), std::move(ri->row())));
+            ri = rows.erase_and_dispose(ri, current_deleter<rows_entry>());
+        }
+    }
+
+    result.emplace_back(partition_end());
+    return result;
+}
+
+void apply_fragment(mutation& m, mutation_fragment&& mf) {
+    auto& s = *m.schema();
+    switch (mf.fragment_kind()) {
+    case mutation_fragment::kind::static_row:
+        m.partition().static_row().merge(s, column_kind::static_column, std::move(mf.as_static_row().cells()));
+        break;
+    case mutation_fragment::kind::clustering_row: {
+        auto& cr = mf.as_clustering_row();
+        auto& dr = m.partition().clustered_row(cr.key());
+        dr.apply(cr.row().deleted_at());
+        dr.apply(cr.row().marker());
+        dr.cells().merge(s, column_kind::regular_column, std::move(cr.row().cells()));
+        break;
+    }
+    case mutation_fragment::kind::range_tombstone: {
+        auto& rt = mf.as_range_tombstone();
+        m.partition().apply_row_tombstone(s, rt.prefix(), rt.tomb());
+        break;
+    }
+    case mutation_fragment::kind::partition_start:
+    case mutation_fragment::kind::partition_end:
+        throw std::runtime_error(sprint("cannot apply %s to a mutation", mf));
+    }
+}
+
+class fragmenting_reader final : public streamed_mutation_reader::impl {
+    mutation_reader _reader;
+    std::deque<mutation_fragment> _buffer;
+private:
+    mutation_fragment_opt pop() {
+        auto mf = std::move(_buffer.front());
+        _buffer.pop_front();
+        return mutation_fragment_opt(std::move(mf));
+    }
+public:
+    fragmenting_reader(mutation_reader reader)
+        : _reader(std::move(reader))
+    { }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (!_buffer.empty()) {
+            return make_ready_future<mutation_fragment_opt>(pop());
+        }
+        return _reader().then([this] (mutation_opt&& mo) {
+            if (!mo) {
+                return mutation_fragment_opt();
+            }
+            _buffer = fragment_mutation(std::move(*mo));
+            return pop();
+        });
+    }
+};
+
+streamed_mutation_reader make_fragmenting_reader(mutation_reader rd) {
+    return make_streamed_mutation_reader<fragmenting_reader>(std::move(rd));
+}
+
+class defragmenting_reader final : public mutation_reader::impl {
+    schema_ptr _schema;
+    streamed_mutation_reader _reader;
+    mutation_opt _current;
+    mutation_opt _result;
+public:
+    defragmenting_reader(schema_ptr s, streamed_mutation_reader reader)
+        : _schema(std::move(s))
+        , _reader(std::move(reader))
+    { }
+
+    virtual future<mutation_opt> operator()() override {
+        return repeat([this] {
+            return _reader().then([this] (mutation_fragment_opt&& mfo) {
+                if (!mfo) {
+                    if (_current) {
+                        throw std::runtime_error("fragment stream ended in the middle of a partition");
+                    }
+                    return stop_iteration::yes;
+                }
+                switch (mfo->fragment_kind()) {
+                case mutation_fragment::kind::partition_start: {
+                    auto& ps = mfo->as_partition_start();
+                    _current = mutation(std::move(ps.key()), _schema);
+                    _current->partition().apply(ps.partition_tombstone());
+                    return stop_iteration::no;
+                }
+                case mutation_fragment::kind::partition_end:
+                    _result = move_and_disengage(_current);
+                    return stop_iteration::yes;
+                default:
+                    apply_fragment(*_current, std::move(*mfo));
+                    return stop_iteration::no;
+                }
+            });
+        }).then([this] {
+            return move_and_disengage(_result);
+        });
+    }
+};
+
+mutation_reader make_defragmenting_reader(schema_ptr s, streamed_mutation_reader rd) {
+    return make_mutation_reader<defragmenting_reader>(std::move(s), std::move(rd));
+}
+
+// Merges fragment streams. Unlike combined_reader, which keeps a heap of
+// whole mutations, this keeps only the next fragment of each input, so
+// memory usage does not depend on partition size.
+class combined_streamed_reader final : public streamed_mutation_reader::impl {
+    struct source {
+        streamed_mutation_reader reader;
+        mutation_fragment_opt head;
+        bool exhausted = false;
+
+        source(streamed_mutation_reader rd) : reader(std::move(rd)) { }
+    };
+    schema_ptr _schema;
+    mutation_fragment_less_compare _less;
+    std::vector<source> _sources;
+    std::vector<source*> _all;
+    // Sources contributing to the partition which is being emitted.
+    std::vector<source*> _current;
+    bool _in_partition = false;
+private:
+    future<> fill(std::vector<source*>& sources) {
+        return parallel_for_each(sources, [] (source* src) {
+            if (src->head || src->exhausted) {
+                return make_ready_future<>();
+            }
+            return src->reader().then([src] (mutation_fragment_opt&& mfo) {
+                if (mfo) {
+                    src->head = std::move(mfo);
+                } else {
+                    src->exhausted = true;
+                }
+            });
+        });
+    }
+
+    mutation_fragment_opt start_partition() {
+        source* min = nullptr;
+        for (auto src : _all) {
+            if (src->head && (!min || src->head->as_partition_start().key().less_compare(*_schema,
+                    min->head->as_partition_start().key()))) {
+                min = src;
+            }
+        }
+        if (!min) {
+            return {};
+        }
+        _current.clear();
+        for (auto src : _all) {
+            if (src->head && src->head->as_partition_start().key().equal(*_schema,
+                    min->head->as_partition_start().key())) {
+                _current.push_back(src);
+            }
+        }
+        _in_partition = true;
+        return merge_current_heads([] (source*) { return true; });
+    }
+
+    mutation_fragment_opt next_in_partition() {
+        source* min = nullptr;
+        for (auto src : _current) {
+            if (!src->head) {
+                throw std::runtime_error("fragment stream ended in the middle of a partition");
+            }
+            if (!min || _less(*src->head, *min->head)) {
+                min = src;
+            }
+        }
+        if (min->head->is_partition_end()) {
+            // partition_end sorts last, so all sources are done with this partition.
+            _in_partition = false;
+        }
+        return merge_current_heads([this, min] (source* src) {
+            return src == min || !_less(*min->head, *src->head);
+        });
+    }
+
+    template <typename Predicate>
+    mutation_fragment_opt merge_current_heads(Predicate&& at_min) {
+        std::vector<source*> selected;
+        for (auto src : _current) {
+            if (at_min(src)) {
+                selected.push_back(src);
+            }
+        }
+        auto result = move_and_disengage(selected.front()->head);
+        for (auto it = std::next(selected.begin()); it != selected.end(); ++it) {
+            result->apply(*_schema, std::move(*(*it)->head));
+            (*it)->head = {};
+        }
+        return result;
+    }
+public:
+    combined_streamed_reader(schema_ptr s, std::vector<streamed_mutation_reader> readers)
+        : _schema(std::move(s))
+        , _less(*_schema)
+    {
+        _sources.reserve(readers.size());
+        for (auto&& rd : readers) {
+            _sources.emplace_back(std::move(rd));
+        }
+        for (auto&& src : _sources) {
+            _all.push_back(&src);
+        }
+    }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (!_in_partition) {
+            return fill(_all).then([this] {
+                return start_partition();
+            });
+        }
+        return fill(_current).then([this] {
+            return next_in_partition();
+        });
+    }
+};
+
+streamed_mutation_reader make_combined_reader(schema_ptr s, std::vector<streamed_mutation_reader> readers) {
+    return make_streamed_mutation_reader<combined_streamed_reader>(std::move(s), std::move(readers));
+}
+
+class joining_streamed_reader final : public streamed_mutation_reader::impl {
+    std::vector<streamed_mutation_reader> _readers;
+    std::vector<streamed_mutation_reader>::iterator _current;
+public:
+    joining_streamed_reader(std::vector<streamed_mutation_reader> readers)
+        : _readers(std::move(readers))
+        , _current(_readers.begin())
+    { }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        if (_current == _readers.end()) {
+            return make_ready_future<mutation_fragment_opt>();
+        }
+        return (*_current)().then([this] (mutation_fragment_opt&& mfo) {
+            if (!mfo) {
+                ++_current;
+                return operator()();
+            }
+            return make_ready_future<mutation_fragment_opt>(std::move(mfo));
+        });
+    }
+};
+
+streamed_mutation_reader make_joining_reader(std::vector<streamed_mutation_reader> readers) {
+    return make_streamed_mutation_reader<joining_streamed_reader>(std::move(readers));
+}
+
+class filtering_streamed_reader final : public streamed_mutation_reader::impl {
+    streamed_mutation_reader _reader;
+    std::function<bool (const dht::decorated_key&)> _filter;
+    bool _skipping = false;
+    mutation_fragment_opt _result;
+public:
+    filtering_streamed_reader(streamed_mutation_reader reader, std::function<bool (const dht::decorated_key&)> filter)
+        : _reader(std::move(reader))
+        , _filter(std::move(filter))
+    { }
+
+    virtual future<mutation_fragment_opt> operator()() override {
+        return repeat([this] {
+            return _reader().then([this] (mutation_fragment_opt&& mfo) {
+                if (!mfo) {
+                    return stop_iteration::yes;
+                }
+                if (mfo->is_partition_start()) {
+                    _skipping = !_filter(mfo->as_partition_start().key());
+                }
+                if (_skipping) {
+                    _skipping = !mfo->is_partition_end();
+                    return stop_iteration::no;
+                }
+                _result = std::move(mfo);
+                return stop_iteration::yes;
+            });
+        }).then([this] {
+            return move_and_disengage(_result);
+        });
+    }
+};
+
+streamed_mutation_reader make_filtering_reader(streamed_mutation_reader rd, std::function<bool (const dht::decorated_key&)> filter) {
+    return make_streamed_mutation_reader<filtering_streamed_reader>(std::move(rd), std::move(filter));
+}
@@ -0,0 +1,287 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <deque>
+#include <vector>
+
+#include "mutation.hh"
+#include "mutation_reader.hh"
+#include "core/future.hh"
+#include "core/future-util.hh"
+#include "core/do_with.hh"
+
+// Fragments of a partition, as produced by a streamed_mutation_reader.
+//
+// A partition is represented by a partition_start fragment, followed by an
+// optional static_row, followed by range_tombstone and clustering_row
+// fragments in clustering order, and terminated by a partition_end fragment.
+// A range_tombstone is emitted before any clustering_row it covers.
+
+class partition_start {
+    dht::decorated_key _key;
+    tombstone _partition_tombstone;
+public:
+    partition_start(dht::decorated_key key, tombstone partition_tombstone)
+        : _key(std::move(key))
+        , _partition_tombstone(partition_tombstone)
+    { }
+    const dht::decorated_key& key() const { return _key; }
+    dht::decorated_key& key() { return _key; }
+    tombstone partition_tombstone() const { return _partition_tombstone; }
+    void apply(tombstone t) { _partition_tombstone.apply(t); }
+    void set_partition_tombstone(tombstone t) { _partition_tombstone = t; }
+};
+
+class static_row {
+    row _cells;
+public:
+    static_row() = default;
+    explicit static_row(row&& cells) : _cells(std::move(cells)) { }
+    const row& cells() const { return _cells; }
+    row& cells() { return _cells; }
+    bool empty() const { return !_cells.size(); }
+    void apply(const schema& s, static_row&& other) {
+        _cells.merge(s, column_kind::static_column, std::move(other._cells));
+    }
+};
+
+class clustering_row {
+    clustering_key _key;
+    deletable_row _row;
+public:
+    clustering_row(clustering_key key, deletable_row&& row)
+        : _key(std::move(key))
+        , _row(std::move(row))
+    { }
+    const clustering_key& key() const { return _key; }
+    const deletable_row& row() const { return _row; }
+    deletable_row& row() { return _row; }
+    bool empty() const { return _row.empty(); }
+    void apply(const schema& s, clustering_row&& other) {
+        _row.apply(other._row.deleted_at());
+        _row.apply(other._row.marker());
+        _row.cells().merge(s, column_kind::regular_column, std::move(other._row.cells()));
+    }
+};
+
+// Deletion of all rows whose clustering key starts with the given prefix.
+// Like mutation_partition::row_tombstones(), the prefix is always strict.
+class range_tombstone {
+    clustering_key_prefix _prefix;
+    tombstone _tomb;
+public:
+    range_tombstone(clustering_key_prefix prefix, tombstone t)
+        : _prefix(std::move(prefix))
+        , _tomb(t)
+    { }
+    const clustering_key_prefix& prefix() const { return _prefix; }
+    tombstone tomb() const { return _tomb; }
+    void apply(tombstone t) { _tomb.apply(t); }
+};
+
+class partition_end { };
+
+class mutation_fragment final {
+public:
+    enum class kind {
+        partition_start,
+        static_row,
+        clustering_row,
+        range_tombstone,
+        partition_end,
+    };
+private:
+    kind _kind;
+    union data {
+        data() { }
+        ~data() { }
+        ::partition_start partition_start;
+        ::static_row static_row;
+        ::clustering_row clustering_row;
+        ::range_tombstone range_tombstone;
+    } _data;
+private:
+    void destroy() noexcept;
+    void move_from(mutation_fragment&& o) noexcept;
+public:
+    mutation_fragment(::partition_start&& ps) : _kind(kind::partition_start) {
+        new (&_data.partition_start) ::partition_start(std::move(ps));
+    }
+    mutation_fragment(::static_row&& sr) : _kind(kind::static_row) {
+        new (&_data.static_row) ::static_row(std::move(sr));
+    }
+    mutation_fragment(::clustering_row&& cr) : _kind(kind::clustering_row) {
+        new (&_data.clustering_row) ::clustering_row(std::move(cr));
+    }
+    mutation_fragment(::range_tombstone&& rt) : _kind(kind::range_tombstone) {
+        new (&_data.range_tombstone) ::range_tombstone(std::move(rt));
+    }
+    mutation_fragment(partition_end) : _kind(kind::partition_end) { }
+    mutation_fragment(mutation_fragment&& o) noexcept {
+        move_from(std::move(o));
+    }
+    mutation_fragment& operator=(mutation_fragment&& o) noexcept {
+        if (this != &o) {
+            destroy();
+            move_from(std::move(o));
+        }
+        return *this;
+    }
+    mutation_fragment(const mutation_fragment&) = delete;
+    mutation_fragment& operator=(const mutation_fragment&) = delete;
+    ~mutation_fragment() {
+        destroy();
+    }
+
+    kind fragment_kind() const { return _kind; }
+    bool is_partition_start() const { return _kind == kind::partition_start; }
+    bool is_static_row() const { return _kind == kind::static_row; }
+    bool is_clustering_row() const { return _kind == kind::clustering_row; }
+    bool is_range_tombstone() const { return _kind == kind::range_tombstone; }
+    bool is_partition_end() const { return _kind == kind::partition_end; }
+
+    ::partition_start& as_partition_start() { assert(is_partition_start()); return _data.partition_start; }
+    const ::partition_start& as_partition_start() const { assert(is_partition_start()); return _data.partition_start; }
+    ::static_row& as_static_row() { assert(is_static_row()); return _data.static_row; }
+    const ::static_row& as_static_row() const { assert(is_static_row()); return _data.static_row; }
+    ::clustering_row& as_clustering_row() { assert(is_clustering_row()); return _data.clustering_row; }
+    const ::clustering_row& as_clustering_row() const { assert(is_clustering_row()); return _data.clustering_row; }
+    ::range_tombstone& as_range_tombstone() { assert(is_range_tombstone()); return _data.range_tombstone; }
+    const ::range_tombstone& as_range_tombstone() const { assert(is_range_tombstone()); return _data.range_tombstone; }
+
+    // Merges other into this fragment. Both must be of the same kind and at
+    // the same position (see mutation_fragment_less_compare).
+    void apply(const schema& s, mutation_fragment&& other);
+
+    friend std::ostream& operator<<(std::ostream&, const mutation_fragment&);
+};
+
+using mutation_fragment_opt = std::experimental::optional<mutation_fragment>;
+
+// Orders fragments of a single partition. Clustering rows and range
+// tombstones are compared lexicographically on their clustering prefixes,
+// which places a range tombstone before all the rows it covers.
+class mutation_fragment_less_compare {
+    clustering_key::less_compare _rows;
+    clustering_key_prefix::less_compare _prefixes;
+    clustering_key::less_compare_with_prefix _mixed;
+    static int rank(const mutation_fragment& mf);
+public:
+    explicit mutation_fragment_less_compare(const schema& s)
+        : _rows(s), _prefixes(s), _mixed(s)
+    { }
+    bool operator()(const clustering_key& a, const clustering_key& b) const { return _rows(a, b); }
+    bool operator()(const clustering_key_prefix& a, const clustering_key_prefix& b) const { return _prefixes(a, b); }
+    bool operator()(const clustering_key& a, const clustering_key_prefix& b) const { return _mixed(a, b); }
+    bool operator()(const clustering_key_prefix& a, const clustering_key& b) const { return _mixed(a, b); }
+    bool operator()(const mutation_fragment& a, const mutation_fragment& b) const;
+};
+
+// Moves contents of the mutation into a sequence of fragments, starting
+// with partition_start and ending with partition_end.
+std::deque<mutation_fragment> fragment_mutation(mutation&& m);
+
+// Applies a fragment which is not partition_start nor partition_end to the
+// mutation it belongs to.
+void apply_fragment(mutation& m, mutation_fragment&& mf);
+
+// A streamed_mutation_reader is like a mutation_reader, but instead of
+// materializing whole partitions it returns them piecewise, as a stream of
+// mutation_fragments. An unset optional marks the end of the stream, which
+// may only happen at partition boundary.
+//
+// Partitions have strictly monotonically increasing keys. After calling
+// streamed_mutation_reader's operator(), caller must keep the object alive
+// until the returned future is fulfilled.
+class streamed_mutation_reader final {
+public:
+    class impl {
+    public:
+        virtual ~impl() {}
+        virtual future<mutation_fragment_opt> operator()() = 0;
+    };
+private:
+    class null_impl final : public impl {
+    public:
+        virtual future<mutation_fragment_opt> operator()() override { throw std::bad_function_call(); }
+    };
+private:
+    std::unique_ptr<impl> _impl;
+public:
+    streamed_mutation_reader(std::unique_ptr<impl> impl) noexcept : _impl(std::move(impl)) {}
+    streamed_mutation_reader() : streamed_mutation_reader(std::make_unique<null_impl>()) {}
+    streamed_mutation_reader(streamed_mutation_reader&&) = default;
+    streamed_mutation_reader(const streamed_mutation_reader&) = delete;
+    streamed_mutation_reader& operator=(streamed_mutation_reader&&) = default;
+    streamed_mutation_reader& operator=(const streamed_mutation_reader&) = delete;
+    future<mutation_fragment_opt> operator()() { return _impl->operator()(); }
+};
+
+// Impl: derived from streamed_mutation_reader::impl; Args/args: arguments for Impl's constructor
+template <typename Impl, typename... Args>
+inline
+streamed_mutation_reader
+make_streamed_mutation_reader(Args&&... args) {
+    return streamed_mutation_reader(std::make_unique<Impl>(std::forward<Args>(args)...));
+}
+
+// Splits mutations returned by the reader into fragments. The reader is
+// advanced only after all fragments of the previous mutation were consumed.
+streamed_mutation_reader make_fragmenting_reader(mutation_reader rd);
+
+// Assembles fragments back into whole partitions.
+mutation_reader make_defragmenting_reader(schema_ptr s, streamed_mutation_reader rd);
+
+// Merges fragment streams into one, combining partitions and rows which
+// appear in more than one of the input streams.
+streamed_mutation_reader make_combined_reader(schema_ptr s, std::vector<streamed_mutation_reader> readers);
+
+// Returns the fragments of each reader in turn. The readers have to cover
+// disjoint, increasing ranges of partitions.
+streamed_mutation_reader make_joining_reader(std::vector<streamed_mutation_reader> readers);
+
+// Skips all fragments of partitions whose key the filter rejects.
+streamed_mutation_reader make_filtering_reader(streamed_mutation_reader rd, std::function<bool (const dht::decorated_key&)> filter);
+
+// Calls the consumer for each fragment of the reader's stream until end of
+// stream is reached or the consumer requests iteration to stop by returning
+// stop_iteration::yes. The consumer should accept mutation_fragment as the
+// argument and return stop_iteration. The returned future<> resolves when
+// consumption ends.
+template <typename Consumer>
+inline
+future<> consume(streamed_mutation_reader& reader, Consumer consumer) {
+    static_assert(std::is_same<future<stop_iteration>, futurize_t<std::result_of_t<Consumer(mutation_fragment&&)>>>::value, "bad Consumer signature");
+    using futurator = futurize<std::result_of_t<Consumer(mutation_fragment&&)>>;
+
+    return do_with(std::move(consumer), [&reader] (Consumer& c) -> future<> {
+        return repeat([&reader, &c] () {
+            return reader().then([&c] (mutation_fragment_opt&& mfo) -> future<stop_iteration> {
+                if (!mfo) {
+                    return make_ready_future<stop_iteration>(stop_iteration::yes);
+                }
+                return futurator::apply(c, std::move(*mfo));
+            });
+        });
+    });
+}
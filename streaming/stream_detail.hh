@@ -39,7 +39,8 @@
 #pragma once
 
 #include "query-request.hh"
-#include "mutation_reader.hh"
+#include "streamed_mutation.hh"
+#include "schema.hh"
 #include "utils/UUID.hh"
 #include <vector>
 
@@ -48,12 +49,14 @@ namespace streaming {
 struct stream_detail {
     using UUID = utils::UUID;
     UUID cf_id;
-    lw_shared_ptr<mutation_reader> mr;
+    schema_ptr s;
+    lw_shared_ptr<streamed_mutation_reader> mr;
     int64_t estimated_keys;
     int64_t repaired_at;
     stream_detail() = default;
-    stream_detail(UUID cf_id_, mutation_reader mr_, long estimated_keys_, long repaired_at_)
+    stream_detail(UUID cf_id_, schema_ptr s_, streamed_mutation_reader mr_, long estimated_keys_, long repaired_at_)
         : cf_id(std::move(cf_id_))
+        , s(std::move(s_))
         , mr(make_lw_shared(std::move(mr_)))
         , estimated_keys(estimated_keys_)
         , repaired_at(repaired_at_) {
@@ -42,7 +42,7 @@
 #include "streaming/stream_session.hh"
 #include "streaming/stream_manager.hh"
 #include "streaming/messages/outgoing_file_message.hh"
-#include "mutation_reader.hh"
+#include "streamed_mutation.hh"
 #include "frozen_mutation.hh"
 #include "mutation.hh"
 #include "message/messaging_service.hh"
@@ -66,6 +66,10 @@ void stream_transfer_task::add_transfer_file(stream_detail detail) {
     total_size += size;
 }
 
+// Partitions are sent in pieces of at most this many rows, so that a wide
+// partition never has to be held in memory, or frozen, as a whole.
+static constexpr size_t max_fragments_per_stream_mutation = 128;
+
 void stream_transfer_task::start() {
     using shard_id = net::messaging_service::shard_id;
     using net::messaging_verb;
@@ -76,10 +80,10 @@ void stream_transfer_task::start() {
         auto id = shard_id{session->peer, session->dst_cpu_id};
         sslog.debug("stream_transfer_task: Sending outgoing_file_message seq={} msg.detail.cf_id={}", seq, msg.detail.cf_id);
         it++;
-        consume(*msg.detail.mr, [&msg, this, seq, id] (mutation&& m) {
+        auto send = [&msg, this, id] (mutation&& m) {
             msg.mutations_nr++;
             auto fm = make_lw_shared<const frozen_mutation>(m);
-            return get_local_stream_manager().mutation_send_limiter().wait().then([&msg, this, fm, seq, id] {
+            return get_local_stream_manager().mutation_send_limiter().wait().then([&msg, this, fm, id] {
                 sslog.debug("SEND STREAM_MUTATION to {}, cf_id={}", id, fm->column_family_id());
                 session->ms().send_stream_mutation(id, session->plan_id(), *fm, session->dst_cpu_id).then_wrapped([&msg, this, id, fm] (auto&& f) {
                     try {
@@ -93,7 +97,40 @@ void stream_transfer_task::start() {
                 }).finally([] {
                     get_local_stream_manager().mutation_send_limiter().signal();
                 });
-                return stop_iteration::no;
+            });
+        };
+        struct partial_partition {
+            mutation_opt m;
+            size_t fragments = 0;
+        };
+        do_with(partial_partition(), [&msg, send] (partial_partition& pp) {
+            return consume(*msg.detail.mr, [&msg, &pp, send] (mutation_fragment&& mf) -> future<stop_iteration> {
+                switch (mf.fragment_kind()) {
+                case mutation_fragment::kind::partition_start: {
+                    auto& ps = mf.as_partition_start();
+                    pp.m = mutation(std::move(ps.key()), msg.detail.s);
+                    pp.m->partition().apply(ps.partition_tombstone());
+                    pp.fragments = 0;
+                    return make_ready_future<stop_iteration>(stop_iteration::no);
+                }
+                case mutation_fragment::kind::partition_end: {
+                    auto m = std::move(*pp.m);
+                    pp.m = {};
+                    return send(std::move(m)).then([] { return stop_iteration::no; });
+                }
+                default:
+                    apply_fragment(*pp.m, std::move(mf));
+                    if (++pp.fragments < max_fragments_per_stream_mutation) {
+                        return make_ready_future<stop_iteration>(stop_iteration::no);
+                    }
+                    // Send what we have so far and continue with the rest
+                    // of the partition. Mutations commute, so the receiver
+                    // ends up with the whole partition.
+                    auto m = std::move(*pp.m);
+                    pp.m = mutation(m.decorated_key(), msg.detail.s);
+                    pp.fragments = 0;
+                    return send(std::move(m)).then([] { return stop_iteration::no; });
+                }
             });
         }).then([&msg] {
             return msg.mutations_done.wait(msg.mutations_nr);
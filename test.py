@@ -33,6 +33,7 @@ boost_tests = [
     'mutation_test',
     'range_test',
     'mutation_reader_test',
+    'streamed_mutation_test',
     'cql_query_test',
     'storage_proxy_test',
     'sstable_test',
@@ -49,13 +50,18 @@ boost_tests = [
     'partitioner_test',
     'frozen_mutation_test',
     'gossiping_property_file_snitch_test',
+    'dynamic_snitch_test',
+    'speculative_retry_test',
     'row_cache_test',
     'network_topology_strategy_test',
     'query_processor_test',
     'batchlog_manager_test',
     'logalloc_test',
     'crc_test',
+    'cql_compression_test',
     'flush_queue_test',
+    'write_admission_controller_test',
+    'token_bucket_test',
 ]
 
 other_tests = [
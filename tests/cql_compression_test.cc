@@ -0,0 +1,113 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+#define BOOST_TEST_MODULE core
+
+#include <boost/test/unit_test.hpp>
+#include "transport/compression.hh"
+#include "exceptions/exceptions.hh"
+#include "core/print.hh"
+
+using namespace transport;
+
+static std::vector<char> make_body(unsigned rows) {
+    std::vector<char> body;
+    for (unsigned i = 0; i < rows; ++i) {
+        auto row = sprint("key%08d:value%04d;", i, i % 100);
+        body.insert(body.end(), row.begin(), row.end());
+    }
+    return body;
+}
+
+static temporary_buffer<char> compress(cql_compression c, const std::vector<char>& body) {
+    std::vector<char> out;
+    auto len = compress_body(c, body.data(), body.size(), out);
+    return temporary_buffer<char>(out.data(), len);
+}
+
+static void check_round_trip(cql_compression c, const std::vector<char>& body) {
+    auto compressed = compress(c, body);
+    auto uncompressed = uncompress_body(c, compressed);
+    BOOST_REQUIRE_EQUAL(uncompressed.size(), body.size());
+    BOOST_REQUIRE(std::equal(body.begin(), body.end(), uncompressed.get()));
+}
+
+BOOST_AUTO_TEST_CASE(test_parse_compression) {
+    BOOST_REQUIRE(parse_compression("lz4") == cql_compression::lz4);
+    BOOST_REQUIRE(parse_compression("snappy") == cql_compression::snappy);
+    BOOST_REQUIRE_THROW(parse_compression("deflate"), exceptions::protocol_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_round_trip) {
+    for (auto c : { cql_compression::lz4, cql_compression::snappy }) {
+        check_round_trip(c, {});
+        check_round_trip(c, make_body(1));
+        check_round_trip(c, make_body(10000));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_uncompress_without_negotiated_compression) {
+    auto compressed = compress(cql_compression::lz4, make_body(10));
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::none, compressed), exceptions::protocol_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_truncated_frame) {
+    for (auto c : { cql_compression::lz4, cql_compression::snappy }) {
+        auto compressed = compress(c, make_body(1000));
+        for (auto len : { size_t(0), size_t(1), size_t(3), compressed.size() / 2, compressed.size() - 1 }) {
+            BOOST_REQUIRE_THROW(uncompress_body(c, compressed.share(0, len)), exceptions::protocol_exception);
+        }
+    }
+}
+
+BOOST_AUTO_TEST_CASE(test_corrupt_lz4_frame) {
+    auto compressed = compress(cql_compression::lz4, make_body(1000));
+
+    // A length prefix larger than the allowed frame size
+    auto too_large = compressed.clone();
+    too_large.get_write()[0] = 0x7f;
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::lz4, too_large), exceptions::protocol_exception);
+
+    // A length prefix which does not match the compressed data
+    auto wrong_length = compressed.clone();
+    wrong_length.get_write()[3] ^= 0x01;
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::lz4, wrong_length), exceptions::protocol_exception);
+
+    // Garbage instead of compressed data
+    auto garbage = compressed.clone();
+    std::fill(garbage.get_write() + 4, garbage.get_write() + garbage.size(), char(0xff));
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::lz4, garbage), exceptions::protocol_exception);
+}
+
+BOOST_AUTO_TEST_CASE(test_corrupt_snappy_frame) {
+    auto compressed = compress(cql_compression::snappy, make_body(1000));
+
+    // An uncompressed length varint which never ends
+    auto bad_length = compressed.clone();
+    std::fill(bad_length.get_write(), bad_length.get_write() + 8, char(0xff));
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::snappy, bad_length), exceptions::protocol_exception);
+
+    // Garbage after a valid length
+    auto garbage = compressed.clone();
+    std::fill(garbage.get_write() + 3, garbage.get_write() + garbage.size(), char(0xff));
+    BOOST_REQUIRE_THROW(uncompress_body(cql_compression::snappy, garbage), exceptions::protocol_exception);
+}
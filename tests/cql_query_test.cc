@@ -35,6 +35,7 @@
 #include "core/sleep.hh"
 #include "transport/messages/result_message.hh"
 #include "utils/big_decimal.hh"
+#include "database.hh"
 
 using namespace std::literals::chrono_literals;
 
@@ -460,6 +461,24 @@ SEASTAR_TEST_CASE(test_limit_is_respected_across_partitions) {
     });
 }
 
+SEASTAR_TEST_CASE(test_estimated_partitions) {
+    return do_with_cql_env([] (auto& e) {
+        return e.execute_cql("create table cf (k int, c int, v int, primary key (k, c));").discard_result().then([&e] {
+            return parallel_for_each(boost::irange(0, 10), [&e] (int k) {
+                return e.execute_cql(sprint("insert into cf (k, c, v) values (%d, 0, 0);", k)).discard_result();
+            });
+        }).then([&e] {
+            return e.db().map_reduce0([] (database& db) {
+                auto& cf = db.find_column_family("ks", "cf");
+                BOOST_REQUIRE_EQUAL(cf.estimated_rows_per_partition(), 1.0);
+                return cf.estimated_partitions();
+            }, uint64_t(0), std::plus<uint64_t>());
+        }).then([] (uint64_t partitions) {
+            BOOST_REQUIRE_EQUAL(partitions, 10u);
+        });
+    });
+}
+
 SEASTAR_TEST_CASE(test_partitions_have_consistent_ordering_in_range_query) {
     return do_with_cql_env([] (auto& e) {
         return e.execute_cql("create table cf (k blob, v int, primary key (k));").discard_result().then([&e] {
@@ -902,6 +921,33 @@ SEASTAR_TEST_CASE(test_list_insert_update) {
     });
 }
 
+SEASTAR_TEST_CASE(test_list_update_with_several_collections) {
+    return do_with_cql_env([] (auto& e) {
+        return e.execute_cql("create table cf (p1 varchar primary key, list1 list<int>, list2 list<int>, set1 set<int>);").discard_result().then([&e] {
+            return e.execute_cql("insert into cf (p1, list1, list2, set1) values ('key1', [ 1, 2, 3 ], [ 4, 5 ], { 6 });").discard_result();
+        }).then([&e] {
+            return e.execute_cql("update cf set list2[1] = 7 where p1 = 'key1';").discard_result();
+        }).then([&e] {
+            return e.require_column_has_value("cf", {sstring("key1")}, {},
+                    "list2", list_type_impl::native_type({boost::any(4), boost::any(7)}));
+        }).then([&e] {
+            return e.require_column_has_value("cf", {sstring("key1")}, {},
+                    "list1", list_type_impl::native_type({boost::any(1), boost::any(2), boost::any(3)}));
+        }).then([&e] {
+            return e.execute_cql("update cf set list1 = list1 - [ 2 ], list2[0] = 8, set1 = set1 + { 10 } where p1 = 'key1';").discard_result();
+        }).then([&e] {
+            return e.require_column_has_value("cf", {sstring("key1")}, {},
+                    "list1", list_type_impl::native_type({boost::any(1), boost::any(3)}));
+        }).then([&e] {
+            return e.require_column_has_value("cf", {sstring("key1")}, {},
+                    "list2", list_type_impl::native_type({boost::any(8), boost::any(7)}));
+        }).then([&e] {
+            return e.require_column_has_value("cf", {sstring("key1")}, {},
+                    "set1", set_type_impl::native_type({6, 10}));
+        });
+    });
+}
+
 SEASTAR_TEST_CASE(test_functions) {
     return do_with_cql_env([] (auto&& e) {
         return e.create_table([](auto ks_name) {
@@ -1887,3 +1933,111 @@ SEASTAR_TEST_CASE(test_compact_storage) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_aggregate_pushdown) {
+    return do_with_cql_env([] (auto& e) {
+        return e.execute_cql("create table tagg (p int, c int, s bigint static, r int, b bigint, t text, PRIMARY KEY (p, c));").discard_result().then([&e] {
+            return e.execute_cql("insert into tagg (p, s) values (1, 10);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tagg (p, c, r, b) values (1, 1, 5, 100);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tagg (p, c, r) values (1, 2, -3);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tagg (p, c, r, b) values (1, 3, 7, -20);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tagg (p, c, t) values (1, 4, 'x');").discard_result();
+        }).then([&e] {
+            // Partition with only a static row, which counts as one row
+            return e.execute_cql("insert into tagg (p, s) values (2, 20);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tagg (p, c, r) values (3, 1, 1);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("delete from tagg where p = 3 and c = 1;").discard_result();
+        }).then([&e] {
+            return e.execute_cql("select count(*), count(r), sum(r), min(r), max(r), avg(r) from tagg where p = 1;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { long_type->decompose(int64_t(4)), long_type->decompose(int64_t(3)), int32_type->decompose(9),
+                  int32_type->decompose(-3), int32_type->decompose(7), int32_type->decompose(3) },
+            });
+            return e.execute_cql("select count(*), sum(b), min(b), max(s), count(s) from tagg;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { long_type->decompose(int64_t(5)), long_type->decompose(int64_t(80)), long_type->decompose(int64_t(-20)),
+                  long_type->decompose(int64_t(20)), long_type->decompose(int64_t(5)) },
+            });
+            return e.execute_cql("select count(*), sum(r), min(r), avg(r) from tagg where p = 4;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { long_type->decompose(int64_t(0)), int32_type->decompose(0), { }, int32_type->decompose(0) },
+            });
+            // Not pushed down: LIMIT applies to the aggregated rows
+            return e.execute_cql("select count(*) from tagg where p = 1 limit 2;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { long_type->decompose(int64_t(2)) },
+            });
+            // Not pushed down: clustering key columns are aggregated by the coordinator
+            return e.execute_cql("select count(*), max(c) from tagg where p = 1;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { long_type->decompose(int64_t(4)), int32_type->decompose(4) },
+            });
+        });
+    });
+}
+
+SEASTAR_TEST_CASE(test_select_cql_rows) {
+    return do_with_cql_env([] (auto& e) {
+        return e.execute_cql("create table tcql (p int, c int, s text static, r1 int, r2 blob, PRIMARY KEY (p, c));").discard_result().then([&e] {
+            return e.execute_cql("insert into tcql (p, c, r1, r2) values (1, 1, 10, 0x0102);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tcql (p, c, r1) values (1, 2, 20);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tcql (p, c, r2) values (1, 3, 0x);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tcql (p, s) values (1, 'one');").discard_result();
+        }).then([&e] {
+            // Partition with only a static row
+            return e.execute_cql("insert into tcql (p, s) values (2, 'two');").discard_result();
+        }).then([&e] {
+            return e.execute_cql("insert into tcql (p, c, r1) values (3, 1, 30);").discard_result();
+        }).then([&e] {
+            return e.execute_cql("delete r1 from tcql where p = 3 and c = 1;").discard_result();
+        }).then([&e] {
+            return e.execute_cql("select * from tcql where p = 1;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { int32_type->decompose(1), int32_type->decompose(1), utf8_type->decompose(sstring("one")),
+                  int32_type->decompose(10), from_hex("0102") },
+                { int32_type->decompose(1), int32_type->decompose(2), utf8_type->decompose(sstring("one")),
+                  int32_type->decompose(20), { } },
+                { int32_type->decompose(1), int32_type->decompose(3), utf8_type->decompose(sstring("one")),
+                  { }, bytes() },
+            });
+            return e.execute_cql("select r1, c, p from tcql where p = 1 order by c desc limit 2;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { { }, int32_type->decompose(3), int32_type->decompose(1) },
+                { int32_type->decompose(20), int32_type->decompose(2), int32_type->decompose(1) },
+            });
+            return e.execute_cql("select * from tcql where p = 2;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_rows({
+                { int32_type->decompose(2), { }, utf8_type->decompose(sstring("two")), { }, { } },
+            });
+            return e.execute_cql("select * from tcql where p = 3;");
+        }).then([&e] (auto msg) {
+            // The row marker keeps the row alive
+            assert_that(msg).is_rows().with_rows({
+                { int32_type->decompose(3), int32_type->decompose(1), { }, { }, { } },
+            });
+            return e.execute_cql("select * from tcql;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_size(5);
+            return e.execute_cql("select p, c from tcql limit 4;");
+        }).then([&e] (auto msg) {
+            assert_that(msg).is_rows().with_size(4);
+        });
+    });
+}
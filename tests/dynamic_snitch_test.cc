@@ -0,0 +1,115 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "locator/dynamic_snitch.hh"
+#include "locator/snitch_base.hh"
+#include "tests/test-utils.hh"
+
+using namespace locator;
+using namespace std::chrono_literals;
+
+static const inet_address self("127.0.0.1");
+static const inet_address ep1("127.0.0.2");
+static const inet_address ep2("127.0.0.3");
+static const inet_address ep3("127.0.0.4");
+
+static dynamic_snitch::config make_config(double badness_threshold) {
+    dynamic_snitch::config cfg;
+    cfg.badness_threshold = badness_threshold;
+    // Scores are updated explicitly by the tests
+    cfg.update_interval = std::chrono::hours(1);
+    cfg.reset_interval = std::chrono::hours(1);
+    return cfg;
+}
+
+// SimpleSnitch keeps the order of the replicas.
+static future<> with_simple_snitch(std::function<void()> func) {
+    return seastar::async([func = std::move(func)] {
+        i_endpoint_snitch::create_snitch("SimpleSnitch").get();
+        try {
+            func();
+        } catch (...) {
+            i_endpoint_snitch::stop_snitch().get();
+            throw;
+        }
+        i_endpoint_snitch::stop_snitch().get();
+    });
+}
+
+static std::vector<inet_address> sorted(dynamic_snitch& ds, std::vector<inet_address> eps) {
+    ds.sort_by_proximity(self, eps);
+    return eps;
+}
+
+SEASTAR_TEST_CASE(test_sorts_by_score_without_threshold) {
+    return with_simple_snitch([] {
+        dynamic_snitch ds(make_config(0));
+        ds.receive_timing(ep1, 3000us);
+        ds.receive_timing(ep2, 1000us);
+        ds.receive_timing(ep3, 2000us);
+
+        // Nothing changes until scores are updated
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2, ep3}) == std::vector<inet_address>({ep1, ep2, ep3}));
+
+        ds.update_scores();
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2, ep3}) == std::vector<inet_address>({ep2, ep3, ep1}));
+
+        ds.reset();
+        ds.update_scores();
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2, ep3}) == std::vector<inet_address>({ep1, ep2, ep3}));
+    });
+}
+
+SEASTAR_TEST_CASE(test_badness_threshold) {
+    return with_simple_snitch([] {
+        dynamic_snitch ds(make_config(0.5));
+        ds.receive_timing(ep1, 1200us);
+        ds.receive_timing(ep2, 1000us);
+        ds.update_scores();
+
+        // ep1 is less than 50% worse than ep2
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2}) == std::vector<inet_address>({ep1, ep2}));
+
+        for (int i = 0; i < 20; ++i) {
+            ds.receive_timing(ep1, 10000us);
+        }
+        ds.update_scores();
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2}) == std::vector<inet_address>({ep2, ep1}));
+    });
+}
+
+SEASTAR_TEST_CASE(test_severity) {
+    return with_simple_snitch([] {
+        dynamic_snitch ds(make_config(0.1));
+        ds.receive_timing(ep1, 1000us);
+        ds.receive_timing(ep2, 1000us);
+        ds.set_severity(ep1, 0.5);
+        ds.update_scores();
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2}) == std::vector<inet_address>({ep2, ep1}));
+
+        ds.remove_endpoint(ep1);
+        ds.update_scores();
+        BOOST_REQUIRE(sorted(ds, {ep1, ep2}) == std::vector<inet_address>({ep1, ep2}));
+    });
+}
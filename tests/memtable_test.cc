@@ -27,6 +27,8 @@
 #include "core/thread.hh"
 #include "memtable.hh"
 #include "mutation_source_test.hh"
+#include "mutation_reader_assertions.hh"
+#include "schema_builder.hh"
 
 SEASTAR_TEST_CASE(test_memtable_conforms_to_mutation_source) {
     return seastar::async([] {
@@ -43,3 +45,61 @@ SEASTAR_TEST_CASE(test_memtable_conforms_to_mutation_source) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_compaction_of_sealed_memtable) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("ck", bytes_type, column_kind::clustering_key)
+            .with_column("v", bytes_type, column_kind::regular_column)
+            .build();
+        auto& v_def = *s->get_column_definition("v");
+
+        auto make_key = [&] (sstring key) {
+            return dht::global_partitioner().decorate_key(*s, partition_key::from_single_value(*s, to_bytes(key)));
+        };
+        auto ck = clustering_key::from_single_value(*s, bytes("ck"));
+        auto make_mutation = [&] (const dht::decorated_key& dk, api::timestamp_type ts) {
+            mutation m(dk, s);
+            m.set_clustered_cell(ck, v_def, atomic_cell::make_live(ts, bytes("value")));
+            return m;
+        };
+        // Deleted long ago, so that it is past gc_grace_seconds.
+        auto old_tombstone = tombstone(2, gc_clock::now() - s->gc_grace_seconds() - std::chrono::hours(1));
+
+        auto mt = make_lw_shared<memtable>(s);
+
+        auto dk1 = make_key("key1");
+        mt->apply(make_mutation(dk1, 1));
+        mutation deletion1(dk1, s);
+        deletion1.partition().apply(old_tombstone);
+        mt->apply(deletion1);
+
+        auto dk2 = make_key("key2");
+        auto m2 = make_mutation(dk2, 3);
+        mt->apply(m2);
+
+        auto dk3 = make_key("key3");
+        mt->apply(make_mutation(dk3, 1));
+        mutation deletion3(dk3, s);
+        deletion3.partition().apply(old_tombstone);
+        mt->apply(deletion3);
+
+        // The tombstone of key3 may shadow data elsewhere, so it must be kept.
+        auto saved = mt->compact(gc_clock::now(), [&] (const dht::decorated_key& dk) {
+            return dk.equal(*s, dk3) ? api::min_timestamp : api::max_timestamp;
+        });
+
+        BOOST_REQUIRE(saved > 0);
+        BOOST_REQUIRE_EQUAL(mt->partition_count(), 2);
+
+        auto range1 = query::partition_range::make_singular(dk1);
+        assert_that(mt->make_reader(range1)).produces_end_of_stream();
+
+        auto range2 = query::partition_range::make_singular(dk2);
+        assert_that(mt->make_reader(range2)).produces(m2).produces_end_of_stream();
+
+        auto range3 = query::partition_range::make_singular(dk3);
+        assert_that(mt->make_reader(range3)).produces(deletion3).produces_end_of_stream();
+    });
+}
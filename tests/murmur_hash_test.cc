@@ -121,5 +121,14 @@ BOOST_AUTO_TEST_CASE(test_hash_output) {
             utils::murmur_hash::hash3_x64_128(prefix.begin(), prefix.size(), seed, dst);
             assert_hashes_equal(prefix, dst, expected);
         }
+
+        // Test the incremental version, feeding pieces of various sizes
+        for (size_t piece = 1; piece <= 17; ++piece) {
+            utils::murmur_hash::hasher3_x64_128 hasher(seed);
+            for (size_t pos = 0; pos < prefix.size(); pos += piece) {
+                hasher.update(prefix.substr(pos, piece));
+            }
+            assert_hashes_equal(prefix, hasher.finalize(), expected);
+        }
     }
 }
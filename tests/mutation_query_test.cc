@@ -33,6 +33,7 @@
 #include "tests/result_set_assertions.hh"
 
 #include "mutation_query.hh"
+#include "query-result-writer.hh"
 #include "core/do_with.hh"
 #include "core/thread.hh"
 #include "schema_builder.hh"
@@ -386,3 +387,72 @@ SEASTAR_TEST_CASE(test_query_when_partition_tombstone_covers_live_cells) {
             .is_empty();
     });
 }
+
+SEASTAR_TEST_CASE(test_reading_fragmented_result) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto now = gc_clock::now();
+
+        // Values are sized so that rows straddle the chunks of the result
+        mutation m1(partition_key::from_single_value(*s, "key1"), s);
+        m1.set_static_cell("s1", bytes(300, int8_t(1)), 1);
+        for (int i = 0; i < 100; ++i) {
+            auto ck = clustering_key::from_single_value(*s, to_bytes(sprint("%03d", i)));
+            m1.set_clustered_cell(ck, "v1", bytes(i * 7, int8_t(i)), 1);
+        }
+
+        auto src = make_source({m1});
+        auto slice = make_full_slice(*s);
+
+        reconcilable_result result = mutation_query(src,
+            query::full_partition_range, slice, query::max_rows, now).get0();
+        auto r = to_data_query_result(result, s, slice);
+        BOOST_REQUIRE(!r.buf().is_linearized());
+
+        auto rs = query::result_set::from_raw_result(s, slice, r);
+        assert_that(rs)
+            .has_size(100)
+            .has(a_row()
+                .with_column("pk", bytes("key1"))
+                .with_column("ck", bytes("099"))
+                .with_column("v1", bytes(99 * 7, int8_t(99))));
+
+        // Copies are linearized
+        query::result copy(bytes_ostream(r.buf()));
+        BOOST_REQUIRE(r.digest() == copy.digest());
+    });
+}
+
+SEASTAR_TEST_CASE(test_murmur3_digest_is_computed_while_building) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto now = gc_clock::now();
+
+        mutation m1(partition_key::from_single_value(*s, "key1"), s);
+        for (int i = 0; i < 100; ++i) {
+            auto ck = clustering_key::from_single_value(*s, to_bytes(sprint("%03d", i)));
+            m1.set_clustered_cell(ck, "v1", bytes(i * 7, int8_t(i)), 1);
+        }
+
+        // Retracted from the result
+        mutation m2(partition_key::from_single_value(*s, "key2"), s);
+        m2.set_clustered_cell(clustering_key::from_single_value(*s, bytes("A")), "v1", bytes("A:v1"), 1);
+        m2.partition().apply(tombstone(api::timestamp_type(2), now));
+
+        mutation m3(partition_key::from_single_value(*s, "key3"), s);
+        m3.set_static_cell("s1", bytes("key3:s1"), 1);
+
+        auto slice = make_full_slice(*s);
+        query::result::builder builder(slice, query::digest_algorithm::murmur3);
+        for (auto&& m : { m1, m2, m3 }) {
+            auto pw = builder.add_partition(m.key());
+            m.partition().query(pw, *s, now, query::max_rows);
+        }
+        auto r = builder.build();
+        BOOST_REQUIRE(!r.buf().is_linearized());
+
+        query::result copy(bytes_ostream(r.buf()));
+        BOOST_REQUIRE(r.digest(query::digest_algorithm::murmur3) == copy.digest(query::digest_algorithm::murmur3));
+        BOOST_REQUIRE(r.digest() == copy.digest());
+    });
+}
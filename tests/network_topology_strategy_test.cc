@@ -24,6 +24,7 @@
 #include "tests/test-utils.hh"
 #include "core/sstring.hh"
 #include "log.hh"
+#include "core/thread.hh"
 #include <vector>
 #include <string>
 #include <map>
@@ -292,3 +293,42 @@ SEASTAR_TEST_CASE(NetworkTopologyStrategy_simple) {
 SEASTAR_TEST_CASE(NetworkTopologyStrategy_heavy) {
     return heavy_origin_test();
 }
+
+SEASTAR_TEST_CASE(NetworkTopologyStrategy_replica_placement) {
+    return seastar::async([] {
+        i_endpoint_snitch::create_snitch("RackInferringSnitch").get();
+        token_metadata tm;
+        for (int i = 0; i < 30; i++) {
+            inet_address ep(sprint("192.%d.%d.%d", 100 + i % 3, 10 * (1 + i % 4), 1 + i / 12));
+            tm.update_normal_token(dht::global_partitioner().get_random_token(), ep);
+        }
+        std::map<sstring, sstring> options = {{"100", "3"}, {"101", "2"}, {"102", "1"}};
+        auto ars_uptr = abstract_replication_strategy::create_replication_strategy(
+            "test keyspace", "NetworkTopologyStrategy", tm, options);
+
+        ars_uptr->update_placement().get();
+        auto check = [&] {
+            for (int i = 0; i < 100; i++) {
+                auto t = dht::global_partitioner().get_random_token();
+                auto hits = ars_uptr->get_cache_hits_count();
+                auto endpoints = ars_uptr->get_natural_endpoints(t);
+                // Served from the placement table
+                BOOST_REQUIRE_EQUAL(ars_uptr->get_cache_hits_count(), hits + 1);
+                BOOST_REQUIRE(endpoints == ars_uptr->calculate_natural_endpoints(t, tm));
+            }
+        };
+        check();
+
+        // A ring change makes the table stale until it is rebuilt
+        tm.update_normal_token(dht::global_partitioner().get_random_token(), inet_address("192.100.10.9"));
+        auto t = dht::global_partitioner().get_random_token();
+        auto hits = ars_uptr->get_cache_hits_count();
+        BOOST_REQUIRE(ars_uptr->get_natural_endpoints(t) == ars_uptr->calculate_natural_endpoints(t, tm));
+        BOOST_REQUIRE_EQUAL(ars_uptr->get_cache_hits_count(), hits);
+
+        ars_uptr->update_placement().get();
+        check();
+
+        i_endpoint_snitch::stop_snitch().get();
+    });
+}
@@ -101,3 +101,16 @@ BOOST_AUTO_TEST_CASE(test_ring_position_is_comparable_with_decorated_key) {
     BOOST_REQUIRE(k2.tri_compare(*s, dht::ring_position::ending_at(k1._token)) > 0);
     BOOST_REQUIRE(k2.tri_compare(*s, dht::ring_position(k1)) > 0);
 }
+
+BOOST_AUTO_TEST_CASE(test_shard_of_remote_shard_count) {
+    dht::murmur3_partitioner partitioner;
+    // Tokens are spread evenly over the shards, lowest tokens first
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0x8000'0000'0000'0000), 4), 0u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0xbfff'ffff'ffff'ffff), 4), 0u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0xc000'0000'0000'0000), 4), 1u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0x0000'0000'0000'0000), 4), 2u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0x7fff'ffff'ffff'ffff), 4), 3u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(dht::minimum_token(), 4), 0u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(dht::maximum_token(), 4), 3u);
+    BOOST_REQUIRE_EQUAL(partitioner.shard_of(token_from_long(0x7fff'ffff'ffff'ffff), 1), 0u);
+}
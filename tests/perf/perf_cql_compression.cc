@@ -0,0 +1,76 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "perf.hh"
+#include "transport/compression.hh"
+
+using namespace transport;
+
+volatile uint64_t black_hole;
+
+static void append_value(std::vector<char>& body, const sstring& v) {
+    auto n = v.size();
+    body.push_back((n >> 24) & 0xFF);
+    body.push_back((n >> 16) & 0xFF);
+    body.push_back((n >> 8) & 0xFF);
+    body.push_back(n & 0xFF);
+    body.insert(body.end(), v.begin(), v.end());
+}
+
+// A result page like the ones of perf_simple_query: rows of a text key
+// followed by five blobs.
+static std::vector<char> make_result_page(unsigned rows) {
+    std::vector<char> body;
+    for (unsigned i = 0; i < rows; ++i) {
+        append_value(body, sprint("key%08d", i));
+        for (unsigned c = 0; c < 5; ++c) {
+            append_value(body, sprint("0x8f75da6b3dcec90c8a404fb9a5f6b0621e62d39c69ba5758e5f41b78311f%04d%d", i % 1000, c));
+        }
+    }
+    return body;
+}
+
+static void run(cql_compression c, const char* name, const std::vector<char>& body) {
+    std::vector<char> buf;
+    auto compressed_size = compress_body(c, body.data(), body.size(), buf);
+    std::cout << name << ": " << body.size() << " bytes -> " << compressed_size << " bytes on the wire ("
+              << sprint("%.2f", double(compressed_size) / body.size()) << ")\n";
+
+    std::cout << "Timing " << name << " compression...\n";
+    time_it([&] {
+        black_hole += compress_body(c, body.data(), body.size(), buf);
+    }, 5, 10);
+
+    temporary_buffer<char> compressed(buf.data(), compressed_size);
+    std::cout << "Timing " << name << " decompression...\n";
+    time_it([&] {
+        black_hole += uncompress_body(c, compressed).size();
+    }, 5, 10);
+}
+
+int main(int argc, char* argv[]) {
+    for (auto rows : { 1u, 100u, 5000u }) {
+        auto body = make_result_page(rows);
+        std::cout << "Result page of " << rows << " rows\n";
+        run(cql_compression::lz4, "lz4", body);
+        run(cql_compression::snappy, "snappy", body);
+    }
+}
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares computing the replicas of a NetworkTopologyStrategy keyspace
+// token by token, as done after every ring change before, with building the
+// replica placement table once and looking replicas up in it.
+
+#include "tests/perf/perf.hh"
+#include "core/app-template.hh"
+#include "core/thread.hh"
+#include "locator/abstract_replication_strategy.hh"
+
+using namespace locator;
+using clk = std::chrono::high_resolution_clock;
+
+static double elapsed_ms(clk::time_point start) {
+    return std::chrono::duration<double, std::milli>(clk::now() - start).count();
+}
+
+// Nodes are spread over two data centers and three racks per data center,
+// which RackInferringSnitch derives from the 2nd and 3rd octets.
+static void populate(token_metadata& tm, unsigned nodes, unsigned tokens_per_node) {
+    std::unordered_map<inet_address, std::unordered_set<token>> endpoint_tokens;
+    for (unsigned n = 0; n < nodes; ++n) {
+        auto ep = inet_address(sprint("10.%d.%d.%d", 1 + n % 2, 1 + (n / 2) % 3, 1 + n / 6));
+        auto& tokens = endpoint_tokens[ep];
+        while (tokens.size() < tokens_per_node) {
+            tokens.insert(dht::global_partitioner().get_random_token());
+        }
+    }
+    tm.update_normal_tokens(endpoint_tokens);
+}
+
+static void run(unsigned nodes, unsigned tokens_per_node) {
+    token_metadata tm;
+    populate(tm, nodes, tokens_per_node);
+    std::map<sstring, sstring> options = {{"1", "3"}, {"2", "3"}};
+    auto rs = abstract_replication_strategy::create_replication_strategy("ks", "NetworkTopologyStrategy", tm, options);
+    auto& sorted_tokens = tm.sorted_tokens();
+
+    std::cout << sprint("%d nodes, %d tokens per node:\n", nodes, tokens_per_node);
+
+    auto start = clk::now();
+    for (auto& t : sorted_tokens) {
+        rs->calculate_natural_endpoints(t, tm);
+    }
+    std::cout << sprint("  computing the replicas of every token: %.2f ms without yielding\n", elapsed_ms(start));
+
+    start = clk::now();
+    auto placement = rs->build_placement().get0();
+    std::cout << sprint("  building the placement table: %.2f ms, yielding every few tokens\n", elapsed_ms(start));
+    if (!placement) {
+        std::cout << "  the ring changed while building the placement table\n";
+        return;
+    }
+
+    unsigned i = 0;
+    std::cout << "  looking up replicas in the table:\n";
+    time_it([&] {
+        placement->get_replicas(sorted_tokens[i++ % sorted_tokens.size()]);
+    });
+}
+
+int main(int argc, char** argv) {
+    namespace bpo = boost::program_options;
+    app_template app;
+    app.add_options()
+        ("nodes", bpo::value<unsigned>()->default_value(100), "number of nodes in the ring")
+        ("tokens", bpo::value<unsigned>()->default_value(256), "number of tokens per node");
+
+    return app.run_deprecated(argc, argv, [&app] {
+        auto nodes = app.configuration()["nodes"].as<unsigned>();
+        auto tokens = app.configuration()["tokens"].as<unsigned>();
+        seastar::async([nodes, tokens] {
+            i_endpoint_snitch::create_snitch("RackInferringSnitch").get();
+            run(nodes, tokens);
+            i_endpoint_snitch::stop_snitch().get();
+        }).then([] {
+            return engine().exit(0);
+        }).or_terminate();
+    });
+}
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+// Compares replicas receiving requests on arbitrary shards, which then pass
+// them to the shard owning the token, with requests being sent straight to
+// the owning shard by the coordinator.
+
+#include "tests/perf/perf.hh"
+#include "core/app-template.hh"
+#include "dht/i_partitioner.hh"
+#include "utils/murmur_hash.hh"
+
+static constexpr unsigned tokens_per_shard = 4096;
+
+// Tokens of the requests received by this shard
+static thread_local std::vector<dht::token> received;
+static thread_local unsigned next_token;
+static thread_local uint64_t requests;
+static thread_local uint64_t cross_shard_hops;
+
+static void fill_tokens(bool owned_only) {
+    received.clear();
+    next_token = 0;
+    requests = 0;
+    cross_shard_hops = 0;
+    while (received.size() < tokens_per_shard) {
+        auto t = dht::global_partitioner().get_random_token();
+        if (!owned_only || dht::shard_of(t) == engine().cpu_id()) {
+            received.push_back(std::move(t));
+        }
+    }
+}
+
+// Stands for the work of the replica on the owning shard
+static uint64_t execute(const dht::token& t) {
+    std::array<uint64_t, 2> hash;
+    utils::murmur_hash::hash3_x64_128(t._data, 0, hash);
+    return hash[0];
+}
+
+static future<> handle_request() {
+    auto& t = received[next_token++ % received.size()];
+    auto shard = dht::shard_of(t);
+    ++requests;
+    if (shard != engine().cpu_id()) {
+        ++cross_shard_hops;
+    }
+    return smp::submit_to(shard, [&t] {
+        return execute(t);
+    }).discard_result();
+}
+
+static future<> run(sstring name, bool owned_only, unsigned concurrency) {
+    auto shards = boost::irange(0u, smp::count);
+    return parallel_for_each(shards.begin(), shards.end(), [owned_only] (unsigned shard) {
+        return smp::submit_to(shard, [owned_only] {
+            fill_tokens(owned_only);
+        });
+    }).then([name, concurrency] {
+        std::cout << "Timing " << name << "...\n";
+        return time_parallel([] { return handle_request(); }, concurrency);
+    }).then([shards] {
+        return map_reduce(shards.begin(), shards.end(), [] (unsigned shard) {
+            return smp::submit_to(shard, [] {
+                return std::make_pair(requests, cross_shard_hops);
+            });
+        }, std::make_pair(uint64_t(0), uint64_t(0)), [] (auto acc, auto counts) {
+            return std::make_pair(acc.first + counts.first, acc.second + counts.second);
+        });
+    }).then([] (auto counts) {
+        std::cout << sprint("%d requests, %d cross-shard hops (%.2f per request)\n",
+            counts.first, counts.second, double(counts.second) / counts.first);
+    });
+}
+
+int main(int argc, char** argv) {
+    namespace bpo = boost::program_options;
+    app_template app;
+    app.add_options()
+        ("concurrency", bpo::value<unsigned>()->default_value(100), "workers per core");
+
+    return app.run_deprecated(argc, argv, [&app] {
+        auto concurrency = app.configuration()["concurrency"].as<unsigned>();
+        run("requests received by any shard", false, concurrency).then([concurrency] {
+            return run("requests received by the owning shard", true, concurrency);
+        }).then([] {
+            return engine().exit(0);
+        }).or_terminate();
+    });
+}
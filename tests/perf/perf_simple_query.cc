@@ -44,10 +44,11 @@ static auto execute_update_for_key(cql_test_env& env, const bytes& key) {
 };
 
 struct test_config {
-    enum class run_mode { read, write };
+    enum class run_mode { read, write, count };
 
     run_mode mode;
     unsigned partitions;
+    unsigned rows;
     unsigned concurrency;
     bool query_single_key;
 };
@@ -56,12 +57,14 @@ std::ostream& operator<<(std::ostream& os, const test_config::run_mode& m) {
     switch (m) {
         case test_config::run_mode::write: return os << "write";
         case test_config::run_mode::read: return os << "read";
+        case test_config::run_mode::count: return os << "count";
     }
     assert(0);
 }
 
 std::ostream& operator<<(std::ostream& os, const test_config& cfg) {
     return os << "{partitions=" << cfg.partitions
+           << ", rows=" << cfg.rows
            << ", concurrency=" << cfg.concurrency
            << ", mode=" << cfg.mode
            << ", query_single_key=" << (cfg.query_single_key ? "yes" : "no")
@@ -99,6 +102,30 @@ future<> test_write(cql_test_env& env, test_config& cfg) {
         });
 }
 
+// Counts the rows of wide partitions, which replicas aggregate without
+// returning the rows.
+future<> test_count(cql_test_env& env, test_config& cfg) {
+    std::cout << "Creating " << cfg.partitions << " partitions of " << cfg.rows << " rows..." << std::endl;
+    return env.execute_cql("create table wide (p int, c int, v int, PRIMARY KEY (p, c));").discard_result().then([&env] {
+        return env.prepare("insert into wide (p, c, v) values (?, ?, ?);");
+    }).then([&env, &cfg] (auto id) {
+        auto partitions = boost::irange(0, (int)cfg.partitions);
+        return do_for_each(partitions.begin(), partitions.end(), [&env, &cfg, id] (int p) {
+            auto rows = boost::irange(0, (int)cfg.rows);
+            return do_for_each(rows.begin(), rows.end(), [&env, id, p] (int c) {
+                return env.execute_prepared(id, {{int32_type->decompose(p)}, {int32_type->decompose(c)}, {int32_type->decompose(c)}}).discard_result();
+            });
+        });
+    }).then([&env] {
+        return env.prepare("select count(*) from wide where p = ?;");
+    }).then([&env, &cfg] (auto id) {
+        return time_parallel([&env, &cfg, id] {
+            int p = cfg.query_single_key ? 0 : std::rand() % cfg.partitions;
+            return env.execute_prepared(id, {{int32_type->decompose(p)}}).discard_result();
+        }, cfg.concurrency);
+    });
+}
+
 future<> do_test(cql_test_env& env, test_config& cfg) {
     std::cout << "Running test with config: " << cfg << std::endl;
     return env.create_table([] (auto ks_name) {
@@ -114,6 +141,8 @@ future<> do_test(cql_test_env& env, test_config& cfg) {
                 return test_read(env, cfg);
             case test_config::run_mode::write:
                 return test_write(env, cfg);
+            case test_config::run_mode::count:
+                return test_count(env, cfg);
         };
         assert(0);
     });
@@ -125,6 +154,8 @@ int main(int argc, char** argv) {
     app.add_options()
         ("partitions", bpo::value<unsigned>()->default_value(10000), "number of partitions")
         ("write", "test write path instead of read path")
+        ("count", "test count(*) over wide partitions instead of read path")
+        ("rows", bpo::value<unsigned>()->default_value(1000), "number of rows per partition in count mode")
         ("query-single-key", "test write path instead of read path")
         ("concurrency", bpo::value<unsigned>()->default_value(100), "workers per core");
 
@@ -133,7 +164,14 @@ int main(int argc, char** argv) {
             auto cfg = make_lw_shared<test_config>();
             cfg->partitions = app.configuration()["partitions"].as<unsigned>();
             cfg->concurrency = app.configuration()["concurrency"].as<unsigned>();
-            cfg->mode = app.configuration().count("write") ? test_config::run_mode::write : test_config::run_mode::read;
+            cfg->rows = app.configuration()["rows"].as<unsigned>();
+            if (app.configuration().count("write")) {
+                cfg->mode = test_config::run_mode::write;
+            } else if (app.configuration().count("count")) {
+                cfg->mode = test_config::run_mode::count;
+            } else {
+                cfg->mode = test_config::run_mode::read;
+            }
             cfg->query_single_key = app.configuration().count("query-single-key");
             return do_test(*env, *cfg).finally([env, cfg] {
                 return env->stop().finally([env] {});
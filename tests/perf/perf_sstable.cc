@@ -39,6 +39,14 @@ future<> test_write(distributed<test_env>& dt) {
     });
 }
 
+future<> test_flush(distributed<test_env>& dt) {
+    return dt.invoke_on_all([] (test_env &t) {
+        t.fill_memtable();
+    }).then([&dt] {
+        return time_runs(iterations, parallelism, dt, &test_env::flush_memtable_bytes, "MB");
+    });
+}
+
 future<> test_index_read(distributed<test_env>& dt) {
     return time_runs(iterations, parallelism, dt, &test_env::read_all_indexes);
 }
@@ -47,18 +55,41 @@ future<> test_sequential_read(distributed<test_env>& dt) {
     return time_runs(iterations, parallelism, dt, &test_env::read_sequential_partitions);
 }
 
+future<> test_random_read(distributed<test_env>& dt) {
+    return time_runs(iterations, parallelism, dt, &test_env::read_random_partitions).then([&dt] {
+        return dt.map_reduce0([] (test_env&) {
+            auto& tracker = global_cache_tracker();
+            return std::make_pair(tracker.index_page_misses(), tracker.index_page_hits());
+        }, std::make_pair(uint64_t(0), uint64_t(0)), [] (auto a, auto b) {
+            return std::make_pair(a.first + b.first, a.second + b.second);
+        }).then([] (std::pair<uint64_t, uint64_t> stats) {
+            std::cout << "Index.db pages read from disk: " << stats.first << ", served from cache: " << stats.second << "\n";
+        });
+    });
+}
+
+future<> test_point_read(distributed<test_env>& dt) {
+    return time_runs(iterations, parallelism, dt, &test_env::read_random_rows);
+}
+
 enum class test_modes {
+    random_read,
     sequential_read,
+    point_read,
     index_read,
     write,
     index_write,
+    flush,
 };
 
 static std::unordered_map<sstring, test_modes> test_mode = {
+    {"random_read", test_modes::random_read },
     {"sequential_read", test_modes::sequential_read },
+    {"point_read", test_modes::point_read },
     {"index_read", test_modes::index_read },
     {"write", test_modes::write },
     {"index_write", test_modes::index_write },
+    {"flush", test_modes::flush },
 };
 
 int main(int argc, char** argv) {
@@ -72,7 +103,10 @@ int main(int argc, char** argv) {
         ("key_size", bpo::value<unsigned>()->default_value(128), "size of partition key")
         ("num_columns", bpo::value<unsigned>()->default_value(5), "number of columns per row")
         ("column_size", bpo::value<unsigned>()->default_value(64), "size in bytes for each column")
-        ("mode", bpo::value<sstring>()->default_value("index_write"), "one of: random_read, sequential_read, index_read, write, index_write (default)")
+        ("rows_per_partition", bpo::value<unsigned>()->default_value(1000), "number of clustering rows per partition (point_read mode)")
+        ("column_index_size", bpo::value<unsigned>()->default_value(64), "size of promoted index blocks, in KB (point_read mode)")
+        ("write_behind", bpo::value<unsigned>()->default_value(4), "number of buffers written to disk concurrently (write and flush modes)")
+        ("mode", bpo::value<sstring>()->default_value("index_write"), "one of: random_read, sequential_read, point_read, index_read, write, index_write (default), flush")
         ("testdir", bpo::value<sstring>()->default_value("/var/lib/cassandra/perf-tests"), "directory in which to store the sstables");
 
     return app.run_deprecated(argc, argv, [&app] {
@@ -84,9 +118,17 @@ int main(int argc, char** argv) {
         cfg.partitions = app.configuration()["partitions"].as<unsigned>();
         cfg.key_size = app.configuration()["key_size"].as<unsigned>();
         cfg.buffer_size = app.configuration()["buffer_size"].as<unsigned>() << 10;
+        cfg.write_behind = app.configuration()["write_behind"].as<unsigned>();
         sstring dir = app.configuration()["testdir"].as<sstring>();
         cfg.dir = dir;
         auto mode = test_mode[app.configuration()["mode"].as<sstring>()];
+        if (mode == test_modes::point_read) {
+            cfg.rows_per_partition = app.configuration()["rows_per_partition"].as<unsigned>();
+            cfg.column_index_size = app.configuration()["column_index_size"].as<unsigned>() << 10;
+        } else {
+            cfg.rows_per_partition = 0;
+            cfg.column_index_size = 64 << 10;
+        }
         if ((mode == test_modes::index_read) || (mode == test_modes::index_write)) {
             cfg.num_columns = 0;
             cfg.column_size = 0;
@@ -96,7 +138,13 @@ int main(int argc, char** argv) {
         }
         return test->start(std::move(cfg)).then([mode, dir, test] {
             engine().at_exit([test] { return test->stop(); });
-            if ((mode == test_modes::index_read) ||
+            if (mode == test_modes::random_read) {
+                return test->invoke_on_all([] (test_env &t) {
+                    return t.load_sstables(iterations).then([&t] {
+                        return t.load_keys();
+                    });
+                });
+            } else if ((mode == test_modes::index_read) ||
                (mode == test_modes::sequential_read)) {
                 return test->invoke_on_all([] (test_env &t) {
                     return t.load_sstables(iterations);
@@ -108,7 +156,11 @@ int main(int argc, char** argv) {
                         throw;
                     }
                 });
-            } else if ((mode == test_modes::index_write) || (mode == test_modes::write)) {
+            } else if (mode == test_modes::point_read) {
+                return test->invoke_on_all([] (test_env &t) {
+                    return t.write_and_load_wide_sstable();
+                });
+            } else if ((mode == test_modes::index_write) || (mode == test_modes::write) || (mode == test_modes::flush)) {
                 return test_setup::create_empty_test_dir(dir);
             } else {
                 throw std::invalid_argument("Invalid mode");
@@ -116,10 +168,16 @@ int main(int argc, char** argv) {
         }).then([test, mode] {
             if (mode == test_modes::index_read) {
                 return test_index_read(*test).then([test] {});
+            } else if (mode == test_modes::random_read) {
+                return test_random_read(*test).then([test] {});
             } else if (mode == test_modes::sequential_read) {
                 return test_sequential_read(*test).then([test] {});
+            } else if (mode == test_modes::point_read) {
+                return test_point_read(*test).then([test] {});
             } else if ((mode == test_modes::index_write) || (mode == test_modes::write)) {
                 return test_write(*test).then([test] {});
+            } else if (mode == test_modes::flush) {
+                return test_flush(*test).then([test] {});
             } else {
                 throw std::invalid_argument("Invalid mode");
             }
@@ -23,6 +23,7 @@
 #include "../sstable_test.hh"
 #include "sstables/sstables.hh"
 #include "mutation_reader.hh"
+#include "row_cache.hh"
 #include <boost/accumulators/accumulators.hpp>
 #include <boost/accumulators/statistics.hpp>
 #include <boost/range/irange.hpp>
@@ -38,6 +39,11 @@ class test_env {
         unsigned column_size;
         size_t buffer_size;
         sstring dir;
+        // Number of clustering rows per partition. Zero means the schema
+        // has no clustering key.
+        unsigned rows_per_partition;
+        size_t column_index_size;
+        unsigned write_behind;
     };
 
 private:
@@ -67,8 +73,22 @@ class test_env {
     std::uniform_int_distribution<char> _distribution;
     lw_shared_ptr<memtable> _mt;
     std::vector<lw_shared_ptr<sstable>> _sst;
+    std::vector<sstables::key> _keys;
+
+    schema_ptr create_wide_schema() {
+        schema_builder builder("ks", "perf-test");
+        builder.with_column("name", utf8_type, column_kind::partition_key);
+        builder.with_column("ck", int32_type, column_kind::clustering_key);
+        for (unsigned i = 0; i < _cfg.num_columns; ++i) {
+            builder.with_column(to_bytes(sprint("column%04d", i)), utf8_type);
+        }
+        return builder.build();
+    }
 
     schema_ptr create_schema() {
+        if (_cfg.rows_per_partition) {
+            return create_wide_schema();
+        }
         std::vector<schema::column> columns;
 
         for (unsigned i = 0; i < _cfg.num_columns; ++i) {
@@ -112,11 +132,57 @@ class test_env {
         }
     }
 
+    void fill_wide_memtable() {
+        for (unsigned i = 0; i < _cfg.partitions; i++) {
+            auto key = partition_key::from_deeply_exploded(*s, { boost::any(random_key()) });
+            auto mut = mutation(key, s);
+            for (unsigned ck = 0; ck < _cfg.rows_per_partition; ++ck) {
+                auto ckey = clustering_key::from_single_value(*s, int32_type->decompose(int32_t(ck)));
+                for (auto& cdef: s->regular_columns()) {
+                    mut.set_clustered_cell(ckey, cdef, atomic_cell::make_live(0, utf8_type->decompose(random_column())));
+                }
+            }
+            _keys.push_back(sstables::key::from_partition_key(*s, key));
+            _mt->apply(std::move(mut));
+        }
+    }
+
+    future<> write_and_load_wide_sstable() {
+        fill_wide_memtable();
+        return test_setup::create_empty_test_dir(dir()).then([this] {
+            auto sst = sstables::test::make_test_sstable(_cfg.buffer_size, "ks", "cf", dir(), 0, sstable::version_types::ka, sstable::format_types::big);
+            sst->set_column_index_size(_cfg.column_index_size);
+            return sst->write_components(*_mt).then([this, sst] {
+                return sst->load().then([this, sst] {
+                    _sst.push_back(sst);
+                });
+            });
+        });
+    }
+
     future<> load_sstables(unsigned iterations) {
         _sst.push_back(make_lw_shared<sstable>("ks", "cf", this->dir(), 0, sstable::version_types::ka, sstable::format_types::big));
         return _sst.back()->load();
     }
 
+    // Collects keys of the loaded sstable, so that they can be looked up
+    // later. Drops the index pages cached in the process, so that lookups
+    // start with a cold cache.
+    future<> load_keys() {
+        return do_with(test(_sst[0]), [this] (auto& sst) {
+            auto idx = boost::irange(0, int(sst.get_summary().header.size));
+            return do_for_each(idx.begin(), idx.end(), [this, &sst] (uint64_t entry) {
+                return sst.read_indexes(entry).then([this] (auto il) {
+                    for (auto&& e : il) {
+                        _keys.push_back(sstables::key::from_bytes(to_bytes(e.get_key_bytes())));
+                    }
+                });
+            });
+        }).then([] {
+            global_cache_tracker().clear();
+        });
+    }
+
     using clk = std::chrono::high_resolution_clock;
     static auto now() {
         return clk::now();
@@ -129,6 +195,7 @@ class test_env {
         size_t partitions = _mt->partition_count();
         return test_setup::create_empty_test_dir(dir()).then([this, idx] {
             auto sst = sstables::test::make_test_sstable(_cfg.buffer_size, "ks", "cf", dir(), idx, sstable::version_types::ka, sstable::format_types::big);
+            sst->set_write_behind(_cfg.write_behind);
             return sst->write_components(*_mt).then([sst] {});
         }).then([start, partitions] {
             auto end = test_env::now();
@@ -137,7 +204,26 @@ class test_env {
         });
     }
 
+    // Like flush_memtable(), but returns the number of megabytes written to
+    // all components per second.
+    future<double> flush_memtable_bytes(int idx) {
+        auto start = test_env::now();
+        return test_setup::create_empty_test_dir(dir()).then([this, idx] {
+            auto sst = sstables::test::make_test_sstable(_cfg.buffer_size, "ks", "cf", dir(), idx, sstable::version_types::ka, sstable::format_types::big);
+            sst->set_write_behind(_cfg.write_behind);
+            return sst->write_components(*_mt).then([sst] {
+                return sst->bytes_on_disk();
+            });
+        }).then([start] (uint64_t bytes) {
+            auto end = test_env::now();
+            auto duration = std::chrono::duration<double>(end - start).count();
+            return bytes / duration / (1 << 20);
+        });
+    }
+
     future<double> read_all_indexes(int idx) {
+        // Measure parsing, not the index page cache.
+        global_cache_tracker().clear();
         return do_with(test(_sst[0]), [] (auto& sst) {
             auto start = test_env::now();
             auto total = make_lw_shared<size_t>(0);
@@ -181,12 +267,60 @@ class test_env {
             });
         });
     }
+
+    // Reads whole partitions with random keys, returns partitions / sec.
+    future<double> read_random_partitions(int idx) {
+        auto start = test_env::now();
+        auto total = make_lw_shared<size_t>(0);
+        auto lookups = boost::irange(size_t(0), _keys.size());
+        return do_for_each(lookups.begin(), lookups.end(), [this, total] (size_t) {
+            std::uniform_int_distribution<size_t> key_dist(0, _keys.size() - 1);
+            auto& key = _keys[key_dist(_generator)];
+            return _sst[0]->read_row(s, key).then([total] (mutation_opt m) {
+                if (!m) {
+                    throw std::invalid_argument("Partition not found in the sstable");
+                }
+                (*total)++;
+            });
+        }).then([total, start] {
+            auto end = test_env::now();
+            auto duration = std::chrono::duration<double>(end - start).count();
+            return *total / duration;
+        });
+    }
+
+    // Reads single clustering rows from random partitions, returns rows / sec.
+    future<double> read_random_rows(int idx) {
+        auto start = test_env::now();
+        auto total = make_lw_shared<size_t>(0);
+        auto lookups = boost::irange(0u, _cfg.partitions);
+        return do_for_each(lookups.begin(), lookups.end(), [this, total] (unsigned) {
+            std::uniform_int_distribution<unsigned> key_dist(0, _keys.size() - 1);
+            std::uniform_int_distribution<int32_t> ck_dist(0, _cfg.rows_per_partition - 1);
+            auto& key = _keys[key_dist(_generator)];
+            auto ck = clustering_key_prefix::from_single_value(*s, int32_type->decompose(ck_dist(_generator)));
+            auto slice = make_lw_shared<query::partition_slice>(std::vector<query::clustering_range>{
+                query::clustering_range::make_singular(std::move(ck)) }, std::vector<column_id>(), std::vector<column_id>(),
+                query::partition_slice::option_set());
+            return _sst[0]->read_row(s, key, *slice).then([this, total, slice] (mutation_opt m) {
+                if (!m || m->partition().clustered_rows().size() != 1) {
+                    throw std::invalid_argument("Row not found in the sstable");
+                }
+                (*total)++;
+            });
+        }).then([total, start] {
+            auto end = test_env::now();
+            auto duration = std::chrono::duration<double>(end - start).count();
+            return *total / duration;
+        });
+    }
 };
 
 // The function func should carry on with the test, and return the number of partitions processed.
 // time_runs will then map reduce it, and return the aggregate partitions / sec for the whole system.
+// Mappers which measure something else than partitions should pass its name as unit.
 template <typename Func>
-future<> time_runs(unsigned iterations, unsigned parallelism, distributed<test_env>& dt, Func func) {
+future<> time_runs(unsigned iterations, unsigned parallelism, distributed<test_env>& dt, Func func, sstring unit = "partitions") {
     using namespace boost::accumulators;
     auto acc = make_lw_shared<accumulator_set<double, features<tag::mean, tag::error_of<tag::mean>>>>();
     auto idx = boost::irange(0, int(iterations));
@@ -199,7 +333,7 @@ future<> time_runs(unsigned iterations, unsigned parallelism, distributed<test_e
                 return make_ready_future<>();
             });
         });
-    }).then([acc, iterations, parallelism] {
-        std::cout << sprint("%.2f", mean(*acc)) << " +- " << sprint("%.2f", error_of<tag::mean>(*acc)) << " partitions / sec (" << iterations << " runs, " << parallelism << " concurrent ops)\n";
+    }).then([acc, iterations, parallelism, unit] {
+        std::cout << sprint("%.2f", mean(*acc)) << " +- " << sprint("%.2f", error_of<tag::mean>(*acc)) << " " << unit << " / sec (" << iterations << " runs, " << parallelism << " concurrent ops)\n";
     });
 }
@@ -222,8 +222,8 @@ SEASTAR_TEST_CASE(test_row_cache_conforms_to_mutation_source) {
             }
 
             auto cache = make_lw_shared<row_cache>(s, mt->as_data_source(), mt->as_key_source(), tracker);
-            return [cache] (const query::partition_range& range) {
-                return cache->make_reader(range);
+            return [cache] (const query::partition_range& range, const query::partition_slice& slice) {
+                return cache->make_reader(range, slice);
             };
         });
     });
@@ -359,3 +359,112 @@ SEASTAR_TEST_CASE(test_update) {
         }
     });
 }
+
+SEASTAR_TEST_CASE(test_only_queried_rows_are_cached) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("s", bytes_type, column_kind::static_column)
+            .with_column("v", bytes_type, column_kind::regular_column)
+            .build();
+
+        auto make_prefix = [&] (int ck) {
+            return clustering_key_prefix::from_single_value(*s, int32_type->decompose(ck));
+        };
+        auto make_slice = [] (query::clustering_row_ranges ranges) {
+            return query::partition_slice(std::move(ranges), { }, { }, query::partition_slice::option_set());
+        };
+
+        mutation m(partition_key::from_single_value(*s, bytes("key1")), s);
+        m.set_static_cell("s", bytes("static"), 1);
+        for (int ck = 0; ck < 10; ++ck) {
+            m.set_clustered_cell(clustering_key::from_single_value(*s, int32_type->decompose(ck)), "v", bytes("v"), 1);
+        }
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        cache_tracker tracker;
+        row_cache cache(s, mt->as_data_source(), mt->as_key_source(), tracker);
+        auto range = query::partition_range::make_singular(m.decorated_key());
+
+        auto verify = [&] (const query::partition_slice& slice, bool hit) {
+            auto hits = cache.stats().hits;
+            auto misses = cache.stats().misses;
+            mutation expected(m.schema(), m.decorated_key(), mutation_partition(m.partition(), *s, slice.row_ranges));
+            assert_that(cache.make_reader(range, slice))
+                .produces(expected)
+                .produces_end_of_stream();
+            BOOST_REQUIRE_EQUAL(cache.stats().hits, hits + hit);
+            BOOST_REQUIRE_EQUAL(cache.stats().misses, misses + !hit);
+        };
+
+        auto slice1 = make_slice({ query::clustering_range::make({ make_prefix(2) }, { make_prefix(4), false }) });
+        auto slice2 = make_slice({ query::clustering_range::make_singular(make_prefix(7)) });
+        auto slice3 = make_slice({ query::clustering_range::make_singular(make_prefix(3)) });
+        auto slice4 = make_slice({ query::clustering_range::make({ make_prefix(4) }, { make_prefix(7) }) });
+        auto slice5 = make_slice({ query::clustering_range::make({ make_prefix(2) }, { make_prefix(7) }) });
+
+        verify(slice1, false);
+        verify(slice1, true);
+        verify(slice3, true);
+        verify(slice2, false);
+        verify(slice2, true);
+        BOOST_REQUIRE_EQUAL(tracker.clustering_ranges(), 2);
+
+        // Fills the gap between the ranges, merging all of them.
+        verify(slice4, false);
+        BOOST_REQUIRE_EQUAL(tracker.clustering_ranges(), 1);
+        verify(slice5, true);
+
+        verify(query::full_slice, false);
+        verify(query::full_slice, true);
+        verify(slice2, true);
+        BOOST_REQUIRE_EQUAL(tracker.clustering_ranges(), 1);
+
+        tracker.clear();
+        BOOST_REQUIRE_EQUAL(tracker.clustering_ranges(), 0);
+        verify(slice2, false);
+    });
+}
+
+SEASTAR_TEST_CASE(test_absent_partitions_are_cached) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto mt = make_lw_shared<memtable>(s);
+
+        auto m1 = make_new_mutation(s);
+        mt->apply(m1);
+
+        cache_tracker tracker;
+        row_cache cache(s, mt->as_data_source(), mt->as_key_source(), tracker);
+
+        auto m2 = make_new_mutation(s);
+        auto key = m2.decorated_key();
+
+        verify_does_not_have(cache, key);
+        BOOST_REQUIRE_EQUAL(cache.stats().misses, 1);
+        BOOST_REQUIRE_EQUAL(cache.stats().negative_hits, 0);
+
+        verify_does_not_have(cache, key);
+        BOOST_REQUIRE_EQUAL(cache.stats().misses, 1);
+        BOOST_REQUIRE_EQUAL(cache.stats().negative_hits, 1);
+        BOOST_REQUIRE_EQUAL(tracker.negative_hits(), 1);
+
+        // Absent partitions are not returned by scans
+        assert_that(cache.make_reader(query::full_partition_range))
+            .produces(m1)
+            .produces_end_of_stream();
+
+        auto mt2 = make_lw_shared<memtable>(s);
+        mt2->apply(m2);
+        cache.update(*mt2, [] (auto&& key) {
+            return partition_presence_checker_result::maybe_exists;
+        }).get();
+
+        verify_has(cache, m2);
+        BOOST_REQUIRE_EQUAL(cache.stats().misses, 1);
+        BOOST_REQUIRE_EQUAL(cache.stats().negative_hits, 1);
+    });
+}
@@ -0,0 +1,110 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include "tests/test-utils.hh"
+#include "sstables/estimated_histogram.hh"
+#include "schema_builder.hh"
+#include "database.hh"
+#include "utils/compaction_manager.hh"
+
+using namespace std::chrono_literals;
+
+SEASTAR_TEST_CASE(test_estimated_histogram_percentile) {
+    sstables::estimated_histogram h;
+    BOOST_REQUIRE_EQUAL(h.percentile(0.5), 0);
+
+    // 10 and 86 are bucket offsets, so the samples are counted exactly
+    for (int i = 0; i < 90; ++i) {
+        h.add(10);
+    }
+    for (int i = 0; i < 10; ++i) {
+        h.add(86);
+    }
+    BOOST_REQUIRE_EQUAL(h.count(), 100);
+    BOOST_REQUIRE_EQUAL(h.percentile(0), 0);
+    BOOST_REQUIRE_EQUAL(h.percentile(0.5), 10);
+    BOOST_REQUIRE_EQUAL(h.percentile(0.9), 10);
+    BOOST_REQUIRE_EQUAL(h.percentile(0.95), 86);
+    BOOST_REQUIRE_EQUAL(h.percentile(1), 86);
+
+    // Values larger than the last offset are counted in the last bucket
+    h.add(std::numeric_limits<int64_t>::max());
+    BOOST_REQUIRE_EQUAL(h.percentile(1), h.get_bucket_offsets().back());
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_speculative_retry_from_sstring) {
+    BOOST_REQUIRE(speculative_retry::from_sstring("99PERCENTILE").get_type() == speculative_retry::type::PERCENTILE);
+    BOOST_REQUIRE_EQUAL(speculative_retry::from_sstring("99.0percentile").get_value(), 0.99);
+    BOOST_REQUIRE(speculative_retry::from_sstring("10ms").get_type() == speculative_retry::type::CUSTOM);
+    BOOST_REQUIRE_EQUAL(speculative_retry::from_sstring("10ms").get_value(), 10);
+
+    // Out of range values would trip the assertion of estimated_histogram::percentile()
+    BOOST_REQUIRE_THROW(speculative_retry::from_sstring("200PERCENTILE"), std::invalid_argument);
+    BOOST_REQUIRE_THROW(speculative_retry::from_sstring("-1PERCENTILE"), std::invalid_argument);
+    BOOST_REQUIRE_THROW(speculative_retry::from_sstring("-10ms"), std::invalid_argument);
+    return make_ready_future<>();
+}
+
+static lw_shared_ptr<column_family> make_column_family(sstring speculative_retry, compaction_manager& cm) {
+    schema_builder builder("tests", "speculative_retry");
+    builder.with_column("p", utf8_type, column_kind::partition_key);
+    builder.set_speculative_retry(speculative_retry);
+    return make_lw_shared<column_family>(builder.build(), column_family::config(), column_family::no_commitlog(), cm);
+}
+
+SEASTAR_TEST_CASE(test_custom_speculative_retry_delay) {
+    compaction_manager cm;
+    auto cf = make_column_family("50ms", cm);
+    BOOST_REQUIRE(cf->speculative_retry_delay() == std::chrono::microseconds(50ms));
+
+    // Observed latencies do not matter
+    for (int i = 0; i < 1000; ++i) {
+        cf->add_coordinator_read_latency(10us);
+    }
+    BOOST_REQUIRE(cf->speculative_retry_delay() == std::chrono::microseconds(50ms));
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(test_percentile_speculative_retry_delay) {
+    compaction_manager cm;
+    auto cf = make_column_family("90PERCENTILE", cm);
+    BOOST_REQUIRE(!cf->speculative_retry_delay());
+
+    // Too few samples for the percentile to be meaningful
+    for (int i = 0; i < 99; ++i) {
+        cf->add_coordinator_read_latency(10us);
+    }
+    BOOST_REQUIRE(!cf->speculative_retry_delay());
+
+    cf->add_coordinator_read_latency(86us);
+    BOOST_REQUIRE(cf->speculative_retry_delay() == 10us);
+
+    // The delay is not recomputed before the update interval elapsed
+    for (int i = 0; i < 1000; ++i) {
+        cf->add_coordinator_read_latency(86us);
+    }
+    BOOST_REQUIRE(cf->speculative_retry_delay() == 10us);
+    return make_ready_future<>();
+}
@@ -35,6 +35,7 @@
 #include "sstable_test.hh"
 #include "core/seastar.hh"
 #include "core/do_with.hh"
+#include "core/thread.hh"
 #include "utils/compaction_manager.hh"
 #include "tmpdir.hh"
 #include "dht/i_partitioner.hh"
@@ -1535,6 +1536,61 @@ SEASTAR_TEST_CASE(check_compaction_ancestor_metadata) {
     });
 }
 
+SEASTAR_TEST_CASE(compaction_partition_estimate) {
+    // NOTE: generations 48 and 49 are used here.
+
+    // check that merging the cardinality of overlapping sstables estimates
+    // the number of distinct partitions rather than the sum of their key counts.
+    return test_setup::do_with_test_directory([] {
+        return seastar::async([] {
+            auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+                {{"p1", utf8_type}}, {{"c1", utf8_type}}, {{"r1", int32_type}}, {}, utf8_type));
+            const column_definition& r1_col = *s->get_column_definition("r1");
+            auto c_key = clustering_key::from_exploded(*s, {to_bytes("abc")});
+
+            // Generation 48 holds keys 0 to 999, generation 49 keys 500 to 1499.
+            std::vector<shared_sstable> sstables;
+            for (auto generation : { 48, 49 }) {
+                auto mt = make_lw_shared<memtable>(s);
+                auto first = (generation - 48) * 500;
+                for (auto i = first; i < first + 1000; i++) {
+                    auto key = partition_key::from_exploded(*s, {to_bytes(sprint("key%d", i))});
+                    mutation m(key, s);
+                    m.set_clustered_cell(c_key, r1_col, make_atomic_cell(int32_type->decompose(i)));
+                    mt->apply(std::move(m));
+                }
+                auto sst = make_lw_shared<sstable>("ks", "cf", "tests/sstables/tests-temporary", generation, la, big);
+                sst->write_components(*mt).get();
+                sstables.push_back(reusable_sst("tests/sstables/tests-temporary", generation).get0());
+            }
+
+            auto estimate = estimate_partitions_after_compaction(sstables);
+            BOOST_REQUIRE(estimate >= 1400 && estimate <= 1600);
+            BOOST_REQUIRE(estimate < sstables[0]->get_estimated_key_count() + sstables[1]->get_estimated_key_count());
+
+            BOOST_REQUIRE_EQUAL(estimate_partitions_after_compaction({}), 0u);
+        });
+    });
+}
+
+// Sstables written before the metadata collector honoured its precision
+// carry 16-register cardinality estimators, which are too inaccurate to
+// size the bloom filter of the compaction output by.
+SEASTAR_TEST_CASE(compaction_partition_estimate_coarse_cardinality) {
+    std::vector<shared_sstable> sstables;
+    for (auto generation : { 1, 2 }) {
+        auto sst = make_lw_shared<sstable>("ks", "cf", "", generation, la, big);
+        hll::HyperLogLog cardinality(4);
+        for (uint64_t i = 0; i < 1000; i++) {
+            cardinality.offer_hashed(utils::murmur_hash::fmix(i));
+        }
+        sstables::test(sst).set_values_for_partition_estimate(1000, std::move(cardinality));
+        sstables.push_back(std::move(sst));
+    }
+    BOOST_REQUIRE_EQUAL(estimate_partitions_after_compaction(sstables), 2000u);
+    return make_ready_future<>();
+}
+
 SEASTAR_TEST_CASE(datafile_generation_47) {
     // Tests the problem in which the sstable row parser would hang.
     return test_setup::do_with_test_directory([] {
@@ -1649,6 +1705,14 @@ static bool sstable_overlaps(const lw_shared_ptr<column_family>& cf, int64_t gen
     return range1.overlaps(range2, dht::token_comparator());
 }
 
+static std::set<unsigned long> generations_of(const std::vector<sstables::shared_sstable>& sstables) {
+    std::set<unsigned long> gens;
+    for (auto& sst : sstables) {
+        gens.insert(sst->generation());
+    }
+    return gens;
+}
+
 SEASTAR_TEST_CASE(leveled_01) {
     auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
         {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
@@ -1888,6 +1952,59 @@ SEASTAR_TEST_CASE(leveled_05) {
     });
 }
 
+SEASTAR_TEST_CASE(leveled_06) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    column_family::config cfg;
+    compaction_manager cm;
+    cfg.enable_disk_writes = false;
+    cfg.enable_commitlog = false;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+
+    auto key_and_token_pair = token_generation_for_current_shard(50);
+    auto key = [&] (int i) { return key_and_token_pair[i].first; };
+
+    auto max_sstable_size_in_mb = 1;
+    auto max_sstable_size_in_bytes = max_sstable_size_in_mb*1024*1024;
+
+    // Two level-0 sstables which, together, are big enough to be compacted with L1.
+    add_sstable_for_leveled_test(cf, /*gen*/1, max_sstable_size_in_bytes, /*level*/0, key(0), key(10), /*max_timestamp*/0);
+    add_sstable_for_leveled_test(cf, /*gen*/2, max_sstable_size_in_bytes, /*level*/0, key(30), key(40), /*max_timestamp*/1);
+    // Generation 3 overlaps generation 1 only, and generation 4 overlaps generation 2 only.
+    add_sstable_for_leveled_test(cf, /*gen*/3, max_sstable_size_in_bytes, /*level*/1, key(0), key(20));
+    add_sstable_for_leveled_test(cf, /*gen*/4, max_sstable_size_in_bytes, /*level*/1, key(25), key(45));
+
+    leveled_manifest manifest = leveled_manifest::create(*cf, max_sstable_size_in_mb);
+    auto candidate = manifest.get_compaction_candidates();
+    BOOST_REQUIRE(generations_of(candidate.sstables) == std::set<unsigned long>({ 1, 2, 3, 4 }));
+    BOOST_REQUIRE(candidate.level == 1);
+
+    // While generation 4 is being compacted, the newest L0 sstable is left out,
+    // so that the remaining candidates don't overlap it.
+    leveled_manifest::compacting_set compacting = { get_sstable(cf, 4) };
+    candidate = manifest.get_compaction_candidates(compacting);
+    BOOST_REQUIRE(generations_of(candidate.sstables) == std::set<unsigned long>({ 1, 3 }));
+    BOOST_REQUIRE(candidate.level == 1);
+
+    // Nothing is left to compact once the older L0 sstable is busy as well.
+    compacting.insert(get_sstable(cf, 1));
+    candidate = manifest.get_compaction_candidates(compacting);
+    BOOST_REQUIRE(candidate.sstables.empty());
+
+    // The manifest follows changes to the sstable set; an sstable which would
+    // overlap its level is kept in L0.
+    add_sstable_for_leveled_test(cf, /*gen*/5, max_sstable_size_in_bytes, /*level*/1, key(21), key(30));
+    auto sst5 = get_sstable(cf, 5);
+    manifest.replace({ get_sstable(cf, 1), get_sstable(cf, 3) }, { sst5 });
+    BOOST_REQUIRE(manifest.get_level_size(0) == 2);
+    BOOST_REQUIRE(manifest.get_level_size(1) == 1);
+    manifest.replace({ sst5 }, {});
+    BOOST_REQUIRE(manifest.get_level_size(0) == 1);
+
+    return make_ready_future<>();
+}
+
 static lw_shared_ptr<key_reader> prepare_key_reader(schema_ptr s,
     const std::vector<shared_sstable>& ssts, const query::partition_range& range)
 {
@@ -2011,3 +2128,190 @@ SEASTAR_TEST_CASE(check_read_indexes) {
         });
     });
 }
+
+static void add_sstable_for_time_window_test(lw_shared_ptr<column_family>& cf, int64_t gen, int64_t min_timestamp,
+        int64_t max_timestamp, uint32_t max_local_deletion_time = std::numeric_limits<int32_t>::max(),
+        sstable::version_types version = la) {
+    auto sst = make_lw_shared<sstable>("ks", "cf", "", gen, version, big);
+    sstables::test(sst).set_values_for_time_window_strategy(1024, min_timestamp, max_timestamp, max_local_deletion_time);
+    column_family_test(cf).add_sstable(std::move(*sst));
+}
+
+SEASTAR_TEST_CASE(time_window_buckets) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    column_family::config cfg;
+    compaction_manager cm;
+    cfg.enable_disk_writes = false;
+    cfg.enable_commitlog = false;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+
+    std::map<sstring, sstring> options = {
+        { "compaction_window_unit", "HOURS" },
+        { "compaction_window_size", "1" },
+    };
+    const int64_t hour = 3600L * 1000000L;
+
+    // Two sstables in an old window, one in the current one.
+    add_sstable_for_time_window_test(cf, 1, 0, hour / 2);
+    add_sstable_for_time_window_test(cf, 2, hour / 4, hour - 1);
+    add_sstable_for_time_window_test(cf, 3, hour * 5, hour * 5 + 10);
+
+    auto candidates = time_window_most_interesting_bucket(cf->get_sstables(), options);
+    BOOST_REQUIRE(generations_of(candidates) == std::set<unsigned long>({ 1, 2 }));
+
+    // The current window is preferred once it has enough sstables of similar size.
+    add_sstable_for_time_window_test(cf, 4, hour * 5, hour * 5 + 20);
+    add_sstable_for_time_window_test(cf, 5, hour * 5, hour * 5 + 30);
+    add_sstable_for_time_window_test(cf, 6, hour * 5, hour * 5 + 40);
+
+    candidates = time_window_most_interesting_bucket(cf->get_sstables(), options);
+    BOOST_REQUIRE(generations_of(candidates) == std::set<unsigned long>({ 3, 4, 5, 6 }));
+
+    // Sstables in different windows are never compacted together.
+    auto single = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+    add_sstable_for_time_window_test(single, 1, 0, 10);
+    add_sstable_for_time_window_test(single, 2, hour, hour + 10);
+    add_sstable_for_time_window_test(single, 3, hour * 2, hour * 2 + 10);
+    BOOST_REQUIRE(time_window_most_interesting_bucket(single->get_sstables(), options).empty());
+
+    BOOST_REQUIRE_THROW(time_window_most_interesting_bucket(single->get_sstables(), {{ "compaction_window_unit", "WEEKS" }}),
+        exceptions::configuration_exception);
+
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(time_window_fully_expired_sstables) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    column_family::config cfg;
+    compaction_manager cm;
+    cfg.enable_disk_writes = false;
+    cfg.enable_commitlog = false;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+
+    auto now = gc_clock::now();
+    auto gc_before = now - s->gc_grace_seconds();
+    uint32_t long_ago = (gc_before - std::chrono::hours(1)).time_since_epoch().count();
+    uint32_t recently = (now - std::chrono::seconds(1)).time_since_epoch().count();
+
+    // Expired, and older than all data which is still live.
+    add_sstable_for_time_window_test(cf, 1, 0, 10, long_ago);
+    // Expired, but newer than live data in generation 4, which it may shadow.
+    add_sstable_for_time_window_test(cf, 2, 30, 40, long_ago);
+    // Expired, but not long enough for its tombstones to be purged.
+    add_sstable_for_time_window_test(cf, 3, 15, 20, recently);
+    // Live.
+    add_sstable_for_time_window_test(cf, 4, 25, 50);
+    // Written by Scylla before max_local_deletion_time covered cells, so
+    // it may hold live data.
+    add_sstable_for_time_window_test(cf, 5, 11, 14, long_ago, sstable::version_types::ka);
+
+    auto expired = get_fully_expired_sstables(*cf, gc_before);
+    BOOST_REQUIRE(generations_of(expired) == std::set<unsigned long>({ 1 }));
+
+    // Generation 1 may shadow data in memtables which is older than it.
+    mutation m(partition_key::from_exploded(*s, {to_bytes("key1")}), s);
+    m.partition().apply(tombstone(5, now));
+    cf->apply(m);
+    BOOST_REQUIRE(get_fully_expired_sstables(*cf, gc_before).empty());
+
+    return make_ready_future<>();
+}
+
+static void add_sstable_for_tombstone_test(lw_shared_ptr<column_family>& cf, int64_t gen, gc_clock::time_point written_at,
+        int64_t min_timestamp, int64_t max_timestamp, sstring first_key, sstring last_key, uint64_t tombstones, uint32_t deletion_time) {
+    auto sst = make_lw_shared<sstable>("ks", "cf", "", gen, la, big, written_at);
+    sstables::test(sst).set_values_for_tombstone_compaction(min_timestamp, max_timestamp, std::move(first_key), std::move(last_key),
+        /*partitions*/100, tombstones, deletion_time);
+    column_family_test(cf).add_sstable(std::move(*sst));
+}
+
+SEASTAR_TEST_CASE(tombstone_compaction_candidate) {
+    auto s = make_lw_shared(schema({}, some_keyspace, some_column_family,
+        {{"p1", utf8_type}}, {}, {}, {}, utf8_type));
+
+    column_family::config cfg;
+    compaction_manager cm;
+    cfg.enable_disk_writes = false;
+    cfg.enable_commitlog = false;
+    auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+
+    auto key_and_token_pair = token_generation_for_current_shard(50);
+    auto key = [&] (int i) { return key_and_token_pair[i].first; };
+
+    auto now = gc_clock::now();
+    auto two_days_ago = now - std::chrono::hours(48);
+    uint32_t long_ago = (now - s->gc_grace_seconds() - std::chrono::hours(1)).time_since_epoch().count();
+    uint32_t recently = (now - std::chrono::seconds(1)).time_since_epoch().count();
+
+    // Half of the cells are tombstones, but they aren't droppable yet.
+    add_sstable_for_tombstone_test(cf, 1, two_days_ago, 0, 10, key(0), key(5), 50, recently);
+    // A tenth of the cells are droppable tombstones, which is below the default threshold.
+    add_sstable_for_tombstone_test(cf, 2, two_days_ago, 0, 10, key(10), key(15), 10, long_ago);
+    BOOST_REQUIRE(!get_tombstone_compaction_candidate(*cf, {}));
+    BOOST_REQUIRE(get_tombstone_compaction_candidate(*cf, {{ "tombstone_threshold", "0.05" }})->generation() == 2);
+
+    // Most droppable tombstones, but the sstable was written too recently.
+    add_sstable_for_tombstone_test(cf, 3, now, 0, 10, key(20), key(25), 90, long_ago);
+    BOOST_REQUIRE(!get_tombstone_compaction_candidate(*cf, {}));
+    BOOST_REQUIRE(get_tombstone_compaction_candidate(*cf, {{ "tombstone_compaction_interval", "0" }})->generation() == 3);
+
+    // Droppable tombstones which shadow older data in an overlapping sstable
+    // can't be purged, unless the check is disabled.
+    add_sstable_for_tombstone_test(cf, 4, two_days_ago, 20, 30, key(30), key(35), 80, long_ago);
+    add_sstable_for_tombstone_test(cf, 5, two_days_ago, 0, 10, key(32), key(38), 0, long_ago);
+    BOOST_REQUIRE(!get_tombstone_compaction_candidate(*cf, {}));
+    BOOST_REQUIRE(get_tombstone_compaction_candidate(*cf, {{ "unchecked_tombstone_compaction", "true" }})->generation() == 4);
+
+    // Overlapping sstables which only hold newer data don't matter.
+    add_sstable_for_tombstone_test(cf, 6, two_days_ago, 0, 10, key(40), key(45), 70, long_ago);
+    add_sstable_for_tombstone_test(cf, 7, two_days_ago, 20, 30, key(42), key(49), 0, long_ago);
+    BOOST_REQUIRE(get_tombstone_compaction_candidate(*cf, {})->generation() == 6);
+
+    BOOST_REQUIRE_THROW(get_tombstone_compaction_candidate(*cf, {{ "unchecked_tombstone_compaction", "yes" }}),
+        exceptions::configuration_exception);
+
+    return make_ready_future<>();
+}
+
+SEASTAR_TEST_CASE(merged_memtable_size_is_capped) {
+    return seastar::async([] {
+        auto s = schema_builder(some_keyspace, some_column_family)
+            .with_column("p1", utf8_type, column_kind::partition_key)
+            .with_column("r1", bytes_type)
+            .build();
+        auto dir = make_lw_shared<tmpdir>();
+
+        column_family::config cfg;
+        cfg.datadir = dir->path;
+        cfg.enable_commitlog = false;
+        cfg.enable_in_memory_compaction = true;
+        cfg.max_memtable_size = 1 << 20;
+        compaction_manager cm;
+        auto cf = make_lw_shared<column_family>(s, cfg, column_family::no_commitlog(), cm);
+        column_family_test cft(cf);
+
+        // The first sealed memtable can't be flushed, so the following
+        // writes are merged into the active memtable until the cap.
+        cft.block_flushes().get();
+        std::set<memtable*> memtables;
+        auto value = bytes(1024, int8_t(0));
+        for (int i = 0; i < 8 * 1024; ++i) {
+            mutation m(partition_key::from_single_value(*s, to_bytes(sprint("key%d", i))), s);
+            m.set_clustered_cell(clustering_key::make_empty(*s), "r1", value, 1);
+            cf->apply(m);
+            memtables.insert(&cf->active_memtable());
+            BOOST_REQUIRE(cf->active_memtable().occupancy().total_space()
+                <= 3 * cfg.max_memtable_size);
+        }
+        // One memtable per cap, rather than one per max_memtable_size.
+        BOOST_REQUIRE(memtables.size() > 2);
+        BOOST_REQUIRE(memtables.size() < 8);
+
+        cft.unblock_flushes();
+        cf->stop().get();
+    });
+}
@@ -474,3 +474,180 @@ SEASTAR_TEST_CASE(broken_ranges_collection) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_clustering_slice_is_applied_by_readers) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("ck", int32_type, column_kind::clustering_key)
+            .with_column("s", bytes_type, column_kind::static_column)
+            .with_column("v", bytes_type, column_kind::regular_column)
+            .build();
+
+        auto make_ck = [&] (int ck) {
+            return clustering_key::from_single_value(*s, int32_type->decompose(ck));
+        };
+
+        mutation m(partition_key::from_single_value(*s, bytes("key1")), s);
+        m.set_static_cell("s", bytes("static"), 1);
+        for (int ck = 0; ck < 10; ++ck) {
+            m.set_clustered_cell(make_ck(ck), "v", bytes("value"), 1);
+        }
+
+        query::partition_slice slice({
+                query::clustering_range::make(
+                    { clustering_key_prefix::from_single_value(*s, int32_type->decompose(2)), true },
+                    { clustering_key_prefix::from_single_value(*s, int32_type->decompose(4)), false }),
+                query::clustering_range::make_singular(clustering_key_prefix::from_single_value(*s, int32_type->decompose(7)))
+            }, { }, { }, query::partition_slice::option_set());
+
+        mutation expected(m.schema(), m.decorated_key(), mutation_partition(m.partition(), *s, slice.row_ranges));
+        BOOST_REQUIRE_EQUAL(expected.partition().clustered_rows().size(), 3);
+        BOOST_REQUIRE(expected.partition().static_row().size());
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        auto range = query::partition_range::make_singular(m.decorated_key());
+        assert_that(mt->make_reader(range, slice))
+            .produces(expected)
+            .produces_end_of_stream();
+        assert_that(mt->make_reader(query::full_partition_range, slice))
+            .produces(expected)
+            .produces_end_of_stream();
+
+        tmpdir dir;
+        auto sst = make_lw_shared<sstables::sstable>("ks", "cf", dir.path, 1 /* generation */,
+            sstables::sstable::version_types::la, sstables::sstable::format_types::big);
+        sst->write_components(*mt).get();
+        sst->load().get();
+
+        auto key = sstables::key::from_partition_key(*s, m.key());
+        auto mo = sst->read_row(s, key, slice).get0();
+        BOOST_REQUIRE(bool(mo));
+        assert_that(*mo).is_equal_to(expected);
+
+        assert_that(as_mutation_reader(sst, sst->read_range_rows(s, query::full_partition_range, slice)))
+            .produces(expected)
+            .produces_end_of_stream();
+    });
+}
+
+SEASTAR_TEST_CASE(test_promoted_index_is_used_for_sliced_reads) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("ck1", int32_type, column_kind::clustering_key)
+            .with_column("ck2", int32_type, column_kind::clustering_key)
+            .with_column("s", bytes_type, column_kind::static_column)
+            .with_column("v", bytes_type, column_kind::regular_column)
+            .build();
+
+        auto explode = [] (std::vector<int> values) {
+            std::vector<bytes> components;
+            for (auto v : values) {
+                components.push_back(int32_type->decompose(v));
+            }
+            return components;
+        };
+        auto make_prefix = [&] (std::vector<int> values) {
+            return clustering_key_prefix::from_exploded(*s, explode(std::move(values)));
+        };
+
+        mutation m(partition_key::from_single_value(*s, bytes("key1")), s);
+        m.set_static_cell("s", bytes("static"), 1);
+        m.partition().apply_row_tombstone(*s, make_prefix({3}), tombstone(0, gc_clock::now()));
+        for (int ck1 = 0; ck1 < 10; ++ck1) {
+            for (int ck2 = 0; ck2 < 5; ++ck2) {
+                m.set_clustered_cell(clustering_key::from_exploded(*s, explode({ck1, ck2})), "v", to_bytes(sstring(64, 'v')), 1);
+            }
+        }
+
+        query::partition_slice slice({
+                query::clustering_range::make_singular(make_prefix({3})),
+                query::clustering_range::make_singular(make_prefix({7, 2}))
+            }, { }, { }, query::partition_slice::option_set());
+
+        mutation expected(m.schema(), m.decorated_key(), mutation_partition(m.partition(), *s, slice.row_ranges));
+        BOOST_REQUIRE_EQUAL(expected.partition().clustered_rows().size(), 6);
+
+        auto mt = make_lw_shared<memtable>(s);
+        mt->apply(m);
+
+        tmpdir dir;
+        auto sst = make_lw_shared<sstables::sstable>("ks", "cf", dir.path, 1 /* generation */,
+            sstables::sstable::version_types::la, sstables::sstable::format_types::big);
+        // Small enough to put every few rows into a separate block.
+        sst->set_column_index_size(256);
+        sst->write_components(*mt).get();
+        sst->load().get();
+
+        auto key = sstables::key::from_partition_key(*s, m.key());
+        auto entries = sstables::test(sst).read_indexes(0).get0();
+        BOOST_REQUIRE_EQUAL(entries.size(), 1);
+        BOOST_REQUIRE(!entries[0].get_promoted_index_bytes().empty());
+
+        auto mo = sst->read_row(s, key, slice).get0();
+        BOOST_REQUIRE(bool(mo));
+        assert_that(*mo).is_equal_to(expected);
+
+        mo = sst->read_row(s, key).get0();
+        BOOST_REQUIRE(bool(mo));
+        assert_that(*mo).is_equal_to(m);
+
+        assert_that(as_mutation_reader(sst, sst->read_rows(s)))
+            .produces(m)
+            .produces_end_of_stream();
+    });
+}
+
+SEASTAR_TEST_CASE(test_index_pages_are_cached) {
+    return seastar::async([] {
+        auto s = schema_builder("ks", "cf")
+            .with_column("pk", bytes_type, column_kind::partition_key)
+            .with_column("v", bytes_type, column_kind::regular_column)
+            .build();
+
+        auto mt = make_lw_shared<memtable>(s);
+        std::vector<mutation> mutations;
+        for (int i = 0; i < 10; ++i) {
+            mutation m(partition_key::from_single_value(*s, to_bytes(sprint("key%d", i))), s);
+            m.set_clustered_cell(clustering_key::make_empty(*s), "v", bytes("value"), 1);
+            mt->apply(m);
+            mutations.push_back(std::move(m));
+        }
+
+        tmpdir dir;
+        auto sst = make_lw_shared<sstables::sstable>("ks", "cf", dir.path, 1 /* generation */,
+            sstables::sstable::version_types::la, sstables::sstable::format_types::big);
+        sst->write_components(*mt).get();
+        sst->load().get();
+
+        auto& tracker = global_cache_tracker();
+        auto read = [&] (const mutation& m) {
+            auto mo = sst->read_row(s, sstables::key::from_partition_key(*s, m.key())).get0();
+            BOOST_REQUIRE(bool(mo));
+            assert_that(*mo).is_equal_to(m);
+        };
+
+        auto misses = tracker.index_page_misses();
+        auto hits = tracker.index_page_hits();
+        read(mutations[0]);
+        BOOST_REQUIRE_EQUAL(tracker.index_page_misses(), misses + 1);
+
+        for (auto&& m : mutations) {
+            read(m);
+        }
+        BOOST_REQUIRE_EQUAL(tracker.index_page_misses(), misses + 1);
+        BOOST_REQUIRE_EQUAL(tracker.index_page_hits(), hits + mutations.size());
+
+        // Evicted pages are read again.
+        tracker.clear();
+        read(mutations[0]);
+        BOOST_REQUIRE_EQUAL(tracker.index_page_misses(), misses + 2);
+
+        // Pages of a dead sstable are released with it.
+        sst = {};
+        tracker.clear();
+    });
+}
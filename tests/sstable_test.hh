@@ -38,7 +38,18 @@ class column_family_test {
 
     void add_sstable(sstables::sstable&& sstable) {
         auto generation = sstable.generation();
-        _cf->_sstables->emplace(generation, make_lw_shared(std::move(sstable)));
+        auto sst = make_lw_shared(std::move(sstable));
+        _cf->_compaction_strategy.notify_sstables_changed({sst}, {});
+        _cf->_sstables->emplace(generation, std::move(sst));
+    }
+
+    // Flushes wait for the sstables lock before writing.
+    future<> block_flushes() {
+        return _cf->_sstables_lock.write_lock();
+    }
+
+    void unblock_flushes() {
+        _cf->_sstables_lock.write_unlock();
     }
 };
 
@@ -130,6 +141,45 @@ class test {
         _sst->_summary.first_key.value = bytes(reinterpret_cast<const signed char*>(first_key.c_str()), first_key.size());
         _sst->_summary.last_key.value = bytes(reinterpret_cast<const signed char*>(last_key.c_str()), last_key.size());
     }
+
+    // Used to create synthetic sstables for testing time-window strategy.
+    void set_values_for_time_window_strategy(uint64_t fake_data_size, int64_t min_timestamp, int64_t max_timestamp,
+            uint32_t max_local_deletion_time = std::numeric_limits<int32_t>::max()) {
+        _sst->_data_file_size = fake_data_size;
+        stats_metadata stats = {};
+        stats.min_timestamp = min_timestamp;
+        stats.max_timestamp = max_timestamp;
+        stats.max_local_deletion_time = max_local_deletion_time;
+        _sst->_statistics.contents[metadata_type::Stats] = std::make_unique<stats_metadata>(std::move(stats));
+    }
+
+    // Used to create synthetic sstables for testing tombstone compaction.
+    // The sstable holds one cell per partition, out of which the given number
+    // of tombstones were deleted at deletion_time.
+    void set_values_for_tombstone_compaction(int64_t min_timestamp, int64_t max_timestamp, sstring first_key, sstring last_key,
+            uint64_t partitions, uint64_t tombstones, uint32_t deletion_time) {
+        _sst->_data_file_size = 1;
+        stats_metadata stats = {};
+        stats.min_timestamp = min_timestamp;
+        stats.max_timestamp = max_timestamp;
+        stats.estimated_column_count.add(1, partitions);
+        stats.estimated_tombstone_drop_time = streaming_histogram(TOMBSTONE_HISTOGRAM_BIN_SIZE);
+        stats.estimated_tombstone_drop_time.update(deletion_time, tombstones);
+        _sst->_statistics.contents[metadata_type::Stats] = std::make_unique<stats_metadata>(std::move(stats));
+        _sst->_summary.first_key.value = bytes(reinterpret_cast<const signed char*>(first_key.c_str()), first_key.size());
+        _sst->_summary.last_key.value = bytes(reinterpret_cast<const signed char*>(last_key.c_str()), last_key.size());
+    }
+
+    // Used to create synthetic sstables for testing the partition estimate
+    // of compactions.
+    void set_values_for_partition_estimate(uint64_t estimated_key_count, hll::HyperLogLog cardinality) {
+        _sst->_summary.header.min_index_interval = 1;
+        _sst->_summary.header.size_at_full_sampling = estimated_key_count - 1;
+        compaction_metadata compaction;
+        auto bytes = cardinality.get_bytes();
+        compaction.cardinality.elements.assign(bytes.get(), bytes.get() + bytes.size());
+        _sst->_statistics.contents[metadata_type::Compaction] = std::make_unique<compaction_metadata>(std::move(compaction));
+    }
 };
 
 inline future<sstable_ptr> reusable_sst(sstring dir, unsigned long generation) {
@@ -108,3 +108,17 @@ SEASTAR_TEST_CASE(test_make_local_reader) {
         });
     });
 }
+
+SEASTAR_TEST_CASE(test_range_concurrency_factor) {
+    using service::storage_proxy;
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(3, 10), 3);
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(0, 10), 1);
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(0.4, 10), 1);
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(11, 10), 10);
+
+    // Unlimited queries want more ranges than an int can count
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(std::ceil(double(query::max_rows) / 0.5), 10), 10);
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(std::round(double(query::max_rows - 1) / 0.001), 257), 257);
+    BOOST_REQUIRE_EQUAL(storage_proxy::range_concurrency_factor(std::numeric_limits<double>::infinity(), 5), 5);
+    return make_ready_future<>();
+}
@@ -0,0 +1,164 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/range/algorithm/sort.hpp>
+
+#include "tests/test-utils.hh"
+#include "tests/mutation_assertions.hh"
+#include "tests/mutation_reader_assertions.hh"
+
+#include "streamed_mutation.hh"
+#include "core/do_with.hh"
+#include "core/thread.hh"
+#include "schema_builder.hh"
+
+static schema_ptr make_schema() {
+    return schema_builder("ks", "cf")
+        .with_column("pk", bytes_type, column_kind::partition_key)
+        .with_column("ck1", bytes_type, column_kind::clustering_key)
+        .with_column("ck2", bytes_type, column_kind::clustering_key)
+        .with_column("s", bytes_type, column_kind::static_column)
+        .with_column("v", bytes_type, column_kind::regular_column)
+        .build();
+}
+
+static api::timestamp_type new_timestamp() {
+    static api::timestamp_type t = 0;
+    return t++;
+};
+
+static tombstone new_tombstone() {
+    return { new_timestamp(), gc_clock::now() };
+};
+
+static clustering_key make_ck(schema_ptr s, sstring ck1, sstring ck2) {
+    return clustering_key::from_deeply_exploded(*s, {to_bytes(ck1), to_bytes(ck2)});
+}
+
+static mutation make_wide_mutation(schema_ptr s, sstring key) {
+    mutation m(partition_key::from_single_value(*s, to_bytes(key)), s);
+    m.partition().apply(new_tombstone());
+    m.set_static_cell("s", bytes("static"), new_timestamp());
+    m.partition().apply_row_tombstone(*s, clustering_key_prefix::from_deeply_exploded(*s, {bytes("b")}), new_tombstone());
+    m.set_clustered_cell(make_ck(s, "a", "1"), "v", bytes("v1"), new_timestamp());
+    m.set_clustered_cell(make_ck(s, "b", "1"), "v", bytes("v2"), new_timestamp());
+    m.partition().apply_delete(*s, make_ck(s, "b", "2"), new_tombstone());
+    m.set_clustered_cell(make_ck(s, "c", "1"), "v", bytes("v3"), new_timestamp());
+    return m;
+}
+
+SEASTAR_TEST_CASE(test_fragments_are_ordered) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto m = make_wide_mutation(s, "key1");
+
+        auto fragments = fragment_mutation(mutation(m));
+        BOOST_REQUIRE_EQUAL(fragments.size(), 8);
+        BOOST_REQUIRE(fragments[0].is_partition_start());
+        BOOST_REQUIRE(fragments[0].as_partition_start().key().equal(*s, m.decorated_key()));
+        BOOST_REQUIRE(fragments[1].is_static_row());
+        BOOST_REQUIRE(fragments[2].is_clustering_row());
+        // The range tombstone precedes the rows it covers.
+        BOOST_REQUIRE(fragments[3].is_range_tombstone());
+        BOOST_REQUIRE(fragments[4].is_clustering_row());
+        BOOST_REQUIRE(fragments[5].is_clustering_row());
+        BOOST_REQUIRE(fragments[6].is_clustering_row());
+        BOOST_REQUIRE(fragments[7].is_partition_end());
+
+        mutation_fragment_less_compare less(*s);
+        for (unsigned i = 1; i < fragments.size(); ++i) {
+            BOOST_REQUIRE(less(fragments[i - 1], fragments[i]));
+        }
+    });
+}
+
+SEASTAR_TEST_CASE(test_fragmenting_round_trip) {
+    return seastar::async([] {
+        auto s = make_schema();
+        auto m1 = make_wide_mutation(s, "key1");
+        auto m2 = make_wide_mutation(s, "key2");
+        std::vector<mutation> ms{m1, m2};
+        boost::sort(ms, mutation_decorated_key_less_comparator());
+
+        assert_that(make_defragmenting_reader(s, make_fragmenting_reader(make_reader_returning_many(ms))))
+            .produces(ms)
+            .produces_end_of_stream();
+    });
+}
+
+SEASTAR_TEST_CASE(test_combining_streamed_readers) {
+    return seastar::async([] {
+        auto s = make_schema();
+
+        auto m1 = make_wide_mutation(s, "key1");
+        auto m2 = make_wide_mutation(s, "key1");
+        m2.set_clustered_cell(make_ck(s, "a", "1"), "v", bytes("v4"), new_timestamp());
+        m2.set_clustered_cell(make_ck(s, "a", "2"), "v", bytes("v5"), new_timestamp());
+        auto m3 = make_wide_mutation(s, "key2");
+        std::vector<mutation> ms{m2, m3};
+        boost::sort(ms, mutation_decorated_key_less_comparator());
+
+        std::vector<streamed_mutation_reader> readers;
+        readers.push_back(make_fragmenting_reader(make_reader_returning(m1)));
+        readers.push_back(make_fragmenting_reader(make_reader_returning_many(ms)));
+        readers.push_back(make_fragmenting_reader(make_empty_reader()));
+
+        std::vector<mutation_reader> mutation_readers;
+        mutation_readers.push_back(make_reader_returning(m1));
+        mutation_readers.push_back(make_reader_returning_many(ms));
+        auto expected = make_combined_reader(std::move(mutation_readers));
+
+        auto rd = make_defragmenting_reader(s, make_combined_reader(s, std::move(readers)));
+        while (auto mo = expected().get0()) {
+            auto mo2 = rd().get0();
+            BOOST_REQUIRE(bool(mo2));
+            assert_that(*mo2).is_equal_to(*mo);
+        }
+        BOOST_REQUIRE(!rd().get0());
+    });
+}
+
+SEASTAR_TEST_CASE(test_filtering_and_joining_streamed_readers) {
+    return seastar::async([] {
+        auto s = make_schema();
+        std::vector<mutation> ms{make_wide_mutation(s, "key1"), make_wide_mutation(s, "key2"), make_wide_mutation(s, "key3")};
+        boost::sort(ms, mutation_decorated_key_less_comparator());
+
+        auto rd = make_filtering_reader(make_fragmenting_reader(make_reader_returning_many(ms)), [&] (const dht::decorated_key& dk) {
+            return !dk.equal(*s, ms[1].decorated_key());
+        });
+        assert_that(make_defragmenting_reader(s, std::move(rd)))
+            .produces(ms[0])
+            .produces(ms[2])
+            .produces_end_of_stream();
+
+        std::vector<streamed_mutation_reader> readers;
+        readers.push_back(make_fragmenting_reader(make_reader_returning(ms[0])));
+        readers.push_back(make_fragmenting_reader(make_empty_reader()));
+        readers.push_back(make_fragmenting_reader(make_reader_returning_many({ms[1], ms[2]})));
+        assert_that(make_defragmenting_reader(s, make_joining_reader(std::move(readers))))
+            .produces(ms)
+            .produces_end_of_stream();
+    });
+}
@@ -0,0 +1,85 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <seastar/core/thread.hh>
+
+#include "tests/test-utils.hh"
+#include "utils/token_bucket.hh"
+
+using namespace std::chrono_literals;
+
+SEASTAR_TEST_CASE(test_take_waits_for_tokens) {
+    return seastar::async([] {
+        utils::token_bucket tb(1000);
+
+        // The bucket starts full.
+        auto start = utils::token_bucket::clock_type::now();
+        tb.take(1000).get();
+        BOOST_REQUIRE(utils::token_bucket::clock_type::now() - start < 50ms);
+
+        // 100 more tokens accumulate in 100ms.
+        start = utils::token_bucket::clock_type::now();
+        tb.take(100).get();
+        BOOST_REQUIRE(utils::token_bucket::clock_type::now() - start >= 90ms);
+    });
+}
+
+SEASTAR_TEST_CASE(test_consume_defers_takers) {
+    return seastar::async([] {
+        utils::token_bucket tb(1000);
+
+        tb.consume(1200);
+        auto start = utils::token_bucket::clock_type::now();
+        tb.take(100).get();
+        BOOST_REQUIRE(utils::token_bucket::clock_type::now() - start >= 290ms);
+    });
+}
+
+// Flushes are charged without being throttled, and may write faster than
+// the rate for a long time. Compactions must still get their turn.
+SEASTAR_TEST_CASE(test_consume_debt_is_bounded) {
+    return seastar::async([] {
+        utils::token_bucket tb(1000);
+
+        for (int i = 0; i < 100; ++i) {
+            tb.consume(10000);
+        }
+        auto start = utils::token_bucket::clock_type::now();
+        tb.take(100).get();
+        auto elapsed = utils::token_bucket::clock_type::now() - start;
+        BOOST_REQUIRE(elapsed >= 1000ms);
+        BOOST_REQUIRE(elapsed < 1300ms);
+    });
+}
+
+SEASTAR_TEST_CASE(test_unlimited_rate) {
+    return seastar::async([] {
+        utils::token_bucket tb(0);
+
+        tb.consume(1 << 30);
+        auto start = utils::token_bucket::clock_type::now();
+        tb.take(1 << 30).get();
+        BOOST_REQUIRE(utils::token_bucket::clock_type::now() - start < 50ms);
+    });
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#define BOOST_TEST_DYN_LINK
+
+#include <boost/test/unit_test.hpp>
+#include <boost/range/irange.hpp>
+#include <seastar/core/sleep.hh>
+#include <seastar/core/thread.hh>
+
+#include "tests/test-utils.hh"
+#include "db/write_admission_controller.hh"
+#include "exceptions/exceptions.hh"
+
+using namespace std::chrono_literals;
+
+static db::write_admission_controller::config make_config() {
+    db::write_admission_controller::config cfg;
+    cfg.soft_limit = 1 << 20;
+    cfg.hard_limit = 2 << 20;
+    cfg.max_delay = 1ms;
+    cfg.max_queued_writes = 50;
+    cfg.timeout = 100ms;
+    return cfg;
+}
+
+SEASTAR_TEST_CASE(test_writes_are_admitted_according_to_dirty_memory) {
+    return seastar::async([] {
+        size_t used = 0;
+        db::write_admission_controller wac(make_config(), [&used] { return used; });
+
+        wac.admit(4096).get();
+        BOOST_REQUIRE_EQUAL(wac.get_stats().delayed, 0);
+
+        used = 3 << 19;
+        wac.admit(4096).get();
+        BOOST_REQUIRE_EQUAL(wac.get_stats().delayed, 1);
+
+        used = 2 << 20;
+        auto f1 = wac.admit(4096);
+        auto f2 = wac.admit(4096);
+        BOOST_REQUIRE_EQUAL(wac.queued_writes(), 2);
+
+        // Only as many writes as fit in the released memory are admitted.
+        used = (2 << 20) - 4096;
+        wac.on_memory_released();
+        f1.get();
+        BOOST_REQUIRE_EQUAL(wac.queued_writes(), 1);
+
+        used = 0;
+        wac.on_memory_released();
+        f2.get();
+        BOOST_REQUIRE_EQUAL(wac.queued_writes(), 0);
+        BOOST_REQUIRE_EQUAL(wac.get_stats().queued, 2);
+    });
+}
+
+SEASTAR_TEST_CASE(test_queued_writes_time_out) {
+    return seastar::async([] {
+        size_t used = 2 << 20;
+        db::write_admission_controller wac(make_config(), [&used] { return used; });
+
+        try {
+            wac.admit(4096).get();
+            BOOST_FAIL("write should have been rejected");
+        } catch (exceptions::overloaded_exception&) {
+            // expected
+        }
+        BOOST_REQUIRE_EQUAL(wac.get_stats().rejected, 1);
+        BOOST_REQUIRE_EQUAL(wac.queued_writes(), 0);
+    });
+}
+
+// Writers produce dirty memory much faster than it is flushed.
+SEASTAR_TEST_CASE(test_sustained_overload) {
+    return seastar::async([] {
+        auto cfg = make_config();
+        size_t used = 0;
+        size_t peak = 0;
+        db::write_admission_controller wac(cfg, [&used] { return used; });
+
+        const size_t write_size = 4096;
+        const int concurrency = 100;
+
+        timer<> flusher([&] {
+            used -= std::min(used, size_t(64 << 10));
+            wac.on_memory_released();
+        });
+        flusher.arm_periodic(1ms);
+
+        uint64_t admitted = 0;
+        uint64_t rejected = 0;
+        auto stop_at = std::chrono::steady_clock::now() + 500ms;
+        parallel_for_each(boost::irange(0, concurrency), [&] (int) {
+            return do_until([&] { return std::chrono::steady_clock::now() >= stop_at; }, [&] {
+                return wac.admit(write_size).then_wrapped([&] (future<> f) {
+                    try {
+                        f.get();
+                        ++admitted;
+                        used += write_size;
+                        peak = std::max(peak, used);
+                        return make_ready_future<>();
+                    } catch (exceptions::overloaded_exception&) {
+                        ++rejected;
+                        return sleep(1ms);
+                    }
+                });
+            });
+        }).get();
+        flusher.cancel();
+
+        BOOST_MESSAGE(sprint("admitted: %d, rejected: %d, delayed: %d, queued: %d, peak: %d",
+            admitted, rejected, wac.get_stats().delayed, wac.get_stats().queued, peak));
+
+        BOOST_REQUIRE(admitted > 0);
+        BOOST_REQUIRE(wac.get_stats().delayed > 0);
+        BOOST_REQUIRE(wac.get_stats().queued > 0);
+        BOOST_REQUIRE_EQUAL(wac.get_stats().rejected, rejected);
+        BOOST_REQUIRE(wac.get_stats().wait_time.count > 0);
+        BOOST_REQUIRE_EQUAL(wac.queued_writes(), 0);
+        // Writes which were delayed below the hard limit may complete after
+        // it was reached, but no more than one per writer.
+        BOOST_REQUIRE(peak <= cfg.hard_limit + concurrency * write_size);
+    });
+}
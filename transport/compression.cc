@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2015 Cloudius Systems, Ltd.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "transport/compression.hh"
+#include "exceptions/exceptions.hh"
+#include "core/print.hh"
+
+#include <lz4.h>
+#include <snappy-c.h>
+
+namespace transport {
+
+// Same limit as Origin's native_transport_max_frame_size_in_mb, guards
+// against allocating huge buffers for corrupted length prefixes.
+static constexpr size_t max_uncompressed_size = 256 * 1024 * 1024;
+
+cql_compression parse_compression(const sstring& name) {
+    if (name == "lz4") {
+        return cql_compression::lz4;
+    } else if (name == "snappy") {
+        return cql_compression::snappy;
+    }
+    throw exceptions::protocol_exception(sprint("Unknown compression algorithm: %s", name));
+}
+
+static size_t compress_lz4(const char* in, size_t in_len, std::vector<char>& out) {
+    out.resize(4 + LZ4_compressBound(in_len));
+    out[0] = (in_len >> 24) & 0xFF;
+    out[1] = (in_len >> 16) & 0xFF;
+    out[2] = (in_len >> 8) & 0xFF;
+    out[3] = in_len & 0xFF;
+    auto ret = LZ4_compress(in, out.data() + 4, in_len);
+    if (ret == 0) {
+        throw std::runtime_error("CQL frame LZ4 compression failure");
+    }
+    return ret + 4;
+}
+
+static size_t compress_snappy(const char* in, size_t in_len, std::vector<char>& out) {
+    size_t out_len = snappy_max_compressed_length(in_len);
+    out.resize(out_len);
+    if (snappy_compress(in, in_len, out.data(), &out_len) != SNAPPY_OK) {
+        throw std::runtime_error("CQL frame snappy compression failure");
+    }
+    return out_len;
+}
+
+size_t compress_body(cql_compression c, const char* in, size_t in_len, std::vector<char>& out) {
+    switch (c) {
+    case cql_compression::lz4:
+        return compress_lz4(in, in_len, out);
+    case cql_compression::snappy:
+        return compress_snappy(in, in_len, out);
+    case cql_compression::none:
+        break;
+    }
+    throw std::invalid_argument("no compression algorithm");
+}
+
+static temporary_buffer<char> uncompress_lz4(const temporary_buffer<char>& in) {
+    if (in.size() < 4) {
+        throw exceptions::protocol_exception("truncated LZ4 compressed frame");
+    }
+    auto p = reinterpret_cast<const uint8_t*>(in.get());
+    size_t out_len = (static_cast<uint32_t>(p[0]) << 24)
+                   | (static_cast<uint32_t>(p[1]) << 16)
+                   | (static_cast<uint32_t>(p[2]) << 8)
+                   | (static_cast<uint32_t>(p[3]));
+    if (out_len > max_uncompressed_size) {
+        throw exceptions::protocol_exception(sprint("LZ4 compressed frame too large: %d", out_len));
+    }
+    temporary_buffer<char> out(out_len);
+    auto ret = LZ4_decompress_safe(in.get() + 4, out.get_write(), in.size() - 4, out_len);
+    if (ret < 0 || size_t(ret) != out_len) {
+        throw exceptions::protocol_exception("Corrupt LZ4 compressed frame");
+    }
+    return out;
+}
+
+static temporary_buffer<char> uncompress_snappy(const temporary_buffer<char>& in) {
+    size_t out_len;
+    if (snappy_uncompressed_length(in.get(), in.size(), &out_len) != SNAPPY_OK || out_len > max_uncompressed_size) {
+        throw exceptions::protocol_exception("Corrupt snappy compressed frame");
+    }
+    temporary_buffer<char> out(out_len);
+    if (snappy_uncompress(in.get(), in.size(), out.get_write(), &out_len) != SNAPPY_OK) {
+        throw exceptions::protocol_exception("Corrupt snappy compressed frame");
+    }
+    out.trim(out_len);
+    return out;
+}
+
+temporary_buffer<char> uncompress_body(cql_compression c, const temporary_buffer<char>& in) {
+    switch (c) {
+    case cql_compression::lz4:
+        return uncompress_lz4(in);
+    case cql_compression::snappy:
+        return uncompress_snappy(in);
+    case cql_compression::none:
+        break;
+    }
+    throw exceptions::protocol_exception("Compressed frame received but no compression was negotiated in STARTUP");
+}
+
+}
@@ -0,0 +1,48 @@
+/*
+ * Copyright (C) 2015 Cloudius Systems, Ltd.
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include "core/sstring.hh"
+#include "core/temporary_buffer.hh"
+#include <vector>
+
+namespace transport {
+
+// Compression of CQL frame bodies, negotiated with the COMPRESSION option
+// of the STARTUP message.
+//
+// LZ4 bodies are prefixed with their uncompressed length as a 4 bytes
+// big-endian integer, snappy bodies are raw snappy blocks.
+enum class cql_compression { none, lz4, snappy };
+
+// Parses the value of the COMPRESSION option of a STARTUP message.
+cql_compression parse_compression(const sstring& name);
+
+// Compresses a frame body into "out". The buffer is resized as needed, so
+// reusing it for all responses of a connection avoids reallocating it.
+// Returns the size of the compressed body.
+size_t compress_body(cql_compression c, const char* in, size_t in_len, std::vector<char>& out);
+
+// Uncompresses the body of a request frame.
+temporary_buffer<char> uncompress_body(cql_compression c, const temporary_buffer<char>& in);
+
+}
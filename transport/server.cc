@@ -58,6 +58,10 @@ struct cql_frame_error : std::exception {
     }
 };
 
+enum cql_frame_flags {
+    compression = 0x01,
+};
+
 enum class cql_binary_opcode : uint8_t {
     ERROR          = 0,
     STARTUP        = 1,
@@ -168,6 +172,9 @@ class cql_server::response {
     int16_t           _stream;
     cql_binary_opcode _opcode;
     std::vector<char> _body;
+    // Sent after _body without copying them, see write_fragments()
+    std::vector<bytes_view> _fragments;
+    shared_ptr<messages::result_message> _result;
 public:
     response(int16_t stream, cql_binary_opcode opcode)
         : _stream{stream}
@@ -193,9 +200,13 @@ class cql_server::response {
     void write_string_multimap(std::multimap<sstring, sstring> string_map);
     void write_value(bytes_opt value);
     void write(const cql3::metadata& m);
-    future<> output(output_stream<char>& out, uint8_t version);
+    void write_fragments(const bytes_ostream& buf, size_t size);
+    void hold(shared_ptr<messages::result_message> result) {
+        _result = std::move(result);
+    }
+    future<> output(output_stream<char>& out, uint8_t version, cql_compression compression, std::vector<char>& compression_buffer);
 private:
-    sstring make_frame(uint8_t version, size_t length);
+    sstring make_frame(uint8_t version, size_t length, uint8_t flags = 0);
 };
 
 cql_server::cql_server(distributed<service::storage_proxy>& proxy, distributed<cql3::query_processor>& qp)
@@ -436,15 +447,14 @@ future<> cql_server::connection::process_request() {
 
         auto& f = *maybe_frame;
 
-        // FIXME: compression
-        if (f.flags & 0x01) {
-            throw std::runtime_error("CQL frame compression is not supported");
-        }
-
         auto op = f.opcode;
         auto stream = f.stream;
+        auto flags = f.flags;
 
-        return _read_buf.read_exactly(f.length).then([this, op, stream] (temporary_buffer<char> buf) {
+        return _read_buf.read_exactly(f.length).then([this, op, stream, flags] (temporary_buffer<char> buf) {
+            if (flags & cql_frame_flags::compression) {
+                buf = uncompress_body(_compression, buf);
+            }
 
             ++_server._requests_served;
             ++_server._requests_serving;
@@ -465,8 +475,16 @@ future<> cql_server::connection::process_request() {
 
 future<> cql_server::connection::process_startup(uint16_t stream, temporary_buffer<char> buf)
 {
-    /*auto string_map =*/ read_string_map(buf);
-    return write_ready(stream);
+    auto options = read_string_map(buf);
+    auto compression = cql_compression::none;
+    auto i = options.find("COMPRESSION");
+    if (i != options.end()) {
+        compression = parse_compression(i->second);
+    }
+    auto f = write_ready(stream);
+    // READY itself is not compressed
+    _compression = compression;
+    return f;
 }
 
 future<> cql_server::connection::process_auth_response(uint16_t stream, temporary_buffer<char> buf)
@@ -704,6 +722,7 @@ future<> cql_server::connection::write_supported(int16_t stream)
 {
     std::multimap<sstring, sstring> opts;
     opts.insert({"CQL_VERSION", cql3::query_processor::CQL_VERSION});
+    opts.insert({"COMPRESSION", "lz4"});
     opts.insert({"COMPRESSION", "snappy"});
     auto response = make_shared<cql_server::response>(stream, cql_binary_opcode::SUPPORTED);
     response->write_string_multimap(opts);
@@ -763,6 +782,10 @@ class cql_server::fmt_visitor : public messages::result_message::visitor {
         auto& rs = m.rs();
         _response->write(rs.get_metadata());
         _response->write_int(rs.size());
+        if (auto rows = rs.serialized_rows()) {
+            _response->write_fragments(*rows, rs.serialized_rows_size());
+            return;
+        }
         for (auto&& row : rs.rows()) {
             for (auto&& cell : row | boost::adaptors::sliced(0, rs.get_metadata().column_count())) {
                 _response->write_value(cell);
@@ -776,6 +799,8 @@ future<> cql_server::connection::write_result(int16_t stream, shared_ptr<message
     auto response = make_shared<cql_server::response>(stream, cql_binary_opcode::RESULT);
     fmt_visitor fmt{_version, response};
     msg->accept(fmt);
+    // The rows may be sent straight from the query results
+    response->hold(std::move(msg));
     return write_response(response);
 }
 
@@ -807,8 +832,10 @@ future<> cql_server::connection::write_schema_change_event(const event::schema_c
 
 future<> cql_server::connection::write_response(shared_ptr<cql_server::response> response)
 {
-    _ready_to_respond = _ready_to_respond.then([this, response = std::move(response)] () mutable {
-        return response->output(_write_buf, _version).then([this, response] {
+    // The compression in effect when the response is created applies to it
+    auto compression = _compression;
+    _ready_to_respond = _ready_to_respond.then([this, compression, response = std::move(response)] () mutable {
+        return response->output(_write_buf, _version, compression, _compression_buffer).then([this, response] {
             return _write_buf.flush();
         });
     });
@@ -1080,20 +1107,50 @@ bytes_view_opt cql_server::connection::read_value_view(temporary_buffer<char>& b
 scattered_message<char> cql_server::response::make_message(uint8_t version) {
     scattered_message<char> msg;
     sstring body{_body.data(), _body.size()};
-    sstring frame = make_frame(version, body.size());
+    auto length = body.size();
+    for (auto&& f : _fragments) {
+        length += f.size();
+    }
+    sstring frame = make_frame(version, length);
     msg.append(std::move(frame));
     msg.append(std::move(body));
+    for (auto&& f : _fragments) {
+        msg.append_static(reinterpret_cast<const char*>(f.data()), f.size());
+    }
+    if (!_fragments.empty()) {
+        msg.on_delete([result = _result] {});
+    }
     return msg;
 }
 
 future<>
-cql_server::response::output(output_stream<char>& out, uint8_t version) {
-    auto frame = make_frame(version, _body.size());
+cql_server::response::output(output_stream<char>& out, uint8_t version, cql_compression compression, std::vector<char>& compression_buffer) {
+    if (!_fragments.empty()) {
+        if (compression == cql_compression::none) {
+            // The stream is flushed after each response, so the zero-copy
+            // write is never mixed with buffered data.
+            return out.write(make_message(version));
+        }
+        // The compressor needs the body in one piece
+        for (auto&& f : _fragments) {
+            _body.insert(_body.end(), f.begin(), f.end());
+        }
+        _fragments.clear();
+    }
+    const char* body = _body.data();
+    size_t body_size = _body.size();
+    uint8_t flags = 0;
+    if (compression != cql_compression::none && body_size) {
+        body_size = compress_body(compression, body, body_size, compression_buffer);
+        body = compression_buffer.data();
+        flags |= cql_frame_flags::compression;
+    }
+    auto frame = make_frame(version, body_size, flags);
     auto tmp = temporary_buffer<char>(frame.size());
     std::copy_n(frame.begin(), frame.size(), tmp.get_write());
     auto f = out.write(tmp.get(), tmp.size());
-    return f.then([this, &out, tmp = std::move(tmp)] {
-        return out.write(_body.data(), _body.size());
+    return f.then([&out, body, body_size, tmp = std::move(tmp)] {
+        return out.write(body, body_size);
     });
 }
 
@@ -1125,7 +1182,7 @@ void cql_server::response::serialize(const event::schema_change& event, uint8_t
     }
 }
 
-sstring cql_server::response::make_frame(uint8_t version, size_t length)
+sstring cql_server::response::make_frame(uint8_t version, size_t length, uint8_t flags)
 {
     switch (version) {
     case 0x01:
@@ -1133,7 +1190,7 @@ sstring cql_server::response::make_frame(uint8_t version, size_t length)
         sstring frame_buf(sstring::initialized_later(), sizeof(cql_binary_frame_v1));
         auto* frame = reinterpret_cast<cql_binary_frame_v1*>(frame_buf.begin());
         frame->version = version | 0x80;
-        frame->flags   = 0x00;
+        frame->flags   = flags;
         frame->stream  = _stream;
         frame->opcode  = static_cast<uint8_t>(_opcode);
         frame->length  = htonl(length);
@@ -1144,7 +1201,7 @@ sstring cql_server::response::make_frame(uint8_t version, size_t length)
         sstring frame_buf(sstring::initialized_later(), sizeof(cql_binary_frame_v3));
         auto* frame = reinterpret_cast<cql_binary_frame_v3*>(frame_buf.begin());
         frame->version = version | 0x80;
-        frame->flags   = 0x00;
+        frame->flags   = flags;
         frame->stream  = htons(_stream);
         frame->opcode  = static_cast<uint8_t>(_opcode);
         frame->length  = htonl(length);
@@ -1291,6 +1348,18 @@ void cql_server::response::write_value(bytes_opt value)
     _body.insert(_body.end(), value->begin(), value->end());
 }
 
+void cql_server::response::write_fragments(const bytes_ostream& buf, size_t size)
+{
+    for (bytes_view f : buf.fragments()) {
+        if (!size) {
+            break;
+        }
+        f = f.substr(0, size);
+        size -= f.size();
+        _fragments.push_back(f);
+    }
+}
+
 class type_codec {
 private:
     enum class type_id : int16_t {
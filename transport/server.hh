@@ -26,6 +26,7 @@
 #include "service/migration_listener.hh"
 #include "service/storage_proxy.hh"
 #include "cql3/query_processor.hh"
+#include "transport/compression.hh"
 #include "core/distributed.hh"
 #include <memory>
 
@@ -150,6 +151,10 @@ class cql_server::connection {
     serialization_format _serialization_format = serialization_format::use_16_bit();
     service::client_state _client_state;
     std::unordered_map<uint16_t, cql_query_state> _query_states;
+    cql_compression _compression = cql_compression::none;
+    // Holds compressed response bodies. Responses are written one at a
+    // time, so a single buffer is reused by all of them.
+    std::vector<char> _compression_buffer;
 public:
     connection(cql_server& server, connected_socket&& fd, socket_address addr);
     ~connection();
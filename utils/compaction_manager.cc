@@ -21,6 +21,7 @@
 
 #include "compaction_manager.hh"
 #include "database.hh"
+#include "sstables/compaction.hh"
 #include "core/scollectd.hh"
 
 static logging::logger cmlog("compaction_manager");
@@ -42,9 +43,7 @@ void compaction_manager::task_start(lw_shared_ptr<compaction_manager::task>& tas
                 // Get a column family from the shared queue if and only
                 // if, the previous compaction job succeeded.
                 if (!task->compacting_cf) {
-                    task->compacting_cf = _cfs_to_compact.front();
-                    _cfs_to_compact.pop_front();
-                    _stats.pending_tasks--;
+                    task->compacting_cf = pick_column_family();
                 }
 
                 _stats.active_tasks++;
@@ -54,14 +53,12 @@ void compaction_manager::task_start(lw_shared_ptr<compaction_manager::task>& tas
                     task->compaction_retry.reset();
 
                     // Re-schedule compaction for compacting_cf, if needed.
-                    if (task->compacting_cf->pending_compactions()) {
-                        // If there are pending compactions for compacting cf,
-                        // push it into the back of the queue.
+                    // It may have been queued again meanwhile, in which case
+                    // some task was already signalled.
+                    if (task->compacting_cf->pending_compactions() && !task->compacting_cf->compaction_manager_queued()) {
+                        task->compacting_cf->set_compaction_manager_queued(true);
                         add_column_family(task->compacting_cf);
                         task->compaction_sem.signal();
-                    } else {
-                        // If so, cf is no longer queued by compaction manager.
-                        task->compacting_cf->set_compaction_manager_queued(false);
                     }
                     task->compacting_cf = nullptr;
 
@@ -95,7 +92,10 @@ void compaction_manager::task_start(lw_shared_ptr<compaction_manager::task>& tas
                 return task->compaction_retry.retry().then([this, task] {
                     // pushing cf to the back, so if the error is persistent,
                     // at least the others get a chance.
-                    add_column_family(task->compacting_cf);
+                    if (!task->compacting_cf->compaction_manager_queued()) {
+                        task->compacting_cf->set_compaction_manager_queued(true);
+                        add_column_family(task->compacting_cf);
+                    }
                     task->compacting_cf = nullptr;
 
                     // after sleeping, signal semaphore for the next compaction attempt.
@@ -135,6 +135,28 @@ void compaction_manager::add_column_family(column_family* cf) {
     _stats.pending_tasks++;
 }
 
+column_family* compaction_manager::pick_column_family() {
+    auto it = std::max_element(_cfs_to_compact.begin(), _cfs_to_compact.end(), [] (column_family* a, column_family* b) {
+        return a->sstables_count() < b->sstables_count();
+    });
+    auto cf = *it;
+    _cfs_to_compact.erase(it);
+    _stats.pending_tasks--;
+    // Once it's out of the queue, the column family may be queued again, so
+    // that another task compacts other sstables of it concurrently.
+    cf->set_compaction_manager_queued(false);
+    return cf;
+}
+
+void compaction_manager::register_compaction(lw_shared_ptr<sstables::compaction_info> info) {
+    _compactions.push_back(std::move(info));
+}
+
+void compaction_manager::deregister_compaction(lw_shared_ptr<sstables::compaction_info> info) {
+    _compactions.remove(info);
+    _stats.bytes_compacted += info->written_bytes;
+}
+
 compaction_manager::compaction_manager() = default;
 
 compaction_manager::~compaction_manager() {
@@ -153,6 +175,7 @@ void compaction_manager::register_collectd_metrics() {
     };
 
     add("objects", "compactions", scollectd::data_type::GAUGE, [&] { return _stats.active_tasks; });
+    add("total_bytes", "compacted", scollectd::data_type::DERIVE, [&] { return _stats.bytes_compacted; });
 }
 
 void compaction_manager::start(int task_nr) {
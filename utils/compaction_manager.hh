@@ -27,22 +27,36 @@
 #include "core/gate.hh"
 #include "log.hh"
 #include "utils/exponential_backoff_retry.hh"
+#include "utils/token_bucket.hh"
 #include <deque>
 #include <vector>
+#include <list>
 #include <functional>
 
 class column_family;
 
+namespace sstables {
+struct compaction_info;
+}
+
 // Compaction manager is a feature used to manage compaction jobs from multiple
 // column families pertaining to the same database.
 // For each compaction job handler, there will be one fiber that will check for
-// jobs, and if any, run it. FIFO ordering is implemented here.
+// jobs, and if any, run it. Column families with the most sstables are
+// compacted first. Several fibers may compact the same column family, as long
+// as they compact different sstables.
+//
+// Compactions and memtable flushes share a disk bandwidth budget: compaction
+// writes wait for it, while flushes are only charged against it, so that
+// compactions back off when memtables are being flushed.
 class compaction_manager {
 public:
     struct stats {
         int64_t pending_tasks = 0;
         int64_t completed_tasks = 0;
         uint64_t active_tasks = 0; // Number of compaction going on.
+        // Bytes written by compactions which completed.
+        int64_t bytes_compacted = 0;
     };
 private:
     struct task {
@@ -66,11 +80,16 @@ class compaction_manager {
 
     stats _stats;
     std::vector<scollectd::registration> _registrations;
+
+    std::list<lw_shared_ptr<sstables::compaction_info>> _compactions;
+    utils::token_bucket _throughput_limiter;
 private:
     void task_start(lw_shared_ptr<task>& task);
     future<> task_stop(lw_shared_ptr<task>& task);
 
     void add_column_family(column_family* cf);
+    // Removes the queued column family with the most sstables from the queue.
+    column_family* pick_column_family();
 public:
     compaction_manager();
     ~compaction_manager();
@@ -94,5 +113,29 @@ class compaction_manager {
     const stats& get_stats() const {
         return _stats;
     }
+
+    // Sets the disk bandwidth budget of compactions, in bytes per second.
+    // 0 means unlimited.
+    void set_compaction_throughput(uint64_t bytes_per_second) {
+        _throughput_limiter.set_rate(bytes_per_second);
+    }
+
+    // Resolves when a compaction may write bytes more bytes.
+    future<> throttle_compaction(uint64_t bytes) {
+        return _throughput_limiter.take(bytes);
+    }
+
+    // Charges bytes written by a memtable flush against the budget.
+    void charge_flush(uint64_t bytes) {
+        _throughput_limiter.consume(bytes);
+    }
+
+    void register_compaction(lw_shared_ptr<sstables::compaction_info> info);
+    void deregister_compaction(lw_shared_ptr<sstables::compaction_info> info);
+
+    // Running compactions.
+    const std::list<lw_shared_ptr<sstables::compaction_info>>& get_compactions() const {
+        return _compactions;
+    }
 };
 
@@ -0,0 +1,67 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <cstdint>
+#include <boost/intrusive/list.hpp>
+
+// Base class of objects which are linked into cache_tracker's LRU.
+//
+// Objects of different types share a single LRU, so that eviction order
+// reflects recency of use regardless of what is being cached. The type is
+// needed to dispose an entry when it is evicted. It is recorded in the
+// entry instead of using a virtual destructor, which keeps entries smaller.
+class lru_entry {
+public:
+    enum class kind : uint8_t {
+        partition,
+        clustering_range,
+        index_page,
+    };
+    using lru_link_type = boost::intrusive::list_member_hook<boost::intrusive::link_mode<boost::intrusive::auto_unlink>>;
+protected:
+    lru_link_type _lru_link;
+private:
+    kind _kind;
+public:
+    explicit lru_entry(kind k) noexcept : _kind(k) { }
+    // Takes over the position of o in the LRU.
+    lru_entry(lru_entry&& o) noexcept;
+
+    kind lru_kind() const { return _kind; }
+
+    using lru_type = boost::intrusive::list<lru_entry,
+        boost::intrusive::member_hook<lru_entry, lru_link_type, &lru_entry::_lru_link>,
+        boost::intrusive::constant_time_size<false>>; // we need this to have bi::auto_unlink on hooks.
+};
+
+inline
+lru_entry::lru_entry(lru_entry&& o) noexcept
+    : _lru_link()
+    , _kind(o._kind)
+{
+    if (o._lru_link.is_linked()) {
+        auto prev = o._lru_link.prev_;
+        o._lru_link.unlink();
+        lru_type::node_algorithms::link_after(prev, _lru_link.this_ptr());
+    }
+}
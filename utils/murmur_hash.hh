@@ -40,6 +40,7 @@
 
 #include <cstdint>
 #include <array>
+#include <algorithm>
 
 #include "bytes.hh"
 
@@ -167,6 +168,103 @@ void hash3_x64_128(InputIterator in, uint32_t length, uint64_t seed, std::array<
 
 void hash3_x64_128(bytes_view key, uint64_t seed, std::array<uint64_t, 2>& result);
 
+// Incremental version of hash3_x64_128(). Feeding data in any number of
+// pieces yields the same hash as hashing it all at once.
+class hasher3_x64_128 {
+    static constexpr uint64_t c1 = 0x87c37b91114253d5L;
+    static constexpr uint64_t c2 = 0x4cf5ad432745937fL;
+    uint64_t _h1;
+    uint64_t _h2;
+    uint64_t _length = 0;
+    // Bytes of an incomplete block
+    int8_t _tail[16];
+    size_t _tail_size = 0;
+private:
+    void process_block(const int8_t* in) {
+        uint64_t k1 = read_block(in);
+        uint64_t k2 = read_block(in);
+
+        k1 *= c1; k1 = rotl64(k1,31); k1 *= c2; _h1 ^= k1;
+
+        _h1 = rotl64(_h1,27); _h1 += _h2; _h1 = _h1*5+0x52dce729;
+
+        k2 *= c2; k2  = rotl64(k2,33); k2 *= c1; _h2 ^= k2;
+
+        _h2 = rotl64(_h2,31); _h2 += _h1; _h2 = _h2*5+0x38495ab5;
+    }
+public:
+    explicit hasher3_x64_128(uint64_t seed = 0)
+        : _h1(seed)
+        , _h2(seed)
+    { }
+
+    void update(bytes_view data) {
+        _length += data.size();
+        auto in = data.begin();
+        auto n = data.size();
+        if (_tail_size) {
+            auto fill = std::min(n, sizeof(_tail) - _tail_size);
+            std::copy_n(in, fill, _tail + _tail_size);
+            _tail_size += fill;
+            in += fill;
+            n -= fill;
+            if (_tail_size < sizeof(_tail)) {
+                return;
+            }
+            process_block(_tail);
+            _tail_size = 0;
+        }
+        for (; n >= sizeof(_tail); n -= sizeof(_tail), in += sizeof(_tail)) {
+            process_block(in);
+        }
+        std::copy_n(in, n, _tail);
+        _tail_size = n;
+    }
+
+    std::array<uint64_t, 2> finalize() const {
+        uint64_t h1 = _h1;
+        uint64_t h2 = _h2;
+        uint64_t k1 = 0;
+        uint64_t k2 = 0;
+        auto& tmp = _tail;
+
+        switch(_tail_size)
+        {
+            case 15: k2 ^= ((uint64_t) tmp[14]) << 48;
+            case 14: k2 ^= ((uint64_t) tmp[13]) << 40;
+            case 13: k2 ^= ((uint64_t) tmp[12]) << 32;
+            case 12: k2 ^= ((uint64_t) tmp[11]) << 24;
+            case 11: k2 ^= ((uint64_t) tmp[10]) << 16;
+            case 10: k2 ^= ((uint64_t) tmp[9]) << 8;
+            case  9: k2 ^= ((uint64_t) tmp[8]) << 0;
+                k2 *= c2; k2  = rotl64(k2,33); k2 *= c1; h2 ^= k2;
+            case  8: k1 ^= ((uint64_t) tmp[7]) << 56;
+            case  7: k1 ^= ((uint64_t) tmp[6]) << 48;
+            case  6: k1 ^= ((uint64_t) tmp[5]) << 40;
+            case  5: k1 ^= ((uint64_t) tmp[4]) << 32;
+            case  4: k1 ^= ((uint64_t) tmp[3]) << 24;
+            case  3: k1 ^= ((uint64_t) tmp[2]) << 16;
+            case  2: k1 ^= ((uint64_t) tmp[1]) << 8;
+            case  1: k1 ^= ((uint64_t) tmp[0]);
+                k1 *= c1; k1  = rotl64(k1,31); k1 *= c2; h1 ^= k1;
+        };
+
+        h1 ^= _length;
+        h2 ^= _length;
+
+        h1 += h2;
+        h2 += h1;
+
+        h1 = fmix(h1);
+        h2 = fmix(h2);
+
+        h1 += h2;
+        h2 += h1;
+
+        return { h1, h2 };
+    }
+};
+
 } // namespace murmur_hash
 
 } // namespace utils
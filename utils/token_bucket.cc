@@ -0,0 +1,71 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "token_bucket.hh"
+#include "core/sleep.hh"
+
+namespace utils {
+
+token_bucket::token_bucket(uint64_t rate)
+    : _rate(rate)
+    , _tokens(rate)
+    , _last_refill(clock_type::now())
+{ }
+
+void token_bucket::refill() {
+    auto now = clock_type::now();
+    auto elapsed = std::chrono::duration<double>(now - _last_refill).count();
+    _tokens = std::min(_rate, _tokens + elapsed * _rate);
+    _last_refill = now;
+}
+
+void token_bucket::set_rate(uint64_t rate) {
+    refill();
+    _rate = rate;
+    _tokens = std::min(_tokens, _rate);
+}
+
+future<> token_bucket::take(uint64_t n) {
+    if (!_rate) {
+        return make_ready_future<>();
+    }
+    refill();
+    // Tokens are reserved right away, so that concurrent takers queue
+    // behind each other.
+    _tokens -= n;
+    if (_tokens >= 0) {
+        return make_ready_future<>();
+    }
+    auto delay = std::chrono::duration<double>(-_tokens / _rate);
+    return sleep(std::chrono::duration_cast<std::chrono::microseconds>(delay));
+}
+
+void token_bucket::consume(uint64_t n) {
+    if (!_rate) {
+        return;
+    }
+    refill();
+    // Debt is limited to one second worth of tokens, so that consumers
+    // which outpace the rate can't defer takers indefinitely.
+    _tokens = std::max(_tokens - n, -_rate);
+}
+
+}
@@ -0,0 +1,65 @@
+/*
+ * Copyright 2015 Cloudius Systems
+ */
+
+/*
+ * This file is part of Scylla.
+ *
+ * Scylla is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU Affero General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * Scylla is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with Scylla.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#pragma once
+
+#include <chrono>
+#include "core/future.hh"
+
+namespace utils {
+
+/**
+ * Limits the rate at which a resource, e.g. disk bandwidth, is used.
+ *
+ * Tokens accumulate at a fixed rate, up to one second worth of them. Users
+ * which can be slowed down take tokens with take(), which defers them until
+ * enough tokens accumulated. Users which must not wait are charged with
+ * consume(), which may put the bucket in debt and so defers the former, by
+ * at most one second.
+ *
+ * A rate of 0 means unlimited.
+ */
+class token_bucket {
+public:
+    using clock_type = std::chrono::steady_clock;
+private:
+    double _rate;
+    double _tokens;
+    clock_type::time_point _last_refill;
+
+    void refill();
+public:
+    explicit token_bucket(uint64_t rate = 0);
+
+    void set_rate(uint64_t rate);
+    uint64_t rate() const {
+        return _rate;
+    }
+
+    // Resolves once n tokens were taken.
+    future<> take(uint64_t n);
+
+    // Takes n tokens right away, even if they aren't available yet. The debt
+    // is capped at one second worth of tokens.
+    void consume(uint64_t n);
+};
+
+}